@@ -0,0 +1,206 @@
+#include "calculator.hpp"
+#include "expression.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace {
+
+// Deterministic operands with a mix of signs and magnitudes.
+template <class T> auto makeValues(std::size_t count, unsigned seed) {
+  std::vector<T> values(count);
+  std::uint32_t state = seed;
+  for (T &value : values) {
+    state = state * 1'664'525U + 1'013'904'223U;
+    value = static_cast<T>(static_cast<std::int32_t>(state) >> 8);
+  }
+  return values;
+}
+
+void scalarOperations(benchmark::State &state) {
+  int lhs = 12'345;
+  int rhs = 678;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lhs);
+    benchmark::DoNotOptimize(rhs);
+    benchmark::DoNotOptimize(Calculator::add(lhs, rhs));
+    benchmark::DoNotOptimize(Calculator::subtract(lhs, rhs));
+    benchmark::DoNotOptimize(Calculator::multiply(lhs, rhs));
+  }
+  state.SetItemsProcessed(state.iterations() * 3);
+}
+BENCHMARK(scalarOperations);
+
+template <Operation Op> void batchApply(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto lhs = makeValues<int>(count, 1);
+  const auto rhs = makeValues<int>(count, 2);
+  std::vector<int> out(count);
+  for (auto _ : state) {
+    Calculator::apply(Op, lhs, rhs, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 3 *
+                          static_cast<std::int64_t>(sizeof(int)));
+}
+BENCHMARK(batchApply<Operation::Add>)->RangeMultiplier(16)->Range(64, 1 << 20);
+BENCHMARK(batchApply<Operation::Subtract>)
+    ->RangeMultiplier(16)
+    ->Range(64, 1 << 20);
+BENCHMARK(batchApply<Operation::Multiply>)
+    ->RangeMultiplier(16)
+    ->Range(64, 1 << 20);
+
+void batchChecked(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto lhs = makeValues<int>(count, 3);
+  const auto rhs = makeValues<int>(count, 4);
+  std::vector<int> out(count);
+  std::vector<std::uint64_t> mask((count + 63) / 64);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        Calculator::checked(Operation::Multiply, lhs, rhs, out, mask));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batchChecked)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+void batchSaturating(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto lhs = makeValues<int>(count, 5);
+  const auto rhs = makeValues<int>(count, 6);
+  std::vector<int> out(count);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        Calculator::saturating(Operation::Add, lhs, rhs, out));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batchSaturating)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+template <class T> void genericMultiply(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto lhs = makeValues<T>(count, 7);
+  const auto rhs = makeValues<T>(count, 8);
+  std::vector<T> out(count);
+  for (auto _ : state) {
+    Calculator::multiply<T>(lhs, rhs, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(genericMultiply<std::int64_t>)->Range(1 << 10, 1 << 20);
+BENCHMARK(genericMultiply<double>)->Range(1 << 10, 1 << 20);
+BENCHMARK(genericMultiply<Int128>)->Range(1 << 10, 1 << 20);
+
+template <class T> void reduceSum(benchmark::State &state) {
+  const auto values =
+      makeValues<T>(static_cast<std::size_t>(state.range(0)), 9);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Calculator::sum<T>(values));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(reduceSum<int>)->RangeMultiplier(16)->Range(64, 1 << 20);
+BENCHMARK(reduceSum<std::int64_t>)->RangeMultiplier(16)->Range(64, 1 << 20);
+BENCHMARK(reduceSum<float>)->RangeMultiplier(16)->Range(64, 1 << 20);
+BENCHMARK(reduceSum<double>)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+template <class T> void reduceDot(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto lhs = makeValues<T>(count, 10);
+  const auto rhs = makeValues<T>(count, 11);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Calculator::dot<T>(lhs, rhs));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(reduceDot<int>)->RangeMultiplier(16)->Range(64, 1 << 20);
+BENCHMARK(reduceDot<double>)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+void reduceProduct(benchmark::State &state) {
+  const std::vector<double> values(static_cast<std::size_t>(state.range(0)),
+                                   1.000'001);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Calculator::product<double>(values));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(reduceProduct)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+// Arguments: element count, ParallelOptions::threads.
+void parallelApply(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto lhs = makeValues<int>(count, 12);
+  const auto rhs = makeValues<int>(count, 13);
+  std::vector<int> out(count);
+  const ParallelOptions options{
+      .threads = static_cast<std::size_t>(state.range(1))};
+  for (auto _ : state) {
+    Calculator::apply(options, Operation::Multiply, lhs, rhs, out);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(parallelApply)
+    ->ArgsProduct({{1 << 16, 1 << 20, 1 << 24}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+void parallelSum(benchmark::State &state) {
+  const auto values = makeValues<int>(static_cast<std::size_t>(state.range(0)),
+                                      14);
+  const ParallelOptions options{
+      .threads = static_cast<std::size_t>(state.range(1))};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Calculator::sum(options, values));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(parallelSum)
+    ->ArgsProduct({{1 << 16, 1 << 20, 1 << 24}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+// Argument: rows. "(a - b) * (a - b) + a * c" compiles to four
+// instructions, each run as a batch kernel over a tile of rows.
+void expressionEvaluate(benchmark::State &state) {
+  const auto rows = static_cast<std::size_t>(state.range(0));
+  const std::vector<int> a = makeValues<int>(rows, 1);
+  const std::vector<int> b = makeValues<int>(rows, 2);
+  const std::vector<int> c = makeValues<int>(rows, 3);
+  const std::vector<std::span<const int>> columns{a, b, c};
+  const Expression expression("(a - b) * (a - b) + a * c", {"a", "b", "c"});
+  std::vector<int> out(rows);
+  for (auto _ : state) {
+    expression.evaluate(columns, out);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(expressionEvaluate)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+// The same formula evaluated one row at a time.
+void expressionEvaluateRows(benchmark::State &state) {
+  const auto rows = static_cast<std::size_t>(state.range(0));
+  const std::vector<int> a = makeValues<int>(rows, 1);
+  const std::vector<int> b = makeValues<int>(rows, 2);
+  const std::vector<int> c = makeValues<int>(rows, 3);
+  const Expression expression("(a - b) * (a - b) + a * c", {"a", "b", "c"});
+  std::vector<int> out(rows);
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < rows; ++i) {
+      const int values[] = {a[i], b[i], c[i]};
+      out[i] = expression.evaluate(values);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(expressionEvaluateRows)->Arg(1 << 16);
+
+} // namespace
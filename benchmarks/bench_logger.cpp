@@ -0,0 +1,471 @@
+#include "binary_log.hpp"
+#include "concurrent_logger.hpp"
+#include "log_segment.hpp"
+#include "log_sink.hpp"
+#include "log_table.hpp"
+#include "logger.hpp"
+#include "operation_table.hpp"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// The unbounded store grows with every record; start over every kReset
+// records so long runs measure appends rather than page faults.
+constexpr std::int64_t kReset = 1 << 20;
+
+void loggerLogOperation(benchmark::State &state) {
+  std::optional<Logger> logger;
+  logger.emplace();
+  std::int64_t logged = 0;
+  int value = 0;
+  for (auto _ : state) {
+    logger->logOperation("7 * 6", ++value);
+    if (++logged == kReset) {
+      state.PauseTiming();
+      logger.emplace();
+      logged = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(loggerLogOperation);
+
+// Argument: ring capacity.
+void boundedLogOperation(benchmark::State &state) {
+  const Logger logger(
+      LoggerOptions{.capacity = static_cast<std::size_t>(state.range(0)),
+                    .policy = OverflowPolicy::Overwrite});
+  int value = 0;
+  for (auto _ : state) {
+    logger.logOperation("7 * 6", ++value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(boundedLogOperation)->Range(64, 1 << 16);
+
+// Same as loggerLogOperation with an interned label: no text is copied.
+void internedLogOperation(benchmark::State &state) {
+  const OpId op = OperationTable::global().intern("7 * 6");
+  std::optional<Logger> logger;
+  logger.emplace();
+  std::int64_t logged = 0;
+  int value = 0;
+  for (auto _ : state) {
+    logger->logOperation(op, ++value);
+    if (++logged == kReset) {
+      state.PauseTiming();
+      logger.emplace();
+      logged = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(internedLogOperation);
+
+// Argument: ring capacity. No per-slot text is reserved.
+void boundedInternedLogOperation(benchmark::State &state) {
+  const OpId op = OperationTable::global().intern("7 * 6");
+  const Logger logger(
+      LoggerOptions{.capacity = static_cast<std::size_t>(state.range(0)),
+                    .policy = OverflowPolicy::Overwrite,
+                    .maxOperationLength = 0});
+  int value = 0;
+  for (auto _ : state) {
+    logger.logOperation(op, ++value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(boundedInternedLogOperation)->Range(64, 1 << 16);
+
+// Argument: distinct labels looked up round-robin, all already interned.
+// Threads share one table.
+void operationTableIntern(benchmark::State &state) {
+  static OperationTable table;
+  std::vector<std::string> labels;
+  for (std::int64_t i = 0; i < state.range(0); ++i) {
+    labels.push_back("tenant-" + std::to_string(i));
+    table.intern(labels.back());
+  }
+  std::size_t next = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.intern(labels[next]));
+    next = next + 1 == labels.size() ? 0 : next + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(operationTableIntern)
+    ->RangeMultiplier(16)
+    ->Range(16, 1 << 16)
+    ->ThreadRange(1, 4);
+
+// Argument: results per logOperations call.
+void loggerLogOperations(benchmark::State &state) {
+  const std::vector<int> results(static_cast<std::size_t>(state.range(0)), 42);
+  std::optional<Logger> logger;
+  logger.emplace();
+  std::int64_t logged = 0;
+  for (auto _ : state) {
+    logger->logOperations("batch", results);
+    logged += state.range(0);
+    if (logged >= kReset) {
+      state.PauseTiming();
+      logger.emplace();
+      logged = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(loggerLogOperations)->RangeMultiplier(16)->Range(16, 1 << 16);
+
+// Argument: records formatted per getLogs() call.
+void loggerGetLogs(benchmark::State &state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    const Logger logger;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+      logger.logOperation("2 + 3", static_cast<int>(i));
+    }
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(logger.getLogs().data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(loggerGetLogs)->RangeMultiplier(16)->Range(16, 1 << 16);
+
+void loggerRecords(benchmark::State &state) {
+  const Logger logger;
+  for (std::int64_t i = 0; i < state.range(0); ++i) {
+    logger.logOperation("2 + 3", static_cast<int>(i));
+  }
+  for (auto _ : state) {
+    std::int64_t total = 0;
+    for (const LogEntry entry : logger.records()) {
+      total += entry.result;
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(loggerRecords)->RangeMultiplier(16)->Range(16, 1 << 16);
+
+// Argument: records in the log. Snapshots it and reads the last 1024
+// records; the cost does not depend on the log size.
+void loggerSnapshotTail(benchmark::State &state) {
+  const Logger logger(LoggerOptions{
+      .capacity = static_cast<std::size_t>(state.range(0))});
+  for (std::int64_t i = 0; i < state.range(0); ++i) {
+    logger.logOperation("2 + 3", static_cast<int>(i));
+  }
+  for (auto _ : state) {
+    const LogSnapshot snapshot = logger.snapshot();
+    std::int64_t total = 0;
+    for (const LogEntry entry : snapshot.tail(1024)) {
+      total += entry.result;
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(loggerSnapshotTail)->RangeMultiplier(64)->Range(1 << 10, 1 << 22);
+
+// A snapshot held while the writer wraps around the ring costs one copy of
+// the ring per snapshot; compare with boundedLogOperation/4096.
+void boundedLogOperationWithSnapshot(benchmark::State &state) {
+  const Logger logger(LoggerOptions{.capacity = 4096});
+  int value = 0;
+  for (auto _ : state) {
+    const LogSnapshot held = logger.snapshot();
+    for (int i = 0; i < 4096; ++i) {
+      logger.logOperation("7 * 6", ++value);
+    }
+    benchmark::DoNotOptimize(held.size());
+  }
+  state.SetItemsProcessed(state.iterations() * 4096);
+}
+BENCHMARK(boundedLogOperationWithSnapshot);
+
+void loggerDrain(benchmark::State &state) {
+  const Logger logger(LoggerOptions{
+      .capacity = static_cast<std::size_t>(state.range(0))});
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+      logger.logOperation("2 + 3", static_cast<int>(i));
+    }
+    state.ResumeTiming();
+    std::int64_t total = 0;
+    logger.drain([&total](const LogEntry &entry) { total += entry.result; });
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(loggerDrain)->RangeMultiplier(16)->Range(16, 1 << 16);
+
+// Every benchmark thread appends to its own buffer of a shared logger.
+void concurrentLogOperation(benchmark::State &state) {
+  static ConcurrentLogger *logger = nullptr;
+  if (state.thread_index() == 0) {
+    logger = new ConcurrentLogger();
+  }
+  const std::string operation = "7 * 6";
+  int value = 0;
+  for (auto _ : state) {
+    logger->logOperation(operation, ++value);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    // Leaving the loop is a barrier across the benchmark threads, so nobody
+    // is still logging.
+    delete logger;
+    logger = nullptr;
+  }
+}
+BENCHMARK(concurrentLogOperation)
+    ->Iterations(1 << 18)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+void concurrentGetLogs(benchmark::State &state) {
+  const ConcurrentLogger logger;
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+      logger.logOperation("2 + 3", static_cast<int>(i));
+    }
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(logger.getLogs().size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(concurrentGetLogs)->RangeMultiplier(16)->Range(16, 1 << 12);
+
+// Argument: batch size; records go to /dev/null so only the sink is timed.
+void asyncSinkLogOperation(benchmark::State &state) {
+  static AsyncLogSink *sink = nullptr;
+  static int fd = -1;
+  if (state.thread_index() == 0) {
+    fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    sink = new AsyncLogSink(
+        fd, AsyncSinkOptions{
+                .batchSize = static_cast<std::size_t>(state.range(0))});
+  }
+  int value = 0;
+  for (auto _ : state) {
+    sink->logOperation("7 * 6", ++value);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete sink;
+    ::close(fd);
+  }
+}
+BENCHMARK(asyncSinkLogOperation)
+    ->Arg(256)
+    ->Arg(4096)
+    ->ThreadRange(1, 4)
+    ->UseRealTime();
+
+void binaryLogAppend(benchmark::State &state) {
+  const auto path = std::filesystem::temp_directory_path() /
+                    ("bench_binary_" + std::to_string(::getpid()) + ".log");
+  std::int64_t appended = 0;
+  auto writer = std::make_unique<BinaryLogWriter>(path);
+  int value = 0;
+  for (auto _ : state) {
+    writer->append("7 * 6", ++value);
+    if (++appended == kReset) {
+      state.PauseTiming();
+      writer.reset();
+      writer = std::make_unique<BinaryLogWriter>(path);
+      appended = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  writer.reset();
+  std::filesystem::remove(path);
+}
+BENCHMARK(binaryLogAppend);
+
+void binaryLogRead(benchmark::State &state) {
+  const auto path = std::filesystem::temp_directory_path() /
+                    ("bench_binary_read_" + std::to_string(::getpid()) +
+                     ".log");
+  {
+    BinaryLogWriter writer(path);
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+      writer.append(i % 2 == 0 ? "even" : "odd", static_cast<int>(i));
+    }
+  }
+  for (auto _ : state) {
+    const BinaryLogReader reader(path);
+    std::int64_t total = 0;
+    for (const LogEntry &entry : reader) {
+      total += entry.result;
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  std::filesystem::remove(path);
+}
+BENCHMARK(binaryLogRead)->RangeMultiplier(16)->Range(1 << 10, 1 << 18);
+
+// Appends into a segment of range(0) records per block with codec range(1)
+// (0 none, 1 lz4); the segment is sealed and restarted every kReset records.
+void segmentAppend(benchmark::State &state) {
+  const auto path = std::filesystem::temp_directory_path() /
+                    ("bench_segment_" + std::to_string(::getpid()) + ".seg");
+  const SegmentWriterOptions options{
+      .codec = static_cast<SegmentCodec>(state.range(1)),
+      .blockRecords = static_cast<std::size_t>(state.range(0))};
+  auto writer = std::make_unique<LogSegmentWriter>(path, options);
+  auto time = std::chrono::system_clock::now();
+  std::int64_t appended = 0;
+  int value = 0;
+  for (auto _ : state) {
+    time += std::chrono::microseconds(100);
+    ++value;
+    writer->append(value % 3 == 0 ? "7 * 6" : "2 + 3", value % 1000, time);
+    if (++appended == kReset) {
+      state.PauseTiming();
+      writer.reset();
+      writer = std::make_unique<LogSegmentWriter>(path, options);
+      appended = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  writer.reset();
+  std::filesystem::remove(path);
+}
+BENCHMARK(segmentAppend)->ArgsProduct({{1024, 4096}, {0, 1}});
+
+// Replays 1 << 20 records on range(0) threads; bytes/record is the size of
+// the sealed segment.
+void segmentReplay(benchmark::State &state) {
+  constexpr std::int64_t kRecords = 1 << 20;
+  const auto path = std::filesystem::temp_directory_path() /
+                    ("bench_segment_replay_" + std::to_string(::getpid()) +
+                     ".seg");
+  {
+    LogSegmentWriter writer(path);
+    auto time = std::chrono::system_clock::now();
+    for (std::int64_t i = 0; i < kRecords; ++i) {
+      time += std::chrono::microseconds(100);
+      writer.append(i % 3 == 0 ? "7 * 6" : "2 + 3",
+                    static_cast<int>(i % 1000), time);
+    }
+  }
+  const LogSegmentReader reader(path);
+  const ParallelOptions options{
+      .threads = static_cast<std::size_t>(state.range(0))};
+  for (auto _ : state) {
+    std::int64_t total = 0;
+    reader.replay(0, reader.blocks().size(), [&](const SegmentBlock &block) {
+      for (const SegmentEntry &entry : block) {
+        total += entry.entry.result;
+      }
+    }, options);
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * kRecords);
+  state.counters["bytes/record"] =
+      static_cast<double>(std::filesystem::file_size(path)) / kRecords;
+  std::filesystem::remove(path);
+}
+BENCHMARK(segmentReplay)->RangeMultiplier(2)->Range(1, 4)->UseRealTime();
+
+// 1 << 20 rows over eight operations for the query benchmarks.
+constexpr std::size_t kTableRows = std::size_t{1} << 20U;
+
+void fillLogger(Logger &logger) {
+  static const std::vector<std::string> kOperations{
+      "2 + 3", "7 * 6", "9 - 4", "8 / 2", "1 + 1", "3 * 3", "5 - 5", "6 / 3"};
+  for (std::size_t i = 0; i < kTableRows; ++i) {
+    logger.logOperation(kOperations[(i * 7) % kOperations.size()],
+                        static_cast<int>((i * 2'654'435'761U) % 2001) - 1000);
+  }
+}
+
+auto makeTable() -> LogTable {
+  Logger logger;
+  fillLogger(logger);
+  LogTable table;
+  table.append(logger.records());
+  return table;
+}
+
+// Row-wise baseline for tableAggregate: one operation's sum straight off the
+// Logger's records, comparing operation text per record.
+void loggerRecordsAggregate(benchmark::State &state) {
+  Logger logger;
+  fillLogger(logger);
+  for (auto _ : state) {
+    std::int64_t sum = 0;
+    for (const LogEntry entry : logger.records()) {
+      if (entry.operation == "7 * 6" && entry.result >= 0) {
+        sum += entry.result;
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kTableRows));
+}
+BENCHMARK(loggerRecordsAggregate);
+
+// The same query on a LogTable; range(0) threads, 0 for the sequential form.
+void tableAggregate(benchmark::State &state) {
+  const LogTable table = makeTable();
+  const LogFilter filter{.operation = "7 * 6", .minResult = 0};
+  const ParallelOptions options{
+      .threads = static_cast<std::size_t>(state.range(0))};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.range(0) == 0
+                                 ? table.aggregate(filter)
+                                 : table.aggregate(options, filter));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kTableRows));
+}
+BENCHMARK(tableAggregate)->Arg(0)->Arg(1)->Arg(4)->UseRealTime();
+
+void tableGroupByOperation(benchmark::State &state) {
+  const LogTable table = makeTable();
+  const ParallelOptions options{
+      .threads = static_cast<std::size_t>(state.range(0))};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.range(0) == 0
+                                 ? table.groupByOperation()
+                                 : table.groupByOperation(options));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kTableRows));
+}
+BENCHMARK(tableGroupByOperation)->Arg(0)->Arg(1)->Arg(4)->UseRealTime();
+
+void tableTopK(benchmark::State &state) {
+  const LogTable table = makeTable();
+  const ParallelOptions options{
+      .threads = static_cast<std::size_t>(state.range(0))};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.range(0) == 0 ? table.topK(100)
+                                                 : table.topK(options, 100));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kTableRows));
+}
+BENCHMARK(tableTopK)->Arg(0)->Arg(1)->Arg(4)->UseRealTime();
+
+} // namespace
@@ -0,0 +1,53 @@
+#include "metrics.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string>
+
+namespace {
+
+// Per-thread cost of the hooks; shards keep threads off each other's lines.
+void counterAdd(benchmark::State &state) {
+  static Counter counter;
+  for (auto _ : state) {
+    counter.add();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(counterAdd)->ThreadRange(1, 8)->UseRealTime();
+
+void histogramRecord(benchmark::State &state) {
+  static Histogram histogram;
+  std::uint64_t value = 1;
+  for (auto _ : state) {
+    histogram.record(value);
+    value = value * 6'364'136'223'846'793'005ULL + 1;
+    value >>= 40U;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(histogramRecord)->ThreadRange(1, 8)->UseRealTime();
+
+void latencyTimer(benchmark::State &state) {
+  static Histogram histogram;
+  for (auto _ : state) {
+    const LatencyTimer timer(histogram);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(latencyTimer);
+
+// Argument: registered metrics.
+void snapshotAndExport(benchmark::State &state) {
+  MetricsRegistry registry;
+  for (std::int64_t i = 0; i < state.range(0); ++i) {
+    const MetricLabels labels{{"id", std::to_string(i)}};
+    registry.counter("bench_events", "Events", labels).add(1);
+    registry.histogram("bench_seconds", "Latency", labels).record(1000);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(formatOpenMetrics(registry.snapshot()));
+  }
+}
+BENCHMARK(snapshotAndExport)->Arg(8)->Arg(64);
+
+} // namespace
@@ -0,0 +1,269 @@
+#include "memory_resource.hpp"
+#include "notification_dispatcher.hpp"
+#include "notifier.hpp"
+#include "notifier_set.hpp"
+#include "streaming_notifier.hpp"
+#include <array>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+auto makeValues(std::size_t count) -> std::vector<int> {
+  std::vector<int> values(count);
+  std::uint32_t state = 17;
+  for (int &value : values) {
+    state = state * 1'664'525U + 1'013'904'223U;
+    value = static_cast<int>(state % 2001) - 1000;
+  }
+  return values;
+}
+
+void shouldNotifyScalar(benchmark::State &state) {
+  const Notifier notifier(500);
+  int value = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(value);
+    benchmark::DoNotOptimize(notifier.shouldNotify(value));
+    value += 7;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(shouldNotifyScalar);
+
+// Argument: 0 for a value within the threshold, 1 for one above it.
+void notifyMessage(benchmark::State &state) {
+  const Notifier notifier(500);
+  const int value = state.range(0) == 0 ? 100 : 123'456;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(notifier.notifyMessage(value));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(notifyMessage)->Arg(0)->Arg(1);
+
+void messageRender(benchmark::State &state) {
+  const Notifier notifier(500);
+  std::array<char, NotifyMessage::kMaxLength> buffer{};
+  int value = 1000;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(notifier.message(++value).render(buffer));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(messageRender);
+
+void batchShouldNotify(benchmark::State &state) {
+  const auto values = makeValues(static_cast<std::size_t>(state.range(0)));
+  std::vector<std::uint64_t> mask(Notifier::maskWords(values.size()));
+  const Notifier notifier(500);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(notifier.shouldNotify(values, mask));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batchShouldNotify)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+void exceedingIndices(benchmark::State &state) {
+  const auto values = makeValues(static_cast<std::size_t>(state.range(0)));
+  const Notifier notifier(900);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(notifier.exceedingIndices(values));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(exceedingIndices)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+// A request-scoped batch of rendered messages, one string each, built on
+// the heap (range(1) == 0) or on a MonotonicArena that one release() frees.
+template <class Strings>
+void renderBatch(const Notifier &notifier, std::span<const int> values,
+                 Strings &out) {
+  std::array<char, NotifyMessage::kMaxLength> buffer{};
+  out.reserve(values.size());
+  for (const int value : values) {
+    out.emplace_back(notifier.message(value).render(buffer));
+  }
+}
+
+void messageBatch(benchmark::State &state) {
+  const auto values = makeValues(static_cast<std::size_t>(state.range(0)));
+  const Notifier notifier(-1000);
+  MonotonicArena arena(ArenaOptions{.initialBytes = std::size_t{1} << 22U});
+  for (auto _ : state) {
+    if (state.range(1) == 0) {
+      std::vector<std::string> messages;
+      renderBatch(notifier, values, messages);
+      benchmark::DoNotOptimize(messages.data());
+    } else {
+      {
+        std::pmr::vector<std::pmr::string> messages(&arena);
+        renderBatch(notifier, values, messages);
+        benchmark::DoNotOptimize(messages.data());
+      }
+      arena.release();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(messageBatch)->ArgsProduct({{64, 4096}, {0, 1}});
+
+// Arguments: element count, ParallelOptions::threads.
+void parallelShouldNotify(benchmark::State &state) {
+  const auto values = makeValues(static_cast<std::size_t>(state.range(0)));
+  std::vector<std::uint64_t> mask(Notifier::maskWords(values.size()));
+  const Notifier notifier(500);
+  const ParallelOptions options{
+      .threads = static_cast<std::size_t>(state.range(1))};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(notifier.shouldNotify(options, values, mask));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(parallelShouldNotify)
+    ->ArgsProduct({{1 << 16, 1 << 20, 1 << 24}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+// Half thresholds, half overlapping ranges.
+auto makeRules(std::size_t count) -> std::vector<NotifierRule> {
+  std::vector<NotifierRule> rules;
+  rules.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const int base = static_cast<int>((i * 37) % 2000) - 1000;
+    rules.push_back(i % 2 == 0 ? NotifierRule::above(base)
+                               : NotifierRule::between(base, base + 50));
+  }
+  return rules;
+}
+
+// Argument: number of rules.
+void notifierSetMatch(benchmark::State &state) {
+  const NotifierSet set(makeRules(static_cast<std::size_t>(state.range(0))));
+  const auto values = makeValues(1024);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.match(values[i++ % values.size()]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(notifierSetMatch)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void notifierSetMatchCount(benchmark::State &state) {
+  const NotifierSet set(makeRules(static_cast<std::size_t>(state.range(0))));
+  const auto values = makeValues(1024);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.matchCount(values[i++ % values.size()]));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(notifierSetMatchCount)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+// Arguments: number of rules, values per call.
+void notifierSetMatchCounts(benchmark::State &state) {
+  const NotifierSet set(makeRules(static_cast<std::size_t>(state.range(0))));
+  const auto values = makeValues(static_cast<std::size_t>(state.range(1)));
+  std::vector<std::uint32_t> counts(values.size());
+  for (auto _ : state) {
+    set.matchCounts(values, counts);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(notifierSetMatchCounts)
+    ->ArgsProduct({{64, 4096}, {1 << 10, 1 << 16}});
+
+void notifierSetMatchAll(benchmark::State &state) {
+  const NotifierSet set(makeRules(256));
+  const auto values = makeValues(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.matchAll(values));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(notifierSetMatchAll)->RangeMultiplier(16)->Range(64, 1 << 16);
+
+void notifierSetBuild(benchmark::State &state) {
+  const auto rules = makeRules(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    const NotifierSet set(rules);
+    benchmark::DoNotOptimize(set.ruleCount());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(notifierSetBuild)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+// Argument: distinct keys. Measures the publish hot path; the dispatcher
+// coalesces in the background and the sink discards everything.
+void dispatcherPublish(benchmark::State &state) {
+  static NotificationDispatcher *dispatcher = nullptr;
+  if (state.thread_index() == 0) {
+    dispatcher = new NotificationDispatcher(
+        {.sinks = {[](std::span<const Notification>) {}},
+         .policy = BackpressurePolicy::Block,
+         .coalesceWindow = std::chrono::milliseconds(1)});
+  }
+  const auto keys = static_cast<std::uint64_t>(state.range(0));
+  std::uint64_t key = 0;
+  int value = 0;
+  for (auto _ : state) {
+    dispatcher->publish(key, NotifyMessage(true, ++value));
+    key = key + 1 == keys ? 0 : key + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete dispatcher;
+    dispatcher = nullptr;
+  }
+}
+BENCHMARK(dispatcherPublish)
+    ->Arg(1)
+    ->Arg(1024)
+    ->ThreadRange(1, 4)
+    ->UseRealTime();
+
+// Batch updates of the streaming screens over one result vector.
+void hysteresisUpdate(benchmark::State &state) {
+  const auto values = makeValues(static_cast<std::size_t>(state.range(0)));
+  std::vector<std::uint64_t> mask(Notifier::maskWords(values.size()));
+  HysteresisNotifier notifier(500, 0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(notifier.update(values, mask));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(hysteresisUpdate)->Arg(1 << 16);
+
+// Arguments: statistic (0 mean, 1 max), window samples.
+void windowUpdate(benchmark::State &state) {
+  const auto values = makeValues(1 << 16);
+  std::vector<std::uint64_t> mask(Notifier::maskWords(values.size()));
+  WindowNotifier notifier(
+      0, state.range(0) == 0 ? WindowStatistic::Mean : WindowStatistic::Max,
+      static_cast<std::size_t>(state.range(1)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(notifier.update(values, mask));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(values.size()));
+}
+BENCHMARK(windowUpdate)->ArgsProduct({{0, 1}, {16, 4096}});
+
+void ewmaUpdate(benchmark::State &state) {
+  const auto values = makeValues(static_cast<std::size_t>(state.range(0)));
+  std::vector<std::uint64_t> mask(Notifier::maskWords(values.size()));
+  EwmaNotifier notifier(0, 0.05);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(notifier.update(values, mask));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(ewmaUpdate)->Arg(1 << 16);
+
+} // namespace
@@ -0,0 +1,53 @@
+#include "state_snapshot.hpp"
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <string>
+
+namespace {
+
+// Writes a snapshot of records records, once per size.
+auto snapshotFile(std::size_t records) -> std::filesystem::path {
+  const auto path = std::filesystem::temp_directory_path() /
+                    ("bench_state_" + std::to_string(records) + ".state");
+  if (!std::filesystem::exists(path)) {
+    const Logger logger;
+    const OpId add = OperationTable::global().intern("add");
+    for (std::size_t i = 0; i < records; ++i) {
+      logger.logOperation(add, static_cast<int>(i % 1000));
+    }
+    std::vector<NotifierRule> rules;
+    for (int i = 0; i < 4096; ++i) {
+      rules.push_back(NotifierRule::above(i * 7));
+    }
+    writeStateSnapshot(path, logger.snapshot().records(), rules);
+  }
+  return path;
+}
+
+// Restart cost: map the snapshot and read its newest record. Stays flat
+// as the history grows, since only touched pages are read.
+void restoreStateSnapshot(benchmark::State &state) {
+  const auto path = snapshotFile(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    const StateSnapshot snapshot(path);
+    const LogRecordRange records = snapshot.records();
+    benchmark::DoNotOptimize(records[records.size() - 1]);
+  }
+  state.SetLabel(std::to_string(state.range(0)) + " records");
+}
+BENCHMARK(restoreStateSnapshot)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 24);
+
+// What a snapshot saves on restart: logging the whole history again.
+void replayStateSnapshot(benchmark::State &state) {
+  const auto path = snapshotFile(static_cast<std::size_t>(state.range(0)));
+  const StateSnapshot snapshot(path);
+  for (auto _ : state) {
+    const Logger logger;
+    snapshot.appendTo(logger);
+    benchmark::DoNotOptimize(logger.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(replayStateSnapshot)->Arg(1 << 16)->Arg(1 << 20);
+
+} // namespace
@@ -0,0 +1,53 @@
+#include "pipeline.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// End to end: calculate, log into a bounded ring and screen every result.
+// Arguments: elements per process() call, PipelineOptions::batchSize.
+void pipelineProcess(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  std::vector<int> lhs(count);
+  std::vector<int> rhs(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    lhs[i] = static_cast<int>(i % 1000);
+    rhs[i] = static_cast<int>(i % 7) - 3;
+  }
+  std::vector<int> results(count);
+  std::vector<std::uint64_t> mask(Notifier::maskWords(count));
+  const Logger logger(LoggerOptions{.capacity = 1 << 16});
+  const Notifier notifier(1500);
+  Pipeline pipeline(
+      logger, notifier,
+      PipelineOptions{.batchSize = static_cast<std::size_t>(state.range(1))});
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        pipeline.process(Operation::Multiply, "mul", lhs, rhs, results, mask));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(pipelineProcess)
+    ->ArgsProduct({{1 << 10, 1 << 16, 1 << 20}, {256, 1024, 8192}});
+
+// The same flow composed from the individual component calls, for
+// comparison with the fused pipeline.
+void pipelineUnfused(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  std::vector<int> lhs(count, 3);
+  std::vector<int> rhs(count, 600);
+  std::vector<int> results(count);
+  std::vector<std::uint64_t> mask(Notifier::maskWords(count));
+  const Logger logger(LoggerOptions{.capacity = 1 << 16});
+  const Notifier notifier(1500);
+  for (auto _ : state) {
+    Calculator::multiply(lhs, rhs, results);
+    logger.logOperations("mul", results);
+    benchmark::DoNotOptimize(notifier.shouldNotify(results, mask));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(pipelineUnfused)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+} // namespace
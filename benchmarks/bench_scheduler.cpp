@@ -0,0 +1,44 @@
+#include "scheduler.hpp"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+
+namespace {
+
+// Arguments: tasks per group, worker threads.
+void taskGroupOverhead(benchmark::State &state) {
+  Scheduler scheduler(
+      SchedulerOptions{.threads = static_cast<std::size_t>(state.range(1))});
+  std::atomic<std::int64_t> counter{0};
+  for (auto _ : state) {
+    TaskGroup group(scheduler);
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+      group.run(
+          [&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+    }
+    group.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(taskGroupOverhead)
+    ->ArgsProduct({{16, 1024}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+// Arguments: range size, worker threads. Pieces of 1024 empty iterations
+// measure splitting and stealing cost.
+void parallelForOverhead(benchmark::State &state) {
+  Scheduler scheduler(
+      SchedulerOptions{.threads = static_cast<std::size_t>(state.range(1))});
+  const auto count = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    scheduler.parallelFor(count, 1024, [](std::size_t begin, std::size_t end) {
+      benchmark::DoNotOptimize(end - begin);
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(parallelForOverhead)
+    ->ArgsProduct({{1 << 16, 1 << 22}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+} // namespace
@@ -0,0 +1,48 @@
+#include "pipeline_client.hpp"
+#include "pipeline_server.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// Loopback throughput of PipelineServer. Arguments: operations per frame,
+// frames in flight before the client reads their responses. (1, 1) is one
+// operation per round trip.
+void serverPipelined(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  const auto depth = static_cast<std::uint32_t>(state.range(1));
+  std::vector<int> lhs(count);
+  std::vector<int> rhs(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    lhs[i] = static_cast<int>(i % 1000);
+    rhs[i] = static_cast<int>(i % 7) - 3;
+  }
+  const Logger logger(LoggerOptions{.capacity = 1 << 16});
+  const Notifier notifier(1500);
+  PipelineServer server(logger, notifier);
+  PipelineClient client("127.0.0.1", server.port());
+  const wire::Request request{.operation = Operation::Multiply,
+                              .label = "mul",
+                              .lhs = lhs,
+                              .rhs = rhs};
+  for (auto _ : state) {
+    for (std::uint32_t i = 0; i < depth; ++i) {
+      client.send(request);
+    }
+    for (std::uint32_t i = 0; i < depth; ++i) {
+      benchmark::DoNotOptimize(client.receive());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+BENCHMARK(serverPipelined)
+    ->Args({1, 1})
+    ->Args({1, 64})
+    ->Args({1024, 1})
+    ->Args({1024, 16})
+    ->Args({16384, 16})
+    ->UseRealTime();
+
+} // namespace
@@ -0,0 +1,31 @@
+#include "tracing.hpp"
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+// Cost of a compiled-in span while no capture runs.
+void spanInactive(benchmark::State &state) {
+  Tracer::global().stop();
+  for (auto _ : state) {
+    const TraceSpan span("inactive");
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(spanInactive);
+
+// Cost of a recorded span: two steady_clock reads and a buffer append. The
+// buffer is sized so no event is dropped.
+void spanActive(benchmark::State &state) {
+  Tracer &tracer = Tracer::global();
+  tracer.start({.eventsPerThread = std::size_t{1} << 22U});
+  for (auto _ : state) {
+    const TraceSpan span("active");
+  }
+  tracer.stop();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(spanActive)->Iterations(std::int64_t{1} << 22);
+
+} // namespace
@@ -1,7 +1,285 @@
 #include "calculator.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+#include <cstddef>
+#include <stdexcept>
 
-auto Calculator::add(int num1, int num2) -> int { return num1 + num2; }
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CALCULATOR_HAS_X86_KERNELS 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CALCULATOR_HAS_NEON_KERNELS 1
+#endif
 
-auto Calculator::subtract(int num1, int num2) -> int { return num1 - num2; }
+#ifdef MY_CODE_METRICS
+namespace {
 
-auto Calculator::multiply(int num1, int num2) -> int { return num1 * num2; }
+struct OperationMetrics {
+  Counter &scalar;
+  Counter &batches;
+  Counter &elements;
+  Histogram &batchLatency;
+};
+
+auto makeOperationMetrics(const char *op) -> OperationMetrics {
+  MetricsRegistry &registry = MetricsRegistry::global();
+  const MetricLabels labels{{"op", op}};
+  return {registry.counter("my_code_calculator_scalar_operations",
+                           "Scalar Calculator operations", labels),
+          registry.counter("my_code_calculator_batches",
+                           "Batch Calculator calls", labels),
+          registry.counter("my_code_calculator_elements",
+                           "Elements processed by batch Calculator calls",
+                           labels),
+          registry.histogram("my_code_calculator_batch_seconds",
+                             "Latency of batch Calculator calls", labels)};
+}
+
+auto operationMetrics(Operation op) -> OperationMetrics & {
+  static OperationMetrics table[] = {makeOperationMetrics("add"),
+                                     makeOperationMetrics("subtract"),
+                                     makeOperationMetrics("multiply")};
+  return table[static_cast<std::size_t>(op)];
+}
+
+} // namespace
+#endif
+
+auto Calculator::add(int num1, int num2) -> int {
+  MY_CODE_METRICS_ONLY(operationMetrics(Operation::Add).scalar.add();)
+  return num1 + num2;
+}
+
+auto Calculator::subtract(int num1, int num2) -> int {
+  MY_CODE_METRICS_ONLY(operationMetrics(Operation::Subtract).scalar.add();)
+  return num1 - num2;
+}
+
+auto Calculator::multiply(int num1, int num2) -> int {
+  MY_CODE_METRICS_ONLY(operationMetrics(Operation::Multiply).scalar.add();)
+  return num1 * num2;
+}
+
+namespace {
+
+using Kernel = void (*)(const int *, const int *, int *, std::size_t);
+
+// Scalar ops go through unsigned arithmetic so the tail loops wrap exactly
+// like the vector lanes do.
+struct AddOp {
+  static auto scalar(int lhs, int rhs) -> int {
+    return static_cast<int>(static_cast<unsigned>(lhs) +
+                            static_cast<unsigned>(rhs));
+  }
+#ifdef CALCULATOR_HAS_X86_KERNELS
+  __attribute__((target("sse4.1"))) static auto sse(__m128i lhs, __m128i rhs)
+      -> __m128i {
+    return _mm_add_epi32(lhs, rhs);
+  }
+  __attribute__((target("avx2"))) static auto avx2(__m256i lhs, __m256i rhs)
+      -> __m256i {
+    return _mm256_add_epi32(lhs, rhs);
+  }
+#endif
+#ifdef CALCULATOR_HAS_NEON_KERNELS
+  static auto neon(int32x4_t lhs, int32x4_t rhs) -> int32x4_t {
+    return vaddq_s32(lhs, rhs);
+  }
+#endif
+};
+
+struct SubtractOp {
+  static auto scalar(int lhs, int rhs) -> int {
+    return static_cast<int>(static_cast<unsigned>(lhs) -
+                            static_cast<unsigned>(rhs));
+  }
+#ifdef CALCULATOR_HAS_X86_KERNELS
+  __attribute__((target("sse4.1"))) static auto sse(__m128i lhs, __m128i rhs)
+      -> __m128i {
+    return _mm_sub_epi32(lhs, rhs);
+  }
+  __attribute__((target("avx2"))) static auto avx2(__m256i lhs, __m256i rhs)
+      -> __m256i {
+    return _mm256_sub_epi32(lhs, rhs);
+  }
+#endif
+#ifdef CALCULATOR_HAS_NEON_KERNELS
+  static auto neon(int32x4_t lhs, int32x4_t rhs) -> int32x4_t {
+    return vsubq_s32(lhs, rhs);
+  }
+#endif
+};
+
+struct MultiplyOp {
+  static auto scalar(int lhs, int rhs) -> int {
+    return static_cast<int>(static_cast<unsigned>(lhs) *
+                            static_cast<unsigned>(rhs));
+  }
+#ifdef CALCULATOR_HAS_X86_KERNELS
+  __attribute__((target("sse4.1"))) static auto sse(__m128i lhs, __m128i rhs)
+      -> __m128i {
+    return _mm_mullo_epi32(lhs, rhs);
+  }
+  __attribute__((target("avx2"))) static auto avx2(__m256i lhs, __m256i rhs)
+      -> __m256i {
+    return _mm256_mullo_epi32(lhs, rhs);
+  }
+#endif
+#ifdef CALCULATOR_HAS_NEON_KERNELS
+  static auto neon(int32x4_t lhs, int32x4_t rhs) -> int32x4_t {
+    return vmulq_s32(lhs, rhs);
+  }
+#endif
+};
+
+template <class Op>
+void scalarKernel(const int *lhs, const int *rhs, int *out, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = Op::scalar(lhs[i], rhs[i]);
+  }
+}
+
+#ifdef CALCULATOR_HAS_X86_KERNELS
+template <class Op>
+__attribute__((target("sse4.1"))) void sseKernel(const int *lhs,
+                                                 const int *rhs, int *out,
+                                                 std::size_t n) {
+  constexpr std::size_t kLanes = 4;
+  std::size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + i));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), Op::sse(a, b));
+  }
+  scalarKernel<Op>(lhs + i, rhs + i, out + i, n - i);
+}
+
+template <class Op>
+__attribute__((target("avx2"))) void avx2Kernel(const int *lhs,
+                                                const int *rhs, int *out,
+                                                std::size_t n) {
+  constexpr std::size_t kLanes = 8;
+  std::size_t i = 0;
+  // Two vectors per iteration keeps both load ports busy.
+  for (; i + 2 * kLanes <= n; i += 2 * kLanes) {
+    const __m256i a0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+    const __m256i b0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+    const __m256i a1 = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(lhs + i + kLanes));
+    const __m256i b1 = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(rhs + i + kLanes));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        Op::avx2(a0, b0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + kLanes),
+                        Op::avx2(a1, b1));
+  }
+  for (; i + kLanes <= n; i += kLanes) {
+    const __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), Op::avx2(a, b));
+  }
+  scalarKernel<Op>(lhs + i, rhs + i, out + i, n - i);
+}
+#endif
+
+#ifdef CALCULATOR_HAS_NEON_KERNELS
+template <class Op>
+void neonKernel(const int *lhs, const int *rhs, int *out, std::size_t n) {
+  constexpr std::size_t kLanes = 4;
+  std::size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    vst1q_s32(out + i, Op::neon(vld1q_s32(lhs + i), vld1q_s32(rhs + i)));
+  }
+  scalarKernel<Op>(lhs + i, rhs + i, out + i, n - i);
+}
+#endif
+
+struct KernelTable {
+  SimdLevel level;
+  Kernel add;
+  Kernel subtract;
+  Kernel multiply;
+};
+
+auto selectKernels() -> KernelTable {
+#ifdef CALCULATOR_HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return {SimdLevel::AVX2, &avx2Kernel<AddOp>, &avx2Kernel<SubtractOp>,
+            &avx2Kernel<MultiplyOp>};
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return {SimdLevel::SSE41, &sseKernel<AddOp>, &sseKernel<SubtractOp>,
+            &sseKernel<MultiplyOp>};
+  }
+#elif defined(CALCULATOR_HAS_NEON_KERNELS)
+  return {SimdLevel::NEON, &neonKernel<AddOp>, &neonKernel<SubtractOp>,
+          &neonKernel<MultiplyOp>};
+#endif
+  return {SimdLevel::Scalar, &scalarKernel<AddOp>, &scalarKernel<SubtractOp>,
+          &scalarKernel<MultiplyOp>};
+}
+
+auto kernels() -> const KernelTable & {
+  static const KernelTable table = selectKernels();
+  return table;
+}
+
+void runKernel([[maybe_unused]] Operation op, Kernel kernel,
+               std::span<const int> lhs, std::span<const int> rhs,
+               std::span<int> out) {
+  if (lhs.size() != rhs.size() || lhs.size() != out.size()) {
+    throw std::invalid_argument("Calculator: span sizes do not match");
+  }
+#ifdef MY_CODE_TRACING
+  static constexpr const char *kSpanNames[] = {
+      "Calculator::add", "Calculator::subtract", "Calculator::multiply"};
+#endif
+  MY_CODE_TRACE_SPAN_ITEMS(kSpanNames[static_cast<std::size_t>(op)],
+                           out.size());
+  MY_CODE_METRICS_ONLY(OperationMetrics &metrics = operationMetrics(op);
+                       metrics.batches.add();
+                       metrics.elements.add(out.size());
+                       const LatencyTimer timer(metrics.batchLatency);)
+  kernel(lhs.data(), rhs.data(), out.data(), out.size());
+}
+
+} // namespace
+
+void Calculator::add(std::span<const int> lhs, std::span<const int> rhs,
+                     std::span<int> out) {
+  runKernel(Operation::Add, kernels().add, lhs, rhs, out);
+}
+
+void Calculator::subtract(std::span<const int> lhs, std::span<const int> rhs,
+                          std::span<int> out) {
+  runKernel(Operation::Subtract, kernels().subtract, lhs, rhs, out);
+}
+
+void Calculator::multiply(std::span<const int> lhs, std::span<const int> rhs,
+                          std::span<int> out) {
+  runKernel(Operation::Multiply, kernels().multiply, lhs, rhs, out);
+}
+
+void Calculator::apply(Operation op, std::span<const int> lhs,
+                       std::span<const int> rhs, std::span<int> out) {
+  const KernelTable &table = kernels();
+  switch (op) {
+  case Operation::Add:
+    return runKernel(op, table.add, lhs, rhs, out);
+  case Operation::Subtract:
+    return runKernel(op, table.subtract, lhs, rhs, out);
+  case Operation::Multiply:
+    return runKernel(op, table.multiply, lhs, rhs, out);
+  }
+  throw std::invalid_argument("Calculator: unknown operation");
+}
+
+auto Calculator::simdLevel() -> SimdLevel { return kernels().level; }
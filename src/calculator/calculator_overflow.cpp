@@ -0,0 +1,323 @@
+#include "calculator.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CALCULATOR_HAS_X86_KERNELS 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CALCULATOR_HAS_NEON_KERNELS 1
+#endif
+
+// Batch checked/saturating kernels. Each kernel handles one block of up to
+// 64 lanes and returns the block's overflow bits; Saturate selects whether
+// overflowing lanes store the wrapped or the clamped result.
+
+namespace {
+
+constexpr std::size_t kBlock = 64;
+constexpr int kIntMax = std::numeric_limits<int>::max();
+
+using BlockKernel = auto (*)(const int *, const int *, int *, std::size_t)
+    -> std::uint64_t;
+
+template <Operation Op, bool Saturate>
+auto scalarBlock(const int *lhs, const int *rhs, int *out, std::size_t n)
+    -> std::uint64_t {
+  std::uint64_t bits = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    const bool overflow =
+        !Calculator::checked<Op>(lhs[i], rhs[i]).has_value();
+    out[i] = Saturate ? Calculator::saturating<Op>(lhs[i], rhs[i])
+                      : Calculator::wrapping<Op>(lhs[i], rhs[i]);
+    bits |= static_cast<std::uint64_t>(overflow) << i;
+  }
+  return bits;
+}
+
+#ifdef CALCULATOR_HAS_X86_KERNELS
+// Overflow lanes are all-ones. The saturation bound is derived from the sign
+// of `base`: lhs for add/subtract, lhs ^ rhs for multiply.
+template <Operation Op> struct SseLanes {
+  __attribute__((target("sse4.1"))) static auto
+  compute(__m128i a, __m128i b, __m128i &overflow, __m128i &base) -> __m128i {
+    if constexpr (Op == Operation::Add) {
+      const __m128i wrapped = _mm_add_epi32(a, b);
+      overflow = _mm_srai_epi32(
+          _mm_and_si128(_mm_xor_si128(a, wrapped), _mm_xor_si128(b, wrapped)),
+          31);
+      base = a;
+      return wrapped;
+    } else if constexpr (Op == Operation::Subtract) {
+      const __m128i wrapped = _mm_sub_epi32(a, b);
+      overflow = _mm_srai_epi32(
+          _mm_and_si128(_mm_xor_si128(a, b), _mm_xor_si128(a, wrapped)), 31);
+      base = a;
+      return wrapped;
+    } else {
+      const __m128i wrapped = _mm_mullo_epi32(a, b);
+      // 64-bit products of the even and odd lanes; the exact product fits
+      // iff its high half equals the sign extension of the low half.
+      const __m128i even = _mm_mul_epi32(a, b);
+      const __m128i odd =
+          _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+      const __m128i high = _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+      overflow = _mm_xor_si128(
+          _mm_cmpeq_epi32(high, _mm_srai_epi32(wrapped, 31)),
+          _mm_set1_epi32(-1));
+      base = _mm_xor_si128(a, b);
+      return wrapped;
+    }
+  }
+};
+
+template <Operation Op> struct Avx2Lanes {
+  __attribute__((target("avx2"))) static auto
+  compute(__m256i a, __m256i b, __m256i &overflow, __m256i &base) -> __m256i {
+    if constexpr (Op == Operation::Add) {
+      const __m256i wrapped = _mm256_add_epi32(a, b);
+      const __m256i signs = _mm256_and_si256(_mm256_xor_si256(a, wrapped),
+                                             _mm256_xor_si256(b, wrapped));
+      overflow = _mm256_srai_epi32(signs, 31);
+      base = a;
+      return wrapped;
+    } else if constexpr (Op == Operation::Subtract) {
+      const __m256i wrapped = _mm256_sub_epi32(a, b);
+      const __m256i signs = _mm256_and_si256(_mm256_xor_si256(a, b),
+                                             _mm256_xor_si256(a, wrapped));
+      overflow = _mm256_srai_epi32(signs, 31);
+      base = a;
+      return wrapped;
+    } else {
+      const __m256i wrapped = _mm256_mullo_epi32(a, b);
+      const __m256i even = _mm256_mul_epi32(a, b);
+      const __m256i odd =
+          _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+      const __m256i high =
+          _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+      overflow = _mm256_xor_si256(
+          _mm256_cmpeq_epi32(high, _mm256_srai_epi32(wrapped, 31)),
+          _mm256_set1_epi32(-1));
+      base = _mm256_xor_si256(a, b);
+      return wrapped;
+    }
+  }
+};
+
+template <Operation Op, bool Saturate>
+__attribute__((target("sse4.1"))) auto
+sseBlock(const int *lhs, const int *rhs, int *out, std::size_t n)
+    -> std::uint64_t {
+  const __m128i intMax = _mm_set1_epi32(kIntMax);
+  std::uint64_t bits = 0;
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + i));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + i));
+    __m128i overflow;
+    __m128i base;
+    __m128i result = SseLanes<Op>::compute(a, b, overflow, base);
+    if constexpr (Saturate) {
+      const __m128i bound = _mm_xor_si128(_mm_srai_epi32(base, 31), intMax);
+      result = _mm_blendv_epi8(result, bound, overflow);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), result);
+    const auto lanes = static_cast<unsigned>(
+        _mm_movemask_ps(_mm_castsi128_ps(overflow)));
+    bits |= static_cast<std::uint64_t>(lanes) << i;
+  }
+  return bits |
+         (scalarBlock<Op, Saturate>(lhs + i, rhs + i, out + i, n - i) << i);
+}
+
+template <Operation Op, bool Saturate>
+__attribute__((target("avx2"))) auto
+avx2Block(const int *lhs, const int *rhs, int *out, std::size_t n)
+    -> std::uint64_t {
+  const __m256i intMax = _mm256_set1_epi32(kIntMax);
+  std::uint64_t bits = 0;
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+    __m256i overflow;
+    __m256i base;
+    __m256i result = Avx2Lanes<Op>::compute(a, b, overflow, base);
+    if constexpr (Saturate) {
+      const __m256i bound =
+          _mm256_xor_si256(_mm256_srai_epi32(base, 31), intMax);
+      result = _mm256_blendv_epi8(result, bound, overflow);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), result);
+    const auto lanes = static_cast<unsigned>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(overflow)));
+    bits |= static_cast<std::uint64_t>(lanes) << i;
+  }
+  return bits |
+         (scalarBlock<Op, Saturate>(lhs + i, rhs + i, out + i, n - i) << i);
+}
+#endif
+
+#ifdef CALCULATOR_HAS_NEON_KERNELS
+// NEON has native saturating add/subtract and a saturating narrow, so the
+// clamped result comes for free and overflow is where it differs from the
+// exact one.
+template <Operation Op, bool Saturate>
+auto neonBlock(const int *lhs, const int *rhs, int *out, std::size_t n)
+    -> std::uint64_t {
+  const uint32x4_t laneBits = {1, 2, 4, 8};
+  std::uint64_t bits = 0;
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const int32x4_t a = vld1q_s32(lhs + i);
+    const int32x4_t b = vld1q_s32(rhs + i);
+    int32x4_t wrapped;
+    int32x4_t clamped;
+    uint32x4_t overflow;
+    if constexpr (Op == Operation::Add) {
+      wrapped = vaddq_s32(a, b);
+      clamped = vqaddq_s32(a, b);
+      overflow = vmvnq_u32(vceqq_s32(wrapped, clamped));
+    } else if constexpr (Op == Operation::Subtract) {
+      wrapped = vsubq_s32(a, b);
+      clamped = vqsubq_s32(a, b);
+      overflow = vmvnq_u32(vceqq_s32(wrapped, clamped));
+    } else {
+      wrapped = vmulq_s32(a, b);
+      const int64x2_t low = vmull_s32(vget_low_s32(a), vget_low_s32(b));
+      const int64x2_t high = vmull_high_s32(a, b);
+      const int32x2_t clampedLow = vqmovn_s64(low);
+      const int32x2_t clampedHigh = vqmovn_s64(high);
+      clamped = vcombine_s32(clampedLow, clampedHigh);
+      const uint32x4_t fits =
+          vcombine_u32(vmovn_u64(vceqq_s64(vmovl_s32(clampedLow), low)),
+                       vmovn_u64(vceqq_s64(vmovl_s32(clampedHigh), high)));
+      overflow = vmvnq_u32(fits);
+    }
+    vst1q_s32(out + i, Saturate ? clamped : wrapped);
+    bits |= static_cast<std::uint64_t>(
+                vaddvq_u32(vandq_u32(overflow, laneBits)))
+            << i;
+  }
+  return bits |
+         (scalarBlock<Op, Saturate>(lhs + i, rhs + i, out + i, n - i) << i);
+}
+#endif
+
+struct OverflowKernels {
+  // Indexed by Operation.
+  BlockKernel checked[3];
+  BlockKernel saturating[3];
+};
+
+#define CALCULATOR_OVERFLOW_TABLE(block)                                       \
+  OverflowKernels {                                                            \
+    {&block<Operation::Add, false>, &block<Operation::Subtract, false>,        \
+     &block<Operation::Multiply, false>},                                      \
+    {                                                                          \
+      &block<Operation::Add, true>, &block<Operation::Subtract, true>,         \
+          &block<Operation::Multiply, true>                                    \
+    }                                                                          \
+  }
+
+auto selectOverflowKernels() -> OverflowKernels {
+#ifdef CALCULATOR_HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return CALCULATOR_OVERFLOW_TABLE(avx2Block);
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return CALCULATOR_OVERFLOW_TABLE(sseBlock);
+  }
+#elif defined(CALCULATOR_HAS_NEON_KERNELS)
+  return CALCULATOR_OVERFLOW_TABLE(neonBlock);
+#endif
+  return CALCULATOR_OVERFLOW_TABLE(scalarBlock);
+}
+
+#undef CALCULATOR_OVERFLOW_TABLE
+
+auto overflowKernels() -> const OverflowKernels & {
+  static const OverflowKernels table = selectOverflowKernels();
+  return table;
+}
+
+auto operationIndex(Operation op) -> std::size_t {
+  switch (op) {
+  case Operation::Add:
+    return 0;
+  case Operation::Subtract:
+    return 1;
+  case Operation::Multiply:
+    return 2;
+  }
+  throw std::invalid_argument("Calculator: unknown operation");
+}
+
+auto runBlocks(BlockKernel kernel, std::span<const int> lhs,
+               std::span<const int> rhs, std::span<int> out,
+               std::span<std::uint64_t> overflowMask) -> std::size_t {
+  const std::size_t n = out.size();
+  if (lhs.size() != rhs.size() || lhs.size() != n) {
+    throw std::invalid_argument("Calculator: span sizes do not match");
+  }
+  const std::size_t words = (n + kBlock - 1) / kBlock;
+  if (!overflowMask.empty() && overflowMask.size() < words) {
+    throw std::invalid_argument("Calculator: overflow mask is too small");
+  }
+  std::size_t overflows = 0;
+  for (std::size_t begin = 0; begin < n; begin += kBlock) {
+    const std::uint64_t bits =
+        kernel(lhs.data() + begin, rhs.data() + begin, out.data() + begin,
+               std::min(kBlock, n - begin));
+    if (!overflowMask.empty()) {
+      overflowMask[begin / kBlock] = bits;
+    }
+    overflows += static_cast<std::size_t>(std::popcount(bits));
+  }
+  return overflows;
+}
+
+#ifdef MY_CODE_METRICS
+auto overflowCounter(const char *mode) -> Counter & {
+  return MetricsRegistry::global().counter(
+      "my_code_calculator_overflows",
+      "Overflowing elements seen by checked and saturating batches",
+      {{"mode", mode}});
+}
+#endif
+
+} // namespace
+
+auto Calculator::checked(Operation op, std::span<const int> lhs,
+                         std::span<const int> rhs, std::span<int> out,
+                         std::span<std::uint64_t> overflowMask)
+    -> std::size_t {
+  MY_CODE_TRACE_SPAN_ITEMS("Calculator::checked", out.size());
+  const std::size_t overflows =
+      runBlocks(overflowKernels().checked[operationIndex(op)], lhs, rhs, out,
+                overflowMask);
+  MY_CODE_METRICS_ONLY(static Counter &counter = overflowCounter("checked");
+                       counter.add(overflows);)
+  return overflows;
+}
+
+auto Calculator::saturating(Operation op, std::span<const int> lhs,
+                            std::span<const int> rhs, std::span<int> out)
+    -> std::size_t {
+  MY_CODE_TRACE_SPAN_ITEMS("Calculator::saturating", out.size());
+  const std::size_t overflows = runBlocks(
+      overflowKernels().saturating[operationIndex(op)], lhs, rhs, out, {});
+  MY_CODE_METRICS_ONLY(static Counter &counter =
+                           overflowCounter("saturating");
+                       counter.add(overflows);)
+  return overflows;
+}
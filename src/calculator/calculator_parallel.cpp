@@ -0,0 +1,82 @@
+#include "calculator.hpp"
+#include <stdexcept>
+
+void Calculator::add(const ParallelOptions &options, std::span<const int> lhs,
+                     std::span<const int> rhs, std::span<int> out) {
+  apply(options, Operation::Add, lhs, rhs, out);
+}
+
+void Calculator::subtract(const ParallelOptions &options,
+                          std::span<const int> lhs, std::span<const int> rhs,
+                          std::span<int> out) {
+  apply(options, Operation::Subtract, lhs, rhs, out);
+}
+
+void Calculator::multiply(const ParallelOptions &options,
+                          std::span<const int> lhs, std::span<const int> rhs,
+                          std::span<int> out) {
+  apply(options, Operation::Multiply, lhs, rhs, out);
+}
+
+void Calculator::apply(const ParallelOptions &options, Operation op,
+                       std::span<const int> lhs, std::span<const int> rhs,
+                       std::span<int> out) {
+  if (lhs.size() != rhs.size() || lhs.size() != out.size()) {
+    throw std::invalid_argument("Calculator: span sizes do not match");
+  }
+  Scheduler::forEachChunk(
+      options, out.size(), [&](std::size_t begin, std::size_t end) {
+        apply(op, lhs.subspan(begin, end - begin),
+              rhs.subspan(begin, end - begin), out.subspan(begin, end - begin));
+      });
+}
+
+auto Calculator::checked(const ParallelOptions &options, Operation op,
+                         std::span<const int> lhs, std::span<const int> rhs,
+                         std::span<int> out,
+                         std::span<std::uint64_t> overflowMask)
+    -> std::size_t {
+  const std::size_t n = out.size();
+  if (lhs.size() != rhs.size() || lhs.size() != n) {
+    throw std::invalid_argument("Calculator: span sizes do not match");
+  }
+  if (!overflowMask.empty() && overflowMask.size() < (n + 63) / 64) {
+    throw std::invalid_argument("Calculator: overflow mask is too small");
+  }
+  // Chunks start on multiples of ParallelOptions::kAlignment, so each one
+  // owns whole mask words.
+  return parallelReduce<Operation::Add, std::size_t>(
+      options, n, [&](std::size_t begin, std::size_t end) {
+        const std::span<std::uint64_t> mask =
+            overflowMask.empty()
+                ? overflowMask
+                : overflowMask.subspan(begin / 64, (end - begin + 63) / 64);
+        return checked(op, lhs.subspan(begin, end - begin),
+                       rhs.subspan(begin, end - begin),
+                       out.subspan(begin, end - begin), mask);
+      });
+}
+
+auto Calculator::saturating(const ParallelOptions &options, Operation op,
+                            std::span<const int> lhs, std::span<const int> rhs,
+                            std::span<int> out) -> std::size_t {
+  if (lhs.size() != rhs.size() || lhs.size() != out.size()) {
+    throw std::invalid_argument("Calculator: span sizes do not match");
+  }
+  return parallelReduce<Operation::Add, std::size_t>(
+      options, out.size(), [&](std::size_t begin, std::size_t end) {
+        return saturating(op, lhs.subspan(begin, end - begin),
+                          rhs.subspan(begin, end - begin),
+                          out.subspan(begin, end - begin));
+      });
+}
+
+auto Calculator::sum(const ParallelOptions &options,
+                     std::span<const int> values) -> std::int64_t {
+  return sum<int, std::int64_t>(options, values);
+}
+
+auto Calculator::dot(const ParallelOptions &options, std::span<const int> lhs,
+                     std::span<const int> rhs) -> std::int64_t {
+  return dot<int, std::int64_t>(options, lhs, rhs);
+}
@@ -0,0 +1,162 @@
+#include "calculator.hpp"
+#include "tracing.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CALCULATOR_HAS_X86_KERNELS 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CALCULATOR_HAS_NEON_KERNELS 1
+#endif
+
+// int -> int64 reductions. 64-bit wrapping addition is associative, so the
+// vector kernels return exactly what the generic pairwise reduction does.
+
+namespace {
+
+using SumKernel = auto (*)(const int *, std::size_t) -> std::int64_t;
+using DotKernel = auto (*)(const int *, const int *, std::size_t)
+    -> std::int64_t;
+
+auto wrappingAdd(std::int64_t lhs, std::int64_t rhs) -> std::int64_t {
+  return Calculator::wrapping<Operation::Add>(lhs, rhs);
+}
+
+#ifdef CALCULATOR_HAS_X86_KERNELS
+__attribute__((target("avx2"))) auto horizontalSum(__m256i lanes)
+    -> std::int64_t {
+  alignas(32) std::int64_t parts[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(parts), lanes);
+  return wrappingAdd(wrappingAdd(parts[0], parts[1]),
+                     wrappingAdd(parts[2], parts[3]));
+}
+
+// Two accumulators of four 64-bit lanes each hide the add latency.
+__attribute__((target("avx2"))) auto avx2Sum(const int *values,
+                                             std::size_t n) -> std::int64_t {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+    acc0 = _mm256_add_epi64(
+        acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    acc1 = _mm256_add_epi64(
+        acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+  std::int64_t total = horizontalSum(_mm256_add_epi64(acc0, acc1));
+  for (; i < n; ++i) {
+    total = wrappingAdd(total, values[i]);
+  }
+  return total;
+}
+
+// _mm256_mul_epi32 multiplies the even 32-bit lanes into exact 64-bit
+// products; shifting by 32 brings the odd lanes into position.
+__attribute__((target("avx2"))) auto avx2Dot(const int *lhs, const int *rhs,
+                                             std::size_t n) -> std::int64_t {
+  __m256i even = _mm256_setzero_si256();
+  __m256i odd = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+    even = _mm256_add_epi64(even, _mm256_mul_epi32(a, b));
+    odd = _mm256_add_epi64(odd, _mm256_mul_epi32(_mm256_srli_epi64(a, 32),
+                                                 _mm256_srli_epi64(b, 32)));
+  }
+  std::int64_t total = horizontalSum(_mm256_add_epi64(even, odd));
+  for (; i < n; ++i) {
+    total = wrappingAdd(total, std::int64_t{lhs[i]} * rhs[i]);
+  }
+  return total;
+}
+#endif
+
+#ifdef CALCULATOR_HAS_NEON_KERNELS
+auto neonSum(const int *values, std::size_t n) -> std::int64_t {
+  int64x2_t acc = vdupq_n_s64(0);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc = vpadalq_s32(acc, vld1q_s32(values + i));
+  }
+  std::int64_t total = wrappingAdd(vgetq_lane_s64(acc, 0),
+                                   vgetq_lane_s64(acc, 1));
+  for (; i < n; ++i) {
+    total = wrappingAdd(total, values[i]);
+  }
+  return total;
+}
+
+auto neonDot(const int *lhs, const int *rhs, std::size_t n) -> std::int64_t {
+  int64x2_t acc = vdupq_n_s64(0);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const int32x4_t a = vld1q_s32(lhs + i);
+    const int32x4_t b = vld1q_s32(rhs + i);
+    acc = vmlal_s32(acc, vget_low_s32(a), vget_low_s32(b));
+    acc = vmlal_high_s32(acc, a, b);
+  }
+  std::int64_t total = wrappingAdd(vgetq_lane_s64(acc, 0),
+                                   vgetq_lane_s64(acc, 1));
+  for (; i < n; ++i) {
+    total = wrappingAdd(total, std::int64_t{lhs[i]} * rhs[i]);
+  }
+  return total;
+}
+#endif
+
+// Null entries fall back to the generic reduction.
+struct ReduceKernels {
+  SumKernel sum = nullptr;
+  DotKernel dot = nullptr;
+};
+
+auto selectReduceKernels() -> ReduceKernels {
+#ifdef CALCULATOR_HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return {&avx2Sum, &avx2Dot};
+  }
+#elif defined(CALCULATOR_HAS_NEON_KERNELS)
+  return {&neonSum, &neonDot};
+#endif
+  return {};
+}
+
+auto reduceKernels() -> const ReduceKernels & {
+  static const ReduceKernels table = selectReduceKernels();
+  return table;
+}
+
+} // namespace
+
+auto Calculator::sum(std::span<const int> values) -> std::int64_t {
+  MY_CODE_TRACE_SPAN_ITEMS("Calculator::sum", values.size());
+  if (const SumKernel kernel = reduceKernels().sum) {
+    return kernel(values.data(), values.size());
+  }
+  return reduce<Operation::Add, std::int64_t>(
+      values.size(),
+      [values](std::size_t i) { return std::int64_t{values[i]}; });
+}
+
+auto Calculator::dot(std::span<const int> lhs, std::span<const int> rhs)
+    -> std::int64_t {
+  if (lhs.size() != rhs.size()) {
+    throw std::invalid_argument("Calculator: span sizes do not match");
+  }
+  MY_CODE_TRACE_SPAN_ITEMS("Calculator::dot", lhs.size());
+  if (const DotKernel kernel = reduceKernels().dot) {
+    return kernel(lhs.data(), rhs.data(), lhs.size());
+  }
+  return reduce<Operation::Add, std::int64_t>(
+      lhs.size(),
+      [lhs, rhs](std::size_t i) { return std::int64_t{lhs[i]} * rhs[i]; });
+}
@@ -0,0 +1,422 @@
+#include "expression.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace {
+
+auto foldConstant(Operation op, int lhs, int rhs) -> int {
+  switch (op) {
+  case Operation::Add:
+    return Calculator::wrapping<Operation::Add>(lhs, rhs);
+  case Operation::Subtract:
+    return Calculator::wrapping<Operation::Subtract>(lhs, rhs);
+  case Operation::Multiply:
+    return Calculator::wrapping<Operation::Multiply>(lhs, rhs);
+  }
+  return 0;
+}
+
+enum class NodeKind { Variable, Constant, Operation };
+
+// Value-numbered expression DAG. Children always precede their parents, so
+// node order is a valid evaluation order.
+struct Node {
+  NodeKind kind = NodeKind::Constant;
+  Operation op = Operation::Add;
+  // Variable index or constant value.
+  int value = 0;
+  std::uint32_t lhs = 0;
+  std::uint32_t rhs = 0;
+};
+
+// Recursive-descent parser that builds the DAG directly, folding constants
+// and sharing identical nodes as it goes:
+//   expression := term (('+' | '-') term)*
+//   term       := unary ('*' unary)*
+//   unary      := ('-' | '+') unary | primary
+//   primary    := integer | identifier | '(' expression ')'
+class Parser {
+public:
+  Parser(std::string_view source, const std::vector<std::string> &variables)
+      : source_(source), variables_(variables),
+        fixedVariables_(!variables.empty()) {}
+
+  auto parse() -> std::uint32_t {
+    const std::uint32_t root = expression();
+    skipSpace();
+    if (position_ != source_.size()) {
+      fail("unexpected '" + std::string(1, source_[position_]) + "'");
+    }
+    return root;
+  }
+
+  [[nodiscard]] auto nodes() const -> const std::vector<Node> & {
+    return nodes_;
+  }
+  [[nodiscard]] auto variables() -> std::vector<std::string> & {
+    return variables_;
+  }
+
+private:
+  auto expression() -> std::uint32_t {
+    std::uint32_t node = term();
+    while (true) {
+      if (accept('+')) {
+        node = operation(Operation::Add, node, term());
+      } else if (accept('-')) {
+        node = operation(Operation::Subtract, node, term());
+      } else {
+        return node;
+      }
+    }
+  }
+
+  auto term() -> std::uint32_t {
+    std::uint32_t node = unary();
+    while (accept('*')) {
+      node = operation(Operation::Multiply, node, unary());
+    }
+    return node;
+  }
+
+  auto unary() -> std::uint32_t {
+    if (accept('-')) {
+      const std::uint32_t operand = unary();
+      return operation(Operation::Subtract, constant(0), operand);
+    }
+    if (accept('+')) {
+      return unary();
+    }
+    return primary();
+  }
+
+  auto primary() -> std::uint32_t {
+    skipSpace();
+    if (position_ == source_.size()) {
+      fail("unexpected end of expression");
+    }
+    const char c = source_[position_];
+    if (accept('(')) {
+      const std::uint32_t node = expression();
+      if (!accept(')')) {
+        fail("expected ')'");
+      }
+      return node;
+    }
+    if (isDigit(c)) {
+      const std::size_t start = position_;
+      std::int64_t value = 0;
+      while (position_ < source_.size() && isDigit(source_[position_])) {
+        value = value * 10 + (source_[position_] - '0');
+        if (value > std::numeric_limits<int>::max()) {
+          position_ = start;
+          fail("integer literal out of range");
+        }
+        ++position_;
+      }
+      return constant(static_cast<int>(value));
+    }
+    if (isIdentifierStart(c)) {
+      const std::size_t start = position_;
+      while (position_ < source_.size() &&
+             (isIdentifierStart(source_[position_]) ||
+              isDigit(source_[position_]))) {
+        ++position_;
+      }
+      return variable(start, source_.substr(start, position_ - start));
+    }
+    fail("unexpected '" + std::string(1, c) + "'");
+  }
+
+  auto variable(std::size_t start, std::string_view name) -> std::uint32_t {
+    const auto found = std::find(variables_.begin(), variables_.end(), name);
+    if (found == variables_.end() && fixedVariables_) {
+      position_ = start;
+      fail("unknown variable '" + std::string(name) + "'");
+    }
+    const auto index = static_cast<int>(found - variables_.begin());
+    if (found == variables_.end()) {
+      variables_.emplace_back(name);
+    }
+    return intern({NodeKind::Variable, Operation::Add, index, 0, 0});
+  }
+
+  auto constant(int value) -> std::uint32_t {
+    return intern({NodeKind::Constant, Operation::Add, value, 0, 0});
+  }
+
+  auto operation(Operation op, std::uint32_t lhs, std::uint32_t rhs)
+      -> std::uint32_t {
+    const auto isConstant = [this](std::uint32_t node, int value) {
+      return nodes_[node].kind == NodeKind::Constant &&
+             nodes_[node].value == value;
+    };
+    if (nodes_[lhs].kind == NodeKind::Constant &&
+        nodes_[rhs].kind == NodeKind::Constant) {
+      return constant(
+          foldConstant(op, nodes_[lhs].value, nodes_[rhs].value));
+    }
+    switch (op) {
+    case Operation::Add:
+      if (isConstant(lhs, 0)) {
+        return rhs;
+      }
+      if (isConstant(rhs, 0)) {
+        return lhs;
+      }
+      break;
+    case Operation::Subtract:
+      if (isConstant(rhs, 0)) {
+        return lhs;
+      }
+      if (lhs == rhs) {
+        return constant(0);
+      }
+      break;
+    case Operation::Multiply:
+      if (isConstant(lhs, 0) || isConstant(rhs, 0)) {
+        return constant(0);
+      }
+      if (isConstant(lhs, 1)) {
+        return rhs;
+      }
+      if (isConstant(rhs, 1)) {
+        return lhs;
+      }
+      break;
+    }
+    // Canonical operand order lets a*b and b*a share a node.
+    if (op != Operation::Subtract && lhs > rhs) {
+      std::swap(lhs, rhs);
+    }
+    return intern({NodeKind::Operation, op, 0, lhs, rhs});
+  }
+
+  auto intern(const Node &node) -> std::uint32_t {
+    const auto key = std::make_tuple(node.kind, node.op, node.value, node.lhs,
+                                     node.rhs);
+    const auto [it, inserted] =
+        ids_.try_emplace(key, static_cast<std::uint32_t>(nodes_.size()));
+    if (inserted) {
+      nodes_.push_back(node);
+    }
+    return it->second;
+  }
+
+  auto accept(char c) -> bool {
+    skipSpace();
+    if (position_ < source_.size() && source_[position_] == c) {
+      ++position_;
+      return true;
+    }
+    return false;
+  }
+
+  void skipSpace() {
+    while (position_ < source_.size() &&
+           (source_[position_] == ' ' || source_[position_] == '\t')) {
+      ++position_;
+    }
+  }
+
+  static auto isDigit(char c) -> bool { return c >= '0' && c <= '9'; }
+  static auto isIdentifierStart(char c) -> bool {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+  }
+
+  [[noreturn]] void fail(const std::string &message) const {
+    throw std::invalid_argument("Expression: " + message + " at column " +
+                                std::to_string(position_ + 1));
+  }
+
+  std::string_view source_;
+  std::vector<std::string> variables_;
+  bool fixedVariables_;
+  std::size_t position_ = 0;
+  std::vector<Node> nodes_;
+  std::map<std::tuple<NodeKind, Operation, int, std::uint32_t, std::uint32_t>,
+           std::uint32_t>
+      ids_;
+};
+
+auto tileRegister(std::span<int> scratch, std::size_t index) -> int * {
+  return scratch.data() + index * Expression::kTileRows;
+}
+
+} // namespace
+
+Expression::Expression(std::string_view source,
+                       const std::vector<std::string> &variables) {
+  Parser parser(source, variables);
+  const std::uint32_t root = parser.parse();
+  variables_ = std::move(parser.variables());
+  const std::vector<Node> &nodes = parser.nodes();
+
+  // Folding and identities can leave nodes nothing refers to.
+  std::vector<bool> live(nodes.size(), false);
+  live[root] = true;
+  for (std::size_t i = root + 1; i-- > 0;) {
+    if (live[i] && nodes[i].kind == NodeKind::Operation) {
+      live[nodes[i].lhs] = true;
+      live[nodes[i].rhs] = true;
+    }
+  }
+
+  // Position of the last instruction reading each node.
+  std::vector<std::size_t> lastUse(nodes.size(), 0);
+  std::size_t position = 0;
+  for (std::size_t i = 0; i <= root; ++i) {
+    if (live[i] && nodes[i].kind == NodeKind::Operation) {
+      lastUse[nodes[i].lhs] = position;
+      lastUse[nodes[i].rhs] = position;
+      ++position;
+    }
+  }
+
+  const auto variableCount = static_cast<std::uint32_t>(variables_.size());
+  std::vector<std::uint32_t> registers(nodes.size(), 0);
+  for (std::size_t i = 0; i <= root; ++i) {
+    if (live[i] && nodes[i].kind == NodeKind::Constant) {
+      registers[i] =
+          variableCount + static_cast<std::uint32_t>(constants_.size());
+      constants_.push_back(nodes[i].value);
+    } else if (nodes[i].kind == NodeKind::Variable) {
+      registers[i] = static_cast<std::uint32_t>(nodes[i].value);
+    }
+  }
+
+  // Linear-scan allocation of temporaries: a register is free again after
+  // the instruction that last reads it, and may be that instruction's dst
+  // since the batch kernels allow out to alias an input.
+  std::uint32_t next =
+      variableCount + static_cast<std::uint32_t>(constants_.size());
+  std::vector<std::uint32_t> freeRegisters;
+  for (std::size_t i = 0; i <= root; ++i) {
+    const Node &node = nodes[i];
+    if (!live[i] || node.kind != NodeKind::Operation) {
+      continue;
+    }
+    const std::size_t here = instructions_.size();
+    for (const std::uint32_t operand : {node.lhs, node.rhs}) {
+      if (nodes[operand].kind == NodeKind::Operation &&
+          lastUse[operand] == here &&
+          (operand == node.lhs || node.lhs != node.rhs)) {
+        freeRegisters.push_back(registers[operand]);
+      }
+    }
+    if (freeRegisters.empty()) {
+      registers[i] = next++;
+    } else {
+      registers[i] = freeRegisters.back();
+      freeRegisters.pop_back();
+    }
+    instructions_.push_back(
+        {node.op, registers[node.lhs], registers[node.rhs], registers[i]});
+  }
+  registerCount_ = next;
+  result_ = registers[root];
+}
+
+auto Expression::evaluate(std::span<const int> values) const -> int {
+  if (values.size() != variables_.size()) {
+    throw std::invalid_argument("Expression: expected " +
+                                std::to_string(variables_.size()) +
+                                " values");
+  }
+  thread_local std::vector<int> registers;
+  registers.resize(registerCount_);
+  std::copy(values.begin(), values.end(), registers.begin());
+  std::copy(constants_.begin(), constants_.end(),
+            registers.begin() + static_cast<std::ptrdiff_t>(values.size()));
+  for (const ExpressionInstruction &instruction : instructions_) {
+    registers[instruction.dst] = foldConstant(
+        instruction.op, registers[instruction.lhs], registers[instruction.rhs]);
+  }
+  return registers[result_];
+}
+
+void Expression::checkColumns(std::span<const std::span<const int>> columns,
+                              std::size_t rows) const {
+  if (columns.size() != variables_.size()) {
+    throw std::invalid_argument("Expression: expected " +
+                                std::to_string(variables_.size()) +
+                                " columns");
+  }
+  for (const std::span<const int> column : columns) {
+    if (column.size() != rows) {
+      throw std::invalid_argument("Expression: column sizes do not match");
+    }
+  }
+}
+
+void Expression::evaluate(std::span<const std::span<const int>> columns,
+                          std::span<int> out) const {
+  checkColumns(columns, out.size());
+  MY_CODE_TRACE_SPAN_ITEMS("Expression::evaluate", out.size());
+  evaluateRange(columns, 0, out.size(), out);
+}
+
+void Expression::evaluate(const ParallelOptions &options,
+                          std::span<const std::span<const int>> columns,
+                          std::span<int> out) const {
+  checkColumns(columns, out.size());
+  MY_CODE_TRACE_SPAN_ITEMS("Expression::evaluate", out.size());
+  Scheduler::forEachChunk(options, out.size(),
+                          [&](std::size_t begin, std::size_t end) {
+                            evaluateRange(columns, begin, end, out);
+                          });
+}
+
+void Expression::evaluateRange(std::span<const std::span<const int>> columns,
+                               std::size_t begin, std::size_t end,
+                               std::span<int> out) const {
+  const std::size_t variableCount = variables_.size();
+  if (instructions_.empty()) {
+    if (result_ < variableCount) {
+      const std::span<const int> column = columns[result_];
+      std::copy(column.begin() + static_cast<std::ptrdiff_t>(begin),
+                column.begin() + static_cast<std::ptrdiff_t>(end),
+                out.begin() + static_cast<std::ptrdiff_t>(begin));
+    } else {
+      std::fill(out.begin() + static_cast<std::ptrdiff_t>(begin),
+                out.begin() + static_cast<std::ptrdiff_t>(end),
+                constants_[result_ - variableCount]);
+    }
+    return;
+  }
+
+  // One tile per constant and temporary, reused across calls; constants are
+  // broadcast once per call.
+  thread_local std::vector<int> scratch;
+  scratch.resize((registerCount_ - variableCount) * kTileRows);
+  for (std::size_t k = 0; k < constants_.size(); ++k) {
+    std::fill_n(tileRegister(scratch, k), kTileRows, constants_[k]);
+  }
+
+  for (std::size_t row = begin; row < end; row += kTileRows) {
+    const std::size_t rows = std::min(kTileRows, end - row);
+    const auto input = [&](std::uint32_t index) -> std::span<const int> {
+      if (index < variableCount) {
+        return columns[index].subspan(row, rows);
+      }
+      return {tileRegister(scratch, index - variableCount), rows};
+    };
+    for (std::size_t i = 0; i < instructions_.size(); ++i) {
+      const ExpressionInstruction &instruction = instructions_[i];
+      // The last instruction computes the result straight into out.
+      const std::span<int> dst =
+          i + 1 == instructions_.size()
+              ? out.subspan(row, rows)
+              : std::span<int>(
+                    tileRegister(scratch, instruction.dst - variableCount),
+                    rows);
+      Calculator::apply(instruction.op, input(instruction.lhs),
+                        input(instruction.rhs), dst);
+    }
+  }
+}
@@ -1,8 +1,396 @@
 #pragma once
+#include "scheduler.hpp"
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// 128-bit integers are a GNU extension; the aliases keep -Wpedantic quiet.
+__extension__ using Int128 = __int128;
+__extension__ using UInt128 = unsigned __int128;
+
+// Operand types accepted by the generic Calculator templates. The standard
+// traits do not count the 128-bit types as integral in strict ISO mode, so
+// they are listed explicitly.
+template <class T>
+concept CalculatorInteger =
+    (std::integral<T> && !std::same_as<T, bool>) || std::same_as<T, Int128> ||
+    std::same_as<T, UInt128>;
+template <class T>
+concept CalculatorNumber = CalculatorInteger<T> || std::floating_point<T>;
+
+// Default accumulator of the reductions: narrow integers widen to 64 bits
+// and float widens to double, so sums of typical columns neither wrap nor
+// lose precision. 64- and 128-bit integers and wider floats accumulate in
+// their own type.
+template <CalculatorNumber T>
+using CalculatorAccumulator = std::conditional_t<
+    std::floating_point<T>,
+    std::conditional_t<(sizeof(T) < sizeof(double)), double, T>,
+    std::conditional_t<(sizeof(T) < sizeof(std::int64_t)),
+                       std::conditional_t<std::numeric_limits<T>::is_signed,
+                                          std::int64_t, std::uint64_t>,
+                       T>>;
+
+// Instruction set picked at runtime for the batch (span) entry points.
+enum class SimdLevel { Scalar, SSE41, AVX2, NEON };
+
+enum class Operation { Add, Subtract, Multiply };
 
 class Calculator {
 public:
   static auto add(int num1, int num2) -> int;
   static auto subtract(int num1, int num2) -> int;
   static auto multiply(int num1, int num2) -> int;
+
+  // Element-wise batch operations: out[i] = lhs[i] op rhs[i]. All spans must
+  // have the same size (std::invalid_argument otherwise); out may alias an
+  // input. Results wrap on overflow instead of invoking UB.
+  static void add(std::span<const int> lhs, std::span<const int> rhs,
+                  std::span<int> out);
+  static void subtract(std::span<const int> lhs, std::span<const int> rhs,
+                       std::span<int> out);
+  static void multiply(std::span<const int> lhs, std::span<const int> rhs,
+                       std::span<int> out);
+  // Runs the batch kernel for op.
+  static void apply(Operation op, std::span<const int> lhs,
+                    std::span<const int> rhs, std::span<int> out);
+
+  [[nodiscard]] static auto simdLevel() -> SimdLevel;
+
+  // Header-only forms with the operation fixed at compile time. These are
+  // constexpr and always visible to the optimiser, so they inline into the
+  // caller and fold constant operands; the out-of-line add/subtract/
+  // multiply above stay as the stable ABI.
+  template <Operation Op, class T>
+  [[nodiscard]] static constexpr auto apply(T lhs, T rhs) -> T {
+    if constexpr (Op == Operation::Add) {
+      return static_cast<T>(lhs + rhs);
+    } else if constexpr (Op == Operation::Subtract) {
+      return static_cast<T>(lhs - rhs);
+    } else {
+      static_assert(Op == Operation::Multiply);
+      return static_cast<T>(lhs * rhs);
+    }
+  }
+
+  // Left fold: fold<Op>(a, b, c) == apply<Op>(apply<Op>(a, b), c).
+  template <Operation Op, class T, class... Rest>
+  [[nodiscard]] static constexpr auto fold(T first, Rest... rest) -> T {
+    ((first = apply<Op, T>(first, static_cast<T>(rest))), ...);
+    return first;
+  }
+
+  // Explicit overflow modes for integral operands. wrapping() is two's
+  // complement modulo arithmetic, checked() returns std::nullopt when the
+  // exact result does not fit in T, and saturating() clamps to T's range.
+  // All three are branch-free and usable in constant expressions.
+  template <Operation Op, CalculatorInteger T>
+  [[nodiscard]] static constexpr auto wrapping(T lhs, T rhs) -> T {
+    return overflowing<Op>(lhs, rhs).value;
+  }
+  template <Operation Op, CalculatorInteger T>
+  [[nodiscard]] static constexpr auto checked(T lhs, T rhs)
+      -> std::optional<T> {
+    const auto result = overflowing<Op>(lhs, rhs);
+    return result.overflow ? std::nullopt : std::optional<T>(result.value);
+  }
+  template <Operation Op, CalculatorInteger T>
+  [[nodiscard]] static constexpr auto saturating(T lhs, T rhs) -> T {
+    const auto result = overflowing<Op>(lhs, rhs);
+    return result.overflow ? saturationBound<Op>(lhs, rhs) : result.value;
+  }
+
+  // Batch forms. checked() stores the wrapped results in out, sets bit i of
+  // overflowMask (if given; Notifier-style 64-bit words) for every lane that
+  // overflowed and returns the number of such lanes. saturating() clamps
+  // those lanes instead and returns how many were clamped. The batch form
+  // of wrapping() is apply().
+  static auto checked(Operation op, std::span<const int> lhs,
+                      std::span<const int> rhs, std::span<int> out,
+                      std::span<std::uint64_t> overflowMask = {})
+      -> std::size_t;
+  static auto saturating(Operation op, std::span<const int> lhs,
+                         std::span<const int> rhs, std::span<int> out)
+      -> std::size_t;
+
+  // Generic element-wise batch forms for any CalculatorNumber, called with
+  // an explicit type, e.g. Calculator::add<std::int64_t>(lhs, rhs, out).
+  // Integers wrap like the int kernels; int itself uses those kernels.
+  template <CalculatorNumber T>
+  static void add(std::span<const T> lhs, std::span<const T> rhs,
+                  std::span<T> out) {
+    transform<Operation::Add, T>(lhs, rhs, out);
+  }
+  template <CalculatorNumber T>
+  static void subtract(std::span<const T> lhs, std::span<const T> rhs,
+                       std::span<T> out) {
+    transform<Operation::Subtract, T>(lhs, rhs, out);
+  }
+  template <CalculatorNumber T>
+  static void multiply(std::span<const T> lhs, std::span<const T> rhs,
+                       std::span<T> out) {
+    transform<Operation::Multiply, T>(lhs, rhs, out);
+  }
+
+  // Reductions. Values are accumulated in Acc (integers wrap) using
+  // kReduceLanes independent accumulators that the compiler keeps in vector
+  // registers, combined pairwise over blocks of kPairwiseBlock values. The
+  // order of operations depends only on the size of the input, so floating
+  // point results are reproducible and their rounding error grows with
+  // O(log n) instead of O(n). dot() throws std::invalid_argument if the
+  // spans differ in size.
+  static auto sum(std::span<const int> values) -> std::int64_t;
+  static auto dot(std::span<const int> lhs, std::span<const int> rhs)
+      -> std::int64_t;
+
+  template <CalculatorNumber T, CalculatorNumber Acc = CalculatorAccumulator<T>>
+  [[nodiscard]] static constexpr auto sum(std::span<const T> values) -> Acc {
+    if constexpr (std::same_as<T, int> && std::same_as<Acc, std::int64_t>) {
+      if (!std::is_constant_evaluated()) {
+        return sum(values);
+      }
+    }
+    return reduce<Operation::Add, Acc>(
+        values.size(), [values](std::size_t i) { return Acc(values[i]); });
+  }
+  template <CalculatorNumber T, CalculatorNumber Acc = CalculatorAccumulator<T>>
+  [[nodiscard]] static constexpr auto product(std::span<const T> values)
+      -> Acc {
+    return reduce<Operation::Multiply, Acc>(
+        values.size(), [values](std::size_t i) { return Acc(values[i]); });
+  }
+  template <CalculatorNumber T, CalculatorNumber Acc = CalculatorAccumulator<T>>
+  [[nodiscard]] static constexpr auto dot(std::span<const T> lhs,
+                                          std::span<const T> rhs) -> Acc {
+    if (lhs.size() != rhs.size()) {
+      throw std::invalid_argument("Calculator: span sizes do not match");
+    }
+    if constexpr (std::same_as<T, int> && std::same_as<Acc, std::int64_t>) {
+      if (!std::is_constant_evaluated()) {
+        return dot(lhs, rhs);
+      }
+    }
+    return reduce<Operation::Add, Acc>(lhs.size(), [lhs, rhs](std::size_t i) {
+      return combine<Operation::Multiply>(Acc(lhs[i]), Acc(rhs[i]));
+    });
+  }
+
+  static constexpr std::size_t kReduceLanes = 8;
+  static constexpr std::size_t kPairwiseBlock = 32 * kReduceLanes;
+
+  // Parallel overloads. They split the input into chunks as described at
+  // ParallelOptions and run the sequential form on each chunk on the
+  // scheduler. Reductions
+  // combine the per-chunk results pairwise in chunk order; the chunks depend
+  // only on the size and grain, so results do not change with the thread
+  // count. Exceptions from a chunk are rethrown to the caller.
+  static void add(const ParallelOptions &options, std::span<const int> lhs,
+                  std::span<const int> rhs, std::span<int> out);
+  static void subtract(const ParallelOptions &options,
+                       std::span<const int> lhs, std::span<const int> rhs,
+                       std::span<int> out);
+  static void multiply(const ParallelOptions &options,
+                       std::span<const int> lhs, std::span<const int> rhs,
+                       std::span<int> out);
+  static void apply(const ParallelOptions &options, Operation op,
+                    std::span<const int> lhs, std::span<const int> rhs,
+                    std::span<int> out);
+  static auto checked(const ParallelOptions &options, Operation op,
+                      std::span<const int> lhs, std::span<const int> rhs,
+                      std::span<int> out,
+                      std::span<std::uint64_t> overflowMask = {})
+      -> std::size_t;
+  static auto saturating(const ParallelOptions &options, Operation op,
+                         std::span<const int> lhs, std::span<const int> rhs,
+                         std::span<int> out) -> std::size_t;
+  static auto sum(const ParallelOptions &options, std::span<const int> values)
+      -> std::int64_t;
+  static auto dot(const ParallelOptions &options, std::span<const int> lhs,
+                  std::span<const int> rhs) -> std::int64_t;
+
+  template <CalculatorNumber T>
+  static void add(const ParallelOptions &options, std::span<const T> lhs,
+                  std::span<const T> rhs, std::span<T> out) {
+    parallelTransform<Operation::Add, T>(options, lhs, rhs, out);
+  }
+  template <CalculatorNumber T>
+  static void subtract(const ParallelOptions &options, std::span<const T> lhs,
+                       std::span<const T> rhs, std::span<T> out) {
+    parallelTransform<Operation::Subtract, T>(options, lhs, rhs, out);
+  }
+  template <CalculatorNumber T>
+  static void multiply(const ParallelOptions &options, std::span<const T> lhs,
+                       std::span<const T> rhs, std::span<T> out) {
+    parallelTransform<Operation::Multiply, T>(options, lhs, rhs, out);
+  }
+  template <CalculatorNumber T, CalculatorNumber Acc = CalculatorAccumulator<T>>
+  [[nodiscard]] static auto sum(const ParallelOptions &options,
+                                std::span<const T> values) -> Acc {
+    return parallelReduce<Operation::Add, Acc>(
+        options, values.size(), [values](std::size_t begin, std::size_t end) {
+          return sum<T, Acc>(values.subspan(begin, end - begin));
+        });
+  }
+  template <CalculatorNumber T, CalculatorNumber Acc = CalculatorAccumulator<T>>
+  [[nodiscard]] static auto product(const ParallelOptions &options,
+                                    std::span<const T> values) -> Acc {
+    return parallelReduce<Operation::Multiply, Acc>(
+        options, values.size(), [values](std::size_t begin, std::size_t end) {
+          return product<T, Acc>(values.subspan(begin, end - begin));
+        });
+  }
+  template <CalculatorNumber T, CalculatorNumber Acc = CalculatorAccumulator<T>>
+  [[nodiscard]] static auto dot(const ParallelOptions &options,
+                                std::span<const T> lhs, std::span<const T> rhs)
+      -> Acc {
+    if (lhs.size() != rhs.size()) {
+      throw std::invalid_argument("Calculator: span sizes do not match");
+    }
+    return parallelReduce<Operation::Add, Acc>(
+        options, lhs.size(), [lhs, rhs](std::size_t begin, std::size_t end) {
+          return dot<T, Acc>(lhs.subspan(begin, end - begin),
+                             rhs.subspan(begin, end - begin));
+        });
+  }
+
+private:
+  template <class T> struct Overflowing {
+    T value;
+    bool overflow;
+  };
+
+  template <Operation Op, CalculatorInteger T>
+  static constexpr auto overflowing(T lhs, T rhs) -> Overflowing<T> {
+    T value{};
+    bool overflow = false;
+    if constexpr (Op == Operation::Add) {
+      overflow = __builtin_add_overflow(lhs, rhs, &value);
+    } else if constexpr (Op == Operation::Subtract) {
+      overflow = __builtin_sub_overflow(lhs, rhs, &value);
+    } else {
+      static_assert(Op == Operation::Multiply);
+      overflow = __builtin_mul_overflow(lhs, rhs, &value);
+    }
+    return {value, overflow};
+  }
+
+  // One step of Op; integers wrap instead of invoking UB.
+  template <Operation Op, CalculatorNumber T>
+  static constexpr auto combine(T lhs, T rhs) -> T {
+    if constexpr (CalculatorInteger<T>) {
+      return wrapping<Op>(lhs, rhs);
+    } else {
+      return apply<Op>(lhs, rhs);
+    }
+  }
+
+  template <Operation Op, CalculatorNumber T>
+  static void transform(std::span<const T> lhs, std::span<const T> rhs,
+                        std::span<T> out) {
+    if constexpr (std::same_as<T, int>) {
+      apply(Op, lhs, rhs, out);
+    } else {
+      if (lhs.size() != rhs.size() || lhs.size() != out.size()) {
+        throw std::invalid_argument("Calculator: span sizes do not match");
+      }
+      for (std::size_t i = 0; i < out.size(); ++i) {
+        out[i] = combine<Op>(lhs[i], rhs[i]);
+      }
+    }
+  }
+
+  template <Operation Op, CalculatorNumber T>
+  static void parallelTransform(const ParallelOptions &options,
+                                std::span<const T> lhs, std::span<const T> rhs,
+                                std::span<T> out) {
+    if (lhs.size() != rhs.size() || lhs.size() != out.size()) {
+      throw std::invalid_argument("Calculator: span sizes do not match");
+    }
+    Scheduler::forEachChunk(
+        options, out.size(), [&](std::size_t begin, std::size_t end) {
+          transform<Op, T>(lhs.subspan(begin, end - begin),
+                           rhs.subspan(begin, end - begin),
+                           out.subspan(begin, end - begin));
+        });
+  }
+
+  template <Operation Op, class Acc, class Chunk>
+  static auto parallelReduce(const ParallelOptions &options, std::size_t count,
+                             const Chunk &chunk) -> Acc {
+    const std::size_t size = options.chunkSize();
+    std::vector<Acc> partials((count + size - 1) / size);
+    Scheduler::forEachChunk(options, count,
+                            [&](std::size_t begin, std::size_t end) {
+                              partials[begin / size] = chunk(begin, end);
+                            });
+    return reduce<Op, Acc>(partials.size(),
+                           [&partials](std::size_t i) { return partials[i]; });
+  }
+
+  // Folds load(i) for i in [begin, end) into kReduceLanes accumulators,
+  // then combines the lanes as a balanced tree.
+  template <Operation Op, class Acc, class Load>
+  static constexpr auto reduceBlock(std::size_t begin, std::size_t end,
+                                    const Load &load) -> Acc {
+    constexpr Acc kIdentity = Op == Operation::Multiply ? Acc(1) : Acc(0);
+    Acc lanes[kReduceLanes];
+    for (Acc &lane : lanes) {
+      lane = kIdentity;
+    }
+    std::size_t i = begin;
+    for (; i + kReduceLanes <= end; i += kReduceLanes) {
+      for (std::size_t k = 0; k < kReduceLanes; ++k) {
+        lanes[k] = combine<Op>(lanes[k], load(i + k));
+      }
+    }
+    for (; i < end; ++i) {
+      lanes[i % kReduceLanes] = combine<Op>(lanes[i % kReduceLanes], load(i));
+    }
+    for (std::size_t width = kReduceLanes / 2; width > 0; width /= 2) {
+      for (std::size_t k = 0; k < width; ++k) {
+        lanes[k] = combine<Op>(lanes[k], lanes[k + width]);
+      }
+    }
+    return lanes[0];
+  }
+
+  // Splits at a lane-aligned midpoint until blocks are small enough.
+  template <Operation Op, class Acc, class Load>
+  static constexpr auto reduceRange(std::size_t begin, std::size_t end,
+                                    const Load &load) -> Acc {
+    if (end - begin <= kPairwiseBlock) {
+      return reduceBlock<Op, Acc>(begin, end, load);
+    }
+    const std::size_t mid =
+        begin + (end - begin) / (2 * kReduceLanes) * kReduceLanes;
+    return combine<Op>(reduceRange<Op, Acc>(begin, mid, load),
+                       reduceRange<Op, Acc>(mid, end, load));
+  }
+
+  template <Operation Op, class Acc, class Load>
+  static constexpr auto reduce(std::size_t count, const Load &load) -> Acc {
+    return reduceRange<Op, Acc>(0, count, load);
+  }
+
+  // The bound an overflowing operation is clamped to.
+  template <Operation Op, CalculatorInteger T>
+  static constexpr auto saturationBound(T lhs, T rhs) -> T {
+    constexpr T kMax = std::numeric_limits<T>::max();
+    constexpr T kMin = std::numeric_limits<T>::min();
+    if constexpr (!std::numeric_limits<T>::is_signed) {
+      return Op == Operation::Subtract ? kMin : kMax;
+    } else if constexpr (Op == Operation::Multiply) {
+      return (lhs < 0) != (rhs < 0) ? kMin : kMax;
+    } else {
+      // Add and subtract can only overflow away from lhs's sign.
+      static_cast<void>(rhs);
+      return lhs < 0 ? kMin : kMax;
+    }
+  }
 };
@@ -0,0 +1,85 @@
+#pragma once
+#include "calculator.hpp"
+#include "scheduler.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One bytecode step: registers[dst] = registers[lhs] op registers[rhs].
+// Registers [0, variables) hold the input columns, the next constants()
+// registers the literals, and the rest are temporaries reused once their
+// value is dead.
+struct ExpressionInstruction {
+  Operation op = Operation::Add;
+  std::uint32_t lhs = 0;
+  std::uint32_t rhs = 0;
+  std::uint32_t dst = 0;
+};
+
+// Integer formula over named variables, such as "a*b + c" or
+// "(x - 3) * (x - 3)", compiled once into a flat register bytecode and then
+// evaluated over any number of rows. Supports decimal literals, + - * with
+// the usual precedence, unary minus and parentheses; arithmetic wraps like
+// the Calculator batch operations.
+//
+// Compilation folds constant subexpressions, drops identities (x + 0, x * 1,
+// x * 0, x - x) and shares repeated subexpressions, so "(x-3)*(x-3)"
+// computes x - 3 once. Evaluation allocates nothing per row.
+class Expression {
+public:
+  // Columns are passed to evaluate() in the order of variables; if it is
+  // empty, in order of first appearance in source. Throws
+  // std::invalid_argument for a syntax error, an out-of-range literal or a
+  // name missing from a non-empty variables list.
+  explicit Expression(std::string_view source,
+                      const std::vector<std::string> &variables = {});
+
+  [[nodiscard]] auto variables() const -> const std::vector<std::string> & {
+    return variables_;
+  }
+  [[nodiscard]] auto instructions() const
+      -> const std::vector<ExpressionInstruction> & {
+    return instructions_;
+  }
+  [[nodiscard]] auto constants() const -> const std::vector<int> & {
+    return constants_;
+  }
+  // Total registers: variables, constants and temporaries.
+  [[nodiscard]] auto registerCount() const -> std::size_t {
+    return registerCount_;
+  }
+
+  // One row: values[v] is variable v. Throws std::invalid_argument if the
+  // count does not match variables().
+  [[nodiscard]] auto evaluate(std::span<const int> values) const -> int;
+  // Columnar batch: out[i] is the result for row i of columns, where
+  // columns[v] holds variable v. Every column must be as long as out, which
+  // may alias one of them. Rows are processed in tiles of kTileRows, each
+  // instruction running the Calculator batch kernel over a whole tile.
+  void evaluate(std::span<const std::span<const int>> columns,
+                std::span<int> out) const;
+  // Same, with the rows split across the scheduler.
+  void evaluate(const ParallelOptions &options,
+                std::span<const std::span<const int>> columns,
+                std::span<int> out) const;
+
+  static constexpr std::size_t kTileRows = 512;
+
+private:
+  void checkColumns(std::span<const std::span<const int>> columns,
+                    std::size_t rows) const;
+  // Rows [begin, end) of already validated columns.
+  void evaluateRange(std::span<const std::span<const int>> columns,
+                     std::size_t begin, std::size_t end,
+                     std::span<int> out) const;
+
+  std::vector<std::string> variables_;
+  std::vector<int> constants_;
+  std::vector<ExpressionInstruction> instructions_;
+  std::size_t registerCount_ = 0;
+  // Register holding the value, used when there are no instructions.
+  std::uint32_t result_ = 0;
+};
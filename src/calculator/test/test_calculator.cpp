@@ -1,5 +1,10 @@
 #include "calculator.hpp"
 #include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
 
 TEST(CalculatorTests, TestAddition) {
   Calculator calc;
@@ -15,3 +20,274 @@ TEST(CalculatorTests, TestMultiplication) {
   Calculator calc;
   EXPECT_EQ(calc.multiply(4, 2), 8);
 }
+
+TEST(CalculatorTests, TestBatchMatchesScalar) {
+  // 37 exercises the unrolled body, a single vector and the scalar tail.
+  constexpr int kCount = 37;
+  std::vector<int> lhs(kCount);
+  std::vector<int> rhs(kCount);
+  for (int i = 0; i < kCount; ++i) {
+    lhs[i] = i * 7 - 100;
+    rhs[i] = 3 - i;
+  }
+
+  std::vector<int> sum(kCount);
+  std::vector<int> difference(kCount);
+  std::vector<int> product(kCount);
+  Calculator::add(lhs, rhs, sum);
+  Calculator::subtract(lhs, rhs, difference);
+  Calculator::multiply(lhs, rhs, product);
+
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_EQ(sum[i], Calculator::add(lhs[i], rhs[i]));
+    EXPECT_EQ(difference[i], Calculator::subtract(lhs[i], rhs[i]));
+    EXPECT_EQ(product[i], Calculator::multiply(lhs[i], rhs[i]));
+  }
+}
+
+TEST(CalculatorTests, TestBatchInPlaceAndEmpty) {
+  std::vector<int> values{1, 2, 3, 4, 5, 6, 7, 8, 9};
+  Calculator::add(values, values, values);
+  EXPECT_EQ(values, (std::vector<int>{2, 4, 6, 8, 10, 12, 14, 16, 18}));
+
+  std::vector<int> empty;
+  EXPECT_NO_THROW(Calculator::multiply(empty, empty, empty));
+}
+
+TEST(CalculatorTests, TestBatchSizeMismatchThrows) {
+  std::vector<int> lhs{1, 2, 3};
+  std::vector<int> rhs{1, 2};
+  std::vector<int> out(3);
+  EXPECT_THROW(Calculator::add(lhs, rhs, out), std::invalid_argument);
+}
+
+TEST(CalculatorTests, TestCompileTimeApply) {
+  static_assert(Calculator::apply<Operation::Add>(2, 3) == 5);
+  static_assert(Calculator::apply<Operation::Subtract>(5, 3) == 2);
+  static_assert(Calculator::apply<Operation::Multiply>(4, 2) == 8);
+  static_assert(Calculator::fold<Operation::Multiply>(2, 3, 4) == 24);
+  static_assert(Calculator::apply<Operation::Add>(1.5, 2.25) == 3.75);
+  static_assert(Calculator::apply<Operation::Multiply>(
+                    std::int64_t{1} << 40, std::int64_t{4}) ==
+                std::int64_t{1} << 42);
+
+  const int lhs = 7;
+  const int rhs = -9;
+  EXPECT_EQ(Calculator::apply<Operation::Add>(lhs, rhs),
+            Calculator::add(lhs, rhs));
+  EXPECT_EQ(Calculator::fold<Operation::Subtract>(lhs, rhs, 1), 15);
+}
+
+TEST(CalculatorTests, TestOverflowModes) {
+  constexpr int kMax = std::numeric_limits<int>::max();
+  constexpr int kMin = std::numeric_limits<int>::min();
+  static_assert(!Calculator::checked<Operation::Add>(kMax, 1).has_value());
+  static_assert(Calculator::checked<Operation::Add>(kMax, -1) == kMax - 1);
+  static_assert(Calculator::wrapping<Operation::Add>(kMax, 1) == kMin);
+  static_assert(Calculator::saturating<Operation::Add>(kMax, 1) == kMax);
+  static_assert(Calculator::saturating<Operation::Subtract>(kMin, 1) == kMin);
+  static_assert(Calculator::saturating<Operation::Subtract>(0, kMin) == kMax);
+  static_assert(Calculator::saturating<Operation::Multiply>(kMin, -1) == kMax);
+  static_assert(Calculator::saturating<Operation::Multiply>(46341, -46341) ==
+                kMin);
+  static_assert(Calculator::saturating<Operation::Subtract>(2U, 3U) == 0U);
+  static_assert(Calculator::saturating<Operation::Add>(std::uint8_t{200},
+                                                       std::uint8_t{100}) ==
+                255);
+  EXPECT_EQ(Calculator::checked<Operation::Multiply>(std::int64_t{1} << 40,
+                                                     std::int64_t{1} << 30),
+            std::nullopt);
+}
+
+TEST(CalculatorTests, TestBatchOverflowMatchesScalar) {
+  constexpr int kMax = std::numeric_limits<int>::max();
+  constexpr int kMin = std::numeric_limits<int>::min();
+  const std::vector<int> edges{kMax, kMin, -1, 0, 1, 46341, -46341, 65536,
+                               kMax / 2, kMin / 2 - 1};
+  // Every pair of edge values: 100 lanes spans two mask words and a tail.
+  std::vector<int> lhs;
+  std::vector<int> rhs;
+  for (const int a : edges) {
+    for (const int b : edges) {
+      lhs.push_back(a);
+      rhs.push_back(b);
+    }
+  }
+  const std::size_t count = lhs.size();
+
+  for (const Operation op :
+       {Operation::Add, Operation::Subtract, Operation::Multiply}) {
+    std::vector<int> checked(count);
+    std::vector<int> saturated(count);
+    std::vector<std::uint64_t> mask(2);
+    const std::size_t overflows =
+        Calculator::checked(op, lhs, rhs, checked, mask);
+    EXPECT_EQ(Calculator::saturating(op, lhs, rhs, saturated), overflows);
+
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      std::optional<int> exact;
+      int wrapped = 0;
+      int clamped = 0;
+      switch (op) {
+      case Operation::Add:
+        exact = Calculator::checked<Operation::Add>(lhs[i], rhs[i]);
+        wrapped = Calculator::wrapping<Operation::Add>(lhs[i], rhs[i]);
+        clamped = Calculator::saturating<Operation::Add>(lhs[i], rhs[i]);
+        break;
+      case Operation::Subtract:
+        exact = Calculator::checked<Operation::Subtract>(lhs[i], rhs[i]);
+        wrapped = Calculator::wrapping<Operation::Subtract>(lhs[i], rhs[i]);
+        clamped = Calculator::saturating<Operation::Subtract>(lhs[i], rhs[i]);
+        break;
+      case Operation::Multiply:
+        exact = Calculator::checked<Operation::Multiply>(lhs[i], rhs[i]);
+        wrapped = Calculator::wrapping<Operation::Multiply>(lhs[i], rhs[i]);
+        clamped = Calculator::saturating<Operation::Multiply>(lhs[i], rhs[i]);
+        break;
+      }
+      const bool overflowed = ((mask[i / 64] >> (i % 64)) & 1U) != 0;
+      EXPECT_EQ(overflowed, !exact.has_value()) << "lane " << i;
+      EXPECT_EQ(checked[i], wrapped) << "lane " << i;
+      EXPECT_EQ(saturated[i], clamped) << "lane " << i;
+      expected += exact.has_value() ? 0 : 1;
+    }
+    EXPECT_EQ(overflows, expected);
+    EXPECT_GT(overflows, 0U);
+  }
+
+  std::vector<int> out(count);
+  std::vector<std::uint64_t> tooSmall(1);
+  EXPECT_THROW(Calculator::checked(Operation::Add, lhs, rhs, out, tooSmall),
+               std::invalid_argument);
+}
+
+TEST(CalculatorTests, TestGenericBatchTypes) {
+  const std::vector<std::int64_t> wideLhs{std::int64_t{1} << 40, -5, 7};
+  const std::vector<std::int64_t> wideRhs{3, std::int64_t{1} << 33, -2};
+  std::vector<std::int64_t> wide(3);
+  Calculator::multiply<std::int64_t>(wideLhs, wideRhs, wide);
+  EXPECT_EQ(wide, (std::vector<std::int64_t>{3 * (std::int64_t{1} << 40),
+                                              -5 * (std::int64_t{1} << 33),
+                                              -14}));
+
+  const std::vector<double> real{0.5, -1.25};
+  std::vector<double> realOut(2);
+  Calculator::subtract<double>(real, real, realOut);
+  EXPECT_EQ(realOut, (std::vector<double>{0.0, 0.0}));
+
+  const std::vector<Int128> huge{Int128{1} << 100};
+  std::vector<Int128> hugeOut(1);
+  Calculator::add<Int128>(huge, huge, hugeOut);
+  EXPECT_TRUE(hugeOut[0] == Int128{1} << 101);
+  static_assert(!Calculator::checked<Operation::Multiply>(Int128{1} << 100,
+                                                          Int128{1} << 30)
+                     .has_value());
+  static_assert(Calculator::saturating<Operation::Subtract>(UInt128{1},
+                                                            UInt128{2}) == 0);
+
+  std::vector<int> ints{1, 2, 3};
+  std::vector<int> intOut(3);
+  Calculator::add<int>(ints, ints, intOut);
+  EXPECT_EQ(intOut, (std::vector<int>{2, 4, 6}));
+  std::vector<std::int64_t> tooShort(2);
+  EXPECT_THROW(Calculator::add<std::int64_t>(wideLhs, wideRhs, tooShort),
+               std::invalid_argument);
+}
+
+TEST(CalculatorTests, TestReductions) {
+  static constexpr int kSmall[] = {1, 2, 3, 4, 5};
+  static_assert(Calculator::sum<int>(kSmall) == 15);
+  static_assert(Calculator::product<int>(kSmall) == 120);
+  static_assert(Calculator::dot<int>(kSmall, kSmall) == 55);
+
+  // Sizes around the lane count and the pairwise block size.
+  for (const std::size_t count :
+       {std::size_t{0}, std::size_t{7}, std::size_t{8}, std::size_t{257},
+        std::size_t{1000}}) {
+    std::vector<int> lhs(count);
+    std::vector<int> rhs(count);
+    std::int64_t expectedSum = 0;
+    std::int64_t expectedDot = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      lhs[i] = std::numeric_limits<int>::max() - static_cast<int>(i);
+      rhs[i] = (i % 2 == 0 ? -1 : 1) * static_cast<int>(i * 31);
+      expectedSum += lhs[i];
+      expectedDot += std::int64_t{lhs[i]} * rhs[i];
+    }
+    EXPECT_EQ(Calculator::sum(lhs), expectedSum) << count;
+    EXPECT_EQ(Calculator::sum<int>(lhs), expectedSum) << count;
+    EXPECT_EQ(Calculator::dot(lhs, rhs), expectedDot) << count;
+    EXPECT_EQ((Calculator::sum<int, Int128>(lhs)), Int128{expectedSum});
+  }
+
+  // float accumulates in double, so a million small terms stay accurate.
+  const std::vector<float> tenths(1'000'000, 0.1F);
+  EXPECT_NEAR(Calculator::sum<float>(tenths), 1e6 * double{0.1F}, 1e-6);
+  EXPECT_DOUBLE_EQ(Calculator::product<double>(std::vector<double>(10, 2.0)),
+                   1024.0);
+
+  std::vector<int> shorter(3);
+  std::vector<int> longer(4);
+  EXPECT_THROW(static_cast<void>(Calculator::dot(shorter, longer)),
+               std::invalid_argument);
+}
+
+TEST(CalculatorTests, TestParallelMatchesSequential) {
+  // Small grain so the 10'000 elements span ten chunks of 1024.
+  const ParallelOptions options{.threads = 4, .grain = 1};
+  constexpr std::size_t kCount = 10'000;
+  std::vector<int> lhs(kCount);
+  std::vector<int> rhs(kCount);
+  for (std::size_t i = 0; i < kCount; ++i) {
+    lhs[i] = static_cast<int>(i * 2'654'435'761U);
+    rhs[i] = static_cast<int>(i) - 5'000;
+  }
+
+  std::vector<int> sequential(kCount);
+  std::vector<int> parallel(kCount);
+  Calculator::multiply(lhs, rhs, sequential);
+  Calculator::multiply(options, lhs, rhs, parallel);
+  EXPECT_EQ(parallel, sequential);
+
+  std::vector<std::uint64_t> sequentialMask((kCount + 63) / 64);
+  std::vector<std::uint64_t> parallelMask(sequentialMask.size());
+  EXPECT_EQ(Calculator::checked(options, Operation::Add, lhs, rhs, parallel,
+                                parallelMask),
+            Calculator::checked(Operation::Add, lhs, rhs, sequential,
+                                sequentialMask));
+  EXPECT_EQ(parallelMask, sequentialMask);
+  EXPECT_EQ(Calculator::saturating(options, Operation::Multiply, lhs, rhs,
+                                   parallel),
+            Calculator::saturating(Operation::Multiply, lhs, rhs, sequential));
+  EXPECT_EQ(parallel, sequential);
+
+  EXPECT_EQ(Calculator::sum(options, lhs), Calculator::sum(lhs));
+  EXPECT_EQ(Calculator::dot(options, lhs, rhs), Calculator::dot(lhs, rhs));
+
+  std::vector<std::int64_t> wide(lhs.begin(), lhs.end());
+  std::vector<std::int64_t> wideOut(kCount);
+  Calculator::add<std::int64_t>(options, wide, wide, wideOut);
+  for (std::size_t i = 0; i < kCount; ++i) {
+    ASSERT_EQ(wideOut[i], 2 * wide[i]);
+  }
+
+  std::vector<int> shorter(kCount - 1);
+  EXPECT_THROW(Calculator::add(options, lhs, shorter, parallel),
+               std::invalid_argument);
+}
+
+TEST(CalculatorTests, TestParallelReductionIsDeterministic) {
+  std::vector<double> values(50'000);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = 1.0 / static_cast<double>(i + 1);
+  }
+  const double reference =
+      Calculator::sum<double>(ParallelOptions{.threads = 1, .grain = 4096},
+                              values);
+  for (const std::size_t threads : {2U, 3U, 8U, 0U}) {
+    const ParallelOptions options{.threads = threads, .grain = 4096};
+    EXPECT_EQ(Calculator::sum<double>(options, values), reference) << threads;
+  }
+  EXPECT_NEAR(reference, Calculator::sum<double>(values), 1e-12);
+}
@@ -0,0 +1,143 @@
+#include "expression.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST(ExpressionTests, TestParsesAndEvaluatesRows) {
+  const Expression expression("a*b + c");
+  EXPECT_EQ(expression.variables(),
+            (std::vector<std::string>{"a", "b", "c"}));
+  EXPECT_EQ(expression.evaluate(std::vector<int>{3, 4, 5}), 17);
+
+  EXPECT_EQ(Expression("2 + 3 * 4").evaluate({}), 14);
+  EXPECT_EQ(Expression("(2 + 3) * 4").evaluate({}), 20);
+  EXPECT_EQ(Expression("10 - 4 - 3").evaluate({}), 3);
+  EXPECT_EQ(Expression("-x * -(y - 1) + +2").evaluate(std::vector<int>{3, 5}),
+            14);
+
+  // Explicit column order; unused names still take a column.
+  const Expression ordered("b - a", {"a", "b", "unused"});
+  EXPECT_EQ(ordered.evaluate(std::vector<int>{1, 10, 99}), 9);
+
+  // Arithmetic wraps like the Calculator batch operations.
+  const int max = std::numeric_limits<int>::max();
+  EXPECT_EQ(Expression("x + 1").evaluate(std::vector<int>{max}),
+            std::numeric_limits<int>::min());
+  EXPECT_EQ(Expression("2147483647 * 2").evaluate({}), -2);
+}
+
+TEST(ExpressionTests, TestSharesCommonSubexpressions) {
+  const Expression square("(x - 3) * (x - 3)");
+  ASSERT_EQ(square.instructions().size(), 2u);
+  EXPECT_EQ(square.instructions()[0].op, Operation::Subtract);
+  EXPECT_EQ(square.instructions()[1].op, Operation::Multiply);
+  EXPECT_EQ(square.evaluate(std::vector<int>{7}), 16);
+
+  // Operands of + and * are ordered, so a*b and b*a are one value.
+  EXPECT_EQ(Expression("a*b + b*a").instructions().size(), 2u);
+  EXPECT_EQ(Expression("a-b + b-a").instructions().size(), 3u);
+}
+
+TEST(ExpressionTests, TestFoldsConstantsAndIdentities) {
+  const Expression folded("2 * 3 + x * (4 - 3)");
+  ASSERT_EQ(folded.instructions().size(), 1u);
+  EXPECT_EQ(folded.constants(), (std::vector<int>{6}));
+  EXPECT_EQ(folded.evaluate(std::vector<int>{1}), 7);
+
+  const Expression constant("x * 0 + (y - y) + 5");
+  EXPECT_TRUE(constant.instructions().empty());
+  EXPECT_EQ(constant.evaluate(std::vector<int>{8, 9}), 5);
+
+  const Expression identity("(x + 0) * 1 - 0");
+  EXPECT_TRUE(identity.instructions().empty());
+  EXPECT_TRUE(identity.constants().empty());
+  EXPECT_EQ(identity.evaluate(std::vector<int>{-4}), -4);
+  EXPECT_EQ(Expression("-5").constants(), (std::vector<int>{-5}));
+}
+
+TEST(ExpressionTests, TestReusesTemporaryRegisters) {
+  // Four independent sums and differences need at most two live temps.
+  const Expression expression("(a + b) * (c + d) + (a - b) * (c - d)");
+  EXPECT_EQ(expression.instructions().size(), 7u);
+  EXPECT_LE(expression.registerCount(), expression.variables().size() + 3);
+  EXPECT_EQ(expression.evaluate(std::vector<int>{5, 2, 4, 1}), 35 + 9);
+}
+
+TEST(ExpressionTests, TestBatchMatchesRows) {
+  // Several full tiles plus a partial one.
+  const std::size_t rows = Expression::kTileRows * 3 + 77;
+  std::vector<int> a(rows);
+  std::vector<int> b(rows);
+  std::vector<int> c(rows);
+  std::uint32_t state = 12345;
+  const auto next = [&state] {
+    state = state * 1'664'525U + 1'013'904'223U;
+    return static_cast<int>(state);
+  };
+  for (std::size_t i = 0; i < rows; ++i) {
+    a[i] = next();
+    b[i] = next() % 1000;
+    c[i] = static_cast<int>(i);
+  }
+  const std::vector<std::span<const int>> columns{a, b, c};
+
+  for (const char *source :
+       {"a*b + c", "(a - 7) * (a - 7) - b*c", "c", "42", "-(a + b) * 3"}) {
+    const Expression expression(source, {"a", "b", "c"});
+    std::vector<int> out(rows);
+    expression.evaluate(columns, out);
+    std::vector<int> parallel(rows);
+    expression.evaluate(ParallelOptions{.threads = 4, .grain = 1},
+                        columns, parallel);
+    for (std::size_t i = 0; i < rows; ++i) {
+      const int expected =
+          expression.evaluate(std::vector<int>{a[i], b[i], c[i]});
+      ASSERT_EQ(out[i], expected) << source << " row " << i;
+      ASSERT_EQ(parallel[i], expected) << source << " row " << i;
+    }
+  }
+
+  // out may alias an input column.
+  std::vector<int> inPlace = c;
+  const std::vector<std::span<const int>> aliased{a, b, inPlace};
+  Expression("a*b + c", {"a", "b", "c"}).evaluate(aliased, inPlace);
+  for (std::size_t i = 0; i < rows; ++i) {
+    ASSERT_EQ(inPlace[i], Calculator::wrapping<Operation::Add>(
+                              Calculator::wrapping<Operation::Multiply>(a[i],
+                                                                        b[i]),
+                              c[i]));
+  }
+}
+
+TEST(ExpressionTests, TestRejectsInvalidInput) {
+  EXPECT_THROW(Expression(""), std::invalid_argument);
+  EXPECT_THROW(Expression("a +"), std::invalid_argument);
+  EXPECT_THROW(Expression("a * (b"), std::invalid_argument);
+  EXPECT_THROW(Expression("a b"), std::invalid_argument);
+  EXPECT_THROW(Expression("3 $ 4"), std::invalid_argument);
+  EXPECT_THROW(Expression("2147483648"), std::invalid_argument);
+  EXPECT_THROW(Expression("a + q", {"a"}), std::invalid_argument);
+  try {
+    Expression("a + )");
+    FAIL() << "expected std::invalid_argument";
+  } catch (const std::invalid_argument &error) {
+    EXPECT_STREQ(error.what(), "Expression: unexpected ')' at column 5");
+  }
+
+  const Expression expression("a + b");
+  EXPECT_THROW(static_cast<void>(expression.evaluate(std::vector<int>{1})),
+               std::invalid_argument);
+  const std::vector<int> three{1, 2, 3};
+  const std::vector<int> two{1, 2};
+  std::vector<int> out(3);
+  EXPECT_THROW(expression.evaluate(
+                   std::vector<std::span<const int>>{three}, out),
+               std::invalid_argument);
+  EXPECT_THROW(expression.evaluate(
+                   std::vector<std::span<const int>>{three, two}, out),
+               std::invalid_argument);
+}
@@ -0,0 +1,288 @@
+#include "binary_log.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t kVersionOffset = 8;
+constexpr std::size_t kHeaderSizeOffset = 12;
+constexpr std::size_t kDataEndOffset = 16;
+constexpr std::size_t kRecordCountOffset = 24;
+// A 32-bit value needs at most five 7-bit groups.
+constexpr std::size_t kMaxVarint32 = 5;
+
+// The data end and record count are published to live readers with single
+// atomic stores into the mapping, so they are kept in host layout.
+static_assert(std::endian::native == std::endian::little,
+              "binary log headers are published in host byte order");
+constexpr std::size_t kFieldAlignment =
+    std::atomic_ref<std::uint64_t>::required_alignment;
+static_assert(kDataEndOffset % kFieldAlignment == 0 &&
+              kRecordCountOffset % kFieldAlignment == 0);
+
+[[noreturn]] void throwErrno(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+[[noreturn]] void throwCorrupt() {
+  throw std::runtime_error("BinaryLogReader: corrupt segment");
+}
+
+void storeLe(char *out, std::uint64_t value, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    out[i] = static_cast<char>((value >> (8 * i)) & 0xFFU);
+  }
+}
+
+auto loadLe(const char *in, std::size_t bytes) -> std::uint64_t {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(in[i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+// at is an 8-byte aligned header field of a page-aligned mapping.
+auto headerField(const char *at) -> std::atomic_ref<std::uint64_t> {
+  return std::atomic_ref<std::uint64_t>(
+      *reinterpret_cast<std::uint64_t *>(const_cast<char *>(at)));
+}
+
+auto putVarint(char *out, std::uint32_t value) -> std::size_t {
+  std::size_t n = 0;
+  while (value >= 0x80U) {
+    out[n++] = static_cast<char>((value & 0x7FU) | 0x80U);
+    value >>= 7U;
+  }
+  out[n++] = static_cast<char>(value);
+  return n;
+}
+
+auto getVarint(const char *data, std::size_t end, std::size_t &offset)
+    -> std::uint32_t {
+  std::uint32_t value = 0;
+  for (std::size_t shift = 0; shift < 7 * kMaxVarint32; shift += 7) {
+    if (offset >= end) {
+      throwCorrupt();
+    }
+    const auto byte = static_cast<unsigned char>(data[offset++]);
+    value |= static_cast<std::uint32_t>(byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0) {
+      return value;
+    }
+  }
+  throwCorrupt();
+}
+
+auto zigzag(int value) -> std::uint32_t {
+  const auto bits = static_cast<std::uint32_t>(value);
+  return (bits << 1U) ^ (value < 0 ? 0xFFFFFFFFU : 0U);
+}
+
+auto unzigzag(std::uint32_t value) -> int {
+  return static_cast<int>((value >> 1U) ^ (~(value & 1U) + 1U));
+}
+
+} // namespace
+
+BinaryLogWriter::BinaryLogWriter(const std::filesystem::path &path,
+                                 std::size_t initialCapacity) {
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    throwErrno("BinaryLogWriter: cannot open " + path.string());
+  }
+  try {
+    map(std::max(initialCapacity, 2 * binary_log::kHeaderSize));
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+  std::memcpy(base_, binary_log::kMagic.data(), binary_log::kMagic.size());
+  storeLe(base_ + kVersionOffset, binary_log::kVersion, 4);
+  storeLe(base_ + kHeaderSizeOffset, binary_log::kHeaderSize, 4);
+  writeHeader();
+}
+
+BinaryLogWriter::~BinaryLogWriter() { close(); }
+
+void BinaryLogWriter::map(std::size_t capacity) {
+  if (::ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+    throwErrno("BinaryLogWriter: cannot grow segment");
+  }
+  void *mapping =
+      ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (mapping == MAP_FAILED) {
+    throwErrno("BinaryLogWriter: cannot map segment");
+  }
+  base_ = static_cast<char *>(mapping);
+  capacity_ = capacity;
+}
+
+void BinaryLogWriter::reserve(std::size_t extra) {
+  if (end_ + extra <= capacity_) {
+    return;
+  }
+  ::munmap(base_, capacity_);
+  base_ = nullptr;
+  map(std::max(2 * capacity_, end_ + extra));
+}
+
+// The data end is released after the entries it covers and the count after
+// the data end, so a reader that acquires the count first never sees more
+// records than the data it then acquires.
+void BinaryLogWriter::writeHeader() {
+  headerField(base_ + kDataEndOffset).store(end_, std::memory_order_release);
+  headerField(base_ + kRecordCountOffset)
+      .store(recordCount_, std::memory_order_release);
+}
+
+void BinaryLogWriter::append(std::string_view operation, int result) {
+  if (base_ == nullptr) {
+    throw std::logic_error("BinaryLogWriter: append after close");
+  }
+  if (operation.size() > 0x7FFFFFFFU) {
+    throw std::invalid_argument("BinaryLogWriter: operation is too long");
+  }
+  reserve(operation.size() + 3 * kMaxVarint32);
+
+  auto found = operationIds_.find(operation);
+  if (found == operationIds_.end()) {
+    const auto length = static_cast<std::uint32_t>(operation.size());
+    end_ += putVarint(base_ + end_, (length << 1U) | 1U);
+    std::memcpy(base_ + end_, operation.data(), operation.size());
+    end_ += operation.size();
+    const auto id = static_cast<std::uint32_t>(operationIds_.size());
+    found = operationIds_.emplace(std::string(operation), id).first;
+  }
+  end_ += putVarint(base_ + end_, found->second << 1U);
+  end_ += putVarint(base_ + end_, zigzag(result));
+  ++recordCount_;
+  writeHeader();
+}
+
+void BinaryLogWriter::append(const LogRecordRange &records) {
+  for (const LogEntry entry : records) {
+    append(entry.operation, entry.result);
+  }
+}
+
+void BinaryLogWriter::sync() {
+  if (base_ != nullptr && ::msync(base_, end_, MS_SYNC) != 0) {
+    throwErrno("BinaryLogWriter: msync failed");
+  }
+}
+
+void BinaryLogWriter::close() {
+  if (base_ == nullptr) {
+    return;
+  }
+  writeHeader();
+  ::munmap(base_, capacity_);
+  base_ = nullptr;
+  // Best effort: the header already records the data end, so a failed trim
+  // only leaves zero padding behind.
+  static_cast<void>(::ftruncate(fd_, static_cast<off_t>(end_)));
+  ::close(fd_);
+  fd_ = -1;
+}
+
+BinaryLogReader::BinaryLogReader(const std::filesystem::path &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throwErrno("BinaryLogReader: cannot open " + path.string());
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throwErrno("BinaryLogReader: cannot stat " + path.string());
+  }
+  mappedSize_ = static_cast<std::size_t>(info.st_size);
+  if (mappedSize_ < binary_log::kHeaderSize) {
+    ::close(fd);
+    throwCorrupt();
+  }
+  void *mapping = ::mmap(nullptr, mappedSize_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throwErrno("BinaryLogReader: cannot map " + path.string());
+  }
+  base_ = static_cast<const char *>(mapping);
+
+  // Count before data end; see BinaryLogWriter::writeHeader().
+  recordCount_ =
+      headerField(base_ + kRecordCountOffset).load(std::memory_order_acquire);
+  end_ = static_cast<std::size_t>(
+      headerField(base_ + kDataEndOffset).load(std::memory_order_acquire));
+  if (std::string_view(base_, binary_log::kMagic.size()) !=
+          binary_log::kMagic ||
+      loadLe(base_ + kVersionOffset, 4) != binary_log::kVersion ||
+      loadLe(base_ + kHeaderSizeOffset, 4) != binary_log::kHeaderSize ||
+      end_ < binary_log::kHeaderSize || end_ > mappedSize_) {
+    ::munmap(const_cast<char *>(base_), mappedSize_);
+    throwCorrupt();
+  }
+}
+
+BinaryLogReader::~BinaryLogReader() {
+  ::munmap(const_cast<char *>(base_), mappedSize_);
+}
+
+auto BinaryLogReader::begin() const -> Iterator {
+  return {this, binary_log::kHeaderSize};
+}
+
+auto BinaryLogReader::end() const -> Iterator { return {this, end_}; }
+
+BinaryLogReader::Iterator::Iterator(const BinaryLogReader *reader,
+                                    std::size_t offset)
+    : reader_(reader), offset_(offset), next_(offset) {
+  advance();
+}
+
+auto BinaryLogReader::Iterator::operator++() -> Iterator & {
+  offset_ = next_;
+  advance();
+  return *this;
+}
+
+void BinaryLogReader::Iterator::advance() {
+  const char *data = reader_->base_;
+  const std::size_t end = reader_->end_;
+  auto &operations = reader_->operations_;
+  std::size_t cursor = offset_;
+  while (cursor < end) {
+    const std::size_t start = cursor;
+    const std::uint32_t tag = getVarint(data, end, cursor);
+    if ((tag & 1U) != 0) {
+      const std::size_t length = tag >> 1U;
+      if (length > end - cursor) {
+        throwCorrupt();
+      }
+      if (definitions_ == operations.size()) {
+        operations.emplace_back(data + cursor, length);
+      }
+      ++definitions_;
+      cursor += length;
+      continue;
+    }
+    const std::uint32_t id = tag >> 1U;
+    if (id >= definitions_) {
+      throwCorrupt();
+    }
+    entry_ = {operations[id], unzigzag(getVarint(data, end, cursor))};
+    offset_ = start;
+    next_ = cursor;
+    return;
+  }
+  offset_ = next_ = end;
+}
@@ -0,0 +1,169 @@
+#include "concurrent_logger.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+auto nextLoggerId() -> std::uint64_t {
+  static std::atomic<std::uint64_t> counter{0};
+  return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// Small cache of the calling thread's buffers, so a thread that writes to a
+// few loggers in turn finds each one without the registry lock. Logger ids
+// are never reused, so a stale entry can never match a different logger.
+struct BufferCache {
+  static constexpr std::size_t kEntries = 8;
+  std::array<std::uint64_t, kEntries> loggerIds{};
+  std::array<void *, kEntries> buffers{};
+  // Slot the next miss replaces, round robin.
+  std::size_t next = 0;
+
+  [[nodiscard]] auto find(std::uint64_t loggerId) const -> void * {
+    for (std::size_t i = 0; i < kEntries; ++i) {
+      if (loggerIds[i] == loggerId) {
+        return buffers[i];
+      }
+    }
+    return nullptr;
+  }
+  void insert(std::uint64_t loggerId, void *buffer) {
+    loggerIds[next] = loggerId;
+    buffers[next] = buffer;
+    next = (next + 1) % kEntries;
+  }
+};
+thread_local BufferCache tlsCache;
+
+} // namespace
+
+// Fixed block of entries. The owning thread fills it and publishes each
+// entry with a release store; the drainer reads up to the published count.
+struct ConcurrentLogger::Chunk {
+  static constexpr std::size_t kCapacity = 256;
+  std::array<Entry, kCapacity> entries;
+  std::atomic<std::size_t> published{0};
+  std::atomic<Chunk *> next{nullptr};
+};
+
+// Single-producer/single-consumer chunk list. The producer only touches
+// tail; the consumer (serialised by drainMutex_) only touches head and frees
+// chunks the producer has already moved past.
+struct ConcurrentLogger::ThreadBuffer {
+  Chunk *head = new Chunk;
+  std::size_t consumed = 0;
+  Chunk *tail = head;
+
+  ThreadBuffer() = default;
+  ThreadBuffer(const ThreadBuffer &) = delete;
+  auto operator=(const ThreadBuffer &) -> ThreadBuffer & = delete;
+  ThreadBuffer(ThreadBuffer &&) = delete;
+  auto operator=(ThreadBuffer &&) -> ThreadBuffer & = delete;
+  ~ThreadBuffer() {
+    while (head != nullptr) {
+      Chunk *next = head->next.load(std::memory_order_relaxed);
+      delete head;
+      head = next;
+    }
+  }
+
+  void push(Entry entry) {
+    Chunk *chunk = tail;
+    std::size_t slot = chunk->published.load(std::memory_order_relaxed);
+    if (slot == Chunk::kCapacity) {
+      auto *fresh = new Chunk;
+      chunk->next.store(fresh, std::memory_order_release);
+      tail = chunk = fresh;
+      slot = 0;
+    }
+    chunk->entries[slot] = std::move(entry);
+    chunk->published.store(slot + 1, std::memory_order_release);
+  }
+
+  void consumeInto(std::vector<Entry> &out) {
+    while (true) {
+      const std::size_t ready =
+          head->published.load(std::memory_order_acquire);
+      for (; consumed < ready; ++consumed) {
+        out.push_back(std::move(head->entries[consumed]));
+      }
+      if (consumed < Chunk::kCapacity) {
+        return;
+      }
+      Chunk *next = head->next.load(std::memory_order_acquire);
+      if (next == nullptr) {
+        return;
+      }
+      delete head;
+      head = next;
+      consumed = 0;
+    }
+  }
+};
+
+ConcurrentLogger::ConcurrentLogger() : id_(nextLoggerId()) {}
+
+ConcurrentLogger::~ConcurrentLogger() = default;
+
+auto ConcurrentLogger::localBuffer() const -> ThreadBuffer & {
+  if (void *cached = tlsCache.find(id_); cached != nullptr) {
+    return *static_cast<ThreadBuffer *>(cached);
+  }
+  const std::lock_guard<std::mutex> lock(registryMutex_);
+  auto &slot = buffers_[std::this_thread::get_id()];
+  if (!slot) {
+    slot = std::make_unique<ThreadBuffer>();
+  }
+  tlsCache.insert(id_, slot.get());
+  return *slot;
+}
+
+void ConcurrentLogger::logOperation(const std::string &operation,
+                                    int result) const {
+  const std::uint64_t sequence =
+      nextSequence_.fetch_add(1, std::memory_order_relaxed);
+  localBuffer().push({sequence, operation + " = " + std::to_string(result)});
+}
+
+void ConcurrentLogger::drainLocked() const {
+  const std::size_t before = pending_.size();
+  {
+    const std::lock_guard<std::mutex> lock(registryMutex_);
+    for (auto &entry : buffers_) {
+      entry.second->consumeInto(pending_);
+    }
+  }
+  if (pending_.size() == before) {
+    return;
+  }
+  std::sort(pending_.begin(), pending_.end(),
+            [](const Entry &lhs, const Entry &rhs) {
+              return lhs.sequence < rhs.sequence;
+            });
+
+  // store_[i] holds sequence i, so only a gap-free run may be committed.
+  // Anything after a gap belongs to an append that is still in flight.
+  auto ready = pending_.begin();
+  while (ready != pending_.end() && ready->sequence == store_.size()) {
+    store_.push_back(std::move(ready->text));
+    ++ready;
+  }
+  pending_.erase(pending_.begin(), ready);
+}
+
+auto ConcurrentLogger::getLogs() const -> std::vector<std::string> {
+  const std::lock_guard<std::mutex> lock(drainMutex_);
+  drainLocked();
+  return store_;
+}
+
+auto ConcurrentLogger::size() const -> std::size_t {
+  const std::lock_guard<std::mutex> lock(drainMutex_);
+  drainLocked();
+  return store_.size();
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "log_record.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// On-disk binary log segment.
+//
+//   header  : magic "MCBINLOG", u32 version, u32 header size,
+//             u64 data end offset, u64 record count (little endian)
+//   entries : varint tag followed by a payload
+//             tag = (length << 1) | 1 -> defines the next operation id as the
+//                                        following `length` bytes
+//             tag = id << 1           -> record for operation `id`, followed
+//                                        by the zig-zag varint result
+//
+// Operation ids are assigned in order of first use, so every definition
+// precedes the records that refer to it.
+namespace binary_log {
+inline constexpr std::string_view kMagic = "MCBINLOG";
+inline constexpr std::uint32_t kVersion = 1;
+inline constexpr std::size_t kHeaderSize = 32;
+
+struct StringHash {
+  using is_transparent = void;
+  auto operator()(std::string_view text) const -> std::size_t {
+    return std::hash<std::string_view>{}(text);
+  }
+};
+} // namespace binary_log
+
+// Appends records to a memory-mapped segment file. The header is published
+// after every append (data end, then record count, each one atomic release
+// store), so a reader can open the file at any time and sees a prefix of the
+// records. A reader opened just as the file grows can find the data end past
+// its mapping and throws std::runtime_error; opening again succeeds.
+class BinaryLogWriter {
+public:
+  explicit BinaryLogWriter(const std::filesystem::path &path,
+                           std::size_t initialCapacity = 1U << 20U);
+  ~BinaryLogWriter();
+  BinaryLogWriter(const BinaryLogWriter &) = delete;
+  auto operator=(const BinaryLogWriter &) -> BinaryLogWriter & = delete;
+  BinaryLogWriter(BinaryLogWriter &&) = delete;
+  auto operator=(BinaryLogWriter &&) -> BinaryLogWriter & = delete;
+
+  void append(std::string_view operation, int result);
+  void append(const LogRecordRange &records);
+
+  // Flushes the mapping to disk.
+  void sync();
+  // Trims the file to its data end and unmaps it. Called by the destructor.
+  void close();
+
+  [[nodiscard]] auto recordCount() const -> std::uint64_t {
+    return recordCount_;
+  }
+  [[nodiscard]] auto bytesWritten() const -> std::size_t { return end_; }
+
+private:
+  void reserve(std::size_t extra);
+  void map(std::size_t capacity);
+  void writeHeader();
+
+  int fd_ = -1;
+  char *base_ = nullptr;
+  std::size_t capacity_ = 0;
+  std::size_t end_ = binary_log::kHeaderSize;
+  std::uint64_t recordCount_ = 0;
+  std::unordered_map<std::string, std::uint32_t, binary_log::StringHash,
+                     std::equal_to<>>
+      operationIds_;
+};
+
+// Iterates a segment file straight from a read-only mapping. Operation names
+// are returned as views into the mapping; nothing is copied per record.
+// Iterators share the reader's operation table, so one reader should not be
+// iterated from several threads at once.
+class BinaryLogReader {
+public:
+  class Iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = LogEntry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const LogEntry *;
+    using reference = const LogEntry &;
+
+    Iterator() = default;
+    Iterator(const BinaryLogReader *reader, std::size_t offset);
+
+    auto operator*() const -> const LogEntry & { return entry_; }
+    auto operator->() const -> const LogEntry * { return &entry_; }
+    auto operator++() -> Iterator &;
+    auto operator++(int) -> Iterator {
+      Iterator copy = *this;
+      ++*this;
+      return copy;
+    }
+    friend auto operator==(const Iterator &lhs, const Iterator &rhs) -> bool {
+      return lhs.offset_ == rhs.offset_;
+    }
+
+  private:
+    // Decodes entries from offset_ until the next record (or the end).
+    void advance();
+
+    const BinaryLogReader *reader_ = nullptr;
+    std::size_t offset_ = 0;
+    std::size_t next_ = 0;
+    std::size_t definitions_ = 0;
+    LogEntry entry_{};
+  };
+
+  explicit BinaryLogReader(const std::filesystem::path &path);
+  ~BinaryLogReader();
+  BinaryLogReader(const BinaryLogReader &) = delete;
+  auto operator=(const BinaryLogReader &) -> BinaryLogReader & = delete;
+  BinaryLogReader(BinaryLogReader &&) = delete;
+  auto operator=(BinaryLogReader &&) -> BinaryLogReader & = delete;
+
+  [[nodiscard]] auto begin() const -> Iterator;
+  [[nodiscard]] auto end() const -> Iterator;
+  [[nodiscard]] auto recordCount() const -> std::uint64_t {
+    return recordCount_;
+  }
+
+private:
+  const char *base_ = nullptr;
+  std::size_t mappedSize_ = 0;
+  std::size_t end_ = 0;
+  std::uint64_t recordCount_ = 0;
+  // Operation names discovered so far, as views into the mapping.
+  mutable std::vector<std::string_view> operations_;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Thread-safe counterpart of Logger. Each writer thread appends to its own
+// single-producer buffer without taking a lock; readers drain those buffers
+// into a shared store ordered by a global sequence number. A thread finds
+// its buffer through a per-thread cache of eight loggers; one that writes to
+// more loggers in turn takes a registry lock whenever the cache misses.
+class ConcurrentLogger {
+public:
+  ConcurrentLogger();
+  ~ConcurrentLogger();
+  ConcurrentLogger(const ConcurrentLogger &) = delete;
+  auto operator=(const ConcurrentLogger &) -> ConcurrentLogger & = delete;
+  ConcurrentLogger(ConcurrentLogger &&) = delete;
+  auto operator=(ConcurrentLogger &&) -> ConcurrentLogger & = delete;
+
+  void logOperation(const std::string &operation, int result) const;
+
+  // Consistent snapshot: every record whose append completed before the
+  // call, in log order, with no gaps. Writers are never blocked.
+  [[nodiscard]] auto getLogs() const -> std::vector<std::string>;
+  [[nodiscard]] auto size() const -> std::size_t;
+
+private:
+  struct Entry {
+    std::uint64_t sequence = 0;
+    std::string text;
+  };
+  struct Chunk;
+  struct ThreadBuffer;
+
+  auto localBuffer() const -> ThreadBuffer &;
+  // Caller holds drainMutex_.
+  void drainLocked() const;
+
+  const std::uint64_t id_;
+  mutable std::atomic<std::uint64_t> nextSequence_{0};
+
+  mutable std::mutex registryMutex_;
+  mutable std::unordered_map<std::thread::id, std::unique_ptr<ThreadBuffer>>
+      buffers_;
+
+  mutable std::mutex drainMutex_;
+  mutable std::vector<Entry> pending_;
+  mutable std::vector<std::string> store_;
+};
@@ -0,0 +1,163 @@
+#pragma once
+#include "operation_table.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Compact, trivially copyable record as stored by Logger. The operation text
+// lives in a separate contiguous arena and is referenced by offset/length,
+// or, for an interned operation, operationLength is kInterned and
+// operationOffset is the OpId in OperationTable::global().
+struct LogRecord {
+  static constexpr std::uint32_t kInterned = 0xFFFF'FFFFU;
+
+  std::uint32_t operationOffset;
+  std::uint32_t operationLength;
+  int result;
+};
+
+// Read-only view of one record. Formatting into "operation = result" only
+// happens when asked for.
+struct LogEntry {
+  std::string_view operation;
+  int result;
+  // Set for records logged by OpId, for grouping without comparing text.
+  std::optional<OpId> op{};
+
+  [[nodiscard]] auto format() const -> std::string;
+  // Appends the formatted entry to out.
+  void formatTo(std::string &out) const;
+};
+
+// Iterable view over records and the arena they point into. The records may
+// wrap around the end of a ring of ringSize slots, starting at slot head.
+// Invalidated by the next append to the owning Logger.
+class LogRecordRange {
+public:
+  class Iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = LogEntry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = LogEntry;
+
+    Iterator() = default;
+    Iterator(const LogRecordRange &range, std::size_t index)
+        : ring_(range.ring_), ringSize_(range.ringSize_), head_(range.head_),
+          arena_(range.arena_), index_(index) {}
+
+    auto operator*() const -> LogEntry {
+      std::size_t slot = head_ + index_;
+      if (slot >= ringSize_) {
+        slot -= ringSize_;
+      }
+      const LogRecord &record = ring_[slot];
+      if (record.operationLength == LogRecord::kInterned) {
+        const auto op = static_cast<OpId>(record.operationOffset);
+        return {OperationTable::global().name(op), record.result, op};
+      }
+      return {arena_.substr(record.operationOffset, record.operationLength),
+              record.result};
+    }
+    auto operator[](difference_type n) const -> LogEntry {
+      return *(*this + n);
+    }
+    auto operator++() -> Iterator & {
+      ++index_;
+      return *this;
+    }
+    auto operator++(int) -> Iterator {
+      Iterator copy = *this;
+      ++index_;
+      return copy;
+    }
+    auto operator--() -> Iterator & {
+      --index_;
+      return *this;
+    }
+    auto operator--(int) -> Iterator {
+      Iterator copy = *this;
+      --index_;
+      return copy;
+    }
+    auto operator+=(difference_type n) -> Iterator & {
+      index_ = static_cast<std::size_t>(static_cast<difference_type>(index_) +
+                                        n);
+      return *this;
+    }
+    auto operator-=(difference_type n) -> Iterator & { return *this += -n; }
+    friend auto operator+(Iterator it, difference_type n) -> Iterator {
+      return it += n;
+    }
+    friend auto operator+(difference_type n, Iterator it) -> Iterator {
+      return it += n;
+    }
+    friend auto operator-(Iterator it, difference_type n) -> Iterator {
+      return it -= n;
+    }
+    friend auto operator-(const Iterator &lhs, const Iterator &rhs)
+        -> difference_type {
+      return static_cast<difference_type>(lhs.index_) -
+             static_cast<difference_type>(rhs.index_);
+    }
+    friend auto operator==(const Iterator &lhs, const Iterator &rhs) -> bool {
+      return lhs.index_ == rhs.index_;
+    }
+    friend auto operator<=>(const Iterator &lhs, const Iterator &rhs) {
+      return lhs.index_ <=> rhs.index_;
+    }
+
+  private:
+    const LogRecord *ring_ = nullptr;
+    std::size_t ringSize_ = 0;
+    std::size_t head_ = 0;
+    std::string_view arena_;
+    std::size_t index_ = 0;
+  };
+
+  LogRecordRange(std::span<const LogRecord> records, std::string_view arena)
+      : ring_(records.data()), ringSize_(records.size()),
+        count_(records.size()), arena_(arena) {}
+  LogRecordRange(std::span<const LogRecord> ring, std::size_t head,
+                 std::size_t count, std::string_view arena,
+                 std::uint64_t firstSequence)
+      : ring_(ring.data()), ringSize_(ring.size()), head_(head),
+        count_(count), arena_(arena), firstSequence_(firstSequence) {}
+
+  [[nodiscard]] auto begin() const -> Iterator { return {*this, 0}; }
+  [[nodiscard]] auto end() const -> Iterator { return {*this, count_}; }
+  [[nodiscard]] auto size() const -> std::size_t { return count_; }
+  [[nodiscard]] auto empty() const -> bool { return count_ == 0; }
+  [[nodiscard]] auto operator[](std::size_t index) const -> LogEntry {
+    return *Iterator(*this, index);
+  }
+  // The count entries starting at index; index + count must not exceed
+  // size().
+  [[nodiscard]] auto subrange(std::size_t index, std::size_t count) const
+      -> LogRecordRange {
+    std::size_t head = head_ + index;
+    if (head >= ringSize_ && ringSize_ != 0) {
+      head -= ringSize_;
+    }
+    return {std::span(ring_, ringSize_), head, count, arena_,
+            firstSequence_ + index};
+  }
+  // Sequence number (total records ever appended before it) of the first
+  // entry in the range.
+  [[nodiscard]] auto firstSequence() const -> std::uint64_t {
+    return firstSequence_;
+  }
+
+private:
+  const LogRecord *ring_ = nullptr;
+  std::size_t ringSize_ = 0;
+  std::size_t head_ = 0;
+  std::size_t count_ = 0;
+  std::string_view arena_;
+  std::uint64_t firstSequence_ = 0;
+};
@@ -0,0 +1,226 @@
+#pragma once
+#include "binary_log.hpp"
+#include "log_record.hpp"
+#include "scheduler.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Sealed, compressed log segment.
+//
+//   header : magic "MCLOGSEG", u32 version, u32 header size,
+//            u64 first sequence, u64 reserved (little endian)
+//   blocks : one compressed payload per block of up to blockRecords records
+//   index  : one 48-byte entry per block - u64 first sequence,
+//            u32 records, u8 codec, 3 padding bytes, i64 min time,
+//            i64 max time, u64 offset, u32 stored size, u32 raw size
+//   footer : u64 index offset, u64 block count, u64 record count,
+//            magic "MCSEGEND"
+//
+// A raw block is columnar so that repeated values compress well: a varint
+// count and the length-prefixed operation names used in the block, then the
+// varint operation index of every record, their zig-zag varint results and
+// the zig-zag varint nanosecond deltas of their times (the first relative to
+// the block's min time). Times are nanoseconds since the system_clock epoch.
+// Each block carries its own codec; blocks that do not shrink are stored.
+namespace log_segment {
+inline constexpr std::string_view kMagic = "MCLOGSEG";
+inline constexpr std::string_view kFooterMagic = "MCSEGEND";
+inline constexpr std::uint32_t kVersion = 1;
+inline constexpr std::size_t kHeaderSize = 32;
+inline constexpr std::size_t kIndexEntrySize = 48;
+inline constexpr std::size_t kFooterSize = 32;
+} // namespace log_segment
+
+// Lz4 uses the LZ4 block format. It is always available: the library links
+// liblz4 when configured with ENABLE_LZ4 and a built-in codec otherwise.
+// Zstd needs ENABLE_ZSTD.
+enum class SegmentCodec : std::uint8_t { None = 0, Lz4 = 1, Zstd = 2 };
+
+[[nodiscard]] auto segmentCodecAvailable(SegmentCodec codec) -> bool;
+
+struct SegmentWriterOptions {
+  SegmentCodec codec = SegmentCodec::Lz4;
+  // Records per block: the unit of compression, seeking and parallel replay.
+  std::size_t blockRecords = 4096;
+  // Codec compression level; 0 selects the codec's default. Ignored by
+  // Lz4, which has a single level.
+  int level = 0;
+  // Sequence number of the first record appended.
+  std::uint64_t firstSequence = 0;
+};
+
+// Metadata of one block, read from the segment index.
+struct SegmentBlockInfo {
+  std::uint64_t firstSequence = 0;
+  std::uint32_t records = 0;
+  SegmentCodec codec = SegmentCodec::None;
+  std::chrono::system_clock::time_point minTime{};
+  std::chrono::system_clock::time_point maxTime{};
+  std::uint64_t offset = 0;
+  std::uint32_t storedSize = 0;
+  std::uint32_t rawSize = 0;
+
+  [[nodiscard]] auto endSequence() const -> std::uint64_t {
+    return firstSequence + records;
+  }
+};
+
+struct SegmentEntry {
+  LogEntry entry;
+  std::uint64_t sequence = 0;
+  std::chrono::system_clock::time_point time{};
+};
+
+// Writes a segment sequentially, compressing a block whenever blockRecords
+// records are buffered. The file is only readable once sealed.
+class LogSegmentWriter {
+public:
+  explicit LogSegmentWriter(const std::filesystem::path &path,
+                            SegmentWriterOptions options = {});
+  // Seals the segment; errors are swallowed, so call seal() to see them.
+  ~LogSegmentWriter();
+  LogSegmentWriter(const LogSegmentWriter &) = delete;
+  auto operator=(const LogSegmentWriter &) -> LogSegmentWriter & = delete;
+  LogSegmentWriter(LogSegmentWriter &&) = delete;
+  auto operator=(LogSegmentWriter &&) -> LogSegmentWriter & = delete;
+
+  void append(std::string_view operation, int result,
+              std::chrono::system_clock::time_point time);
+  // Appends every record of the range with the same time.
+  void append(const LogRecordRange &records,
+              std::chrono::system_clock::time_point time);
+
+  // Compresses the buffered records, writes the index and footer and closes
+  // the file. Further appends throw std::logic_error.
+  void seal();
+
+  [[nodiscard]] auto recordCount() const -> std::uint64_t {
+    return recordCount_;
+  }
+  // Blocks written so far, not counting buffered records.
+  [[nodiscard]] auto blockCount() const -> std::size_t {
+    return index_.size();
+  }
+
+private:
+  void flushBlock();
+  void write(const char *data, std::size_t size);
+
+  SegmentWriterOptions options_;
+  int fd_ = -1;
+  std::uint64_t offset_ = 0;
+  std::uint64_t recordCount_ = 0;
+  std::vector<SegmentBlockInfo> index_;
+
+  // The block being filled.
+  std::unordered_map<std::string, std::uint32_t, binary_log::StringHash,
+                     std::equal_to<>>
+      operationIds_;
+  // Views of operationIds_ keys, by id.
+  std::vector<std::string_view> operations_;
+  std::vector<std::uint32_t> ids_;
+  std::vector<int> results_;
+  std::vector<std::int64_t> times_;
+  std::string raw_;
+  std::string compressed_;
+};
+
+// The decoded records of one block. Operation names point into the block
+// itself, so entries stay valid as long as it (or what it was moved to)
+// lives.
+class SegmentBlock {
+public:
+  SegmentBlock() = default;
+  SegmentBlock(const SegmentBlock &) = delete;
+  auto operator=(const SegmentBlock &) -> SegmentBlock & = delete;
+  SegmentBlock(SegmentBlock &&) noexcept = default;
+  auto operator=(SegmentBlock &&) noexcept -> SegmentBlock & = default;
+  ~SegmentBlock() = default;
+
+  [[nodiscard]] auto entries() const -> std::span<const SegmentEntry> {
+    return entries_;
+  }
+  [[nodiscard]] auto begin() const { return entries_.begin(); }
+  [[nodiscard]] auto end() const { return entries_.end(); }
+  [[nodiscard]] auto size() const -> std::size_t { return entries_.size(); }
+  [[nodiscard]] auto operator[](std::size_t index) const
+      -> const SegmentEntry & {
+    return entries_[index];
+  }
+
+private:
+  friend class LogSegmentReader;
+
+  std::vector<char> text_;
+  std::vector<SegmentEntry> entries_;
+};
+
+// Reads a sealed segment through a read-only mapping. Only the index is
+// parsed up front; blocks are decompressed on demand. All members are const
+// and may be called from several threads at once.
+class LogSegmentReader {
+public:
+  using BlockVisitor = std::function<void(const SegmentBlock &)>;
+  using EntryVisitor = std::function<void(const SegmentEntry &)>;
+
+  explicit LogSegmentReader(const std::filesystem::path &path);
+  ~LogSegmentReader();
+  LogSegmentReader(const LogSegmentReader &) = delete;
+  auto operator=(const LogSegmentReader &) -> LogSegmentReader & = delete;
+  LogSegmentReader(LogSegmentReader &&) = delete;
+  auto operator=(LogSegmentReader &&) -> LogSegmentReader & = delete;
+
+  [[nodiscard]] auto blocks() const -> std::span<const SegmentBlockInfo> {
+    return index_;
+  }
+  [[nodiscard]] auto recordCount() const -> std::uint64_t {
+    return recordCount_;
+  }
+  [[nodiscard]] auto firstSequence() const -> std::uint64_t {
+    return firstSequence_;
+  }
+  [[nodiscard]] auto endSequence() const -> std::uint64_t {
+    return firstSequence_ + recordCount_;
+  }
+
+  // Index of the block holding sequence, or blocks().size() if the segment
+  // does not. Binary search over the index; nothing is decompressed.
+  [[nodiscard]] auto findSequence(std::uint64_t sequence) const
+      -> std::size_t;
+  // Index of the first block with a record at or after time, or
+  // blocks().size(). Exact for segments appended in time order.
+  [[nodiscard]] auto findTime(std::chrono::system_clock::time_point time) const
+      -> std::size_t;
+
+  // Decompresses and decodes block index.
+  [[nodiscard]] auto readBlock(std::size_t index) const -> SegmentBlock;
+
+  // Visits the records with sequence numbers in [first, last) in order,
+  // decoding only the blocks that hold them.
+  void scan(std::uint64_t first, std::uint64_t last,
+            const EntryVisitor &visit) const;
+
+  // Bulk replay: decodes blocks [first, last) on the scheduler, a window of
+  // two blocks per thread at a time, and calls visit on the calling thread
+  // for every block in order. The first exception thrown by decoding or by
+  // visit is rethrown; blocks after it are not visited.
+  void replay(std::size_t first, std::size_t last, const BlockVisitor &visit,
+              const ParallelOptions &options = {}) const;
+
+private:
+  void parseIndex();
+
+  const char *base_ = nullptr;
+  std::size_t mappedSize_ = 0;
+  std::uint64_t firstSequence_ = 0;
+  std::uint64_t recordCount_ = 0;
+  std::vector<SegmentBlockInfo> index_;
+};
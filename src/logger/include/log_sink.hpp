@@ -0,0 +1,120 @@
+#pragma once
+#include "logger.hpp"
+#include "scheduler.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+struct AsyncSinkOptions {
+  // Records buffered between producers and the writer thread.
+  std::size_t queueCapacity = 64 * 1024;
+  // What logOperation does while the queue is full.
+  OverflowPolicy policy = OverflowPolicy::Block;
+  // Size threshold: the writer wakes once this many records are queued and
+  // writes at most this many per write() call.
+  std::size_t batchSize = 4096;
+  // Time threshold: queued records are written at least this often.
+  std::chrono::milliseconds flushInterval{50};
+  std::size_t maxOperationLength = 64;
+  // When set, batches are written by tasks on this scheduler instead of a
+  // dedicated writer thread. Without a thread of its own the sink checks
+  // flushInterval only as records arrive, so a tail shorter than batchSize
+  // waits for the next record, flush() or close(). With the Block policy,
+  // producers must not run on that scheduler's workers.
+  Scheduler *scheduler = nullptr;
+};
+
+struct AsyncSinkStats {
+  // Records written out.
+  std::uint64_t records = 0;
+  std::uint64_t bytes = 0;
+  std::uint64_t batches = 0;
+  // Records overwritten in the queue or lost with a failed batch.
+  std::uint64_t dropped = 0;
+  // Batches whose write() failed; the rest of such a batch is discarded.
+  std::uint64_t writeErrors = 0;
+};
+
+// Writes "operation = result" lines to a file descriptor from a background
+// thread. Producers only pay for an enqueue into a bounded Logger; the
+// writer drains it in batches and issues one write() per batch.
+class AsyncLogSink {
+public:
+  // Appends to fd, which stays owned by the caller.
+  explicit AsyncLogSink(int fd, AsyncSinkOptions options = {});
+  // Opens (creating if needed) and appends to path; the sink owns the fd.
+  explicit AsyncLogSink(const std::filesystem::path &path,
+                        AsyncSinkOptions options = {});
+  ~AsyncLogSink();
+  AsyncLogSink(const AsyncLogSink &) = delete;
+  auto operator=(const AsyncLogSink &) -> AsyncLogSink & = delete;
+  AsyncLogSink(AsyncLogSink &&) = delete;
+  auto operator=(AsyncLogSink &&) -> AsyncLogSink & = delete;
+
+  void logOperation(std::string_view operation, int result);
+
+  // Blocks until every record enqueued before the call has been written.
+  // Returns at once if close() has begun, which writes everything itself.
+  void flush();
+  // Writes everything still queued and stops the writer thread. Called by
+  // the destructor; no records may be logged afterwards.
+  void close();
+
+  [[nodiscard]] auto stats() const -> AsyncSinkStats;
+
+private:
+  AsyncLogSink(int fd, bool ownsFd, AsyncSinkOptions options);
+  void run();
+  // Scheduler mode: queues one write task unless one is already pending.
+  void scheduleWrite();
+  void writeTask();
+  void writeNow();
+  // Drains the queue in batches; returns once it is empty.
+  void writeQueued(std::string &buffer);
+  // Takes records evicted by OverflowPolicy::Overwrite since the last call
+  // off queued_, which counted them when they were accepted.
+  void forgetOverwritten();
+  // Returns false, counting a write error, if write() failed.
+  auto writeBatch(const std::string &buffer) -> bool;
+
+  const int fd_;
+  const bool ownsFd_;
+  const AsyncSinkOptions options_;
+  const std::int64_t wakeThreshold_;
+  Logger queue_;
+
+  // Signed: the writer may drain a record before its producer counts it.
+  std::atomic<std::int64_t> queued_{0};
+  // Writer only: queue_.stats().overwritten already taken off queued_.
+  std::uint64_t overwritten_ = 0;
+  std::atomic<std::uint64_t> records_{0};
+  std::atomic<std::uint64_t> failedRecords_{0};
+  std::atomic<std::uint64_t> bytes_{0};
+  std::atomic<std::uint64_t> batches_{0};
+  std::atomic<std::uint64_t> writeErrors_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  bool stopping_ = false;
+  std::uint64_t flushRequested_ = 0;
+  std::uint64_t flushCompleted_ = 0;
+  std::thread writer_;
+
+  // Scheduler mode only.
+  std::mutex writeMutex_;
+  std::string buffer_;
+  std::atomic<bool> writeScheduled_{false};
+  std::atomic<bool> closed_{false};
+  // steady_clock nanoseconds of the last write.
+  std::atomic<std::int64_t> lastWrite_{0};
+  std::optional<TaskGroup> tasks_;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include "log_record.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Record and text storage of a Logger, shared with the snapshots taken of
+// it. The Logger only ever appends past what a snapshot can see, or moves
+// to a fresh copy before reusing a slot while snapshots hold the block, so
+// pinned records are never written again.
+struct LogStorage {
+  LogStorage() = default;
+  explicit LogStorage(std::pmr::memory_resource *resource)
+      : records(resource), arena(resource) {}
+
+  std::pmr::vector<LogRecord> records;
+  std::pmr::string arena;
+  // Live LogSnapshots of this block. Snapshots release with a release
+  // decrement; the Logger reads it with acquire before reusing slots.
+  mutable std::atomic<std::uint32_t> pins{0};
+};
+
+// Immutable view of the records a Logger held when snapshot() was called.
+// Iterating it needs no lock and copies nothing, and stays valid while the
+// Logger keeps appending, draining or overwriting. Snapshots and the ranges
+// they return may be read from any thread; copies share the same storage.
+class LogSnapshot {
+public:
+  LogSnapshot() = default;
+  // Pins storage; range must point into it.
+  LogSnapshot(std::shared_ptr<const LogStorage> storage, LogRecordRange range);
+  LogSnapshot(const LogSnapshot &other);
+  auto operator=(const LogSnapshot &other) -> LogSnapshot &;
+  LogSnapshot(LogSnapshot &&other) noexcept;
+  auto operator=(LogSnapshot &&other) noexcept -> LogSnapshot &;
+  ~LogSnapshot();
+
+  [[nodiscard]] auto records() const -> LogRecordRange { return range_; }
+  [[nodiscard]] auto begin() const { return range_.begin(); }
+  [[nodiscard]] auto end() const { return range_.end(); }
+  [[nodiscard]] auto size() const -> std::size_t { return range_.size(); }
+  [[nodiscard]] auto empty() const -> bool { return range_.empty(); }
+  [[nodiscard]] auto operator[](std::size_t index) const -> LogEntry {
+    return range_[index];
+  }
+
+  // Sequence numbers (see LogRecordRange::firstSequence) covered by the
+  // snapshot: [firstSequence(), endSequence()).
+  [[nodiscard]] auto firstSequence() const -> std::uint64_t {
+    return range_.firstSequence();
+  }
+  [[nodiscard]] auto endSequence() const -> std::uint64_t {
+    return range_.firstSequence() + range_.size();
+  }
+
+  // Records with sequence numbers in [first, last), clamped to the
+  // snapshot. Valid as long as the snapshot (or a copy) is alive.
+  [[nodiscard]] auto range(std::uint64_t first, std::uint64_t last) const
+      -> LogRecordRange;
+  // The last count records.
+  [[nodiscard]] auto tail(std::size_t count) const -> LogRecordRange;
+
+private:
+  void pin() const;
+  void release();
+
+  std::shared_ptr<const LogStorage> storage_;
+  LogRecordRange range_{{}, {}};
+};
@@ -0,0 +1,139 @@
+#pragma once
+#include "log_record.hpp"
+#include "log_segment.hpp"
+#include "scheduler.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Row predicate of LogTable queries; the default matches every row.
+struct LogFilter {
+  std::optional<std::string_view> operation{};
+  // Inclusive result bounds.
+  int minResult = std::numeric_limits<int>::min();
+  int maxResult = std::numeric_limits<int>::max();
+  // Half-open time range [from, until).
+  std::chrono::system_clock::time_point from =
+      std::chrono::system_clock::time_point::min();
+  std::chrono::system_clock::time_point until =
+      std::chrono::system_clock::time_point::max();
+};
+
+struct LogAggregate {
+  std::uint64_t count = 0;
+  std::int64_t sum = 0;
+  // Only meaningful when count is non-zero.
+  int min = std::numeric_limits<int>::max();
+  int max = std::numeric_limits<int>::min();
+
+  // Throws std::logic_error when count is zero.
+  [[nodiscard]] auto mean() const -> double;
+  void merge(const LogAggregate &other);
+};
+
+struct LogGroup {
+  std::string_view operation;
+  LogAggregate aggregate;
+};
+
+struct LogRow {
+  std::size_t index = 0;
+  std::string_view operation;
+  int result = 0;
+  std::chrono::system_clock::time_point time{};
+};
+
+// Columnar copy of log records for analysis: dictionary-encoded operation
+// ids, results and nanosecond timestamps in separate contiguous columns, so
+// queries scan only the columns they filter or aggregate on. Scans are
+// branch-free and vectorise; the ParallelOptions overloads split the rows
+// into ParallelOptions chunks on the scheduler and merge the partial
+// results in chunk order, so they match the sequential forms exactly.
+// Appends are single-threaded; const queries may run concurrently.
+class LogTable {
+public:
+  // Columns and the dictionary are allocated from resource (nullptr: the
+  // default resource), which must outlive the table.
+  explicit LogTable(std::pmr::memory_resource *resource = nullptr);
+
+  void append(std::string_view operation, int result,
+              std::chrono::system_clock::time_point time = {});
+  // Appends logged records, e.g. a LogSnapshot's, all stamped with time;
+  // interned records are mapped by OpId without touching their text.
+  void append(const LogRecordRange &records,
+              std::chrono::system_clock::time_point time = {});
+  // Appends a segment block with its per-record times.
+  void append(const SegmentBlock &block);
+  void reserve(std::size_t rows);
+
+  [[nodiscard]] auto size() const -> std::size_t { return results_.size(); }
+  [[nodiscard]] auto empty() const -> bool { return results_.empty(); }
+  [[nodiscard]] auto row(std::size_t index) const -> LogRow;
+
+  // Distinct operations, with ids in order of first appearance.
+  [[nodiscard]] auto operationCount() const -> std::size_t {
+    return names_.size();
+  }
+  [[nodiscard]] auto operationName(std::uint32_t id) const
+      -> std::string_view {
+    return names_[id];
+  }
+  [[nodiscard]] auto findOperation(std::string_view operation) const
+      -> std::optional<std::uint32_t>;
+
+  // The columns, one element per row. Times are nanoseconds since the
+  // system_clock epoch.
+  [[nodiscard]] auto operationIds() const -> std::span<const std::uint32_t> {
+    return operations_;
+  }
+  [[nodiscard]] auto results() const -> std::span<const int> {
+    return results_;
+  }
+  [[nodiscard]] auto times() const -> std::span<const std::int64_t> {
+    return times_;
+  }
+
+  // Count, sum, min and max of the matching results.
+  [[nodiscard]] auto aggregate(const LogFilter &filter = {}) const
+      -> LogAggregate;
+  [[nodiscard]] auto aggregate(const ParallelOptions &options,
+                               const LogFilter &filter = {}) const
+      -> LogAggregate;
+  // One group per operation with matching rows, in operation id order.
+  [[nodiscard]] auto groupByOperation(const LogFilter &filter = {}) const
+      -> std::vector<LogGroup>;
+  [[nodiscard]] auto groupByOperation(const ParallelOptions &options,
+                                      const LogFilter &filter = {}) const
+      -> std::vector<LogGroup>;
+  // The k matching rows with the largest results, largest first; ties go
+  // to the earlier row.
+  [[nodiscard]] auto topK(std::size_t k, const LogFilter &filter = {}) const
+      -> std::vector<LogRow>;
+  [[nodiscard]] auto topK(const ParallelOptions &options, std::size_t k,
+                          const LogFilter &filter = {}) const
+      -> std::vector<LogRow>;
+  // Indices of the matching rows, ascending.
+  [[nodiscard]] auto select(const LogFilter &filter = {}) const
+      -> std::vector<std::size_t>;
+
+private:
+  auto intern(std::string_view operation) -> std::uint32_t;
+
+  // Names live in a deque so the views in ids_ stay put as it grows.
+  std::pmr::deque<std::pmr::string> names_;
+  std::pmr::unordered_map<std::string_view, std::uint32_t> ids_;
+  // OperationTable::global() id -> table id, or kNoId until first seen.
+  std::pmr::vector<std::uint32_t> interned_;
+  std::pmr::vector<std::uint32_t> operations_;
+  std::pmr::vector<int> results_;
+  std::pmr::vector<std::int64_t> times_;
+};
@@ -1,12 +1,206 @@
 #pragma once
+#include "log_record.hpp"
+#include "log_snapshot.hpp"
+#include "operation_table.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// What a bounded Logger does with a new record when it is full.
+enum class OverflowPolicy {
+  Overwrite, // evict the oldest record
+  Drop,      // discard the new record
+  Block      // wait for drain() to make room
+};
+
+struct LoggerOptions {
+  // Maximum number of retained records; 0 keeps the unbounded store. The
+  // ring is allocated up front, but reusing a slot a live LogSnapshot can
+  // still see copies it into new storage; see Logger::snapshot().
+  std::size_t capacity = 0;
+  OverflowPolicy policy = OverflowPolicy::Overwrite;
+  // Bounded mode reserves this much operation text per slot up front;
+  // longer operations are truncated. Interned operations use none of it, so
+  // a logger fed only OpIds can set this to 0.
+  std::size_t maxOperationLength = 64;
+  // Non-zero keeps a sparse time index for sequenceAt(): each append call
+  // reads the clock, and a (sequence, time) checkpoint is added once this
+  // much time has passed since the previous one.
+  std::chrono::microseconds timeIndexResolution{0};
+  // Source of the record and text storage, the storage copies snapshots
+  // force and the time index; nullptr selects
+  // std::pmr::get_default_resource() at construction. It must outlive the
+  // Logger and every LogSnapshot taken of it. getLogs() keeps its own
+  // std::string cache on the global heap.
+  std::pmr::memory_resource *resource = nullptr;
+};
+
+struct LoggerStats {
+  std::uint64_t appended = 0;
+  std::uint64_t dropped = 0;
+  std::uint64_t overwritten = 0;
+  std::uint64_t truncated = 0;
+};
+
 class Logger {
 public:
-  void logOperation(const std::string &operation, int result) const;
+  Logger();
+  // A non-zero capacity allocates the whole ring here; appends allocate
+  // afterwards only to copy the ring away from a live snapshot. Bounded
+  // loggers are internally synchronised so a drain() thread can run
+  // alongside the writer.
+  explicit Logger(LoggerOptions options);
+  // Move-only: copies would share storage. Moving is not synchronised, and a
+  // moved-from Logger may only be destroyed or assigned to.
+  Logger(const Logger &) = delete;
+  auto operator=(const Logger &) -> Logger & = delete;
+  Logger(Logger &&) = default;
+  auto operator=(Logger &&) -> Logger & = default;
+
+  // Stores a LogRecord plus the operation text in the arena; no string is
+  // formatted on this path. Returns false if OverflowPolicy::Drop discarded
+  // the record. An unbounded logger throws std::length_error once its text
+  // would pass 4 GiB, the reach of LogRecord's 32-bit offsets.
+  auto logOperation(std::string_view operation, int result) const -> bool;
+  // Logs one record per result under the same operation label, taking the
+  // lock (bounded mode) once. Returns the number of records kept.
+  auto logOperations(std::string_view operation,
+                     std::span<const int> results) const -> std::size_t;
+  // Same for an operation interned in OperationTable::global(): the record
+  // stores only the id, so no text is hashed, copied or stored. Throws
+  // std::invalid_argument for an id that table did not issue.
+  auto logOperation(OpId operation, int result) const -> bool;
+  auto logOperations(OpId operation, std::span<const int> results) const
+      -> std::size_t;
+
+  // Compatibility view: formats any records added since the last call. The
+  // reference stays valid until the next logOperation/getLogs call; use
+  // snapshot() to read while other threads keep logging.
   [[nodiscard]] auto getLogs() const -> const std::vector<std::string> &;
 
+  [[nodiscard]] auto records() const -> LogRecordRange;
+  // Lock-free view of the current records that survives later appends,
+  // drains and overwrites; see LogSnapshot. Costs O(1) and copies nothing
+  // until the Logger has to reuse a slot the snapshot can see, when it moves
+  // to a fresh copy of its storage once. Unbounded loggers keep their
+  // single-threaded contract: take the snapshot on the writer thread, then
+  // hand it to any number of readers.
+  [[nodiscard]] auto snapshot() const -> LogSnapshot;
+  // First sequence number logged at or after time, for
+  // LogSnapshot::range(); the end of the log if there is none. Accurate to
+  // LoggerOptions::timeIndexResolution. Throws std::logic_error if the time
+  // index is disabled.
+  [[nodiscard]] auto sequenceAt(std::chrono::steady_clock::time_point time)
+      const -> std::uint64_t;
+  [[nodiscard]] auto size() const -> std::size_t;
+  // Pre-sizes the record and text arenas so appends do not allocate.
+  // Unbounded mode only; a bounded logger is already fully allocated.
+  void reserve(std::size_t records, std::size_t textBytes) const;
+
+  // Hands up to maxRecords of the oldest records to consume(LogEntry) and
+  // removes them, waking writers blocked by OverflowPolicy::Block.
+  template <class Consume>
+  auto drain(Consume &&consume,
+             std::size_t maxRecords = std::numeric_limits<std::size_t>::max())
+      const -> std::size_t;
+
+  [[nodiscard]] auto stats() const -> LoggerStats;
+  [[nodiscard]] auto options() const -> const LoggerOptions & {
+    return options_;
+  }
+
 private:
+  [[nodiscard]] auto bounded() const -> bool { return options_.capacity != 0; }
+  [[nodiscard]] auto lock() const -> std::unique_lock<std::mutex>;
+  [[nodiscard]] auto recordsLocked() const -> LogRecordRange;
+  auto appendBoundedLocked(std::unique_lock<std::mutex> &guard,
+                           std::string_view operation, int result) const
+      -> bool;
+  auto appendBoundedLocked(std::unique_lock<std::mutex> &guard, OpId operation,
+                           int result) const -> bool;
+  // Makes room for one record under options_.policy and returns its ring
+  // slot, or capacity if the record is dropped.
+  auto claimSlotLocked(std::unique_lock<std::mutex> &guard) const
+      -> std::size_t;
+  void popFrontLocked(std::size_t count) const;
+  // Records address the arena with 32-bit offsets and lengths, and a length
+  // of LogRecord::kInterned marks an interned record.
+  static constexpr std::size_t kMaxArenaBytes = LogRecord::kInterned - 1;
+  // Unbounded mode: makes room for records more records and textBytes more
+  // text without reallocating storage a snapshot points into. Text past
+  // kMaxArenaBytes also takes the slow path, which throws.
+  void prepareAppendLocked(std::size_t records, std::size_t textBytes) const {
+    const LogStorage &storage = *storage_;
+    if (storage.records.size() + records > storage.records.capacity() ||
+        storage.arena.size() + textBytes >
+            std::min(storage.arena.capacity(), kMaxArenaBytes)) {
+      growLocked(records, textBytes);
+    }
+  }
+  void growLocked(std::size_t records, std::size_t textBytes) const;
+  // True while a LogSnapshot shares storage_.
+  [[nodiscard]] auto pinnedLocked() const -> bool;
+  // Swaps storage_ for a private copy with room for the given sizes.
+  void unshareLocked(std::size_t records, std::size_t textBytes) const;
+  void stampLocked() const {
+    if (options_.timeIndexResolution.count() != 0) {
+      stampTimeLocked();
+    }
+  }
+  void stampTimeLocked() const;
+  [[nodiscard]] auto makeStorage() const -> std::shared_ptr<LogStorage>;
+
+  LoggerOptions options_;
+  // Bounded mode only, and held by pointer so the Logger stays movable.
+  struct Sync {
+    std::mutex mutex;
+    std::condition_variable notFull;
+  };
+  std::unique_ptr<Sync> sync_;
+
+  // Unbounded: records grow and head_ only moves on drain(). Bounded:
+  // records is a ring of options_.capacity slots, each owning
+  // maxOperationLength bytes of the arena.
+  mutable std::shared_ptr<LogStorage> storage_;
+  mutable std::size_t head_ = 0;
+  mutable std::size_t count_ = 0;
+  mutable std::uint64_t firstSequence_ = 0;
+  // End sequence of the newest snapshot of storage_; a bounded slot whose
+  // previous record is below it may be visible to a snapshot.
+  mutable std::uint64_t observedEnd_ = 0;
+  mutable LoggerStats stats_;
+
+  struct TimeCheckpoint {
+    std::uint64_t sequence;
+    std::chrono::steady_clock::time_point time;
+  };
+  mutable std::pmr::deque<TimeCheckpoint> timeIndex_;
+
+  // Formatted cache behind getLogs(), starting at sequence logsFirst_.
   mutable std::vector<std::string> logs_;
+  mutable std::uint64_t logsFirst_ = 0;
 };
+
+template <class Consume>
+auto Logger::drain(Consume &&consume, std::size_t maxRecords) const
+    -> std::size_t {
+  const auto guard = lock();
+  const LogRecordRange pending = recordsLocked();
+  const std::size_t count = std::min(maxRecords, pending.size());
+  for (std::size_t i = 0; i < count; ++i) {
+    consume(pending[i]);
+  }
+  popFrontLocked(count);
+  return count;
+}
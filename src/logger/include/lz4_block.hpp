@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// LZ4 block format: sequences of a token (literal count << 4 | match length
+// - 4), extra length bytes, the literals and a little-endian 16-bit match
+// offset. The last sequence has literals only; the last five bytes are
+// always literals and no match starts within the last twelve.
+//
+// Built-in codec behind SegmentCodec::Lz4 when the library is configured
+// without ENABLE_LZ4. Its blocks decode with liblz4 and it decodes liblz4's.
+namespace lz4_block {
+
+// Appends the compressed form of src to out. Greedy single-probe matcher,
+// the same strategy as LZ4's fast mode: it skips ahead faster the longer it
+// goes without finding a match. Its output can differ from liblz4's.
+void compress(std::string_view src, std::string &out);
+
+// Decodes exactly size bytes into out; false if src is not a valid block
+// of that size.
+auto decompress(std::string_view src, char *out, std::size_t size) -> bool;
+
+} // namespace lz4_block
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Interned operation label. Ids are dense, start at 0 and stay valid for the
+// lifetime of the OperationTable that issued them.
+enum class OpId : std::uint32_t {};
+
+// Interns operation labels to OpIds. Lookups probe a fixed open-addressing
+// table with acquire loads only and never block; inserting a new label takes
+// a mutex, which a small vocabulary pays once per label.
+class OperationTable {
+public:
+  static constexpr std::size_t kDefaultCapacity = std::size_t{1} << 16U;
+
+  // Holds up to capacity distinct labels.
+  explicit OperationTable(std::size_t capacity = kDefaultCapacity);
+  OperationTable(const OperationTable &) = delete;
+  auto operator=(const OperationTable &) -> OperationTable & = delete;
+  OperationTable(OperationTable &&) = delete;
+  auto operator=(OperationTable &&) -> OperationTable & = delete;
+  ~OperationTable();
+
+  // Returns the id of operation, adding it on first use. Throws
+  // std::length_error once capacity labels are interned.
+  auto intern(std::string_view operation) -> OpId;
+  // The id of an already interned label, without adding it.
+  [[nodiscard]] auto find(std::string_view operation) const
+      -> std::optional<OpId>;
+
+  [[nodiscard]] auto contains(OpId id) const -> bool {
+    return static_cast<std::size_t>(id) <
+           count_.load(std::memory_order_acquire);
+  }
+  // The label of id, which must have been issued by this table.
+  [[nodiscard]] auto name(OpId id) const -> std::string_view {
+    const Entry &entry = entries_[static_cast<std::size_t>(id)];
+    return {entry.data, entry.length};
+  }
+  [[nodiscard]] auto size() const -> std::size_t {
+    return count_.load(std::memory_order_acquire);
+  }
+  [[nodiscard]] auto capacity() const -> std::size_t { return capacity_; }
+
+  // The table behind Logger::logOperation(OpId, int).
+  static auto global() -> OperationTable &;
+
+private:
+  struct Entry {
+    const char *data = nullptr;
+    std::size_t length = 0;
+  };
+
+  [[nodiscard]] auto find(std::string_view operation, std::size_t hash) const
+      -> std::optional<OpId>;
+
+  const std::size_t capacity_;
+  // Power of two, at least twice capacity_, so probe runs stay short.
+  const std::size_t mask_;
+  // 0 for an empty slot, otherwise the upper hash bits above id + 1.
+  // Published with a release store after the entry it names is written.
+  std::unique_ptr<std::atomic<std::uint64_t>[]> slots_;
+  std::unique_ptr<Entry[]> entries_;
+  std::atomic<std::size_t> count_{0};
+
+  // Serialises inserts and owns the label text.
+  std::mutex mutex_;
+  std::deque<std::string> text_;
+};
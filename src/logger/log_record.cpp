@@ -0,0 +1,25 @@
+#include "log_record.hpp"
+#include <array>
+#include <charconv>
+#include <limits>
+#include <string>
+
+auto LogEntry::format() const -> std::string {
+  std::string out;
+  formatTo(out);
+  return out;
+}
+
+void LogEntry::formatTo(std::string &out) const {
+  constexpr std::string_view kSeparator = " = ";
+  std::array<char, std::numeric_limits<int>::digits10 + 2> digits{};
+  const auto [end, ec] =
+      std::to_chars(digits.data(), digits.data() + digits.size(), result);
+  static_cast<void>(ec);
+
+  out.reserve(out.size() + operation.size() + kSeparator.size() +
+              static_cast<std::size_t>(end - digits.data()));
+  out.append(operation);
+  out.append(kSeparator);
+  out.append(digits.data(), end);
+}
@@ -0,0 +1,637 @@
+#include "log_segment.hpp"
+#include "lz4_block.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#ifdef MY_CODE_LZ4
+#include <lz4.h>
+#endif
+#ifdef MY_CODE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::system_clock;
+
+constexpr std::size_t kVersionOffset = 8;
+constexpr std::size_t kHeaderSizeOffset = 12;
+constexpr std::size_t kFirstSequenceOffset = 16;
+// A 64-bit value needs at most ten 7-bit groups.
+constexpr std::size_t kMaxVarint64 = 10;
+// Raw blocks must stay addressable by the LZ4 block format.
+constexpr std::size_t kMaxRawBlock = 0x7E000000;
+
+[[noreturn]] void throwErrno(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+[[noreturn]] void throwCorrupt() {
+  throw std::runtime_error("LogSegmentReader: corrupt segment");
+}
+
+void storeLe(char *out, std::uint64_t value, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    out[i] = static_cast<char>((value >> (8 * i)) & 0xFFU);
+  }
+}
+
+auto loadLe(const char *in, std::size_t bytes) -> std::uint64_t {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(in[i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+void putVarint(std::string &out, std::uint64_t value) {
+  while (value >= 0x80U) {
+    out.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+    value >>= 7U;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+auto getVarint(std::string_view data, std::size_t &offset) -> std::uint64_t {
+  std::uint64_t value = 0;
+  for (std::size_t shift = 0; shift < 7 * kMaxVarint64; shift += 7) {
+    if (offset >= data.size()) {
+      throwCorrupt();
+    }
+    const auto byte = static_cast<unsigned char>(data[offset++]);
+    value |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0) {
+      return value;
+    }
+  }
+  throwCorrupt();
+}
+
+auto zigzag(std::int64_t value) -> std::uint64_t {
+  const auto bits = static_cast<std::uint64_t>(value);
+  return (bits << 1U) ^ (value < 0 ? ~std::uint64_t{0} : 0U);
+}
+
+auto unzigzag(std::uint64_t value) -> std::int64_t {
+  return static_cast<std::int64_t>((value >> 1U) ^ (~(value & 1U) + 1U));
+}
+
+auto toNanos(Clock::time_point time) -> std::int64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+auto fromNanos(std::int64_t nanos) -> Clock::time_point {
+  return Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+      std::chrono::nanoseconds(nanos)));
+}
+
+auto codecName(SegmentCodec codec) -> const char * {
+  switch (codec) {
+  case SegmentCodec::None:
+    return "none";
+  case SegmentCodec::Lz4:
+    return "lz4";
+  case SegmentCodec::Zstd:
+    return "zstd";
+  }
+  return "unknown";
+}
+
+void compress(SegmentCodec codec, [[maybe_unused]] int level,
+              std::string_view raw, std::string &out) {
+  out.clear();
+  switch (codec) {
+  case SegmentCodec::None:
+    out.assign(raw);
+    return;
+  case SegmentCodec::Lz4: {
+#ifdef MY_CODE_LZ4
+    const auto size = static_cast<int>(raw.size());
+    out.resize(static_cast<std::size_t>(LZ4_compressBound(size)));
+    const int written = LZ4_compress_default(raw.data(), out.data(), size,
+                                             static_cast<int>(out.size()));
+    if (written <= 0) {
+      throw std::runtime_error("LogSegmentWriter: lz4 compression failed");
+    }
+    out.resize(static_cast<std::size_t>(written));
+#else
+    out.reserve(raw.size() + raw.size() / 255 + 16);
+    lz4_block::compress(raw, out);
+#endif
+    return;
+  }
+  case SegmentCodec::Zstd: {
+#ifdef MY_CODE_ZSTD
+    out.resize(ZSTD_compressBound(raw.size()));
+    const std::size_t written =
+        ZSTD_compress(out.data(), out.size(), raw.data(), raw.size(), level);
+    if (ZSTD_isError(written) != 0) {
+      throw std::runtime_error(std::string("LogSegmentWriter: ") +
+                               ZSTD_getErrorName(written));
+    }
+    out.resize(written);
+    return;
+#else
+    break;
+#endif
+  }
+  }
+  throw std::invalid_argument(std::string("LogSegmentWriter: ") +
+                              codecName(codec) +
+                              " support is not compiled in");
+}
+
+// Decompresses a stored block into out, which holds exactly rawSize bytes.
+void decompress(SegmentCodec codec, std::string_view stored, char *out,
+                std::size_t rawSize) {
+  switch (codec) {
+  case SegmentCodec::None:
+    if (stored.size() != rawSize) {
+      throwCorrupt();
+    }
+    std::memcpy(out, stored.data(), rawSize);
+    return;
+  case SegmentCodec::Lz4: {
+#ifdef MY_CODE_LZ4
+    const int written = LZ4_decompress_safe(
+        stored.data(), out, static_cast<int>(stored.size()),
+        static_cast<int>(rawSize));
+    if (written < 0 || static_cast<std::size_t>(written) != rawSize) {
+      throwCorrupt();
+    }
+#else
+    if (!lz4_block::decompress(stored, out, rawSize)) {
+      throwCorrupt();
+    }
+#endif
+    return;
+  }
+  case SegmentCodec::Zstd: {
+#ifdef MY_CODE_ZSTD
+    const std::size_t written =
+        ZSTD_decompress(out, rawSize, stored.data(), stored.size());
+    if (ZSTD_isError(written) != 0 || written != rawSize) {
+      throwCorrupt();
+    }
+    return;
+#else
+    break;
+#endif
+  }
+  }
+  throw std::runtime_error(std::string("LogSegmentReader: ") +
+                           codecName(codec) + " support is not compiled in");
+}
+
+} // namespace
+
+auto segmentCodecAvailable(SegmentCodec codec) -> bool {
+  switch (codec) {
+  case SegmentCodec::None:
+  case SegmentCodec::Lz4:
+    return true;
+  case SegmentCodec::Zstd:
+#ifdef MY_CODE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+LogSegmentWriter::LogSegmentWriter(const std::filesystem::path &path,
+                                   SegmentWriterOptions options)
+    : options_(options) {
+  if (options_.blockRecords == 0) {
+    throw std::invalid_argument(
+        "LogSegmentWriter: blockRecords must be non-zero");
+  }
+  if (options_.blockRecords > 0xFFFFFFFFU) {
+    throw std::invalid_argument("LogSegmentWriter: blockRecords is too large");
+  }
+  if (!segmentCodecAvailable(options_.codec)) {
+    throw std::invalid_argument(std::string("LogSegmentWriter: ") +
+                                codecName(options_.codec) +
+                                " support is not compiled in");
+  }
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    throwErrno("LogSegmentWriter: cannot open " + path.string());
+  }
+  std::array<char, log_segment::kHeaderSize> header{};
+  std::memcpy(header.data(), log_segment::kMagic.data(),
+              log_segment::kMagic.size());
+  storeLe(header.data() + kVersionOffset, log_segment::kVersion, 4);
+  storeLe(header.data() + kHeaderSizeOffset, log_segment::kHeaderSize, 4);
+  storeLe(header.data() + kFirstSequenceOffset, options_.firstSequence, 8);
+  try {
+    write(header.data(), header.size());
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+  const std::size_t reserved = std::min<std::size_t>(options_.blockRecords,
+                                                     std::size_t{1} << 16U);
+  ids_.reserve(reserved);
+  results_.reserve(reserved);
+  times_.reserve(reserved);
+}
+
+LogSegmentWriter::~LogSegmentWriter() {
+  try {
+    seal();
+  } catch (...) {
+    // Destructors must not throw; seal() explicitly to observe failures.
+  }
+}
+
+void LogSegmentWriter::write(const char *data, std::size_t size) {
+  while (size > 0) {
+    const ::ssize_t written = ::write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throwErrno("LogSegmentWriter: write failed");
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+    offset_ += static_cast<std::uint64_t>(written);
+  }
+}
+
+void LogSegmentWriter::append(std::string_view operation, int result,
+                              Clock::time_point time) {
+  if (fd_ < 0) {
+    throw std::logic_error("LogSegmentWriter: append after seal");
+  }
+  auto found = operationIds_.find(operation);
+  if (found == operationIds_.end()) {
+    const auto id = static_cast<std::uint32_t>(operations_.size());
+    found = operationIds_.emplace(std::string(operation), id).first;
+    operations_.push_back(found->first);
+  }
+  ids_.push_back(found->second);
+  results_.push_back(result);
+  times_.push_back(toNanos(time));
+  ++recordCount_;
+  // >= so that a block left full by a failed flushBlock() is retried.
+  if (ids_.size() >= options_.blockRecords) {
+    flushBlock();
+  }
+}
+
+void LogSegmentWriter::append(const LogRecordRange &records,
+                              Clock::time_point time) {
+  for (const LogEntry entry : records) {
+    append(entry.operation, entry.result, time);
+  }
+}
+
+void LogSegmentWriter::flushBlock() {
+  if (ids_.empty()) {
+    return;
+  }
+  MY_CODE_TRACE_SPAN_ITEMS("LogSegmentWriter::flushBlock", ids_.size());
+  raw_.clear();
+  putVarint(raw_, operations_.size());
+  for (const std::string_view operation : operations_) {
+    putVarint(raw_, operation.size());
+    raw_.append(operation);
+  }
+  for (const std::uint32_t id : ids_) {
+    putVarint(raw_, id);
+  }
+  for (const int result : results_) {
+    putVarint(raw_, zigzag(result));
+  }
+  const auto [minTime, maxTime] =
+      std::minmax_element(times_.begin(), times_.end());
+  // Differences are taken modulo 2^64, so any pair of times round-trips.
+  auto previous = static_cast<std::uint64_t>(*minTime);
+  for (const std::int64_t time : times_) {
+    const auto bits = static_cast<std::uint64_t>(time);
+    putVarint(raw_, zigzag(static_cast<std::int64_t>(bits - previous)));
+    previous = bits;
+  }
+  if (raw_.size() > kMaxRawBlock) {
+    throw std::length_error("LogSegmentWriter: block is too large");
+  }
+
+  SegmentBlockInfo info{
+      .firstSequence = options_.firstSequence + recordCount_ - ids_.size(),
+      .records = static_cast<std::uint32_t>(ids_.size()),
+      .codec = options_.codec,
+      .minTime = fromNanos(*minTime),
+      .maxTime = fromNanos(*maxTime),
+      .offset = offset_,
+      .storedSize = 0,
+      .rawSize = static_cast<std::uint32_t>(raw_.size()),
+  };
+  std::string_view stored = raw_;
+  if (info.codec != SegmentCodec::None) {
+    compress(info.codec, options_.level, raw_, compressed_);
+    if (compressed_.size() < raw_.size()) {
+      stored = compressed_;
+    } else {
+      info.codec = SegmentCodec::None;
+    }
+  }
+  info.storedSize = static_cast<std::uint32_t>(stored.size());
+  write(stored.data(), stored.size());
+  index_.push_back(info);
+
+  operationIds_.clear();
+  operations_.clear();
+  ids_.clear();
+  results_.clear();
+  times_.clear();
+}
+
+void LogSegmentWriter::seal() {
+  if (fd_ < 0) {
+    return;
+  }
+  try {
+    flushBlock();
+    const std::uint64_t indexOffset = offset_;
+    std::string tail(index_.size() * log_segment::kIndexEntrySize +
+                         log_segment::kFooterSize,
+                     '\0');
+    char *out = tail.data();
+    for (const SegmentBlockInfo &info : index_) {
+      storeLe(out, info.firstSequence, 8);
+      storeLe(out + 8, info.records, 4);
+      storeLe(out + 12, static_cast<std::uint8_t>(info.codec), 1);
+      storeLe(out + 16, static_cast<std::uint64_t>(toNanos(info.minTime)), 8);
+      storeLe(out + 24, static_cast<std::uint64_t>(toNanos(info.maxTime)), 8);
+      storeLe(out + 32, info.offset, 8);
+      storeLe(out + 40, info.storedSize, 4);
+      storeLe(out + 44, info.rawSize, 4);
+      out += log_segment::kIndexEntrySize;
+    }
+    storeLe(out, indexOffset, 8);
+    storeLe(out + 8, index_.size(), 8);
+    storeLe(out + 16, recordCount_, 8);
+    std::memcpy(out + 24, log_segment::kFooterMagic.data(),
+                log_segment::kFooterMagic.size());
+    write(tail.data(), tail.size());
+  } catch (...) {
+    ::close(std::exchange(fd_, -1));
+    throw;
+  }
+  if (::close(std::exchange(fd_, -1)) != 0) {
+    throwErrno("LogSegmentWriter: close failed");
+  }
+}
+
+LogSegmentReader::LogSegmentReader(const std::filesystem::path &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throwErrno("LogSegmentReader: cannot open " + path.string());
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throwErrno("LogSegmentReader: cannot stat " + path.string());
+  }
+  mappedSize_ = static_cast<std::size_t>(info.st_size);
+  if (mappedSize_ < log_segment::kHeaderSize + log_segment::kFooterSize) {
+    ::close(fd);
+    throwCorrupt();
+  }
+  void *mapping = ::mmap(nullptr, mappedSize_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throwErrno("LogSegmentReader: cannot map " + path.string());
+  }
+  base_ = static_cast<const char *>(mapping);
+  try {
+    parseIndex();
+  } catch (...) {
+    ::munmap(const_cast<char *>(base_), mappedSize_);
+    throw;
+  }
+}
+
+LogSegmentReader::~LogSegmentReader() {
+  ::munmap(const_cast<char *>(base_), mappedSize_);
+}
+
+void LogSegmentReader::parseIndex() {
+  if (std::string_view(base_, log_segment::kMagic.size()) !=
+          log_segment::kMagic ||
+      loadLe(base_ + kVersionOffset, 4) != log_segment::kVersion ||
+      loadLe(base_ + kHeaderSizeOffset, 4) != log_segment::kHeaderSize) {
+    throwCorrupt();
+  }
+  firstSequence_ = loadLe(base_ + kFirstSequenceOffset, 8);
+
+  const char *footer = base_ + mappedSize_ - log_segment::kFooterSize;
+  if (std::string_view(footer + 24, log_segment::kFooterMagic.size()) !=
+      log_segment::kFooterMagic) {
+    throw std::runtime_error("LogSegmentReader: segment is not sealed");
+  }
+  const std::uint64_t indexOffset = loadLe(footer, 8);
+  const std::uint64_t blockCount = loadLe(footer + 8, 8);
+  recordCount_ = loadLe(footer + 16, 8);
+  const std::uint64_t indexEnd = mappedSize_ - log_segment::kFooterSize;
+  if (indexOffset < log_segment::kHeaderSize || indexOffset > indexEnd ||
+      (indexEnd - indexOffset) / log_segment::kIndexEntrySize != blockCount ||
+      (indexEnd - indexOffset) % log_segment::kIndexEntrySize != 0) {
+    throwCorrupt();
+  }
+
+  index_.reserve(blockCount);
+  std::uint64_t sequence = firstSequence_;
+  std::uint64_t dataOffset = log_segment::kHeaderSize;
+  const char *in = base_ + indexOffset;
+  for (std::uint64_t i = 0; i < blockCount; ++i) {
+    SegmentBlockInfo block{
+        .firstSequence = loadLe(in, 8),
+        .records = static_cast<std::uint32_t>(loadLe(in + 8, 4)),
+        .codec = static_cast<SegmentCodec>(loadLe(in + 12, 1)),
+        .minTime = fromNanos(static_cast<std::int64_t>(loadLe(in + 16, 8))),
+        .maxTime = fromNanos(static_cast<std::int64_t>(loadLe(in + 24, 8))),
+        .offset = loadLe(in + 32, 8),
+        .storedSize = static_cast<std::uint32_t>(loadLe(in + 40, 4)),
+        .rawSize = static_cast<std::uint32_t>(loadLe(in + 44, 4)),
+    };
+    // Blocks are contiguous, in sequence order and non-empty.
+    if (block.firstSequence != sequence || block.records == 0 ||
+        block.offset != dataOffset ||
+        block.storedSize > indexOffset - dataOffset ||
+        static_cast<std::uint8_t>(block.codec) >
+            static_cast<std::uint8_t>(SegmentCodec::Zstd)) {
+      throwCorrupt();
+    }
+    sequence = block.endSequence();
+    dataOffset += block.storedSize;
+    index_.push_back(block);
+    in += log_segment::kIndexEntrySize;
+  }
+  if (dataOffset != indexOffset || sequence - firstSequence_ != recordCount_) {
+    throwCorrupt();
+  }
+}
+
+auto LogSegmentReader::findSequence(std::uint64_t sequence) const
+    -> std::size_t {
+  const auto found =
+      std::partition_point(index_.begin(), index_.end(),
+                           [sequence](const SegmentBlockInfo &block) {
+                             return block.endSequence() <= sequence;
+                           });
+  if (found == index_.end() || found->firstSequence > sequence) {
+    return index_.size();
+  }
+  return static_cast<std::size_t>(found - index_.begin());
+}
+
+auto LogSegmentReader::findTime(Clock::time_point time) const
+    -> std::size_t {
+  const auto found = std::partition_point(
+      index_.begin(), index_.end(),
+      [time](const SegmentBlockInfo &block) { return block.maxTime < time; });
+  return static_cast<std::size_t>(found - index_.begin());
+}
+
+auto LogSegmentReader::readBlock(std::size_t index) const -> SegmentBlock {
+  if (index >= index_.size()) {
+    throw std::out_of_range("LogSegmentReader: block index out of range");
+  }
+  const SegmentBlockInfo &info = index_[index];
+  MY_CODE_TRACE_SPAN_ITEMS("LogSegmentReader::readBlock", info.records);
+  const std::string_view stored(base_ + info.offset, info.storedSize);
+  std::string decoded;
+  std::string_view raw = stored;
+  if (info.codec != SegmentCodec::None) {
+    decoded.resize(info.rawSize);
+    decompress(info.codec, stored, decoded.data(), decoded.size());
+    raw = decoded;
+  } else if (info.storedSize != info.rawSize) {
+    throwCorrupt();
+  }
+
+  SegmentBlock block;
+  std::size_t cursor = 0;
+  const std::uint64_t operationCount = getVarint(raw, cursor);
+  if (operationCount > raw.size()) {
+    throwCorrupt();
+  }
+  // Names are copied first and viewed once text_ has stopped growing.
+  std::vector<std::pair<std::size_t, std::size_t>> names(
+      static_cast<std::size_t>(operationCount));
+  for (auto &[offset, length] : names) {
+    const std::uint64_t size = getVarint(raw, cursor);
+    if (size > raw.size() - cursor) {
+      throwCorrupt();
+    }
+    offset = block.text_.size();
+    length = static_cast<std::size_t>(size);
+    block.text_.insert(block.text_.end(), raw.data() + cursor,
+                       raw.data() + cursor + length);
+    cursor += length;
+  }
+  std::vector<std::string_view> operations;
+  operations.reserve(names.size());
+  for (const auto &[offset, length] : names) {
+    operations.emplace_back(block.text_.data() + offset, length);
+  }
+
+  block.entries_.resize(info.records);
+  for (std::size_t i = 0; i < block.entries_.size(); ++i) {
+    const std::uint64_t id = getVarint(raw, cursor);
+    if (id >= operations.size()) {
+      throwCorrupt();
+    }
+    block.entries_[i].entry.operation = operations[id];
+    block.entries_[i].sequence = info.firstSequence + i;
+  }
+  for (SegmentEntry &entry : block.entries_) {
+    entry.entry.result = static_cast<int>(unzigzag(getVarint(raw, cursor)));
+  }
+  auto time = static_cast<std::uint64_t>(toNanos(info.minTime));
+  for (SegmentEntry &entry : block.entries_) {
+    time += static_cast<std::uint64_t>(unzigzag(getVarint(raw, cursor)));
+    entry.time = fromNanos(static_cast<std::int64_t>(time));
+  }
+  if (cursor != raw.size()) {
+    throwCorrupt();
+  }
+  return block;
+}
+
+void LogSegmentReader::scan(std::uint64_t first, std::uint64_t last,
+                            const EntryVisitor &visit) const {
+  first = std::max(first, firstSequence_);
+  last = std::min(last, endSequence());
+  if (first >= last) {
+    return;
+  }
+  for (std::size_t i = findSequence(first);
+       i < index_.size() && index_[i].firstSequence < last; ++i) {
+    for (const SegmentEntry &entry : readBlock(i)) {
+      if (entry.sequence >= first && entry.sequence < last) {
+        visit(entry);
+      }
+    }
+  }
+}
+
+void LogSegmentReader::replay(std::size_t first, std::size_t last,
+                              const BlockVisitor &visit,
+                              const ParallelOptions &options) const {
+  last = std::min(last, index_.size());
+  if (first >= last) {
+    return;
+  }
+  MY_CODE_TRACE_SPAN_ITEMS("LogSegmentReader::replay", last - first);
+  Scheduler &scheduler = options.scheduler != nullptr ? *options.scheduler
+                                                      : Scheduler::global();
+  const std::size_t threads =
+      options.threads == 0 ? scheduler.concurrency() : options.threads;
+  const std::size_t window = 2 * std::max<std::size_t>(threads, 1);
+  const auto decodeWindow = [&](std::vector<SegmentBlock> &out,
+                                std::size_t begin) {
+    out.clear();
+    out.resize(std::min(window, last - begin));
+    scheduler.parallelFor(out.size(), 1,
+                          [&](std::size_t from, std::size_t to) {
+                            for (std::size_t i = from; i < to; ++i) {
+                              out[i] = readBlock(begin + i);
+                            }
+                          });
+  };
+
+  // The next window decodes on the workers while this one is visited.
+  std::vector<SegmentBlock> current;
+  std::vector<SegmentBlock> next;
+  decodeWindow(current, first);
+  for (std::size_t begin = first; begin < last;) {
+    const std::size_t nextBegin = begin + current.size();
+    TaskGroup group(scheduler);
+    if (nextBegin < last) {
+      group.run([&] { decodeWindow(next, nextBegin); });
+    }
+    for (const SegmentBlock &block : current) {
+      visit(block);
+    }
+    group.wait();
+    std::swap(current, next);
+    begin = nextBegin;
+  }
+}
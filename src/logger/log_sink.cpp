@@ -0,0 +1,266 @@
+#include "log_sink.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+auto openForAppend(const std::filesystem::path &path) -> int {
+  constexpr mode_t kMode = 0644;
+  const int fd =
+      ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, kMode);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "AsyncLogSink: cannot open " + path.string());
+  }
+  return fd;
+}
+
+#ifdef MY_CODE_METRICS
+struct SinkMetrics {
+  Gauge &queueDepth;
+  Histogram &writeLatency;
+  Histogram &flushLatency;
+};
+
+auto sinkMetrics() -> SinkMetrics & {
+  static SinkMetrics metrics = [] {
+    MetricsRegistry &registry = MetricsRegistry::global();
+    return SinkMetrics{
+        registry.gauge("my_code_sink_queue_depth",
+                       "Records queued in all AsyncLogSinks"),
+        registry.histogram("my_code_sink_write_seconds",
+                           "Latency of one AsyncLogSink batch write"),
+        registry.histogram("my_code_sink_flush_seconds",
+                           "Latency of AsyncLogSink::flush")};
+  }();
+  return metrics;
+}
+#endif
+
+auto validated(AsyncSinkOptions options) -> AsyncSinkOptions {
+  if (options.queueCapacity == 0 || options.batchSize == 0) {
+    throw std::invalid_argument(
+        "AsyncLogSink: queueCapacity and batchSize must be non-zero");
+  }
+  return options;
+}
+
+} // namespace
+
+AsyncLogSink::AsyncLogSink(int fd, AsyncSinkOptions options)
+    : AsyncLogSink(fd, false, options) {}
+
+AsyncLogSink::AsyncLogSink(const std::filesystem::path &path,
+                           AsyncSinkOptions options)
+    : AsyncLogSink(openForAppend(path), true, options) {}
+
+AsyncLogSink::AsyncLogSink(int fd, bool ownsFd, AsyncSinkOptions options)
+    : fd_(fd), ownsFd_(ownsFd), options_(validated(options)),
+      wakeThreshold_(static_cast<std::int64_t>(
+          std::min(options_.batchSize, options_.queueCapacity))),
+      queue_(LoggerOptions{.capacity = options_.queueCapacity,
+                           .policy = options_.policy,
+                           .maxOperationLength = options_.maxOperationLength}),
+      lastWrite_(std::chrono::steady_clock::now().time_since_epoch().count()) {
+  if (options_.scheduler != nullptr) {
+    tasks_.emplace(*options_.scheduler);
+  } else {
+    writer_ = std::thread([this] { run(); });
+  }
+}
+
+AsyncLogSink::~AsyncLogSink() {
+  close();
+  if (ownsFd_) {
+    ::close(fd_);
+  }
+}
+
+void AsyncLogSink::logOperation(std::string_view operation, int result) {
+  if (!queue_.logOperation(operation, result)) {
+    return;
+  }
+  MY_CODE_METRICS_ONLY(sinkMetrics().queueDepth.add(1);)
+  // Only the producer that crosses the threshold pays for the wake-up. The
+  // notify is lock-free and may race with the writer going to sleep; the
+  // flush interval bounds how long such a missed wake-up can delay a batch.
+  const std::int64_t queued =
+      queued_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (tasks_) {
+    const std::int64_t now =
+        std::chrono::steady_clock::now().time_since_epoch().count();
+    const std::int64_t interval =
+        std::chrono::nanoseconds(options_.flushInterval).count();
+    if (queued >= wakeThreshold_ ||
+        now - lastWrite_.load(std::memory_order_relaxed) >= interval) {
+      scheduleWrite();
+    }
+    return;
+  }
+  if (queued == wakeThreshold_) {
+    wake_.notify_one();
+  }
+}
+
+void AsyncLogSink::scheduleWrite() {
+  if (!writeScheduled_.exchange(true, std::memory_order_acq_rel)) {
+    tasks_->run([this] { writeTask(); });
+  }
+}
+
+void AsyncLogSink::writeTask() {
+  writeNow();
+  writeScheduled_.store(false, std::memory_order_release);
+  // Records that crossed the threshold while this task was pending saw the
+  // flag still set; pick them up here.
+  if (queued_.load(std::memory_order_relaxed) >= wakeThreshold_) {
+    scheduleWrite();
+  }
+}
+
+void AsyncLogSink::writeNow() {
+  const std::lock_guard<std::mutex> lock(writeMutex_);
+  writeQueued(buffer_);
+  lastWrite_.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                   std::memory_order_relaxed);
+}
+
+void AsyncLogSink::flush() {
+  MY_CODE_TRACE_SPAN("AsyncLogSink::flush");
+  MY_CODE_METRICS_ONLY(const LatencyTimer timer(sinkMetrics().flushLatency);)
+  if (tasks_) {
+    if (!closed_.load(std::memory_order_acquire)) {
+      writeNow();
+    }
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Once close() has begun, the writer may have read its last ticket and
+  // close() may be joining writer_. Its final pass writes everything.
+  if (stopping_ || !writer_.joinable()) {
+    return;
+  }
+  const std::uint64_t ticket = ++flushRequested_;
+  wake_.notify_one();
+  flushed_.wait(lock, [this, ticket] { return flushCompleted_ >= ticket; });
+}
+
+void AsyncLogSink::close() {
+  if (tasks_) {
+    if (!closed_.exchange(true, std::memory_order_acq_rel)) {
+      tasks_->wait();
+      writeNow();
+    }
+    return;
+  }
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    if (!writer_.joinable()) {
+      return;
+    }
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  writer_.join();
+}
+
+auto AsyncLogSink::stats() const -> AsyncSinkStats {
+  const LoggerStats queue = queue_.stats();
+  return {records_.load(std::memory_order_relaxed),
+          bytes_.load(std::memory_order_relaxed),
+          batches_.load(std::memory_order_relaxed),
+          queue.dropped + queue.overwritten +
+              failedRecords_.load(std::memory_order_relaxed),
+          writeErrors_.load(std::memory_order_relaxed)};
+}
+
+void AsyncLogSink::run() {
+  MY_CODE_TRACE_THREAD_NAME("log sink writer");
+  std::string buffer;
+  while (true) {
+    std::uint64_t ticket = 0;
+    bool stopping = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait_for(lock, options_.flushInterval, [this] {
+        return stopping_ || flushRequested_ != flushCompleted_ ||
+               queued_.load(std::memory_order_relaxed) >= wakeThreshold_;
+      });
+      ticket = flushRequested_;
+      stopping = stopping_;
+    }
+
+    writeQueued(buffer);
+
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      flushCompleted_ = ticket;
+    }
+    flushed_.notify_all();
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+void AsyncLogSink::writeQueued(std::string &buffer) {
+  while (true) {
+    buffer.clear();
+    const std::size_t count = queue_.drain(
+        [&buffer](const LogEntry &entry) {
+          entry.formatTo(buffer);
+          buffer.push_back('\n');
+        },
+        options_.batchSize);
+    if (count == 0) {
+      forgetOverwritten();
+      return;
+    }
+    queued_.fetch_sub(static_cast<std::int64_t>(count),
+                      std::memory_order_relaxed);
+    MY_CODE_METRICS_ONLY(
+        sinkMetrics().queueDepth.add(-static_cast<std::int64_t>(count));)
+    (writeBatch(buffer) ? records_ : failedRecords_)
+        .fetch_add(count, std::memory_order_relaxed);
+  }
+}
+
+void AsyncLogSink::forgetOverwritten() {
+  const std::uint64_t overwritten = queue_.stats().overwritten;
+  const auto evicted = static_cast<std::int64_t>(overwritten - overwritten_);
+  overwritten_ = overwritten;
+  if (evicted == 0) {
+    return;
+  }
+  queued_.fetch_sub(evicted, std::memory_order_relaxed);
+  MY_CODE_METRICS_ONLY(sinkMetrics().queueDepth.add(-evicted);)
+}
+
+auto AsyncLogSink::writeBatch(const std::string &buffer) -> bool {
+  MY_CODE_TRACE_SPAN_ITEMS("AsyncLogSink::writeBatch", buffer.size());
+  MY_CODE_METRICS_ONLY(const LatencyTimer timer(sinkMetrics().writeLatency);)
+  const char *data = buffer.data();
+  std::size_t remaining = buffer.size();
+  while (remaining > 0) {
+    const ssize_t written = ::write(fd_, data, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      writeErrors_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    data += written;
+    remaining -= static_cast<std::size_t>(written);
+  }
+  bytes_.fetch_add(buffer.size(), std::memory_order_relaxed);
+  batches_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
@@ -0,0 +1,69 @@
+#include "log_snapshot.hpp"
+#include <algorithm>
+#include <utility>
+
+LogSnapshot::LogSnapshot(std::shared_ptr<const LogStorage> storage,
+                         LogRecordRange range)
+    : storage_(std::move(storage)), range_(range) {
+  pin();
+}
+
+LogSnapshot::LogSnapshot(const LogSnapshot &other)
+    : storage_(other.storage_), range_(other.range_) {
+  pin();
+}
+
+auto LogSnapshot::operator=(const LogSnapshot &other) -> LogSnapshot & {
+  if (this != &other) {
+    other.pin();
+    release();
+    storage_ = other.storage_;
+    range_ = other.range_;
+  }
+  return *this;
+}
+
+LogSnapshot::LogSnapshot(LogSnapshot &&other) noexcept
+    : storage_(std::move(other.storage_)), range_(other.range_) {
+  other.range_ = LogRecordRange({}, {});
+}
+
+auto LogSnapshot::operator=(LogSnapshot &&other) noexcept -> LogSnapshot & {
+  if (this != &other) {
+    release();
+    storage_ = std::move(other.storage_);
+    range_ = other.range_;
+    other.range_ = LogRecordRange({}, {});
+  }
+  return *this;
+}
+
+LogSnapshot::~LogSnapshot() { release(); }
+
+void LogSnapshot::pin() const {
+  if (storage_) {
+    storage_->pins.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void LogSnapshot::release() {
+  if (storage_) {
+    // Orders every read through this snapshot before the Logger's acquire
+    // load that lets it reuse the slots.
+    storage_->pins.fetch_sub(1, std::memory_order_release);
+    storage_.reset();
+  }
+}
+
+auto LogSnapshot::range(std::uint64_t first, std::uint64_t last) const
+    -> LogRecordRange {
+  const std::uint64_t begin = std::clamp(first, firstSequence(), endSequence());
+  const std::uint64_t end = std::clamp(last, begin, endSequence());
+  return range_.subrange(static_cast<std::size_t>(begin - firstSequence()),
+                         static_cast<std::size_t>(end - begin));
+}
+
+auto LogSnapshot::tail(std::size_t count) const -> LogRecordRange {
+  const std::size_t kept = std::min(count, size());
+  return range_.subrange(size() - kept, kept);
+}
@@ -0,0 +1,459 @@
+#include "log_table.hpp"
+#include "memory_resource.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+
+using Clock = std::chrono::system_clock;
+
+constexpr std::uint32_t kNoId = 0xFFFF'FFFFU;
+constexpr std::size_t kWordBits = 64;
+
+// time_point::min() and max() stand for "unbounded" and map to the ends of
+// the int64 range instead of overflowing.
+auto toNanos(Clock::time_point time) -> std::int64_t {
+  if (time == Clock::time_point::min()) {
+    return std::numeric_limits<std::int64_t>::min();
+  }
+  if (time == Clock::time_point::max()) {
+    return std::numeric_limits<std::int64_t>::max();
+  }
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+auto fromNanos(std::int64_t nanos) -> Clock::time_point {
+  return Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+      std::chrono::nanoseconds(nanos)));
+}
+
+struct Columns {
+  const std::uint32_t *operations;
+  const int *results;
+  const std::int64_t *times;
+};
+
+// A LogFilter resolved against one table.
+struct Bounds {
+  // Nothing can match, e.g. the operation is not in the table.
+  bool none = false;
+  bool byOperation = false;
+  bool byTime = false;
+  std::uint32_t operation = 0;
+  int minResult = 0;
+  int maxResult = 0;
+  std::int64_t from = 0;
+  std::int64_t until = 0;
+};
+
+// Evaluated with & rather than && so the scans stay branch-free; columns a
+// filter does not use are not read at all.
+template <bool ByOperation, bool ByTime>
+auto matches(const Columns &columns, const Bounds &bounds, std::size_t i)
+    -> bool {
+  const int result = columns.results[i];
+  bool pass = (result >= bounds.minResult) & (result <= bounds.maxResult);
+  if constexpr (ByOperation) {
+    pass &= columns.operations[i] == bounds.operation;
+  }
+  if constexpr (ByTime) {
+    const std::int64_t time = columns.times[i];
+    pass &= (time >= bounds.from) & (time < bounds.until);
+  }
+  return pass;
+}
+
+// Runs scan.operator()<ByOperation, ByTime>() for the shape of bounds.
+template <class Scan> auto dispatch(const Bounds &bounds, const Scan &scan) {
+  if (bounds.byOperation) {
+    return bounds.byTime ? scan.template operator()<true, true>()
+                         : scan.template operator()<true, false>();
+  }
+  return bounds.byTime ? scan.template operator()<false, true>()
+                       : scan.template operator()<false, false>();
+}
+
+template <bool ByOperation, bool ByTime>
+auto aggregateRange(const Columns &columns, const Bounds &bounds,
+                    std::size_t begin, std::size_t end) -> LogAggregate {
+  std::uint64_t count = 0;
+  std::int64_t sum = 0;
+  int low = std::numeric_limits<int>::max();
+  int high = std::numeric_limits<int>::min();
+  // All ones for a matching row; selecting through the mask rather than
+  // with ?: is what lets GCC vectorise the loop.
+  for (std::size_t i = begin; i < end; ++i) {
+    const int mask =
+        -static_cast<int>(matches<ByOperation, ByTime>(columns, bounds, i));
+    const int kept = columns.results[i] & mask;
+    count -= static_cast<std::int64_t>(mask);
+    sum += kept;
+    low = std::min(low, kept | (std::numeric_limits<int>::max() & ~mask));
+    high = std::max(high, kept | (std::numeric_limits<int>::min() & ~mask));
+  }
+  return {count, sum, low, high};
+}
+
+// groups holds one aggregate per operation id.
+template <bool ByOperation, bool ByTime>
+auto groupRange(const Columns &columns, const Bounds &bounds,
+                std::size_t begin, std::size_t end,
+                std::vector<LogAggregate> &groups) -> bool {
+  for (std::size_t i = begin; i < end; ++i) {
+    if (!matches<ByOperation, ByTime>(columns, bounds, i)) {
+      continue;
+    }
+    const int result = columns.results[i];
+    LogAggregate &group = groups[columns.operations[i]];
+    ++group.count;
+    group.sum += result;
+    group.min = std::min(group.min, result);
+    group.max = std::max(group.max, result);
+  }
+  return true;
+}
+
+struct Candidate {
+  std::size_t index;
+  int result;
+};
+
+// Larger results first, then earlier rows.
+auto better(const Candidate &lhs, const Candidate &rhs) -> bool {
+  return lhs.result != rhs.result ? lhs.result > rhs.result
+                                  : lhs.index < rhs.index;
+}
+
+// Keeps the best k candidates of [begin, end) in heap, whose front is the
+// worst of them. Rows are visited in order, so a later row only displaces
+// the front with a strictly larger result.
+template <bool ByOperation, bool ByTime>
+auto topRange(const Columns &columns, const Bounds &bounds, std::size_t begin,
+              std::size_t end, std::size_t k, std::vector<Candidate> &heap)
+    -> bool {
+  for (std::size_t i = begin; i < end; ++i) {
+    const int result = columns.results[i];
+    if (heap.size() == k && result <= heap.front().result) {
+      continue;
+    }
+    if (!matches<ByOperation, ByTime>(columns, bounds, i)) {
+      continue;
+    }
+    if (heap.size() == k) {
+      std::pop_heap(heap.begin(), heap.end(), better);
+      heap.back() = {i, result};
+    } else {
+      heap.push_back({i, result});
+    }
+    std::push_heap(heap.begin(), heap.end(), better);
+  }
+  return true;
+}
+
+template <bool ByOperation, bool ByTime>
+auto selectRange(const Columns &columns, const Bounds &bounds,
+                 std::size_t begin, std::size_t end,
+                 std::vector<std::size_t> &out) -> bool {
+  for (std::size_t word = begin; word < end; word += kWordBits) {
+    const std::size_t count = std::min(kWordBits, end - word);
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      bits |= static_cast<std::uint64_t>(
+                  matches<ByOperation, ByTime>(columns, bounds, word + i))
+              << i;
+    }
+    for (; bits != 0; bits &= bits - 1) {
+      out.push_back(word + static_cast<std::size_t>(std::countr_zero(bits)));
+    }
+  }
+  return true;
+}
+
+auto columnsOf(const LogTable &table) -> Columns {
+  return {table.operationIds().data(), table.results().data(),
+          table.times().data()};
+}
+
+auto boundsOf(const LogTable &table, const LogFilter &filter) -> Bounds {
+  Bounds bounds{
+      .minResult = filter.minResult,
+      .maxResult = filter.maxResult,
+      .from = toNanos(filter.from),
+      .until = toNanos(filter.until),
+  };
+  bounds.byTime = filter.from != Clock::time_point::min() ||
+                  filter.until != Clock::time_point::max();
+  bounds.none = filter.minResult > filter.maxResult ||
+                (bounds.byTime && bounds.from >= bounds.until);
+  if (filter.operation) {
+    const auto id = table.findOperation(*filter.operation);
+    bounds.byOperation = true;
+    bounds.operation = id.value_or(0);
+    bounds.none = bounds.none || !id;
+  }
+  return bounds;
+}
+
+auto chunkCount(const ParallelOptions &options, std::size_t rows)
+    -> std::size_t {
+  return (rows + options.chunkSize() - 1) / options.chunkSize();
+}
+
+auto toGroups(const LogTable &table, const std::vector<LogAggregate> &groups)
+    -> std::vector<LogGroup> {
+  std::vector<LogGroup> out;
+  for (std::size_t id = 0; id < groups.size(); ++id) {
+    if (groups[id].count != 0) {
+      out.push_back(
+          {table.operationName(static_cast<std::uint32_t>(id)), groups[id]});
+    }
+  }
+  return out;
+}
+
+auto toRows(const LogTable &table, std::vector<Candidate> candidates,
+            std::size_t k) -> std::vector<LogRow> {
+  std::sort(candidates.begin(), candidates.end(), better);
+  candidates.resize(std::min(k, candidates.size()));
+  std::vector<LogRow> rows;
+  rows.reserve(candidates.size());
+  for (const Candidate &candidate : candidates) {
+    rows.push_back(table.row(candidate.index));
+  }
+  return rows;
+}
+
+} // namespace
+
+auto LogAggregate::mean() const -> double {
+  if (count == 0) {
+    throw std::logic_error("LogAggregate: no matching rows");
+  }
+  return static_cast<double>(sum) / static_cast<double>(count);
+}
+
+void LogAggregate::merge(const LogAggregate &other) {
+  count += other.count;
+  sum += other.sum;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+}
+
+LogTable::LogTable(std::pmr::memory_resource *resource)
+    : names_(resourceOrDefault(resource)), ids_(resourceOrDefault(resource)),
+      interned_(resourceOrDefault(resource)),
+      operations_(resourceOrDefault(resource)),
+      results_(resourceOrDefault(resource)),
+      times_(resourceOrDefault(resource)) {}
+
+auto LogTable::intern(std::string_view operation) -> std::uint32_t {
+  const auto found = ids_.find(operation);
+  if (found != ids_.end()) {
+    return found->second;
+  }
+  if (names_.size() == kNoId) {
+    throw std::length_error("LogTable: too many operations");
+  }
+  const auto id = static_cast<std::uint32_t>(names_.size());
+  names_.emplace_back(operation);
+  ids_.emplace(names_.back(), id);
+  return id;
+}
+
+void LogTable::append(std::string_view operation, int result,
+                      Clock::time_point time) {
+  operations_.push_back(intern(operation));
+  results_.push_back(result);
+  times_.push_back(toNanos(time));
+}
+
+void LogTable::append(const LogRecordRange &records, Clock::time_point time) {
+  MY_CODE_TRACE_SPAN_ITEMS("LogTable::append", records.size());
+  reserve(size() + records.size());
+  const std::int64_t nanos = toNanos(time);
+  for (const LogEntry entry : records) {
+    std::uint32_t id = 0;
+    if (entry.op) {
+      const auto op = static_cast<std::size_t>(*entry.op);
+      if (op >= interned_.size()) {
+        interned_.resize(op + 1, kNoId);
+      }
+      if (interned_[op] == kNoId) {
+        interned_[op] = intern(entry.operation);
+      }
+      id = interned_[op];
+    } else {
+      id = intern(entry.operation);
+    }
+    operations_.push_back(id);
+    results_.push_back(entry.result);
+    times_.push_back(nanos);
+  }
+}
+
+void LogTable::append(const SegmentBlock &block) {
+  reserve(size() + block.size());
+  for (const SegmentEntry &entry : block) {
+    append(entry.entry.operation, entry.entry.result, entry.time);
+  }
+}
+
+void LogTable::reserve(std::size_t rows) {
+  operations_.reserve(rows);
+  results_.reserve(rows);
+  times_.reserve(rows);
+}
+
+auto LogTable::row(std::size_t index) const -> LogRow {
+  return {index, names_[operations_[index]], results_[index],
+          fromNanos(times_[index])};
+}
+
+auto LogTable::findOperation(std::string_view operation) const
+    -> std::optional<std::uint32_t> {
+  const auto found = ids_.find(operation);
+  if (found == ids_.end()) {
+    return std::nullopt;
+  }
+  return found->second;
+}
+
+auto LogTable::aggregate(const LogFilter &filter) const -> LogAggregate {
+  MY_CODE_TRACE_SPAN_ITEMS("LogTable::aggregate", size());
+  const Bounds bounds = boundsOf(*this, filter);
+  if (bounds.none) {
+    return {};
+  }
+  const Columns columns = columnsOf(*this);
+  return dispatch(bounds, [&]<bool ByOperation, bool ByTime>() {
+    return aggregateRange<ByOperation, ByTime>(columns, bounds, 0, size());
+  });
+}
+
+auto LogTable::aggregate(const ParallelOptions &options,
+                         const LogFilter &filter) const -> LogAggregate {
+  MY_CODE_TRACE_SPAN_ITEMS("LogTable::aggregate", size());
+  const Bounds bounds = boundsOf(*this, filter);
+  if (bounds.none) {
+    return {};
+  }
+  const Columns columns = columnsOf(*this);
+  std::vector<LogAggregate> partial(chunkCount(options, size()));
+  Scheduler::forEachChunk(
+      options, size(), [&](std::size_t begin, std::size_t end) {
+        partial[begin / options.chunkSize()] =
+            dispatch(bounds, [&]<bool ByOperation, bool ByTime>() {
+              return aggregateRange<ByOperation, ByTime>(columns, bounds,
+                                                         begin, end);
+            });
+      });
+  LogAggregate total;
+  for (const LogAggregate &part : partial) {
+    total.merge(part);
+  }
+  return total;
+}
+
+auto LogTable::groupByOperation(const LogFilter &filter) const
+    -> std::vector<LogGroup> {
+  MY_CODE_TRACE_SPAN_ITEMS("LogTable::groupByOperation", size());
+  const Bounds bounds = boundsOf(*this, filter);
+  if (bounds.none) {
+    return {};
+  }
+  const Columns columns = columnsOf(*this);
+  std::vector<LogAggregate> groups(operationCount());
+  dispatch(bounds, [&]<bool ByOperation, bool ByTime>() {
+    return groupRange<ByOperation, ByTime>(columns, bounds, 0, size(),
+                                           groups);
+  });
+  return toGroups(*this, groups);
+}
+
+auto LogTable::groupByOperation(const ParallelOptions &options,
+                                const LogFilter &filter) const
+    -> std::vector<LogGroup> {
+  MY_CODE_TRACE_SPAN_ITEMS("LogTable::groupByOperation", size());
+  const Bounds bounds = boundsOf(*this, filter);
+  if (bounds.none) {
+    return {};
+  }
+  const Columns columns = columnsOf(*this);
+  std::vector<std::vector<LogAggregate>> partial(chunkCount(options, size()));
+  Scheduler::forEachChunk(
+      options, size(), [&](std::size_t begin, std::size_t end) {
+        std::vector<LogAggregate> &groups =
+            partial[begin / options.chunkSize()];
+        groups.resize(operationCount());
+        dispatch(bounds, [&]<bool ByOperation, bool ByTime>() {
+          return groupRange<ByOperation, ByTime>(columns, bounds, begin, end,
+                                                 groups);
+        });
+      });
+  std::vector<LogAggregate> groups(operationCount());
+  for (const std::vector<LogAggregate> &part : partial) {
+    for (std::size_t id = 0; id < part.size(); ++id) {
+      groups[id].merge(part[id]);
+    }
+  }
+  return toGroups(*this, groups);
+}
+
+auto LogTable::topK(std::size_t k, const LogFilter &filter) const
+    -> std::vector<LogRow> {
+  MY_CODE_TRACE_SPAN_ITEMS("LogTable::topK", size());
+  const Bounds bounds = boundsOf(*this, filter);
+  if (bounds.none || k == 0) {
+    return {};
+  }
+  const Columns columns = columnsOf(*this);
+  std::vector<Candidate> heap;
+  heap.reserve(std::min(k, size()));
+  dispatch(bounds, [&]<bool ByOperation, bool ByTime>() {
+    return topRange<ByOperation, ByTime>(columns, bounds, 0, size(), k, heap);
+  });
+  return toRows(*this, std::move(heap), k);
+}
+
+auto LogTable::topK(const ParallelOptions &options, std::size_t k,
+                    const LogFilter &filter) const -> std::vector<LogRow> {
+  MY_CODE_TRACE_SPAN_ITEMS("LogTable::topK", size());
+  const Bounds bounds = boundsOf(*this, filter);
+  if (bounds.none || k == 0) {
+    return {};
+  }
+  const Columns columns = columnsOf(*this);
+  std::vector<std::vector<Candidate>> partial(chunkCount(options, size()));
+  Scheduler::forEachChunk(
+      options, size(), [&](std::size_t begin, std::size_t end) {
+        std::vector<Candidate> &heap = partial[begin / options.chunkSize()];
+        dispatch(bounds, [&]<bool ByOperation, bool ByTime>() {
+          return topRange<ByOperation, ByTime>(columns, bounds, begin, end, k,
+                                               heap);
+        });
+      });
+  std::vector<Candidate> candidates;
+  for (const std::vector<Candidate> &part : partial) {
+    candidates.insert(candidates.end(), part.begin(), part.end());
+  }
+  return toRows(*this, std::move(candidates), k);
+}
+
+auto LogTable::select(const LogFilter &filter) const
+    -> std::vector<std::size_t> {
+  MY_CODE_TRACE_SPAN_ITEMS("LogTable::select", size());
+  const Bounds bounds = boundsOf(*this, filter);
+  if (bounds.none) {
+    return {};
+  }
+  const Columns columns = columnsOf(*this);
+  std::vector<std::size_t> out;
+  dispatch(bounds, [&]<bool ByOperation, bool ByTime>() {
+    return selectRange<ByOperation, ByTime>(columns, bounds, 0, size(), out);
+  });
+  return out;
+}
@@ -1,11 +1,399 @@
 #include "logger.hpp"
-#include <string> // Include for std::string and std::to_string
+#include "memory_resource.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string> // Include for std::string
 #include <vector> // Include for std::vector
 
-void Logger::logOperation(const std::string &operation, int result) const {
-  logs_.push_back(operation + " = " + std::to_string(result));
+namespace {
+
+auto withResource(LoggerOptions options) -> LoggerOptions {
+  options.resource = resourceOrDefault(options.resource);
+  return options;
+}
+
+} // namespace
+
+Logger::Logger() : Logger(LoggerOptions{}) {}
+
+Logger::Logger(LoggerOptions options)
+    : options_(withResource(options)), storage_(makeStorage()),
+      timeIndex_(options_.resource) {
+  if (!bounded()) {
+    return;
+  }
+  if (options_.maxOperationLength >
+      std::numeric_limits<std::uint32_t>::max() / options_.capacity) {
+    throw std::invalid_argument("Logger: capacity is too large");
+  }
+  storage_->records.resize(options_.capacity);
+  storage_->arena.resize(options_.capacity * options_.maxOperationLength);
+  sync_ = std::make_unique<Sync>();
+}
+
+#ifdef MY_CODE_METRICS
+namespace {
+
+struct LoggerMetrics {
+  Counter &records;
+  Histogram &appendLatency;
+};
+
+auto makeLoggerMetrics(const char *call) -> LoggerMetrics {
+  MetricsRegistry &registry = MetricsRegistry::global();
+  const MetricLabels labels{{"call", call}};
+  return {registry.counter("my_code_logger_records",
+                           "Records passed to Logger appends", labels),
+          registry.histogram("my_code_logger_append_seconds",
+                             "Latency of Logger appends, including waits "
+                             "for room in a blocking logger",
+                             labels)};
+}
+
+auto singleMetrics() -> LoggerMetrics & {
+  static LoggerMetrics metrics = makeLoggerMetrics("logOperation");
+  return metrics;
+}
+
+auto batchMetrics() -> LoggerMetrics & {
+  static LoggerMetrics metrics = makeLoggerMetrics("logOperations");
+  return metrics;
+}
+
+} // namespace
+#endif
+
+auto Logger::lock() const -> std::unique_lock<std::mutex> {
+  // The unbounded store keeps its original single-threaded contract and
+  // skips the mutex entirely.
+  return bounded() ? std::unique_lock<std::mutex>(sync_->mutex)
+                   : std::unique_lock<std::mutex>();
+}
+
+auto Logger::logOperation(std::string_view operation, int result) const
+    -> bool {
+  MY_CODE_TRACE_SPAN("Logger::logOperation");
+  MY_CODE_METRICS_ONLY(LoggerMetrics &metrics = singleMetrics();
+                       metrics.records.add();
+                       const LatencyTimer timer(metrics.appendLatency);)
+  auto guard = lock();
+  stampLocked();
+  if (!bounded()) {
+    prepareAppendLocked(1, operation.size());
+    LogStorage &storage = *storage_;
+    storage.records.push_back(
+        {static_cast<std::uint32_t>(storage.arena.size()),
+         static_cast<std::uint32_t>(operation.size()), result});
+    storage.arena.append(operation);
+    ++count_;
+    ++stats_.appended;
+    return true;
+  }
+  return appendBoundedLocked(guard, operation, result);
+}
+
+auto Logger::logOperations(std::string_view operation,
+                           std::span<const int> results) const
+    -> std::size_t {
+  MY_CODE_TRACE_SPAN_ITEMS("Logger::logOperations", results.size());
+  MY_CODE_METRICS_ONLY(LoggerMetrics &metrics = batchMetrics();
+                       metrics.records.add(results.size());
+                       const LatencyTimer timer(metrics.appendLatency);)
+  auto guard = lock();
+  stampLocked();
+  if (!bounded()) {
+    prepareAppendLocked(results.size(), operation.size());
+    LogStorage &storage = *storage_;
+    // Every record of the batch shares a single copy of the operation text.
+    const auto offset = static_cast<std::uint32_t>(storage.arena.size());
+    const auto length = static_cast<std::uint32_t>(operation.size());
+    storage.arena.append(operation);
+    for (const int result : results) {
+      storage.records.push_back({offset, length, result});
+    }
+    count_ += results.size();
+    stats_.appended += results.size();
+    return results.size();
+  }
+  std::size_t appended = 0;
+  for (const int result : results) {
+    appended += appendBoundedLocked(guard, operation, result) ? 1 : 0;
+  }
+  return appended;
+}
+
+auto Logger::logOperation(OpId operation, int result) const -> bool {
+  MY_CODE_TRACE_SPAN("Logger::logOperation");
+  MY_CODE_METRICS_ONLY(LoggerMetrics &metrics = singleMetrics();
+                       metrics.records.add();
+                       const LatencyTimer timer(metrics.appendLatency);)
+  if (!OperationTable::global().contains(operation)) {
+    throw std::invalid_argument("Logger: unknown operation id");
+  }
+  auto guard = lock();
+  stampLocked();
+  if (!bounded()) {
+    prepareAppendLocked(1, 0);
+    storage_->records.push_back({static_cast<std::uint32_t>(operation),
+                                 LogRecord::kInterned, result});
+    ++count_;
+    ++stats_.appended;
+    return true;
+  }
+  return appendBoundedLocked(guard, operation, result);
+}
+
+auto Logger::logOperations(OpId operation, std::span<const int> results) const
+    -> std::size_t {
+  MY_CODE_TRACE_SPAN_ITEMS("Logger::logOperations", results.size());
+  MY_CODE_METRICS_ONLY(LoggerMetrics &metrics = batchMetrics();
+                       metrics.records.add(results.size());
+                       const LatencyTimer timer(metrics.appendLatency);)
+  if (!OperationTable::global().contains(operation)) {
+    throw std::invalid_argument("Logger: unknown operation id");
+  }
+  auto guard = lock();
+  stampLocked();
+  if (!bounded()) {
+    prepareAppendLocked(results.size(), 0);
+    for (const int result : results) {
+      storage_->records.push_back({static_cast<std::uint32_t>(operation),
+                                   LogRecord::kInterned, result});
+    }
+    count_ += results.size();
+    stats_.appended += results.size();
+    return results.size();
+  }
+  std::size_t appended = 0;
+  for (const int result : results) {
+    appended += appendBoundedLocked(guard, operation, result) ? 1 : 0;
+  }
+  return appended;
+}
+
+auto Logger::claimSlotLocked(std::unique_lock<std::mutex> &guard) const
+    -> std::size_t {
+  const std::size_t capacity = options_.capacity;
+  if (count_ == capacity) {
+    switch (options_.policy) {
+    case OverflowPolicy::Drop:
+      ++stats_.dropped;
+      return capacity;
+    case OverflowPolicy::Overwrite:
+      ++stats_.overwritten;
+      popFrontLocked(1);
+      break;
+    case OverflowPolicy::Block: {
+      MY_CODE_TRACE_SPAN("Logger::waitForRoom");
+      sync_->notFull.wait(guard,
+                          [this, capacity] { return count_ < capacity; });
+      break;
+    }
+    }
+  }
+
+  // The slot's previous record may still be visible to a snapshot.
+  const std::uint64_t sequence = firstSequence_ + count_;
+  if (sequence >= capacity && sequence - capacity < observedEnd_ &&
+      pinnedLocked()) {
+    unshareLocked(0, 0);
+  }
+  std::size_t slot = head_ + count_;
+  if (slot >= capacity) {
+    slot -= capacity;
+  }
+  ++count_;
+  ++stats_.appended;
+  return slot;
+}
+
+auto Logger::appendBoundedLocked(std::unique_lock<std::mutex> &guard,
+                                 std::string_view operation, int result) const
+    -> bool {
+  const std::size_t slot = claimSlotLocked(guard);
+  if (slot == options_.capacity) {
+    return false;
+  }
+  const std::size_t offset = slot * options_.maxOperationLength;
+  const std::size_t length =
+      std::min(operation.size(), options_.maxOperationLength);
+  if (length < operation.size()) {
+    ++stats_.truncated;
+  }
+  LogStorage &storage = *storage_;
+  std::copy_n(operation.data(), length, storage.arena.data() + offset);
+  storage.records[slot] = {static_cast<std::uint32_t>(offset),
+                           static_cast<std::uint32_t>(length), result};
+  return true;
+}
+
+auto Logger::appendBoundedLocked(std::unique_lock<std::mutex> &guard,
+                                 OpId operation, int result) const -> bool {
+  const std::size_t slot = claimSlotLocked(guard);
+  if (slot == options_.capacity) {
+    return false;
+  }
+  storage_->records[slot] = {static_cast<std::uint32_t>(operation),
+                             LogRecord::kInterned, result};
+  return true;
+}
+
+void Logger::popFrontLocked(std::size_t count) const {
+  if (count == 0) {
+    return;
+  }
+  count_ -= count;
+  firstSequence_ += count;
+  while (timeIndex_.size() > 1 && timeIndex_[1].sequence <= firstSequence_) {
+    timeIndex_.pop_front();
+  }
+  if (bounded()) {
+    head_ = (head_ + count) % options_.capacity;
+    sync_->notFull.notify_all();
+  } else if (count_ == 0) {
+    // Fully drained: rewind so the existing capacity is reused, unless a
+    // snapshot still reads it.
+    if (pinnedLocked()) {
+      const LogStorage &old = *storage_;
+      auto fresh = makeStorage();
+      fresh->records.reserve(old.records.capacity());
+      fresh->arena.reserve(old.arena.capacity());
+      storage_ = std::move(fresh);
+      observedEnd_ = 0;
+    } else {
+      storage_->records.clear();
+      storage_->arena.clear();
+    }
+    head_ = 0;
+  } else {
+    head_ += count;
+  }
+}
+
+auto Logger::makeStorage() const -> std::shared_ptr<LogStorage> {
+  // The control block comes from the same resource as the storage.
+  return std::allocate_shared<LogStorage>(
+      std::pmr::polymorphic_allocator<LogStorage>(options_.resource),
+      options_.resource);
+}
+
+auto Logger::pinnedLocked() const -> bool {
+  // Pairs with the release decrement in LogSnapshot, so reads through a
+  // released snapshot happen before the slots are reused.
+  return storage_->pins.load(std::memory_order_acquire) != 0;
+}
+
+void Logger::unshareLocked(std::size_t records, std::size_t textBytes) const {
+  const LogStorage &old = *storage_;
+  auto fresh = makeStorage();
+  fresh->records.reserve(std::max(records, old.records.size()));
+  fresh->records.assign(old.records.begin(), old.records.end());
+  fresh->arena.reserve(std::max(textBytes, old.arena.size()));
+  fresh->arena.assign(old.arena);
+  storage_ = std::move(fresh);
+  observedEnd_ = 0;
+}
+
+void Logger::growLocked(std::size_t records, std::size_t textBytes) const {
+  LogStorage &storage = *storage_;
+  const std::size_t needRecords = storage.records.size() + records;
+  const std::size_t needText = storage.arena.size() + textBytes;
+  if (needText > kMaxArenaBytes) {
+    throw std::length_error("Logger: operation text exceeds 32-bit offsets");
+  }
+  // Grow geometrically: batch appends would otherwise reallocate each time.
+  // Only the buffer that is full grows, so interned records, which carry no
+  // text, do not keep doubling the arena.
+  const auto grown = [](std::size_t need, std::size_t capacity) {
+    return need <= capacity ? capacity : std::max(need, 2 * capacity);
+  };
+  const std::size_t recordCapacity =
+      grown(needRecords, storage.records.capacity());
+  const std::size_t textCapacity =
+      std::min(grown(needText, storage.arena.capacity()), kMaxArenaBytes);
+  if (pinnedLocked()) {
+    unshareLocked(recordCapacity, textCapacity);
+    return;
+  }
+  storage.records.reserve(recordCapacity);
+  storage.arena.reserve(textCapacity);
+}
+
+void Logger::stampTimeLocked() const {
+  const auto now = std::chrono::steady_clock::now();
+  if (timeIndex_.empty() ||
+      now - timeIndex_.back().time >= options_.timeIndexResolution) {
+    timeIndex_.push_back({firstSequence_ + count_, now});
+  }
+}
+
+auto Logger::recordsLocked() const -> LogRecordRange {
+  return {storage_->records, head_, count_, storage_->arena, firstSequence_};
 }
 
 auto Logger::getLogs() const -> const std::vector<std::string> & {
+  const auto guard = lock();
+  const LogRecordRange all = recordsLocked();
+  if (logsFirst_ < firstSequence_) {
+    const auto stale = static_cast<std::ptrdiff_t>(
+        std::min<std::uint64_t>(firstSequence_ - logsFirst_, logs_.size()));
+    logs_.erase(logs_.begin(), logs_.begin() + stale);
+    logsFirst_ = firstSequence_;
+  }
+  for (std::size_t i = logs_.size(); i < all.size(); ++i) {
+    logs_.push_back(all[i].format());
+  }
   return logs_;
 }
+
+auto Logger::records() const -> LogRecordRange {
+  const auto guard = lock();
+  return recordsLocked();
+}
+
+auto Logger::snapshot() const -> LogSnapshot {
+  const auto guard = lock();
+  observedEnd_ = firstSequence_ + count_;
+  return {storage_, recordsLocked()};
+}
+
+auto Logger::sequenceAt(std::chrono::steady_clock::time_point time) const
+    -> std::uint64_t {
+  if (options_.timeIndexResolution.count() == 0) {
+    throw std::logic_error("Logger: time index is disabled");
+  }
+  const auto guard = lock();
+  const auto found = std::partition_point(
+      timeIndex_.begin(), timeIndex_.end(),
+      [time](const TimeCheckpoint &checkpoint) {
+        return checkpoint.time < time;
+      });
+  return found == timeIndex_.end() ? firstSequence_ + count_
+                                   : found->sequence;
+}
+
+auto Logger::size() const -> std::size_t {
+  const auto guard = lock();
+  return count_;
+}
+
+void Logger::reserve(std::size_t records, std::size_t textBytes) const {
+  if (bounded()) {
+    return;
+  }
+  if (pinnedLocked()) {
+    unshareLocked(records, textBytes);
+    return;
+  }
+  storage_->records.reserve(records);
+  storage_->arena.reserve(textBytes);
+}
+
+auto Logger::stats() const -> LoggerStats {
+  const auto guard = lock();
+  return stats_;
+}
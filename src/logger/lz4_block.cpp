@@ -0,0 +1,155 @@
+#include "lz4_block.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr std::size_t kMinMatch = 4;
+constexpr std::size_t kLastLiterals = 5;
+constexpr std::size_t kMatchFindLimit = 12;
+constexpr std::size_t kMaxOffset = 0xFFFF;
+constexpr std::size_t kHashLog = 12;
+constexpr std::size_t kRunMask = 15;
+
+auto read32(const char *in) -> std::uint32_t {
+  std::uint32_t value = 0;
+  std::memcpy(&value, in, sizeof(value));
+  return value;
+}
+
+auto hash(std::uint32_t sequence) -> std::size_t {
+  return (sequence * 2'654'435'761U) >> (32 - kHashLog);
+}
+
+void putLength(std::string &out, std::size_t length) {
+  for (; length >= 0xFF; length -= 0xFF) {
+    out.push_back(static_cast<char>(0xFF));
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+// Emits one sequence; matchLength 0 ends the block with literals only.
+void putSequence(std::string &out, const char *literals,
+                    std::size_t literalCount, std::size_t offset,
+                    std::size_t matchLength) {
+  const std::size_t literalCode = std::min(literalCount, kRunMask);
+  const std::size_t matchCode =
+      matchLength == 0 ? 0 : std::min(matchLength - kMinMatch, kRunMask);
+  out.push_back(static_cast<char>((literalCode << 4U) | matchCode));
+  if (literalCode == kRunMask) {
+    putLength(out, literalCount - kRunMask);
+  }
+  out.append(literals, literalCount);
+  if (matchLength == 0) {
+    return;
+  }
+  out.push_back(static_cast<char>(offset & 0xFFU));
+  out.push_back(static_cast<char>(offset >> 8U));
+  if (matchCode == kRunMask) {
+    putLength(out, matchLength - kMinMatch - kRunMask);
+  }
+}
+
+} // namespace
+
+namespace lz4_block {
+
+void compress(std::string_view src, std::string &out) {
+  const char *in = src.data();
+  const std::size_t size = src.size();
+  std::size_t anchor = 0;
+  if (size > kMatchFindLimit) {
+    std::array<std::uint32_t, std::size_t{1} << kHashLog> table{};
+    const std::size_t matchLimit = size - kLastLiterals;
+    const std::size_t inputLimit = size - kMatchFindLimit;
+    std::size_t position = 0;
+    std::size_t misses = 0;
+    while (position < inputLimit) {
+      const std::uint32_t sequence = read32(in + position);
+      const std::size_t slot = hash(sequence);
+      const std::size_t candidate = table[slot];
+      table[slot] = static_cast<std::uint32_t>(position);
+      if (candidate >= position || position - candidate > kMaxOffset ||
+          read32(in + candidate) != sequence) {
+        position += 1 + (misses++ >> 6U);
+        continue;
+      }
+      misses = 0;
+      std::size_t length = kMinMatch;
+      while (position + length < matchLimit &&
+             in[candidate + length] == in[position + length]) {
+        ++length;
+      }
+      putSequence(out, in + anchor, position - anchor,
+                     position - candidate, length);
+      position += length;
+      anchor = position;
+    }
+  }
+  putSequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+auto decompress(std::string_view src, char *out, std::size_t size) -> bool {
+  const auto *in = reinterpret_cast<const unsigned char *>(src.data());
+  const std::size_t end = src.size();
+  std::size_t input = 0;
+  std::size_t output = 0;
+  const auto addLength = [&](std::size_t &length) {
+    unsigned char byte = 0;
+    do {
+      if (input >= end) {
+        return false;
+      }
+      byte = in[input++];
+      length += byte;
+    } while (byte == 0xFF);
+    return true;
+  };
+  while (input < end) {
+    const unsigned char token = in[input++];
+    std::size_t literals = token >> 4U;
+    if (literals == kRunMask && !addLength(literals)) {
+      return false;
+    }
+    if (literals > end - input || literals > size - output) {
+      return false;
+    }
+    std::memcpy(out + output, in + input, literals);
+    input += literals;
+    output += literals;
+    if (input == end) {
+      return output == size;
+    }
+    if (end - input < 2) {
+      return false;
+    }
+    const std::size_t offset = in[input] | (in[input + 1] << 8U);
+    input += 2;
+    if (offset == 0 || offset > output) {
+      return false;
+    }
+    std::size_t length = token & kRunMask;
+    if (length == kRunMask && !addLength(length)) {
+      return false;
+    }
+    length += kMinMatch;
+    if (length > size - output) {
+      return false;
+    }
+    const char *match = out + output - offset;
+    if (offset >= length) {
+      std::memcpy(out + output, match, length);
+    } else {
+      // Overlapping copy repeats the last offset bytes.
+      for (std::size_t i = 0; i < length; ++i) {
+        out[output + i] = match[i];
+      }
+    }
+    output += length;
+  }
+  return false;
+}
+
+} // namespace lz4_block
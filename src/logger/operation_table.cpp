@@ -0,0 +1,86 @@
+#include "operation_table.hpp"
+#include <bit>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::uint64_t kIdBits = 32;
+
+auto pack(std::size_t hash, std::uint32_t id) -> std::uint64_t {
+  const auto high = static_cast<std::uint64_t>(hash) >> kIdBits;
+  return (high << kIdBits) | (std::uint64_t{id} + 1);
+}
+
+auto tableSize(std::size_t capacity) -> std::size_t {
+  if (capacity == 0 ||
+      capacity > std::numeric_limits<std::uint32_t>::max() / 2) {
+    throw std::invalid_argument("OperationTable: invalid capacity");
+  }
+  return std::bit_ceil(capacity * 2);
+}
+
+} // namespace
+
+OperationTable::OperationTable(std::size_t capacity)
+    : capacity_(capacity), mask_(tableSize(capacity) - 1),
+      slots_(std::make_unique<std::atomic<std::uint64_t>[]>(mask_ + 1)),
+      entries_(std::make_unique<Entry[]>(capacity)) {}
+
+OperationTable::~OperationTable() = default;
+
+auto OperationTable::find(std::string_view operation, std::size_t hash) const
+    -> std::optional<OpId> {
+  const std::uint64_t high = pack(hash, 0) >> kIdBits;
+  for (std::size_t index = hash & mask_;; index = (index + 1) & mask_) {
+    const std::uint64_t slot = slots_[index].load(std::memory_order_acquire);
+    if (slot == 0) {
+      return std::nullopt;
+    }
+    if ((slot >> kIdBits) != high) {
+      continue;
+    }
+    const auto id = static_cast<OpId>((slot & 0xFFFF'FFFFU) - 1);
+    if (name(id) == operation) {
+      return id;
+    }
+  }
+}
+
+auto OperationTable::find(std::string_view operation) const
+    -> std::optional<OpId> {
+  return find(operation, std::hash<std::string_view>{}(operation));
+}
+
+auto OperationTable::intern(std::string_view operation) -> OpId {
+  const std::size_t hash = std::hash<std::string_view>{}(operation);
+  if (const std::optional<OpId> id = find(operation, hash)) {
+    return *id;
+  }
+
+  const std::lock_guard guard(mutex_);
+  // Another thread may have added it since the lock-free probe.
+  if (const std::optional<OpId> id = find(operation, hash)) {
+    return *id;
+  }
+  const std::size_t count = count_.load(std::memory_order_relaxed);
+  if (count == capacity_) {
+    throw std::length_error("OperationTable: table is full");
+  }
+  const std::string &text = text_.emplace_back(operation);
+  entries_[count] = {text.data(), text.size()};
+  const auto id = static_cast<std::uint32_t>(count);
+  count_.store(count + 1, std::memory_order_release);
+
+  std::size_t index = hash & mask_;
+  while (slots_[index].load(std::memory_order_relaxed) != 0) {
+    index = (index + 1) & mask_;
+  }
+  slots_[index].store(pack(hash, id), std::memory_order_release);
+  return static_cast<OpId>(id);
+}
+
+auto OperationTable::global() -> OperationTable & {
+  static OperationTable instance;
+  return instance;
+}
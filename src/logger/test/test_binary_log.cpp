@@ -0,0 +1,104 @@
+#include "binary_log.hpp"
+#include "logger.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+auto tempSegmentPath(const std::string &name) -> std::filesystem::path {
+  return std::filesystem::temp_directory_path() /
+         (name + "_" + std::to_string(::getpid()) + ".binlog");
+}
+
+} // namespace
+
+TEST(BinaryLogTests, TestRoundTripThroughMapping) {
+  const auto path = tempSegmentPath("binlog_roundtrip");
+  const std::vector<int> results{0, 1, -1, 300, -300,
+                                 std::numeric_limits<int>::max(),
+                                 std::numeric_limits<int>::min()};
+  {
+    // A tiny initial capacity forces the mapping to grow.
+    BinaryLogWriter writer(path, 64);
+    for (const int result : results) {
+      writer.append(result % 2 == 0 ? "add" : "multiply", result);
+    }
+    EXPECT_EQ(writer.recordCount(), results.size());
+  }
+
+  const BinaryLogReader reader(path);
+  EXPECT_EQ(reader.recordCount(), results.size());
+  std::size_t index = 0;
+  for (const LogEntry &entry : reader) {
+    ASSERT_LT(index, results.size());
+    EXPECT_EQ(entry.result, results[index]);
+    EXPECT_EQ(entry.operation, results[index] % 2 == 0 ? "add" : "multiply");
+    ++index;
+  }
+  EXPECT_EQ(index, results.size());
+  std::filesystem::remove(path);
+}
+
+TEST(BinaryLogTests, TestInternedOperationsKeepRecordsCompact) {
+  const auto path = tempSegmentPath("binlog_compact");
+  Logger logger;
+  for (int i = 0; i < 100; ++i) {
+    logger.logOperation("5 * 3", 15);
+  }
+  BinaryLogWriter writer(path);
+  writer.append(logger.records());
+  // One definition, then two bytes (id, result) per record.
+  EXPECT_EQ(writer.bytesWritten(),
+            binary_log::kHeaderSize + 1 + 5 + 100 * 2);
+
+  // Readers can open a segment that is still being written.
+  const BinaryLogReader reader(path);
+  std::vector<std::string> formatted;
+  for (const LogEntry &entry : reader) {
+    formatted.push_back(entry.format());
+  }
+  EXPECT_EQ(formatted, logger.getLogs());
+  writer.close();
+  std::filesystem::remove(path);
+}
+
+TEST(BinaryLogTests, TestRejectsForeignFile) {
+  const auto path = tempSegmentPath("binlog_foreign");
+  { const BinaryLogWriter writer(path); }
+  std::filesystem::resize_file(path, 8);
+  EXPECT_THROW(BinaryLogReader{path}, std::runtime_error);
+  std::filesystem::remove(path);
+}
+
+// Readers opened while the writer appends see a prefix: every record the
+// header counts is within the published data.
+TEST(BinaryLogTests, TestReaderOpenedDuringAppendsSeesPrefix) {
+  const auto path = tempSegmentPath("binlog_live");
+  constexpr int kRecords = 20'000;
+  // Large enough that the mapping never grows under the reader.
+  BinaryLogWriter writer(path, 1U << 20U);
+  std::thread appender([&] {
+    for (int i = 0; i < kRecords; ++i) {
+      writer.append(i % 2 == 0 ? "add" : "multiply", i);
+    }
+  });
+  for (int open = 0; open < 200; ++open) {
+    const BinaryLogReader reader(path);
+    std::uint64_t seen = 0;
+    for (const LogEntry &entry : reader) {
+      ASSERT_EQ(entry.result, static_cast<int>(seen));
+      ++seen;
+    }
+    EXPECT_GE(seen, reader.recordCount());
+  }
+  appender.join();
+  writer.close();
+  EXPECT_EQ(BinaryLogReader(path).recordCount(), std::uint64_t{kRecords});
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,84 @@
+#include "concurrent_logger.hpp"
+#include <gtest/gtest.h>
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ConcurrentLoggerTests, TestLogOperation) {
+  ConcurrentLogger logger;
+  logger.logOperation("2 + 3", 5);
+  logger.logOperation("5 * 2", 10);
+
+  auto logs = logger.getLogs();
+  ASSERT_EQ(logs.size(), 2u);
+  EXPECT_EQ(logs[0], "2 + 3 = 5");
+  EXPECT_EQ(logs[1], "5 * 2 = 10");
+}
+
+// More loggers than the per-thread buffer cache holds, written in turn.
+TEST(ConcurrentLoggerTests, TestThreadAlternatingBetweenLoggers) {
+  std::array<ConcurrentLogger, 12> loggers;
+  for (int round = 0; round < 3; ++round) {
+    for (std::size_t i = 0; i < loggers.size(); ++i) {
+      loggers[i].logOperation("op" + std::to_string(i), round);
+    }
+  }
+  for (std::size_t i = 0; i < loggers.size(); ++i) {
+    const std::string op = "op" + std::to_string(i);
+    EXPECT_EQ(loggers[i].getLogs(),
+              (std::vector<std::string>{op + " = 0", op + " = 1",
+                                        op + " = 2"}));
+  }
+}
+
+TEST(ConcurrentLoggerTests, TestConcurrentWritersKeepPerThreadOrder) {
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 2000;
+  ConcurrentLogger logger;
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kThreads; ++t) {
+    writers.emplace_back([&logger, t] {
+      std::string label(1, 't');
+      label += std::to_string(t);
+      for (int i = 0; i < kPerThread; ++i) {
+        logger.logOperation(label, i);
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+
+  auto logs = logger.getLogs();
+  ASSERT_EQ(logs.size(), static_cast<std::size_t>(kThreads * kPerThread));
+  std::vector<int> next(kThreads, 0);
+  for (const auto &log : logs) {
+    const int thread = std::stoi(log.substr(1));
+    const int value = std::stoi(log.substr(log.find('=') + 2));
+    EXPECT_EQ(value, next[thread]++);
+  }
+}
+
+TEST(ConcurrentLoggerTests, TestSnapshotsArePrefixesWhileWriting) {
+  constexpr int kRecords = 20000;
+  ConcurrentLogger logger;
+  std::thread writer([&logger] {
+    for (int i = 0; i < kRecords; ++i) {
+      logger.logOperation("op", i);
+    }
+  });
+
+  std::size_t previous = 0;
+  while (previous < static_cast<std::size_t>(kRecords)) {
+    auto snapshot = logger.getLogs();
+    ASSERT_GE(snapshot.size(), previous);
+    for (std::size_t i = previous; i < snapshot.size(); ++i) {
+      ASSERT_EQ(snapshot[i], "op = " + std::to_string(i));
+    }
+    previous = snapshot.size();
+  }
+  writer.join();
+  EXPECT_EQ(logger.size(), static_cast<std::size_t>(kRecords));
+}
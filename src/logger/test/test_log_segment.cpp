@@ -0,0 +1,258 @@
+#include "log_segment.hpp"
+#include "logger.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::system_clock;
+
+const auto kStart = Clock::time_point{} + std::chrono::hours(24 * 365 * 50);
+
+auto tempPath(const std::string &name) -> std::filesystem::path {
+  return std::filesystem::path(::testing::TempDir()) / name;
+}
+
+struct Record {
+  std::string operation;
+  int result = 0;
+  Clock::time_point time{};
+
+  friend auto operator==(const Record &, const Record &) -> bool = default;
+};
+
+// Repetitive operations, small results and steady timestamps, like a real
+// calculator log, with the odd long name to exercise long literal runs.
+auto makeRecords(std::size_t count) -> std::vector<Record> {
+  static const std::vector<std::string> kOperations{
+      "add", "subtract", "multiply", "divide",
+      "expression: " + std::string(300, 'x')};
+  std::vector<Record> records(count);
+  std::uint32_t state = 7;
+  for (std::size_t i = 0; i < count; ++i) {
+    state = state * 1'664'525U + 1'013'904'223U;
+    records[i] = {kOperations[(state >> 8U) % kOperations.size()],
+                  static_cast<int>(state % 2001) - 1000,
+                  kStart + std::chrono::microseconds(150 * i)};
+  }
+  return records;
+}
+
+void writeAll(const std::filesystem::path &path,
+              const std::vector<Record> &records,
+              SegmentWriterOptions options) {
+  LogSegmentWriter writer(path, options);
+  for (const Record &record : records) {
+    writer.append(record.operation, record.result, record.time);
+  }
+  writer.seal();
+}
+
+auto readAll(const LogSegmentReader &reader) -> std::vector<Record> {
+  std::vector<Record> out;
+  for (std::size_t i = 0; i < reader.blocks().size(); ++i) {
+    for (const SegmentEntry &entry : reader.readBlock(i)) {
+      EXPECT_EQ(entry.sequence, reader.firstSequence() + out.size());
+      out.push_back({std::string(entry.entry.operation), entry.entry.result,
+                     entry.time});
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(LogSegmentTests, TestLz4RoundTripCompresses) {
+  const auto path = tempPath("segment_lz4.seg");
+  const auto records = makeRecords(10'000);
+  writeAll(path, records, {.codec = SegmentCodec::Lz4, .blockRecords = 1000});
+
+  const LogSegmentReader reader(path);
+  ASSERT_EQ(reader.blocks().size(), 10u);
+  EXPECT_EQ(reader.recordCount(), records.size());
+  EXPECT_EQ(readAll(reader), records);
+
+  std::uint64_t raw = 0;
+  std::uint64_t stored = 0;
+  for (const SegmentBlockInfo &block : reader.blocks()) {
+    EXPECT_EQ(block.codec, SegmentCodec::Lz4);
+    raw += block.rawSize;
+    stored += block.storedSize;
+  }
+  EXPECT_LT(stored * 2, raw);
+  // The columnar encoding alone is far smaller than "operation = result".
+  EXPECT_LT(std::filesystem::file_size(path), records.size() * 40);
+}
+
+TEST(LogSegmentTests, TestStoredAndIncompressibleBlocks) {
+  // Random names, results and times leave LZ4 nothing to find; such blocks
+  // are stored.
+  std::vector<Record> records;
+  std::uint64_t state = 1;
+  const auto next = [&state] {
+    state = state * 6'364'136'223'846'793'005ULL + 1;
+    return state >> 24U;
+  };
+  for (int i = 0; i < 300; ++i) {
+    std::string name;
+    for (int c = 0; c < 24; ++c) {
+      name.push_back(static_cast<char>(33 + next() % 94));
+    }
+    // Out-of-order times still round-trip.
+    records.push_back({name, static_cast<int>(next()),
+                       kStart - std::chrono::nanoseconds(next() % 1'000'000)});
+  }
+  records[0].time = kStart;
+  records[1].time = kStart - std::chrono::seconds(1);
+  const auto path = tempPath("segment_stored.seg");
+  writeAll(path, records, {.codec = SegmentCodec::Lz4, .blockRecords = 64});
+  const LogSegmentReader reader(path);
+  EXPECT_EQ(reader.blocks()[0].codec, SegmentCodec::None);
+  EXPECT_EQ(readAll(reader), records);
+  EXPECT_EQ(reader.blocks()[0].minTime, kStart - std::chrono::seconds(1));
+  EXPECT_EQ(reader.blocks()[0].maxTime, kStart);
+
+  writeAll(path, records, {.codec = SegmentCodec::None, .blockRecords = 100});
+  const LogSegmentReader plain(path);
+  EXPECT_EQ(plain.blocks().size(), 3u);
+  EXPECT_EQ(readAll(plain), records);
+
+  // Tiny blocks take the short-input paths of the codec.
+  const auto small = makeRecords(5);
+  writeAll(path, small, {.codec = SegmentCodec::Lz4, .blockRecords = 1});
+  EXPECT_EQ(readAll(LogSegmentReader(path)), small);
+}
+
+TEST(LogSegmentTests, TestSeekBySequenceAndTime) {
+  const auto path = tempPath("segment_seek.seg");
+  const auto records = makeRecords(5000);
+  writeAll(path, records,
+           {.blockRecords = 512, .firstSequence = 1'000'000});
+  const LogSegmentReader reader(path);
+  EXPECT_EQ(reader.firstSequence(), 1'000'000u);
+  EXPECT_EQ(reader.endSequence(), 1'005'000u);
+
+  EXPECT_EQ(reader.findSequence(1'000'000), 0u);
+  EXPECT_EQ(reader.findSequence(1'000'511), 0u);
+  EXPECT_EQ(reader.findSequence(1'000'512), 1u);
+  EXPECT_EQ(reader.findSequence(1'004'999), 9u);
+  EXPECT_EQ(reader.findSequence(1'005'000), reader.blocks().size());
+  EXPECT_EQ(reader.findSequence(3), reader.blocks().size());
+
+  EXPECT_EQ(reader.findTime(Clock::time_point{}), 0u);
+  EXPECT_EQ(reader.findTime(records[600].time), 1u);
+  EXPECT_EQ(reader.findTime(records.back().time + std::chrono::seconds(1)),
+            reader.blocks().size());
+
+  std::vector<std::uint64_t> sequences;
+  std::vector<int> results;
+  reader.scan(1'001'020, 1'001'030, [&](const SegmentEntry &entry) {
+    sequences.push_back(entry.sequence);
+    results.push_back(entry.entry.result);
+  });
+  ASSERT_EQ(sequences.size(), 10u);
+  EXPECT_EQ(sequences.front(), 1'001'020u);
+  EXPECT_EQ(sequences.back(), 1'001'029u);
+  EXPECT_EQ(results[0], records[1020].result);
+
+  std::size_t clamped = 0;
+  reader.scan(0, ~std::uint64_t{0},
+              [&](const SegmentEntry &) { ++clamped; });
+  EXPECT_EQ(clamped, records.size());
+}
+
+TEST(LogSegmentTests, TestParallelReplayKeepsOrder) {
+  const auto path = tempPath("segment_replay.seg");
+  const auto records = makeRecords(20'000);
+  writeAll(path, records, {.blockRecords = 300});
+  const LogSegmentReader reader(path);
+
+  Scheduler scheduler(SchedulerOptions{.threads = 3});
+  std::vector<Record> replayed;
+  reader.replay(
+      0, reader.blocks().size(),
+      [&](const SegmentBlock &block) {
+        for (const SegmentEntry &entry : block) {
+          replayed.push_back({std::string(entry.entry.operation),
+                              entry.entry.result, entry.time});
+        }
+      },
+      ParallelOptions{.threads = 4, .scheduler = &scheduler});
+  EXPECT_EQ(replayed, records);
+
+  // A sub-range, and an exception from the visitor stops the replay.
+  std::size_t visited = 0;
+  const auto stopAtFive = [&](const SegmentBlock &block) {
+    EXPECT_EQ(block[0].sequence, 300 * (10 + visited));
+    if (++visited == 5) {
+      throw std::runtime_error("stop");
+    }
+  };
+  EXPECT_THROW(reader.replay(10, 30, stopAtFive), std::runtime_error);
+  EXPECT_EQ(visited, 5u);
+}
+
+TEST(LogSegmentTests, TestLoggerHistoryAndErrors) {
+  Logger logger;
+  logger.logOperation("1 + 2", 3);
+  logger.logOperation("2 * 4", 8);
+  const LogSnapshot snapshot = logger.snapshot();
+  const auto path = tempPath("segment_logger.seg");
+  {
+    LogSegmentWriter writer(path, {.firstSequence = snapshot.firstSequence()});
+    writer.append(snapshot.records(), kStart);
+    EXPECT_EQ(writer.recordCount(), 2u);
+    EXPECT_EQ(writer.blockCount(), 0u);
+  } // the destructor seals
+  const LogSegmentReader reader(path);
+  const SegmentBlock block = reader.readBlock(0);
+  ASSERT_EQ(block.size(), 2u);
+  EXPECT_EQ(block[1].entry.format(), "2 * 4 = 8");
+  EXPECT_THROW(static_cast<void>(reader.readBlock(1)), std::out_of_range);
+
+  LogSegmentWriter sealed(path);
+  sealed.seal();
+  EXPECT_THROW(sealed.append("x", 1, kStart), std::logic_error);
+  EXPECT_EQ(LogSegmentReader(path).blocks().size(), 0u);
+
+  EXPECT_THROW(LogSegmentWriter(path, {.blockRecords = 0}),
+               std::invalid_argument);
+  if (!segmentCodecAvailable(SegmentCodec::Zstd)) {
+    EXPECT_THROW(LogSegmentWriter(path, {.codec = SegmentCodec::Zstd}),
+                 std::invalid_argument);
+  }
+
+  // An unsealed (truncated) or damaged segment is rejected.
+  writeAll(path, makeRecords(2000), {.blockRecords = 500});
+  const auto size = std::filesystem::file_size(path);
+  std::filesystem::resize_file(path, size - 10);
+  EXPECT_THROW(LogSegmentReader{path}, std::runtime_error);
+  writeAll(path, makeRecords(2000), {.blockRecords = 500});
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(log_segment::kHeaderSize + 40);
+    file.put('\x7F').put('\x00').put('\x55');
+  }
+  const LogSegmentReader damaged(path);
+  EXPECT_THROW(static_cast<void>(damaged.readBlock(0)), std::runtime_error);
+  EXPECT_THROW(LogSegmentReader{tempPath("missing.seg")}, std::system_error);
+}
+
+TEST(LogSegmentTests, TestZstdRoundTrip) {
+  if (!segmentCodecAvailable(SegmentCodec::Zstd)) {
+    GTEST_SKIP() << "zstd support is not compiled in";
+  }
+  const auto path = tempPath("segment_zstd.seg");
+  const auto records = makeRecords(8000);
+  writeAll(path, records,
+           {.codec = SegmentCodec::Zstd, .blockRecords = 2048, .level = 3});
+  const LogSegmentReader reader(path);
+  EXPECT_EQ(reader.blocks()[0].codec, SegmentCodec::Zstd);
+  EXPECT_EQ(readAll(reader), records);
+}
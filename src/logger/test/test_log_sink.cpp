@@ -0,0 +1,203 @@
+#include "log_sink.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+auto tempLogPath(const std::string &name) -> std::filesystem::path {
+  auto path = std::filesystem::temp_directory_path() /
+              (name + "_" + std::to_string(::getpid()) + ".log");
+  std::filesystem::remove(path);
+  return path;
+}
+
+auto readLines(const std::filesystem::path &path) -> std::vector<std::string> {
+  std::ifstream in(path);
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(in, line);) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+} // namespace
+
+TEST(AsyncLogSinkTests, TestFlushWritesEverythingInOrder) {
+  const auto path = tempLogPath("sink_flush");
+  AsyncLogSink sink(path, AsyncSinkOptions{.queueCapacity = 64,
+                                           .batchSize = 16});
+  constexpr int kRecords = 1000;
+  for (int i = 0; i < kRecords; ++i) {
+    sink.logOperation("op", i);
+  }
+  sink.flush();
+
+  const auto lines = readLines(path);
+  ASSERT_EQ(lines.size(), static_cast<std::size_t>(kRecords));
+  EXPECT_EQ(lines.front(), "op = 0");
+  EXPECT_EQ(lines.back(), "op = 999");
+
+  const AsyncSinkStats stats = sink.stats();
+  EXPECT_EQ(stats.records, static_cast<std::uint64_t>(kRecords));
+  EXPECT_GE(stats.batches, static_cast<std::uint64_t>(kRecords / 16));
+  EXPECT_EQ(stats.writeErrors, 0u);
+  std::filesystem::remove(path);
+}
+
+TEST(AsyncLogSinkTests, TestIntervalFlushesWithoutExplicitCall) {
+  const auto path = tempLogPath("sink_interval");
+  AsyncLogSink sink(path, AsyncSinkOptions{
+                              .flushInterval = std::chrono::milliseconds(5)});
+  sink.logOperation("2 + 3", 5);
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (sink.stats().records == 0 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(readLines(path), (std::vector<std::string>{"2 + 3 = 5"}));
+  std::filesystem::remove(path);
+}
+
+TEST(AsyncLogSinkTests, TestFailedWritesCountRecordsAsDropped) {
+  // write() on a read-only descriptor fails with EBADF.
+  const int fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+  ASSERT_GE(fd, 0);
+  {
+    AsyncLogSink sink(fd, AsyncSinkOptions{.queueCapacity = 64,
+                                           .batchSize = 16});
+    constexpr int kRecords = 40;
+    for (int i = 0; i < kRecords; ++i) {
+      sink.logOperation("op", i);
+    }
+    sink.flush();
+    const AsyncSinkStats stats = sink.stats();
+    EXPECT_EQ(stats.records, 0u);
+    EXPECT_EQ(stats.dropped, static_cast<std::uint64_t>(kRecords));
+    EXPECT_GE(stats.writeErrors, 1u);
+    EXPECT_EQ(stats.batches, 0u);
+  }
+  ::close(fd);
+}
+
+TEST(AsyncLogSinkTests, TestOverwrittenRecordsCountAsDroppedAndWriterIdles) {
+  const auto path = tempLogPath("sink_overwrite");
+  AsyncLogSink sink(path, AsyncSinkOptions{.queueCapacity = 16,
+                                           .policy = OverflowPolicy::Overwrite,
+                                           .batchSize = 8});
+  constexpr int kRecords = 100'000;
+  for (int i = 0; i < kRecords; ++i) {
+    sink.logOperation("op", i);
+  }
+  sink.flush();
+  const AsyncSinkStats stats = sink.stats();
+  EXPECT_EQ(stats.dropped, kRecords - stats.records);
+  EXPECT_EQ(readLines(path).size(), stats.records);
+
+  // Overwrites must not leave the writer thinking records are queued.
+  const std::clock_t start = std::clock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  const double cpuSeconds =
+      static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+  EXPECT_LT(cpuSeconds, 0.05);
+  std::filesystem::remove(path);
+}
+
+// A flush() that loses the race with close() returns instead of waiting for
+// a pass the exiting writer will never make.
+TEST(AsyncLogSinkTests, TestFlushRacingCloseReturns) {
+  const auto path = tempLogPath("sink_flush_close");
+  for (int round = 0; round < 200; ++round) {
+    AsyncLogSink sink(path, AsyncSinkOptions{
+                                .flushInterval = std::chrono::milliseconds(1)});
+    sink.logOperation("op", round);
+    std::atomic<bool> closed{false};
+    std::thread flusher([&] {
+      while (!closed.load(std::memory_order_acquire)) {
+        sink.flush();
+      }
+    });
+    sink.close();
+    closed.store(true, std::memory_order_release);
+    flusher.join();
+    EXPECT_EQ(sink.stats().records, 1u);
+  }
+  std::filesystem::remove(path);
+}
+
+TEST(AsyncLogSinkTests, TestCloseDrainsConcurrentProducers) {
+  const auto path = tempLogPath("sink_close");
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 500;
+  {
+    AsyncLogSink sink(path, AsyncSinkOptions{.queueCapacity = 128});
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; ++t) {
+      producers.emplace_back([&sink] {
+        for (int i = 0; i < kPerThread; ++i) {
+          sink.logOperation("mul", i);
+        }
+      });
+    }
+    for (auto &producer : producers) {
+      producer.join();
+    }
+  }
+  EXPECT_EQ(readLines(path).size(),
+            static_cast<std::size_t>(kThreads * kPerThread));
+  std::filesystem::remove(path);
+}
+
+TEST(AsyncLogSinkTests, TestSchedulerWritesWithoutWriterThread) {
+  const auto path = tempLogPath("sink_scheduler");
+  Scheduler scheduler(SchedulerOptions{.threads = 2});
+  constexpr int kProducers = 4;
+  constexpr int kRecords = 2000;
+  {
+    AsyncLogSink sink(path, AsyncSinkOptions{.queueCapacity = 256,
+                                             .batchSize = 64,
+                                             .scheduler = &scheduler});
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+      producers.emplace_back([&sink, p] {
+        std::string label(1, 'p');
+        label += std::to_string(p);
+        for (int i = 0; i < kRecords; ++i) {
+          sink.logOperation(label, i);
+        }
+      });
+    }
+    for (std::thread &producer : producers) {
+      producer.join();
+    }
+    // The queue holds far fewer records than were logged, so scheduler
+    // tasks must have written batches before this point.
+    EXPECT_GT(sink.stats().batches, 0U);
+    sink.flush();
+    EXPECT_EQ(sink.stats().records,
+              static_cast<std::uint64_t>(kProducers * kRecords));
+  }
+
+  // Each producer's records appear in the order it logged them.
+  std::vector<int> next(kProducers, 0);
+  for (const std::string &line : readLines(path)) {
+    const int producer = line[1] - '0';
+    std::string expected(1, 'p');
+    expected += std::to_string(producer) + " = " +
+                std::to_string(next[producer]);
+    ASSERT_EQ(line, expected);
+    ++next[producer];
+  }
+  EXPECT_EQ(next, std::vector<int>(kProducers, kRecords));
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,179 @@
+#include "logger.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+auto formatAll(const LogRecordRange &range) -> std::vector<std::string> {
+  std::vector<std::string> out;
+  for (const LogEntry entry : range) {
+    out.push_back(entry.format());
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(LogSnapshotTests, TestSnapshotSurvivesAppendsAndDrains) {
+  Logger logger;
+  logger.logOperation("a", 1);
+  logger.logOperation("b", 2);
+  logger.logOperation("c", 3);
+  const LogSnapshot snapshot = logger.snapshot();
+
+  // Enough appends to outgrow the storage the snapshot points into.
+  const std::vector<int> results(10'000, 7);
+  logger.logOperations("grow", results);
+  EXPECT_EQ(formatAll(snapshot.records()),
+            (std::vector<std::string>{"a = 1", "b = 2", "c = 3"}));
+
+  // A full drain rewinds the store; the snapshot keeps the old records.
+  LogSnapshot copy = snapshot;
+  EXPECT_EQ(logger.drain([](LogEntry) {}), 10'003u);
+  logger.logOperation("reused", 4);
+  EXPECT_EQ(copy[0].format(), "a = 1");
+  EXPECT_EQ(copy.size(), 3u);
+  EXPECT_EQ(snapshot[2].format(), "c = 3");
+
+  const LogSnapshot later = logger.snapshot();
+  ASSERT_EQ(later.size(), 1u);
+  EXPECT_EQ(later.firstSequence(), 10'003u);
+  EXPECT_EQ(later[0].format(), "reused = 4");
+
+  const LogSnapshot empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(empty.tail(5).size(), 0u);
+}
+
+TEST(LogSnapshotTests, TestBoundedSnapshotSurvivesOverwrite) {
+  Logger logger(LoggerOptions{.capacity = 4});
+  for (int i = 0; i < 4; ++i) {
+    logger.logOperation("op" + std::to_string(i), i);
+  }
+  LogSnapshot snapshot = logger.snapshot();
+  for (int i = 4; i < 10; ++i) {
+    logger.logOperation("op" + std::to_string(i), i);
+  }
+  EXPECT_EQ(formatAll(snapshot.records()),
+            (std::vector<std::string>{"op0 = 0", "op1 = 1", "op2 = 2",
+                                      "op3 = 3"}));
+  EXPECT_EQ(logger.getLogs(),
+            (std::vector<std::string>{"op6 = 6", "op7 = 7", "op8 = 8",
+                                      "op9 = 9"}));
+
+  // Once released, later snapshots see the live ring again.
+  snapshot = logger.snapshot();
+  EXPECT_EQ(snapshot.firstSequence(), 6u);
+  EXPECT_EQ(snapshot[3].format(), "op9 = 9");
+}
+
+TEST(LogSnapshotTests, TestRangeQueries) {
+  Logger logger(LoggerOptions{.capacity = 8});
+  for (int i = 0; i < 12; ++i) {
+    logger.logOperation("x", i);
+  }
+  // The ring wraps: sequences 4..11 are retained.
+  const LogSnapshot snapshot = logger.snapshot();
+  EXPECT_EQ(snapshot.firstSequence(), 4u);
+  EXPECT_EQ(snapshot.endSequence(), 12u);
+
+  const LogRecordRange middle = snapshot.range(6, 10);
+  ASSERT_EQ(middle.size(), 4u);
+  EXPECT_EQ(middle.firstSequence(), 6u);
+  EXPECT_EQ(middle[0].result, 6);
+  EXPECT_EQ(middle[3].result, 9);
+
+  const LogRecordRange clamped = snapshot.range(0, 100);
+  EXPECT_EQ(clamped.size(), 8u);
+  EXPECT_EQ(clamped[0].result, 4);
+  EXPECT_TRUE(snapshot.range(20, 30).empty());
+  EXPECT_TRUE(snapshot.range(9, 7).empty());
+
+  const LogRecordRange tail = snapshot.tail(3);
+  ASSERT_EQ(tail.size(), 3u);
+  EXPECT_EQ(tail.firstSequence(), 9u);
+  EXPECT_EQ(tail[2].result, 11);
+  EXPECT_EQ(snapshot.tail(100).size(), 8u);
+}
+
+TEST(LogSnapshotTests, TestSequenceAtUsesTimeIndex) {
+  Logger logger(
+      LoggerOptions{.timeIndexResolution = std::chrono::microseconds(100)});
+  logger.logOperation("early", 1);
+  logger.logOperation("early", 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  const auto middle = std::chrono::steady_clock::now();
+  logger.logOperation("late", 3);
+
+  EXPECT_EQ(logger.sequenceAt(std::chrono::steady_clock::time_point{}), 0u);
+  EXPECT_EQ(logger.sequenceAt(middle), 2u);
+  EXPECT_EQ(logger.sequenceAt(middle + std::chrono::hours(1)), 3u);
+  const LogSnapshot snapshot = logger.snapshot();
+  const LogRecordRange late =
+      snapshot.range(logger.sequenceAt(middle), snapshot.endSequence());
+  ASSERT_EQ(late.size(), 1u);
+  EXPECT_EQ(late[0].format(), "late = 3");
+
+  EXPECT_THROW(static_cast<void>(
+                   Logger().sequenceAt(std::chrono::steady_clock::now())),
+               std::logic_error);
+}
+
+TEST(LogSnapshotTests, TestReadersRunAlongsideWriter) {
+  constexpr int kRecords = 20'000;
+  Logger bounded(LoggerOptions{.capacity = 512});
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int i = 0; i < kRecords; ++i) {
+      bounded.logOperation("w", i);
+    }
+    done = true;
+  });
+  do {
+    const LogSnapshot snapshot = bounded.snapshot();
+    std::uint64_t sequence = snapshot.firstSequence();
+    for (const LogEntry entry : snapshot) {
+      ASSERT_EQ(entry.result, static_cast<int>(sequence++));
+    }
+  } while (!done);
+  writer.join();
+  EXPECT_EQ(bounded.snapshot().endSequence(),
+            static_cast<std::uint64_t>(kRecords));
+
+  // Unbounded loggers take snapshots on the writer thread and hand them on.
+  Logger unbounded;
+  std::mutex handoff;
+  LogSnapshot latest;
+  done = false;
+  std::thread reader([&] {
+    do {
+      LogSnapshot snapshot;
+      {
+        const std::lock_guard guard(handoff);
+        snapshot = latest;
+      }
+      int expected = 0;
+      for (const LogEntry entry : snapshot) {
+        ASSERT_EQ(entry.result, expected++);
+        ASSERT_EQ(entry.operation, "u");
+      }
+    } while (!done);
+  });
+  for (int i = 0; i < kRecords; ++i) {
+    unbounded.logOperation("u", i);
+    if (i % 256 == 0) {
+      const std::lock_guard guard(handoff);
+      latest = unbounded.snapshot();
+    }
+  }
+  done = true;
+  reader.join();
+  EXPECT_EQ(latest.size(), static_cast<std::size_t>(kRecords - 31));
+}
@@ -0,0 +1,220 @@
+#include "log_table.hpp"
+#include "logger.hpp"
+#include "memory_resource.hpp"
+#include "operation_table.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::system_clock;
+
+const auto kStart = Clock::time_point{} + std::chrono::hours(24 * 365 * 50);
+
+struct Record {
+  std::string operation;
+  int result = 0;
+  Clock::time_point time{};
+};
+
+auto makeRecords(std::size_t count) -> std::vector<Record> {
+  static const std::vector<std::string> kOperations{"add", "subtract",
+                                                    "multiply", "divide"};
+  std::vector<Record> records(count);
+  std::uint32_t state = 11;
+  for (std::size_t i = 0; i < count; ++i) {
+    state = state * 1'664'525U + 1'013'904'223U;
+    records[i] = {kOperations[(state >> 8U) % kOperations.size()],
+                  static_cast<int>(state % 201) - 100,
+                  kStart + std::chrono::milliseconds(i)};
+  }
+  return records;
+}
+
+auto makeTable(const std::vector<Record> &records) -> LogTable {
+  LogTable table;
+  for (const Record &record : records) {
+    table.append(record.operation, record.result, record.time);
+  }
+  return table;
+}
+
+auto passes(const Record &record, const LogFilter &filter) -> bool {
+  return (!filter.operation || record.operation == *filter.operation) &&
+         record.result >= filter.minResult &&
+         record.result <= filter.maxResult && record.time >= filter.from &&
+         record.time < filter.until;
+}
+
+auto bruteAggregate(const std::vector<Record> &records,
+                    const LogFilter &filter) -> LogAggregate {
+  LogAggregate out;
+  for (const Record &record : records) {
+    if (passes(record, filter)) {
+      out.merge({1, record.result, record.result, record.result});
+    }
+  }
+  return out;
+}
+
+void expectEqual(const LogAggregate &actual, const LogAggregate &expected) {
+  EXPECT_EQ(actual.count, expected.count);
+  EXPECT_EQ(actual.sum, expected.sum);
+  EXPECT_EQ(actual.min, expected.min);
+  EXPECT_EQ(actual.max, expected.max);
+}
+
+auto filters() -> std::vector<LogFilter> {
+  return {
+      {},
+      {.operation = "divide"},
+      {.minResult = -10, .maxResult = 40},
+      {.from = kStart + std::chrono::seconds(3),
+       .until = kStart + std::chrono::seconds(17)},
+      {.operation = "add",
+       .minResult = 0,
+       .from = kStart + std::chrono::seconds(5)},
+      {.operation = "missing"},
+      {.minResult = 5, .maxResult = 4},
+  };
+}
+
+} // namespace
+
+TEST(LogTableTests, TestAppendBuildsColumns) {
+  LogTable table;
+  EXPECT_TRUE(table.empty());
+  table.append("add", 3, kStart);
+  table.append("divide", -2, kStart + std::chrono::seconds(1));
+  table.append("add", 7, kStart + std::chrono::seconds(2));
+
+  ASSERT_EQ(table.size(), 3u);
+  EXPECT_EQ(table.operationCount(), 2u);
+  EXPECT_EQ(table.operationName(1), "divide");
+  EXPECT_EQ(table.findOperation("add"), 0u);
+  EXPECT_FALSE(table.findOperation("multiply"));
+  EXPECT_EQ(std::vector<std::uint32_t>(table.operationIds().begin(),
+                                       table.operationIds().end()),
+            (std::vector<std::uint32_t>{0, 1, 0}));
+  EXPECT_EQ(std::vector<int>(table.results().begin(), table.results().end()),
+            (std::vector<int>{3, -2, 7}));
+  EXPECT_EQ(table.times()[1] - table.times()[0], 1'000'000'000);
+
+  const LogRow row = table.row(2);
+  EXPECT_EQ(row.index, 2u);
+  EXPECT_EQ(row.operation, "add");
+  EXPECT_EQ(row.result, 7);
+  EXPECT_EQ(row.time, kStart + std::chrono::seconds(2));
+
+  const LogAggregate all = table.aggregate();
+  EXPECT_EQ(all.count, 3u);
+  EXPECT_DOUBLE_EQ(all.mean(), 8.0 / 3.0);
+  EXPECT_THROW((void)table.aggregate({.operation = "none"}).mean(),
+               std::logic_error);
+}
+
+TEST(LogTableTests, TestQueriesMatchBruteForce) {
+  const std::vector<Record> records = makeRecords(20'000);
+  const LogTable table = makeTable(records);
+  for (const LogFilter &filter : filters()) {
+    expectEqual(table.aggregate(filter), bruteAggregate(records, filter));
+
+    std::vector<std::size_t> expected;
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      if (passes(records[i], filter)) {
+        expected.push_back(i);
+      }
+    }
+    EXPECT_EQ(table.select(filter), expected);
+
+    for (const LogGroup &group : table.groupByOperation(filter)) {
+      LogFilter only = filter;
+      only.operation = group.operation;
+      expectEqual(group.aggregate, bruteAggregate(records, only));
+    }
+
+    // Stable sort by descending result gives the tie order topK promises.
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&records](std::size_t lhs, std::size_t rhs) {
+                       return records[lhs].result > records[rhs].result;
+                     });
+    const std::vector<LogRow> top = table.topK(25, filter);
+    ASSERT_EQ(top.size(), std::min<std::size_t>(25, expected.size()));
+    for (std::size_t i = 0; i < top.size(); ++i) {
+      EXPECT_EQ(top[i].index, expected[i]);
+      EXPECT_EQ(top[i].result, records[expected[i]].result);
+    }
+  }
+  EXPECT_TRUE(table.topK(0).empty());
+  EXPECT_EQ(table.topK(100'000).size(), records.size());
+}
+
+TEST(LogTableTests, TestParallelQueriesMatchSequential) {
+  const std::vector<Record> records = makeRecords(50'000);
+  const LogTable table = makeTable(records);
+  Scheduler scheduler(SchedulerOptions{.threads = 4});
+  const ParallelOptions options{
+      .threads = 4, .grain = 1024, .scheduler = &scheduler};
+  for (const LogFilter &filter : filters()) {
+    expectEqual(table.aggregate(options, filter), table.aggregate(filter));
+
+    const std::vector<LogGroup> groups = table.groupByOperation(filter);
+    const std::vector<LogGroup> parallel =
+        table.groupByOperation(options, filter);
+    ASSERT_EQ(parallel.size(), groups.size());
+    for (std::size_t i = 0; i < groups.size(); ++i) {
+      EXPECT_EQ(parallel[i].operation, groups[i].operation);
+      expectEqual(parallel[i].aggregate, groups[i].aggregate);
+    }
+
+    const std::vector<LogRow> top = table.topK(40, filter);
+    const std::vector<LogRow> parallelTop = table.topK(options, 40, filter);
+    ASSERT_EQ(parallelTop.size(), top.size());
+    for (std::size_t i = 0; i < top.size(); ++i) {
+      EXPECT_EQ(parallelTop[i].index, top[i].index);
+    }
+  }
+}
+
+TEST(LogTableTests, TestAppendFromLoggerAndSegment) {
+  Logger logger;
+  const OpId add = OperationTable::global().intern("table-add");
+  logger.logOperation(add, 1);
+  logger.logOperation("table-text", 2);
+  logger.logOperation(add, 3);
+
+  MonotonicArena arena;
+  LogTable table(&arena);
+  table.append(logger.snapshot().records(), kStart);
+  ASSERT_EQ(table.size(), 3u);
+  EXPECT_EQ(table.operationCount(), 2u);
+  EXPECT_EQ(table.row(2).operation, "table-add");
+  EXPECT_EQ(table.row(1).time, kStart);
+  EXPECT_EQ(table.aggregate({.operation = "table-add"}).sum, 4);
+  EXPECT_GT(arena.bytesAllocated(), 0u);
+
+  const auto path =
+      std::filesystem::path(::testing::TempDir()) / "log_table.seg";
+  LogSegmentWriter writer(path, SegmentWriterOptions{.blockRecords = 2});
+  writer.append("seg", 10, kStart + std::chrono::seconds(1));
+  writer.append("table-add", 20, kStart + std::chrono::seconds(2));
+  writer.append("seg", 30, kStart + std::chrono::seconds(3));
+  writer.seal();
+  const LogSegmentReader reader(path);
+  for (std::size_t i = 0; i < reader.blocks().size(); ++i) {
+    table.append(reader.readBlock(i));
+  }
+  std::filesystem::remove(path);
+
+  ASSERT_EQ(table.size(), 6u);
+  EXPECT_EQ(table.operationCount(), 3u);
+  EXPECT_EQ(table.aggregate({.operation = "table-add"}).sum, 24);
+  EXPECT_EQ(table.select({.from = kStart + std::chrono::seconds(2)}),
+            (std::vector<std::size_t>{4, 5}));
+}
@@ -1,5 +1,13 @@
 #include "logger.hpp"
+#include "memory_resource.hpp"
 #include <gtest/gtest.h>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 TEST(LoggerTests, TestLogOperation) {
   Logger logger;
@@ -11,3 +19,192 @@ TEST(LoggerTests, TestLogOperation) {
   EXPECT_EQ(logs[0], "2 + 3 = 5");
   EXPECT_EQ(logs[1], "5 * 2 = 10");
 }
+
+TEST(LoggerTests, TestRecordsFormatLazily) {
+  Logger logger;
+  logger.reserve(4, 32);
+  logger.logOperation("7 - 9", -2);
+  logger.logOperation("mul", 2147483647);
+
+  const auto records = logger.records();
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0].operation, "7 - 9");
+  EXPECT_EQ(records[0].result, -2);
+  EXPECT_EQ(records[1].format(), "mul = 2147483647");
+
+  std::vector<std::string> formatted;
+  for (const auto entry : records) {
+    formatted.push_back(entry.format());
+  }
+  EXPECT_EQ(formatted, logger.getLogs());
+}
+
+TEST(LoggerTests, TestGetLogsPicksUpLaterRecords) {
+  Logger logger;
+  logger.logOperation("a", 1);
+  ASSERT_EQ(logger.getLogs().size(), 1u);
+  logger.logOperation("b", 2);
+  const auto &logs = logger.getLogs();
+  ASSERT_EQ(logs.size(), 2u);
+  EXPECT_EQ(logs[1], "b = 2");
+  EXPECT_EQ(logger.size(), 2u);
+}
+
+TEST(LoggerTests, TestBoundedOverwriteKeepsNewest) {
+  Logger logger(LoggerOptions{.capacity = 3});
+  for (int i = 0; i < 5; ++i) {
+    logger.logOperation("op", i);
+  }
+
+  const auto &logs = logger.getLogs();
+  ASSERT_EQ(logs.size(), 3u);
+  EXPECT_EQ(logs[0], "op = 2");
+  EXPECT_EQ(logs[2], "op = 4");
+  EXPECT_EQ(logger.records().firstSequence(), 2u);
+
+  const LoggerStats stats = logger.stats();
+  EXPECT_EQ(stats.appended, 5u);
+  EXPECT_EQ(stats.overwritten, 2u);
+  EXPECT_EQ(stats.dropped, 0u);
+}
+
+TEST(LoggerTests, TestBoundedDropKeepsOldest) {
+  Logger logger(LoggerOptions{.capacity = 2, .policy = OverflowPolicy::Drop});
+  logger.logOperation("a", 1);
+  logger.logOperation("b", 2);
+  logger.logOperation("c", 3);
+
+  EXPECT_EQ(logger.getLogs(), (std::vector<std::string>{"a = 1", "b = 2"}));
+  EXPECT_EQ(logger.stats().dropped, 1u);
+}
+
+TEST(LoggerTests, TestBoundedTruncatesLongOperations) {
+  Logger logger(LoggerOptions{.capacity = 2, .maxOperationLength = 4});
+  logger.logOperation("multiply", 6);
+  EXPECT_EQ(logger.records()[0].operation, "mult");
+  EXPECT_EQ(logger.stats().truncated, 1u);
+}
+
+TEST(LoggerTests, TestMovedLoggerKeepsRecordsAndLock) {
+  static_assert(std::is_move_constructible_v<Logger> &&
+                std::is_move_assignable_v<Logger> &&
+                !std::is_copy_constructible_v<Logger>);
+  Logger logger(LoggerOptions{.capacity = 2});
+  logger.logOperation("a", 1);
+  std::vector<Logger> loggers;
+  loggers.push_back(std::move(logger));
+  loggers.front().logOperation("b", 2);
+  loggers.front().logOperation("c", 3);
+  EXPECT_EQ(loggers.front().getLogs(),
+            (std::vector<std::string>{"b = 2", "c = 3"}));
+
+  Logger unbounded;
+  unbounded.logOperation("d", 4);
+  loggers.front() = std::move(unbounded);
+  EXPECT_EQ(loggers.front().getLogs(), (std::vector<std::string>{"d = 4"}));
+}
+
+TEST(LoggerTests, TestDrainRemovesOldestRecords) {
+  Logger logger;
+  logger.logOperation("a", 1);
+  logger.logOperation("b", 2);
+  logger.logOperation("c", 3);
+  ASSERT_EQ(logger.getLogs().size(), 3u);
+
+  std::vector<std::string> drained;
+  const auto consumed = logger.drain(
+      [&](const LogEntry &entry) { drained.push_back(entry.format()); }, 2);
+  EXPECT_EQ(consumed, 2u);
+  EXPECT_EQ(drained, (std::vector<std::string>{"a = 1", "b = 2"}));
+  EXPECT_EQ(logger.getLogs(), (std::vector<std::string>{"c = 3"}));
+}
+
+TEST(LoggerTests, TestBoundedBlockWaitsForDrain) {
+  constexpr int kRecords = 1000;
+  Logger logger(LoggerOptions{.capacity = 8, .policy = OverflowPolicy::Block});
+  std::thread writer([&logger] {
+    for (int i = 0; i < kRecords; ++i) {
+      logger.logOperation("op", i);
+    }
+  });
+
+  int expected = 0;
+  while (expected < kRecords) {
+    logger.drain([&](const LogEntry &entry) {
+      EXPECT_EQ(entry.result, expected++);
+    });
+  }
+  writer.join();
+
+  const LoggerStats stats = logger.stats();
+  EXPECT_EQ(stats.appended, static_cast<std::uint64_t>(kRecords));
+  EXPECT_EQ(stats.dropped + stats.overwritten, 0u);
+}
+
+TEST(LoggerTests, TestLogOperationsSharesLabel) {
+  Logger logger;
+  const std::vector<int> results{1, 2, 3};
+  EXPECT_EQ(logger.logOperations("add", results), 3u);
+  EXPECT_EQ(logger.getLogs(),
+            (std::vector<std::string>{"add = 1", "add = 2", "add = 3"}));
+
+  Logger bounded(LoggerOptions{.capacity = 2, .policy = OverflowPolicy::Drop});
+  EXPECT_EQ(bounded.logOperations("add", results), 2u);
+  EXPECT_EQ(bounded.stats().dropped, 1u);
+}
+
+TEST(LoggerTests, TestLogInternedOperation) {
+  const OpId add = OperationTable::global().intern("add");
+  Logger logger;
+  EXPECT_TRUE(logger.logOperation(add, 1));
+  logger.logOperation("sub", 2);
+  const std::vector<int> results{3, 4};
+  EXPECT_EQ(logger.logOperations(add, results), 2u);
+
+  const auto records = logger.records();
+  ASSERT_EQ(records.size(), 4u);
+  EXPECT_EQ(records[0].operation, "add");
+  EXPECT_EQ(records[0].op, add);
+  EXPECT_EQ(records[1].op, std::nullopt);
+  EXPECT_EQ(logger.getLogs(), (std::vector<std::string>{"add = 1", "sub = 2",
+                                                        "add = 3", "add = 4"}));
+
+  // A ring without per-slot text still holds interned records.
+  Logger bounded(LoggerOptions{.capacity = 2,
+                               .policy = OverflowPolicy::Overwrite,
+                               .maxOperationLength = 0});
+  EXPECT_EQ(bounded.logOperations(add, results), 2u);
+  bounded.logOperation(add, 5);
+  EXPECT_EQ(bounded.getLogs(),
+            (std::vector<std::string>{"add = 4", "add = 5"}));
+  EXPECT_EQ(bounded.stats().overwritten, 1u);
+  EXPECT_EQ(bounded.stats().truncated, 0u);
+
+  const auto unknown =
+      static_cast<OpId>(OperationTable::global().capacity() - 1);
+  EXPECT_THROW(logger.logOperation(unknown, 0), std::invalid_argument);
+}
+
+TEST(LoggerTests, TestStorageComesFromMemoryResource) {
+  MonotonicArena arena;
+  Logger logger(LoggerOptions{.resource = &arena});
+  EXPECT_EQ(logger.options().resource, &arena);
+  logger.logOperation("2 + 3", 5);
+  const std::size_t first = arena.bytesAllocated();
+  EXPECT_GT(first, 0u);
+
+  // Growth and the copy a pinned snapshot forces stay on the arena.
+  const LogSnapshot snapshot = logger.snapshot();
+  const std::vector<int> results(1000, 1);
+  logger.logOperations("1 * 1", results);
+  EXPECT_GT(arena.bytesAllocated(), first + 1000 * sizeof(LogRecord));
+  EXPECT_EQ(snapshot[0].format(), "2 + 3 = 5");
+  EXPECT_EQ(logger.size(), 1001u);
+
+  MonotonicArena ringArena;
+  const Logger bounded(
+      LoggerOptions{.capacity = 16, .maxOperationLength = 8,
+                    .resource = &ringArena});
+  EXPECT_GE(ringArena.bytesAllocated(), 16 * (sizeof(LogRecord) + 8));
+  EXPECT_EQ(Logger().options().resource, std::pmr::get_default_resource());
+}
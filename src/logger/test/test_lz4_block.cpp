@@ -0,0 +1,64 @@
+#include "lz4_block.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+
+namespace {
+
+// Text with short and overlapping matches, a literal run and a match long
+// enough to need extra length bytes.
+auto sample() -> std::string {
+  return "add = 1\nadd = 2\nadd = 3\nmultiply = 42\n" + std::string(40, 'x') +
+         "0123456789abcdefghijklmnop" + "add = 1\nadd = 2\nmultiply = 42\n" +
+         "tail!";
+}
+
+// sample() compressed by liblz4 1.9.4 (`lz4 -1 -BI`, block taken out of
+// the frame).
+constexpr unsigned char kLiblz4Block[] = {
+    0x82, 0x61, 0x64, 0x64, 0x20, 0x3D, 0x20, 0x31, 0x0A, 0x08, 0x00,
+    0x13, 0x32, 0x08, 0x00, 0xFF, 0x02, 0x33, 0x0A, 0x6D, 0x75, 0x6C,
+    0x74, 0x69, 0x70, 0x6C, 0x79, 0x20, 0x3D, 0x20, 0x34, 0x32, 0x0A,
+    0x78, 0x01, 0x00, 0x14, 0xF2, 0x0B, 0x30, 0x31, 0x32, 0x33, 0x34,
+    0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66,
+    0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70, 0x60,
+    0x00, 0x06, 0x68, 0x00, 0x0A, 0x60, 0x00, 0x50, 0x74, 0x61, 0x69,
+    0x6C, 0x21,
+};
+
+auto liblz4Block() -> std::string_view {
+  return {reinterpret_cast<const char *>(kLiblz4Block), sizeof(kLiblz4Block)};
+}
+
+} // namespace
+
+TEST(Lz4BlockTests, TestDecodesLiblz4Block) {
+  const std::string expected = sample();
+  std::string decoded(expected.size(), '\0');
+  ASSERT_TRUE(lz4_block::decompress(liblz4Block(), decoded.data(),
+                                    decoded.size()));
+  EXPECT_EQ(decoded, expected);
+}
+
+// On this input the greedy matcher makes the same choices as liblz4.
+TEST(Lz4BlockTests, TestEncoderEmitsKnownBlock) {
+  std::string encoded;
+  lz4_block::compress(sample(), encoded);
+  EXPECT_EQ(encoded, liblz4Block());
+}
+
+TEST(Lz4BlockTests, TestRejectsMalformedBlocks) {
+  const std::string expected = sample();
+  std::string decoded(expected.size(), '\0');
+  const std::string_view block = liblz4Block();
+  EXPECT_FALSE(lz4_block::decompress(block.substr(0, block.size() - 1),
+                                     decoded.data(), decoded.size()));
+  EXPECT_FALSE(
+      lz4_block::decompress(block, decoded.data(), decoded.size() - 1));
+  // A match offset of zero.
+  std::string zeroOffset(block);
+  zeroOffset[9] = 0;
+  zeroOffset[10] = 0;
+  EXPECT_FALSE(lz4_block::decompress(zeroOffset, decoded.data(),
+                                     decoded.size()));
+}
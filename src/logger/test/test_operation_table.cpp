@@ -0,0 +1,67 @@
+#include "operation_table.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(OperationTableTests, TestInternReturnsStableIds) {
+  OperationTable table(8);
+  const OpId add = table.intern("add");
+  const OpId mul = table.intern("mul");
+  EXPECT_NE(add, mul);
+  EXPECT_EQ(table.intern("add"), add);
+  EXPECT_EQ(table.intern(std::string("mu") + "l"), mul);
+  EXPECT_EQ(table.name(add), "add");
+  EXPECT_EQ(table.name(mul), "mul");
+  EXPECT_EQ(table.find("mul"), mul);
+  EXPECT_EQ(table.find("sub"), std::nullopt);
+  EXPECT_EQ(table.size(), 2u);
+  EXPECT_TRUE(table.contains(add));
+  EXPECT_FALSE(table.contains(static_cast<OpId>(2)));
+
+  // Ids are dense and the empty label is a label like any other.
+  EXPECT_EQ(static_cast<std::uint32_t>(add), 0u);
+  EXPECT_EQ(static_cast<std::uint32_t>(mul), 1u);
+  EXPECT_EQ(table.name(table.intern("")), "");
+}
+
+TEST(OperationTableTests, TestFullTableThrows) {
+  OperationTable table(3);
+  for (int i = 0; i < 3; ++i) {
+    table.intern(std::to_string(i));
+  }
+  EXPECT_THROW(table.intern("3"), std::length_error);
+  // Known labels still resolve once the table is full.
+  EXPECT_EQ(table.name(table.intern("2")), "2");
+  EXPECT_THROW(OperationTable(0), std::invalid_argument);
+}
+
+TEST(OperationTableTests, TestConcurrentInternAgrees) {
+  OperationTable table(1024);
+  constexpr int kThreads = 4;
+  constexpr int kLabels = 500;
+  std::vector<std::vector<OpId>> ids(kThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&table, &ids, t] {
+      // Each thread walks the labels in a different order.
+      for (int i = 0; i < kLabels; ++i) {
+        const int label = (i * (2 * t + 1)) % kLabels;
+        ids[t].push_back(table.intern("tenant-" + std::to_string(label)));
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(table.size(), std::size_t{kLabels});
+  for (int t = 0; t < kThreads; ++t) {
+    for (int i = 0; i < kLabels; ++i) {
+      const int label = (i * (2 * t + 1)) % kLabels;
+      EXPECT_EQ(table.name(ids[t][i]), "tenant-" + std::to_string(label));
+      EXPECT_EQ(ids[t][i], table.find("tenant-" + std::to_string(label)));
+    }
+  }
+}
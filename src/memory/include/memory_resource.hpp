@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+struct ArenaOptions {
+  // Bytes owned by the arena itself and reused after every release(); a
+  // request that outgrows them takes further blocks from upstream.
+  std::size_t initialBytes = std::size_t{64} << 10U;
+  // Source of the initial and overflow blocks; nullptr selects
+  // std::pmr::new_delete_resource().
+  std::pmr::memory_resource *upstream = nullptr;
+};
+
+// Bump-pointer memory_resource for request-scoped data: deallocate() is a
+// no-op and release() frees everything at once, so tearing down a batch of
+// containers built on the arena costs O(1) in the number of allocations.
+// Not thread-safe; give each thread (or request) its own arena. Everything
+// allocated from it must be dead before release() or destruction.
+class MonotonicArena final : public std::pmr::memory_resource {
+public:
+  explicit MonotonicArena(ArenaOptions options = {});
+  ~MonotonicArena() override;
+  MonotonicArena(const MonotonicArena &) = delete;
+  auto operator=(const MonotonicArena &) -> MonotonicArena & = delete;
+  MonotonicArena(MonotonicArena &&) = delete;
+  auto operator=(MonotonicArena &&) -> MonotonicArena & = delete;
+
+  // Returns overflow blocks upstream and rewinds to the initial block.
+  void release();
+
+  // Bytes handed out since construction or the last release().
+  [[nodiscard]] auto bytesAllocated() const -> std::size_t {
+    return allocated_;
+  }
+  // Largest bytesAllocated() seen, across releases.
+  [[nodiscard]] auto peakBytes() const -> std::size_t { return peak_; }
+
+private:
+  auto do_allocate(std::size_t bytes, std::size_t alignment)
+      -> void * override;
+  void do_deallocate(void *pointer, std::size_t bytes,
+                     std::size_t alignment) override;
+  [[nodiscard]] auto do_is_equal(const std::pmr::memory_resource &other)
+      const noexcept -> bool override;
+
+  std::pmr::memory_resource *upstream_;
+  std::size_t initialBytes_;
+  void *initial_;
+  std::pmr::monotonic_buffer_resource buffer_;
+  std::size_t allocated_ = 0;
+  std::size_t peak_ = 0;
+};
+
+// The calling thread's pooled memory_resource: size-bucketed free lists
+// over new/delete with no locking. Memory must be freed on the thread that
+// allocated it, and before that thread exits, which releases the pool.
+// Suits long-lived per-thread state such as a worker's Logger or Pipeline.
+[[nodiscard]] auto threadPoolResource() -> std::pmr::memory_resource *;
+
+// resource, or std::pmr::get_default_resource() when it is nullptr; the
+// components' options use nullptr for "no preference".
+[[nodiscard]] inline auto
+resourceOrDefault(std::pmr::memory_resource *resource)
+    -> std::pmr::memory_resource * {
+  return resource != nullptr ? resource : std::pmr::get_default_resource();
+}
@@ -0,0 +1,49 @@
+#include "memory_resource.hpp"
+#include <algorithm>
+
+namespace {
+
+auto upstreamOrNewDelete(std::pmr::memory_resource *upstream)
+    -> std::pmr::memory_resource * {
+  return upstream != nullptr ? upstream : std::pmr::new_delete_resource();
+}
+
+} // namespace
+
+MonotonicArena::MonotonicArena(ArenaOptions options)
+    : upstream_(upstreamOrNewDelete(options.upstream)),
+      initialBytes_(std::max<std::size_t>(options.initialBytes, 1)),
+      initial_(upstream_->allocate(initialBytes_)),
+      buffer_(initial_, initialBytes_, upstream_) {}
+
+MonotonicArena::~MonotonicArena() {
+  buffer_.release();
+  upstream_->deallocate(initial_, initialBytes_);
+}
+
+void MonotonicArena::release() {
+  buffer_.release();
+  allocated_ = 0;
+}
+
+auto MonotonicArena::do_allocate(std::size_t bytes, std::size_t alignment)
+    -> void * {
+  void *pointer = buffer_.allocate(bytes, alignment);
+  allocated_ += bytes;
+  peak_ = std::max(peak_, allocated_);
+  return pointer;
+}
+
+void MonotonicArena::do_deallocate(void * /*pointer*/, std::size_t /*bytes*/,
+                                   std::size_t /*alignment*/) {}
+
+auto MonotonicArena::do_is_equal(
+    const std::pmr::memory_resource &other) const noexcept -> bool {
+  return this == &other;
+}
+
+auto threadPoolResource() -> std::pmr::memory_resource * {
+  thread_local std::pmr::unsynchronized_pool_resource pool(
+      std::pmr::new_delete_resource());
+  return &pool;
+}
@@ -0,0 +1,70 @@
+#include "memory_resource.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(MemoryResourceTests, TestArenaReleaseRewinds) {
+  MonotonicArena arena(ArenaOptions{.initialBytes = 4096});
+  void *first = nullptr;
+  for (int round = 0; round < 3; ++round) {
+    std::pmr::vector<int> values(&arena);
+    values.assign(100, round);
+    std::pmr::string text("a string too long for the small buffer", &arena);
+    if (round == 0) {
+      first = values.data();
+    }
+    // Every round reuses the same initial block from the start.
+    EXPECT_EQ(values.data(), first);
+    EXPECT_GE(arena.bytesAllocated(), 100 * sizeof(int) + text.size());
+    values = {};
+    text = {};
+    arena.release();
+    EXPECT_EQ(arena.bytesAllocated(), 0u);
+  }
+  EXPECT_GE(arena.peakBytes(), 100 * sizeof(int));
+}
+
+TEST(MemoryResourceTests, TestArenaOverflowsToUpstream) {
+  // One arena stands in for the heap to count what the other takes from it.
+  MonotonicArena upstream(ArenaOptions{.initialBytes = 1 << 20});
+  MonotonicArena arena(
+      ArenaOptions{.initialBytes = 256, .upstream = &upstream});
+  const std::size_t initial = upstream.bytesAllocated();
+  EXPECT_EQ(initial, 256u);
+
+  std::pmr::vector<std::uint64_t> values(&arena);
+  for (std::uint64_t i = 0; i < 1000; ++i) {
+    values.push_back(i);
+  }
+  EXPECT_EQ(values[999], 999u);
+  EXPECT_GT(upstream.bytesAllocated(), initial + 1000 * sizeof(std::uint64_t));
+  // Growth never frees into the arena: the peak includes every
+  // reallocation.
+  EXPECT_GT(arena.peakBytes(), 1000 * sizeof(std::uint64_t));
+  EXPECT_TRUE(arena.is_equal(arena));
+  EXPECT_FALSE(arena.is_equal(upstream));
+}
+
+TEST(MemoryResourceTests, TestThreadPoolResourceIsPerThread) {
+  std::pmr::memory_resource *mine = threadPoolResource();
+  EXPECT_EQ(mine, threadPoolResource());
+  std::pmr::memory_resource *other = nullptr;
+  std::thread worker([&other] {
+    other = threadPoolResource();
+    // Allocate and free on the owning thread.
+    std::pmr::vector<std::string> strings(other);
+    for (int i = 0; i < 100; ++i) {
+      strings.emplace_back(40, 'x');
+    }
+  });
+  worker.join();
+  EXPECT_NE(mine, other);
+
+  std::pmr::vector<int> values(mine);
+  values.resize(10'000, 5);
+  EXPECT_EQ(values.back(), 5);
+  EXPECT_EQ(resourceOrDefault(nullptr), std::pmr::get_default_resource());
+  EXPECT_EQ(resourceOrDefault(mine), mine);
+}
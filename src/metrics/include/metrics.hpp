@@ -0,0 +1,230 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Component instrumentation is compiled in only with -DENABLE_METRICS=ON,
+// which defines MY_CODE_METRICS. Without it MY_CODE_METRICS_ONLY(...)
+// expands to nothing, so the hooks cost nothing; the classes below stay
+// available for application metrics either way.
+#ifdef MY_CODE_METRICS
+#define MY_CODE_METRICS_ONLY(...) __VA_ARGS__
+#else
+#define MY_CODE_METRICS_ONLY(...)
+#endif
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+namespace metrics_detail {
+
+// Writers spread over this many cache-line sized shards; each thread sticks
+// to one, so uncontended updates stay in the writer's own cache.
+inline constexpr std::size_t kShards = 8;
+
+auto nextShard() -> std::size_t;
+
+inline auto shardIndex() -> std::size_t {
+  thread_local const std::size_t index = nextShard();
+  return index;
+}
+
+} // namespace metrics_detail
+
+// Monotonic event count. add() is one relaxed fetch_add on the calling
+// thread's shard; value() sums the shards.
+class Counter {
+public:
+  void add(std::uint64_t amount = 1) {
+    shards_[metrics_detail::shardIndex()].value.fetch_add(
+        amount, std::memory_order_relaxed);
+  }
+  [[nodiscard]] auto value() const -> std::uint64_t;
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> value{0};
+  };
+  std::array<Shard, metrics_detail::kShards> shards_{};
+};
+
+// Current level of something, such as a queue depth.
+class Gauge {
+public:
+  void set(std::int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+  void add(std::int64_t amount) {
+    value_.fetch_add(amount, std::memory_order_relaxed);
+  }
+  [[nodiscard]] auto value() const -> std::int64_t {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+private:
+  alignas(64) std::atomic<std::int64_t> value_{0};
+};
+
+struct HistogramSnapshot {
+  std::uint64_t count = 0;
+  std::uint64_t sum = 0;
+  std::uint64_t max = 0;
+  // Counts per Histogram bucket index.
+  std::vector<std::uint64_t> buckets{};
+
+  [[nodiscard]] auto mean() const -> double;
+  // Highest value of the bucket holding the value at fraction q (0..1) of
+  // the distribution, capped at max; 0 when empty.
+  [[nodiscard]] auto percentile(double q) const -> std::uint64_t;
+};
+
+// Latency distribution in nanoseconds with HDR-style log-linear buckets:
+// every power of two is split into kSubBuckets equal buckets, so the
+// reported value of a bucket is within 1/kSubBuckets of any value in it.
+// Values up to 2^(kMaxExponent + 1) ns (about 36 minutes) are resolved;
+// larger ones land in the last bucket.
+class Histogram {
+public:
+  static constexpr unsigned kSubBucketBits = 4;
+  static constexpr std::uint64_t kSubBuckets = std::uint64_t{1}
+                                               << kSubBucketBits;
+  static constexpr unsigned kMaxExponent = 40;
+  static constexpr std::size_t kBuckets =
+      kSubBuckets * (kMaxExponent - kSubBucketBits + 2);
+
+  static constexpr auto bucketIndex(std::uint64_t value) -> std::size_t;
+  // Smallest value mapped to bucket index.
+  static constexpr auto bucketLowerBound(std::size_t index) -> std::uint64_t;
+
+  void record(std::uint64_t value);
+  [[nodiscard]] auto snapshot() const -> HistogramSnapshot;
+
+private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<std::uint64_t>, kBuckets> buckets{};
+    std::atomic<std::uint64_t> sum{0};
+    std::atomic<std::uint64_t> max{0};
+  };
+  // Shards are large, so they live on the heap.
+  std::unique_ptr<std::array<Shard, metrics_detail::kShards>> shards_ =
+      std::make_unique<std::array<Shard, metrics_detail::kShards>>();
+};
+
+// Records the time from construction to destruction into a histogram.
+class LatencyTimer {
+public:
+  explicit LatencyTimer(Histogram &histogram)
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+  ~LatencyTimer() {
+    histogram_.record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_)
+            .count()));
+  }
+  LatencyTimer(const LatencyTimer &) = delete;
+  auto operator=(const LatencyTimer &) -> LatencyTimer & = delete;
+  LatencyTimer(LatencyTimer &&) = delete;
+  auto operator=(LatencyTimer &&) -> LatencyTimer & = delete;
+
+private:
+  Histogram &histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+enum class MetricType { Counter, Gauge, Histogram };
+
+struct MetricSample {
+  std::string name;
+  std::string help;
+  MetricLabels labels;
+  MetricType type = MetricType::Counter;
+  // Counter value or gauge level.
+  std::int64_t value = 0;
+  HistogramSnapshot histogram{};
+};
+
+// Point-in-time copy of every registered metric, ordered by name and then
+// labels. Shards are read with relaxed loads, so a snapshot taken while
+// writers run is not an atomic cut across metrics.
+struct MetricsSnapshot {
+  std::vector<MetricSample> samples;
+
+  // nullptr if no metric has that name and label set.
+  [[nodiscard]] auto find(std::string_view name,
+                          const MetricLabels &labels = {}) const
+      -> const MetricSample *;
+};
+
+// Owns named metrics. Registering an existing name and label set returns
+// the same object, so components can look their metrics up once and keep
+// the reference; references stay valid for the registry's lifetime.
+class MetricsRegistry {
+public:
+  MetricsRegistry();
+  ~MetricsRegistry();
+  MetricsRegistry(const MetricsRegistry &) = delete;
+  auto operator=(const MetricsRegistry &) -> MetricsRegistry & = delete;
+  MetricsRegistry(MetricsRegistry &&) = delete;
+  auto operator=(MetricsRegistry &&) -> MetricsRegistry & = delete;
+
+  // Names follow the Prometheus rules ([a-zA-Z_:][a-zA-Z0-9_:]*); the
+  // exporter appends _total to counters. Throws std::invalid_argument for
+  // an invalid name or a name already registered with another type.
+  auto counter(std::string_view name, std::string_view help,
+               MetricLabels labels = {}) -> Counter &;
+  auto gauge(std::string_view name, std::string_view help,
+             MetricLabels labels = {}) -> Gauge &;
+  // Records nanoseconds; exported in seconds.
+  auto histogram(std::string_view name, std::string_view help,
+                 MetricLabels labels = {}) -> Histogram &;
+
+  [[nodiscard]] auto snapshot() const -> MetricsSnapshot;
+
+  // The registry the component hooks report to.
+  static auto global() -> MetricsRegistry &;
+
+private:
+  struct Entry;
+  auto find(std::string_view name, const MetricLabels &labels,
+            MetricType type, std::string_view help) -> Entry &;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Entry>> entries_;
+};
+
+// OpenMetrics text exposition (also accepted by Prometheus). Histogram
+// buckets are reported at every power of two nanoseconds from 1 us up.
+auto formatOpenMetrics(const MetricsSnapshot &snapshot) -> std::string;
+
+constexpr auto Histogram::bucketIndex(std::uint64_t value) -> std::size_t {
+  if (value < kSubBuckets) {
+    return static_cast<std::size_t>(value);
+  }
+  const auto exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+  if (exponent > kMaxExponent) {
+    return kBuckets - 1;
+  }
+  const std::uint64_t mantissa =
+      (value >> (exponent - kSubBucketBits)) - kSubBuckets;
+  return static_cast<std::size_t>(
+      kSubBuckets * (exponent - kSubBucketBits + 1) + mantissa);
+}
+
+constexpr auto Histogram::bucketLowerBound(std::size_t index)
+    -> std::uint64_t {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const auto exponent =
+      static_cast<unsigned>(index / kSubBuckets) + kSubBucketBits - 1;
+  const std::uint64_t mantissa = index % kSubBuckets;
+  return (kSubBuckets + mantissa) << (exponent - kSubBucketBits);
+}
@@ -0,0 +1,364 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+
+// Buckets exported per histogram: 2^10 ns (about 1 us) to 2^40 ns.
+constexpr unsigned kExportFirstExponent = 10;
+
+auto validName(std::string_view name) -> bool {
+  const auto isStart = [](char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+           c == ':';
+  };
+  if (name.empty() || !isStart(name.front())) {
+    return false;
+  }
+  return std::all_of(name.begin() + 1, name.end(), [&](char c) {
+    return isStart(c) || (c >= '0' && c <= '9');
+  });
+}
+
+void appendEscaped(std::string &out, std::string_view text, bool quotes) {
+  for (const char c : text) {
+    if (c == '\\') {
+      out += "\\\\";
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (c == '"' && quotes) {
+      out += "\\\"";
+    } else {
+      out.push_back(c);
+    }
+  }
+}
+
+// Writes {a="x",b="y"}, with an optional trailing le label for buckets.
+void appendLabels(std::string &out, const MetricLabels &labels,
+                  std::string_view le = {}) {
+  if (labels.empty() && le.empty()) {
+    return;
+  }
+  out.push_back('{');
+  bool first = true;
+  for (const auto &[key, value] : labels) {
+    if (!first) {
+      out.push_back(',');
+    }
+    first = false;
+    out += key;
+    out += "=\"";
+    appendEscaped(out, value, true);
+    out.push_back('"');
+  }
+  if (!le.empty()) {
+    out += first ? "le=\"" : ",le=\"";
+    out += le;
+    out.push_back('"');
+  }
+  out.push_back('}');
+}
+
+void appendNumber(std::string &out, double value) {
+  char buffer[32];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  static_cast<void>(ec);
+  out.append(buffer, end);
+}
+
+void appendNumber(std::string &out, std::int64_t value) {
+  char buffer[24];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  static_cast<void>(ec);
+  out.append(buffer, end);
+}
+
+auto seconds(std::uint64_t nanoseconds) -> double {
+  return static_cast<double>(nanoseconds) / 1e9;
+}
+
+void appendHistogram(std::string &out, const MetricSample &sample) {
+  const HistogramSnapshot &histogram = sample.histogram;
+  std::uint64_t cumulative = 0;
+  std::size_t index = 0;
+  for (unsigned exponent = kExportFirstExponent;
+       exponent <= Histogram::kMaxExponent; ++exponent) {
+    // Bucket bounds are powers of two, so this sums the values below 2^e.
+    const std::size_t end =
+        Histogram::bucketIndex(std::uint64_t{1} << exponent);
+    for (; index < end; ++index) {
+      cumulative += histogram.buckets[index];
+    }
+    std::string le;
+    appendNumber(le, seconds(std::uint64_t{1} << exponent));
+    out += sample.name;
+    out += "_bucket";
+    appendLabels(out, sample.labels, le);
+    out.push_back(' ');
+    appendNumber(out, static_cast<std::int64_t>(cumulative));
+    out.push_back('\n');
+  }
+  out += sample.name;
+  out += "_bucket";
+  appendLabels(out, sample.labels, "+Inf");
+  out.push_back(' ');
+  appendNumber(out, static_cast<std::int64_t>(histogram.count));
+  out.push_back('\n');
+
+  out += sample.name;
+  out += "_count";
+  appendLabels(out, sample.labels);
+  out.push_back(' ');
+  appendNumber(out, static_cast<std::int64_t>(histogram.count));
+  out.push_back('\n');
+
+  out += sample.name;
+  out += "_sum";
+  appendLabels(out, sample.labels);
+  out.push_back(' ');
+  appendNumber(out, seconds(histogram.sum));
+  out.push_back('\n');
+}
+
+auto typeName(MetricType type) -> std::string_view {
+  switch (type) {
+  case MetricType::Counter:
+    return "counter";
+  case MetricType::Gauge:
+    return "gauge";
+  case MetricType::Histogram:
+    return "histogram";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+auto metrics_detail::nextShard() -> std::size_t {
+  static std::atomic<std::size_t> nextThread{0};
+  return nextThread.fetch_add(1, std::memory_order_relaxed) % kShards;
+}
+
+auto Counter::value() const -> std::uint64_t {
+  std::uint64_t total = 0;
+  for (const Shard &shard : shards_) {
+    total += shard.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void Histogram::record(std::uint64_t value) {
+  Shard &shard = (*shards_)[metrics_detail::shardIndex()];
+  shard.buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(value, std::memory_order_relaxed);
+  std::uint64_t max = shard.max.load(std::memory_order_relaxed);
+  while (value > max && !shard.max.compare_exchange_weak(
+                            max, value, std::memory_order_relaxed)) {
+  }
+}
+
+auto Histogram::snapshot() const -> HistogramSnapshot {
+  HistogramSnapshot result;
+  result.buckets.assign(kBuckets, 0);
+  for (const Shard &shard : *shards_) {
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      const std::uint64_t count =
+          shard.buckets[i].load(std::memory_order_relaxed);
+      result.buckets[i] += count;
+      result.count += count;
+    }
+    result.sum += shard.sum.load(std::memory_order_relaxed);
+    result.max =
+        std::max(result.max, shard.max.load(std::memory_order_relaxed));
+  }
+  return result;
+}
+
+auto HistogramSnapshot::mean() const -> double {
+  return count == 0 ? 0.0
+                    : static_cast<double>(sum) / static_cast<double>(count);
+}
+
+auto HistogramSnapshot::percentile(double q) const -> std::uint64_t {
+  if (count == 0) {
+    return 0;
+  }
+  const double clamped = std::clamp(q, 0.0, 1.0);
+  const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(
+             std::ceil(clamped * static_cast<double>(count))));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i + 1 < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return std::min(max, Histogram::bucketLowerBound(i + 1) - 1);
+    }
+  }
+  return max;
+}
+
+auto MetricsSnapshot::find(std::string_view name,
+                           const MetricLabels &labels) const
+    -> const MetricSample * {
+  for (const MetricSample &sample : samples) {
+    if (sample.name == name && sample.labels == labels) {
+      return &sample;
+    }
+  }
+  return nullptr;
+}
+
+struct MetricsRegistry::Entry {
+  std::string name;
+  std::string help;
+  MetricLabels labels;
+  MetricType type;
+  std::unique_ptr<Counter> counter;
+  std::unique_ptr<Gauge> gauge;
+  std::unique_ptr<Histogram> histogram;
+};
+
+MetricsRegistry::MetricsRegistry() = default;
+MetricsRegistry::~MetricsRegistry() = default;
+
+auto MetricsRegistry::find(std::string_view name, const MetricLabels &labels,
+                           MetricType type, std::string_view help)
+    -> Entry & {
+  if (!validName(name)) {
+    throw std::invalid_argument("Metrics: invalid metric name '" +
+                                std::string(name) + "'");
+  }
+  for (const auto &[key, value] : labels) {
+    if (!validName(key) || key.find(':') != std::string::npos) {
+      throw std::invalid_argument("Metrics: invalid label name '" + key +
+                                  "'");
+    }
+  }
+  const std::lock_guard guard(mutex_);
+  for (const auto &entry : entries_) {
+    if (entry->name != name) {
+      continue;
+    }
+    if (entry->type != type) {
+      throw std::invalid_argument("Metrics: '" + std::string(name) +
+                                  "' is registered with another type");
+    }
+    if (entry->labels == labels) {
+      return *entry;
+    }
+  }
+  auto entry = std::make_unique<Entry>(
+      Entry{std::string(name), std::string(help), labels, type, nullptr,
+            nullptr, nullptr});
+  switch (type) {
+  case MetricType::Counter:
+    entry->counter = std::make_unique<Counter>();
+    break;
+  case MetricType::Gauge:
+    entry->gauge = std::make_unique<Gauge>();
+    break;
+  case MetricType::Histogram:
+    entry->histogram = std::make_unique<Histogram>();
+    break;
+  }
+  entries_.push_back(std::move(entry));
+  return *entries_.back();
+}
+
+auto MetricsRegistry::counter(std::string_view name, std::string_view help,
+                              MetricLabels labels) -> Counter & {
+  return *find(name, labels, MetricType::Counter, help).counter;
+}
+
+auto MetricsRegistry::gauge(std::string_view name, std::string_view help,
+                            MetricLabels labels) -> Gauge & {
+  return *find(name, labels, MetricType::Gauge, help).gauge;
+}
+
+auto MetricsRegistry::histogram(std::string_view name, std::string_view help,
+                                MetricLabels labels) -> Histogram & {
+  return *find(name, labels, MetricType::Histogram, help).histogram;
+}
+
+auto MetricsRegistry::snapshot() const -> MetricsSnapshot {
+  MetricsSnapshot result;
+  {
+    const std::lock_guard guard(mutex_);
+    result.samples.reserve(entries_.size());
+    for (const auto &entry : entries_) {
+      MetricSample sample{entry->name, entry->help, entry->labels,
+                          entry->type};
+      switch (entry->type) {
+      case MetricType::Counter:
+        sample.value = static_cast<std::int64_t>(entry->counter->value());
+        break;
+      case MetricType::Gauge:
+        sample.value = entry->gauge->value();
+        break;
+      case MetricType::Histogram:
+        sample.histogram = entry->histogram->snapshot();
+        break;
+      }
+      result.samples.push_back(std::move(sample));
+    }
+  }
+  std::sort(result.samples.begin(), result.samples.end(),
+            [](const MetricSample &lhs, const MetricSample &rhs) {
+              return std::tie(lhs.name, lhs.labels) <
+                     std::tie(rhs.name, rhs.labels);
+            });
+  return result;
+}
+
+auto MetricsRegistry::global() -> MetricsRegistry & {
+  static MetricsRegistry instance;
+  return instance;
+}
+
+auto formatOpenMetrics(const MetricsSnapshot &snapshot) -> std::string {
+  std::string out;
+  const std::string *family = nullptr;
+  for (const MetricSample &sample : snapshot.samples) {
+    if (family == nullptr || *family != sample.name) {
+      family = &sample.name;
+      out += "# TYPE ";
+      out += sample.name;
+      out.push_back(' ');
+      out += typeName(sample.type);
+      out.push_back('\n');
+      if (!sample.help.empty()) {
+        out += "# HELP ";
+        out += sample.name;
+        out.push_back(' ');
+        appendEscaped(out, sample.help, false);
+        out.push_back('\n');
+      }
+    }
+    switch (sample.type) {
+    case MetricType::Counter:
+      out += sample.name;
+      out += "_total";
+      appendLabels(out, sample.labels);
+      out.push_back(' ');
+      appendNumber(out, sample.value);
+      out.push_back('\n');
+      break;
+    case MetricType::Gauge:
+      out += sample.name;
+      appendLabels(out, sample.labels);
+      out.push_back(' ');
+      appendNumber(out, sample.value);
+      out.push_back('\n');
+      break;
+    case MetricType::Histogram:
+      appendHistogram(out, sample);
+      break;
+    }
+  }
+  out += "# EOF\n";
+  return out;
+}
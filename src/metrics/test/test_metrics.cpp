@@ -0,0 +1,196 @@
+#include "metrics.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef MY_CODE_METRICS
+#include "calculator.hpp"
+#include "logger.hpp"
+#include "notifier.hpp"
+#include "pipeline.hpp"
+#endif
+
+static_assert(Histogram::bucketIndex(0) == 0);
+static_assert(Histogram::bucketIndex(15) == 15);
+static_assert(Histogram::bucketIndex(16) == 16);
+static_assert(Histogram::bucketIndex(32) == 32);
+static_assert(Histogram::bucketIndex(std::uint64_t{1} << 60U) ==
+              Histogram::kBuckets - 1);
+static_assert(Histogram::bucketLowerBound(Histogram::bucketIndex(1000)) <=
+              1000);
+static_assert(Histogram::bucketLowerBound(Histogram::bucketIndex(1000) + 1) >
+              1000);
+
+TEST(MetricsTests, TestCounterSumsAcrossThreads) {
+  Counter counter;
+  constexpr int kThreads = 6;
+  constexpr int kAdds = 10'000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&counter] {
+      for (int i = 0; i < kAdds; ++i) {
+        counter.add();
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  counter.add(5);
+  EXPECT_EQ(counter.value(), std::uint64_t{kThreads * kAdds + 5});
+
+  Gauge gauge;
+  gauge.add(3);
+  gauge.add(-5);
+  EXPECT_EQ(gauge.value(), -2);
+  gauge.set(7);
+  EXPECT_EQ(gauge.value(), 7);
+}
+
+TEST(MetricsTests, TestHistogramBucketsAndPercentiles) {
+  // Every bucket bound maps back to its own bucket.
+  for (std::size_t i = 1; i < Histogram::kBuckets; ++i) {
+    const std::uint64_t lower = Histogram::bucketLowerBound(i);
+    ASSERT_EQ(Histogram::bucketIndex(lower), i);
+    ASSERT_EQ(Histogram::bucketIndex(lower - 1), i - 1);
+  }
+
+  Histogram histogram;
+  EXPECT_EQ(histogram.snapshot().percentile(0.5), 0U);
+  for (std::uint64_t v = 1; v <= 10'000; ++v) {
+    histogram.record(v);
+  }
+  const HistogramSnapshot snapshot = histogram.snapshot();
+  EXPECT_EQ(snapshot.count, 10'000U);
+  EXPECT_EQ(snapshot.sum, 10'000U * 10'001U / 2);
+  EXPECT_EQ(snapshot.max, 10'000U);
+  EXPECT_DOUBLE_EQ(snapshot.mean(), 5000.5);
+  // Within one sub-bucket (1/16) above the exact percentile.
+  for (const double q : {0.5, 0.9, 0.99}) {
+    const double exact = q * 10'000;
+    const auto value = static_cast<double>(snapshot.percentile(q));
+    EXPECT_GE(value, exact);
+    EXPECT_LE(value, exact * (1.0 + 1.0 / 16));
+  }
+  EXPECT_EQ(snapshot.percentile(1.0), 10'000U);
+}
+
+TEST(MetricsTests, TestRegistryReturnsSameMetricAndRejectsConflicts) {
+  MetricsRegistry registry;
+  Counter &first = registry.counter("requests", "Requests", {{"op", "a"}});
+  Counter &again = registry.counter("requests", "Requests", {{"op", "a"}});
+  Counter &other = registry.counter("requests", "Requests", {{"op", "b"}});
+  EXPECT_EQ(&first, &again);
+  EXPECT_NE(&first, &other);
+  first.add(2);
+  other.add(1);
+
+  EXPECT_THROW(static_cast<void>(registry.gauge("requests", "")),
+               std::invalid_argument);
+  EXPECT_THROW(static_cast<void>(registry.counter("9lives", "")),
+               std::invalid_argument);
+  EXPECT_THROW(static_cast<void>(registry.counter("ok", "", {{"a-b", "x"}})),
+               std::invalid_argument);
+
+  const MetricsSnapshot snapshot = registry.snapshot();
+  ASSERT_EQ(snapshot.samples.size(), 2U);
+  const MetricSample *sample = snapshot.find("requests", {{"op", "a"}});
+  ASSERT_NE(sample, nullptr);
+  EXPECT_EQ(sample->value, 2);
+  EXPECT_EQ(snapshot.find("requests"), nullptr);
+}
+
+TEST(MetricsTests, TestOpenMetricsExport) {
+  MetricsRegistry registry;
+  registry.counter("jobs", "Jobs \"done\"", {{"queue", "a\"b"}}).add(3);
+  registry.gauge("depth", "Queue depth").set(-4);
+  Histogram &latency = registry.histogram("latency_seconds", "Latency");
+  latency.record(500);       // below the first exported bound
+  latency.record(3'000);     // between 2^11 and 2^12 ns
+  latency.record(1'000'000); // about 1 ms
+
+  const std::string text = formatOpenMetrics(registry.snapshot());
+  EXPECT_NE(text.find("# TYPE depth gauge\n# HELP depth Queue depth\n"
+                      "depth -4\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("# TYPE jobs counter\n"), std::string::npos);
+  EXPECT_NE(text.find("jobs_total{queue=\"a\\\"b\"} 3\n"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE latency_seconds histogram\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("latency_seconds_bucket{le=\"1.024e-06\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("latency_seconds_bucket{le=\"2.048e-06\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("latency_seconds_bucket{le=\"4.096e-06\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("latency_seconds_bucket{le=\"+Inf\"} 3\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("latency_seconds_count 3\n"), std::string::npos);
+  EXPECT_NE(text.find("latency_seconds_sum 0.0010035\n"), std::string::npos);
+  // Families are sorted by name and the exposition is terminated.
+  EXPECT_LT(text.find("depth"), text.find("jobs"));
+  EXPECT_EQ(text.substr(text.size() - 6), "# EOF\n");
+}
+
+#ifdef MY_CODE_METRICS
+TEST(MetricsTests, TestComponentHooksReportToGlobalRegistry) {
+  const auto counter = [](const char *name, const MetricLabels &labels) {
+    const MetricsSnapshot snapshot = MetricsRegistry::global().snapshot();
+    const MetricSample *sample = snapshot.find(name, labels);
+    return sample == nullptr ? 0 : sample->value;
+  };
+  const auto elementsBefore =
+      counter("my_code_calculator_elements", {{"op", "add"}});
+  const auto hitsBefore = counter("my_code_notifier_hits", {});
+
+  const std::vector<int> lhs(100, 1);
+  const std::vector<int> rhs(100, 2);
+  std::vector<int> out(100);
+  Calculator::add(lhs, rhs, out);
+  const Notifier notifier(2);
+  std::vector<std::uint64_t> mask(Notifier::maskWords(out.size()));
+  EXPECT_EQ(notifier.shouldNotify(out, mask), 100U);
+
+  EXPECT_EQ(counter("my_code_calculator_elements", {{"op", "add"}}),
+            elementsBefore + 100);
+  EXPECT_EQ(counter("my_code_notifier_hits", {}), hitsBefore + 100);
+  EXPECT_NE(formatOpenMetrics(MetricsRegistry::global().snapshot())
+                .find("my_code_calculator_batch_seconds_count{op=\"add\"}"),
+            std::string::npos);
+}
+
+// onNotify callbacks reuse the batch screen instead of screening each hit
+// again, so every value is counted once.
+TEST(MetricsTests, TestPipelineNotifyCallbacksCountOnce) {
+  const auto counter = [](const char *name) {
+    const MetricsSnapshot snapshot = MetricsRegistry::global().snapshot();
+    const MetricSample *sample = snapshot.find(name, {});
+    return sample == nullptr ? 0 : sample->value;
+  };
+  const auto checksBefore = counter("my_code_notifier_checks");
+  const auto hitsBefore = counter("my_code_notifier_hits");
+
+  const Logger logger;
+  const Notifier notifier(2);
+  std::size_t delivered = 0;
+  Pipeline pipeline(
+      logger, notifier,
+      PipelineOptions{.onNotify = [&delivered](std::size_t,
+                                               const NotifyMessage &message) {
+        EXPECT_TRUE(message.exceeded());
+        ++delivered;
+      }});
+  const std::vector<int> lhs(100, 1);
+  std::vector<int> rhs(100, 0);
+  for (std::size_t i = 0; i < rhs.size(); i += 4) {
+    rhs[i] = 5;
+  }
+  EXPECT_EQ(pipeline.process(Operation::Add, "add", lhs, rhs).notified, 25U);
+  EXPECT_EQ(delivered, 25U);
+  EXPECT_EQ(counter("my_code_notifier_checks"), checksBefore + 100);
+  EXPECT_EQ(counter("my_code_notifier_hits"), hitsBefore + 25);
+}
+#endif
@@ -0,0 +1,197 @@
+#pragma once
+#include "notifier.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Token bucket: holds up to burst tokens and refills at ratePerSecond. A
+// rate of 0 disables limiting. Time is passed in, so it can be driven by a
+// test clock.
+class TokenBucket {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // Starts full. Throws std::invalid_argument for a negative rate or, when
+  // limiting, a burst below one token.
+  TokenBucket(double ratePerSecond, double burst,
+              Clock::time_point now = Clock::now());
+
+  // Takes one token if available.
+  auto tryAcquire(Clock::time_point now) -> bool;
+  [[nodiscard]] auto available(Clock::time_point now) const -> double;
+
+private:
+  double rate_;
+  double burst_;
+  double tokens_;
+  Clock::time_point last_;
+};
+
+// One delivered alert: every publish() for key within one coalescing window,
+// merged.
+struct Notification {
+  std::uint64_t key = 0;
+  // The latest message published for key.
+  NotifyMessage message{false, 0};
+  // Largest value among the merged messages.
+  int peak = 0;
+  std::uint32_t count = 0;
+  std::chrono::steady_clock::time_point first{};
+  std::chrono::steady_clock::time_point last{};
+
+  // "[key] message" plus " (xN)" when several alerts were merged.
+  [[nodiscard]] auto format() const -> std::string;
+  void formatTo(std::string &out) const;
+};
+
+// Receives batches of notifications on the dispatcher thread, in delivery
+// order. May block or do I/O; producers never wait for it unless the queue
+// policy is Block and the queue fills up.
+using NotificationSink = std::function<void(std::span<const Notification>)>;
+
+// Sink writing one formatted line per notification to fd (owned by the
+// caller), with a single write() per batch.
+auto fdNotificationSink(int fd) -> NotificationSink;
+
+// What publish() does while the queue is full.
+enum class BackpressurePolicy {
+  Drop, // discard the alert and return false
+  Block // wait for the dispatcher to make room
+};
+
+struct DispatcherOptions {
+  std::vector<NotificationSink> sinks{};
+  // Alerts buffered between publishers and the dispatcher thread.
+  std::size_t queueCapacity = 4096;
+  BackpressurePolicy policy = BackpressurePolicy::Drop;
+  // Repeats of a key within this long after its first alert are merged
+  // into one notification, delivered when the window closes. With 0,
+  // repeats only merge while a notification waits for the dispatcher or
+  // for a token.
+  std::chrono::milliseconds coalesceWindow{1000};
+  // Token bucket shared by all keys; 0 disables rate limiting. Notifications
+  // over the limit stay pending, still absorbing repeats, until a token
+  // frees up.
+  double ratePerSecond = 0;
+  double burst = 10;
+  // Distinct keys held in open windows or waiting for a token; alerts for
+  // further keys are dropped.
+  std::size_t maxPendingKeys = 4096;
+  // The dispatcher wakes at least this often, and as soon as batchSize
+  // alerts are queued.
+  std::chrono::milliseconds pollInterval{10};
+  std::size_t batchSize = 256;
+};
+
+struct DispatcherStats {
+  std::uint64_t published = 0;
+  // Rejected by a full queue or the maxPendingKeys bound.
+  std::uint64_t dropped = 0;
+  // Alerts merged into an already pending notification.
+  std::uint64_t coalesced = 0;
+  std::uint64_t delivered = 0;
+  // Notifications held back at least once by the rate limit.
+  std::uint64_t throttled = 0;
+  // Exceptions thrown by sinks.
+  std::uint64_t sinkErrors = 0;
+};
+
+// Delivery layer behind Notifier: publishers enqueue alerts into a bounded
+// queue, and a dispatcher thread coalesces them per key, applies the rate
+// limit and hands the result to the sinks. publish() never does I/O.
+class NotificationDispatcher {
+public:
+  explicit NotificationDispatcher(DispatcherOptions options);
+  ~NotificationDispatcher();
+  NotificationDispatcher(const NotificationDispatcher &) = delete;
+  auto operator=(const NotificationDispatcher &)
+      -> NotificationDispatcher & = delete;
+  NotificationDispatcher(NotificationDispatcher &&) = delete;
+  auto operator=(NotificationDispatcher &&)
+      -> NotificationDispatcher & = delete;
+
+  // Enqueues one alert. Returns false if it was dropped.
+  auto publish(std::uint64_t key, NotifyMessage message) -> bool;
+  // Enqueues an exceeded alert for every values[i] whose bit is set in mask
+  // (Notifier::shouldNotify layout), taking the queue lock once. Returns the
+  // number enqueued.
+  auto publish(std::uint64_t key, std::span<const int> values,
+               std::span<const std::uint64_t> mask) -> std::size_t;
+
+  // Delivers everything published before the call, closing open windows
+  // early and bypassing the rate limit, and waits for the sinks to return.
+  // Returns at once if close() has begun, which delivers everything itself.
+  void flush();
+  // Flushes and stops the dispatcher thread. Called by the destructor; no
+  // alerts may be published afterwards.
+  void close();
+
+  [[nodiscard]] auto stats() const -> DispatcherStats;
+
+private:
+  struct Event {
+    std::uint64_t key = 0;
+    NotifyMessage message{false, 0};
+    std::chrono::steady_clock::time_point time{};
+  };
+  struct Pending {
+    Notification notification;
+    std::chrono::steady_clock::time_point windowEnd{};
+    bool throttled = false;
+  };
+
+  // Caller holds queueMutex_ with room in the queue.
+  void pushLocked(const Event &event);
+  // Waits for room under BackpressurePolicy::Block; returns false if the
+  // alert must be dropped instead.
+  auto waitForRoomLocked(std::unique_lock<std::mutex> &lock) -> bool;
+  void run();
+  void coalesce(const Event &event);
+  // Delivers pending notifications whose window has closed, or all of them
+  // when force is set.
+  void deliverReady(std::chrono::steady_clock::time_point now, bool force);
+
+  const DispatcherOptions options_;
+
+  // Ring of queueCapacity events.
+  std::mutex queueMutex_;
+  std::condition_variable notFull_;
+  std::vector<Event> queue_;
+  std::size_t head_ = 0;
+  std::size_t count_ = 0;
+  bool closed_ = false;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  bool stopping_ = false;
+  std::uint64_t flushRequested_ = 0;
+  std::uint64_t flushCompleted_ = 0;
+
+  // Dispatcher thread only.
+  std::unordered_map<std::uint64_t, Pending> pending_;
+  std::vector<Event> batch_;
+  std::vector<std::pair<std::chrono::steady_clock::time_point, std::uint64_t>>
+      due_;
+  std::vector<Notification> ready_;
+  TokenBucket bucket_;
+
+  std::atomic<std::uint64_t> published_{0};
+  std::atomic<std::uint64_t> dropped_{0};
+  std::atomic<std::uint64_t> coalesced_{0};
+  std::atomic<std::uint64_t> delivered_{0};
+  std::atomic<std::uint64_t> throttled_{0};
+  std::atomic<std::uint64_t> sinkErrors_{0};
+
+  std::thread dispatcher_;
+};
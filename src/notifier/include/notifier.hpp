@@ -1,5 +1,42 @@
 #pragma once
+#include "scheduler.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
+
+// Deferred notification message: records what to say and renders the text
+// only when asked to.
+class NotifyMessage {
+public:
+  static constexpr std::string_view kWithinThreshold =
+      "Value within threshold.";
+  static constexpr std::string_view kExceededPrefix =
+      "Threshold exceeded! Value: ";
+  // Large enough for any message, including the sign of INT_MIN.
+  static constexpr std::size_t kMaxLength =
+      kExceededPrefix.size() + std::numeric_limits<int>::digits10 + 2;
+
+  constexpr NotifyMessage(bool exceeded, int value)
+      : exceeded_(exceeded), value_(value) {}
+
+  [[nodiscard]] constexpr auto exceeded() const -> bool { return exceeded_; }
+  [[nodiscard]] constexpr auto value() const -> int { return value_; }
+
+  // Writes the message into buffer and returns a view of it. The
+  // within-threshold message is a static string and never touches buffer.
+  // Throws std::invalid_argument if buffer is shorter than required.
+  [[nodiscard]] auto render(std::span<char> buffer) const -> std::string_view;
+  [[nodiscard]] auto str() const -> std::string;
+
+private:
+  bool exceeded_;
+  int value_;
+};
 
 class Notifier {
 public:
@@ -7,6 +44,40 @@ public:
 
   [[nodiscard]] auto shouldNotify(int value) const -> bool;
   [[nodiscard]] auto notifyMessage(int value) const -> std::string;
+  // Allocation-free alternative to notifyMessage().
+  [[nodiscard]] auto message(int value) const -> NotifyMessage {
+    return {shouldNotify(value), value};
+  }
+
+  // Batch screening: bit i (word i / 64, bit i % 64) is set when values[i]
+  // exceeds the threshold.
+  [[nodiscard]] auto shouldNotify(std::span<const int> values) const
+      -> std::vector<std::uint64_t>;
+  // Same, with the mask allocated from resource (e.g. a request's
+  // MonotonicArena).
+  [[nodiscard]] auto shouldNotify(std::span<const int> values,
+                                  std::pmr::memory_resource *resource) const
+      -> std::pmr::vector<std::uint64_t>;
+  // Allocation-free form; mask needs maskWords(values.size()) words
+  // (std::invalid_argument otherwise). Returns the number of set bits.
+  auto shouldNotify(std::span<const int> values,
+                    std::span<std::uint64_t> mask) const -> std::size_t;
+  // Parallel form: screens ParallelOptions chunks on the scheduler. Chunks
+  // start on multiples of 64, so each one fills whole mask words.
+  auto shouldNotify(const ParallelOptions &options,
+                    std::span<const int> values,
+                    std::span<std::uint64_t> mask) const -> std::size_t;
+  // Indices of the values that exceed the threshold, in ascending order.
+  [[nodiscard]] auto exceedingIndices(std::span<const int> values) const
+      -> std::vector<std::size_t>;
+  [[nodiscard]] auto exceedingIndices(std::span<const int> values,
+                                      std::pmr::memory_resource *resource)
+      const -> std::pmr::vector<std::size_t>;
+
+  [[nodiscard]] static constexpr auto maskWords(std::size_t count)
+      -> std::size_t {
+    return (count + 63) / 64;
+  }
 
 private:
   int threshold_;
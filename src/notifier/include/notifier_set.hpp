@@ -0,0 +1,103 @@
+#pragma once
+#include "scheduler.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+// One rule of a NotifierSet: fires for every value in [low, high].
+struct NotifierRule {
+  int low;
+  int high;
+
+  // Same condition as Notifier(threshold): value > threshold.
+  static constexpr auto above(int threshold) -> NotifierRule {
+    if (threshold == std::numeric_limits<int>::max()) {
+      return {std::numeric_limits<int>::max(), std::numeric_limits<int>::min()};
+    }
+    return {threshold + 1, std::numeric_limits<int>::max()};
+  }
+  static constexpr auto between(int low, int high) -> NotifierRule {
+    return {low, high};
+  }
+};
+
+// Rules matched by one value, as views into the NotifierSet. Thresholds are
+// ordered from the lowest bound up, ranges by rule id.
+struct NotifierSetMatch {
+  std::span<const std::uint32_t> thresholds;
+  std::span<const std::uint32_t> ranges;
+
+  [[nodiscard]] auto size() const -> std::size_t {
+    return thresholds.size() + ranges.size();
+  }
+  [[nodiscard]] auto empty() const -> bool { return size() == 0; }
+};
+
+// Immutable collection of many rules, built once and then queried from any
+// number of threads. Rule ids are the indices into the constructor's span.
+//
+// Open-ended rules (high == INT_MAX, i.e. thresholds) are kept sorted by
+// low, so the rules matching a value are a prefix of that order. Bounded
+// ranges are flattened into elementary segments, each with the ids of the
+// ranges covering it; memory grows with how much the ranges overlap. Both
+// searches run over Eytzinger-ordered keys.
+class NotifierSet {
+public:
+  explicit NotifierSet(std::span<const NotifierRule> rules);
+
+  // O(log n) in the number of rules; the result views are not copied.
+  [[nodiscard]] auto match(int value) const -> NotifierSetMatch;
+  // O(log n) and touches no per-rule data.
+  [[nodiscard]] auto matchCount(int value) const -> std::size_t;
+
+  // Batch forms: one result per value. counts needs values.size() slots
+  // (std::invalid_argument otherwise).
+  void matchCounts(std::span<const int> values,
+                   std::span<std::uint32_t> counts) const;
+  // Parallel form over ParallelOptions chunks; the set is immutable, so the
+  // chunks share it without synchronisation.
+  void matchCounts(const ParallelOptions &options, std::span<const int> values,
+                   std::span<std::uint32_t> counts) const;
+  [[nodiscard]] auto matchAll(std::span<const int> values) const
+      -> std::vector<NotifierSetMatch>;
+  [[nodiscard]] auto matchAll(std::span<const int> values,
+                              std::pmr::memory_resource *resource) const
+      -> std::pmr::vector<NotifierSetMatch>;
+
+  [[nodiscard]] auto ruleCount() const -> std::size_t { return ruleCount_; }
+
+private:
+  // Sorted keys stored in Eytzinger (BFS) order for cache-friendly binary
+  // search. rank(value) returns how many keys are <= value.
+  class EytzingerKeys {
+  public:
+    EytzingerKeys() = default;
+    explicit EytzingerKeys(std::span<const int> sorted);
+    [[nodiscard]] auto rank(int value) const -> std::size_t;
+
+  private:
+    // Slot 0 is unused. ranks_[k] is the sorted position of keys_[k].
+    std::vector<int> keys_;
+    std::vector<std::uint32_t> ranks_;
+  };
+
+  struct Located {
+    std::size_t thresholds;
+    std::size_t segment; // 0 means before the first boundary
+  };
+  [[nodiscard]] auto locate(int value) const -> Located;
+
+  std::size_t ruleCount_ = 0;
+
+  EytzingerKeys thresholdKeys_;
+  std::vector<std::uint32_t> thresholdIds_;
+
+  // Segment s (1-based) covers [boundaries[s-1], boundaries[s]) and owns
+  // rangeIds_[segmentOffsets_[s], segmentOffsets_[s + 1]).
+  EytzingerKeys boundaryKeys_;
+  std::vector<std::uint32_t> segmentOffsets_;
+  std::vector<std::uint32_t> rangeIds_;
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Stateful screens for a stream of samples. Unlike Notifier, each one
+// remembers earlier samples, so a value hovering around a threshold does not
+// raise an alert per sample. Not thread-safe: feed each instance from one
+// thread. Batch updates fill a mask in the Notifier::shouldNotify layout and
+// give the same result as calling update() per value.
+
+// Alerts once when a value rises above rise and re-arms only after a value
+// at or below fall.
+class HysteresisNotifier {
+public:
+  // Throws std::invalid_argument if fall > rise.
+  HysteresisNotifier(int rise, int fall);
+
+  // True for the sample that raises the alert.
+  auto update(int value) -> bool;
+  // Sets the bit of every sample that raises an alert; returns their number.
+  auto update(std::span<const int> values, std::span<std::uint64_t> mask)
+      -> std::size_t;
+
+  [[nodiscard]] auto active() const -> bool { return active_; }
+  void reset() { active_ = false; }
+
+private:
+  int rise_;
+  int fall_;
+  bool active_ = false;
+};
+
+// The most recent `samples` values, optionally also bounded by age, with
+// O(1) sum, mean and max. The max is tracked with a monotonic queue, so
+// push() is amortised O(1); memory is fixed at construction.
+class SlidingWindow {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // With a non-zero maxAge, samples pushed at or before now - maxAge are
+  // evicted as well. Throws std::invalid_argument if samples is 0.
+  explicit SlidingWindow(std::size_t samples,
+                         Clock::duration maxAge = Clock::duration::zero());
+
+  // now is only used when maxAge is set, and must not go backwards.
+  void push(int value, Clock::time_point now = {});
+  // Evicts samples that are too old at now, without adding one.
+  void expire(Clock::time_point now);
+  void clear();
+
+  [[nodiscard]] auto size() const -> std::size_t { return size_; }
+  [[nodiscard]] auto empty() const -> bool { return size_ == 0; }
+  [[nodiscard]] auto capacity() const -> std::size_t {
+    return values_.size();
+  }
+  [[nodiscard]] auto maxAge() const -> Clock::duration { return maxAge_; }
+  [[nodiscard]] auto sum() const -> std::int64_t { return sum_; }
+  // Both throw std::logic_error on an empty window.
+  [[nodiscard]] auto mean() const -> double;
+  [[nodiscard]] auto max() const -> int;
+
+private:
+  void evictOldest();
+  [[nodiscard]] auto next(std::size_t slot) const -> std::size_t {
+    return slot + 1 == values_.size() ? 0 : slot + 1;
+  }
+
+  Clock::duration maxAge_;
+  std::vector<int> values_;
+  // Only allocated when maxAge is set.
+  std::vector<Clock::time_point> times_;
+  std::size_t oldest_ = 0;
+  std::size_t size_ = 0;
+  std::int64_t sum_ = 0;
+  // Ring of value slots whose values strictly decrease from front to back;
+  // the front holds the window max.
+  std::vector<std::size_t> maxQueue_;
+  std::size_t maxHead_ = 0;
+  std::size_t maxCount_ = 0;
+};
+
+enum class WindowStatistic { Mean, Max };
+
+// Level alert on a SlidingWindow statistic: true while the mean (or max) of
+// the window exceeds the threshold.
+class WindowNotifier {
+public:
+  using Clock = SlidingWindow::Clock;
+
+  WindowNotifier(int threshold, WindowStatistic statistic,
+                 std::size_t samples,
+                 Clock::duration maxAge = Clock::duration::zero());
+
+  // Pushes value, then compares the statistic with the threshold.
+  auto update(int value, Clock::time_point now = {}) -> bool;
+  auto update(std::span<const int> values, std::span<std::uint64_t> mask)
+      -> std::size_t;
+  // Timed form: times[i] is the arrival time of values[i].
+  auto update(std::span<const int> values,
+              std::span<const Clock::time_point> times,
+              std::span<std::uint64_t> mask) -> std::size_t;
+
+  [[nodiscard]] auto window() const -> const SlidingWindow & {
+    return window_;
+  }
+  void reset() { window_.clear(); }
+
+private:
+  [[nodiscard]] auto exceeded() const -> bool;
+
+  int threshold_;
+  WindowStatistic statistic_;
+  SlidingWindow window_;
+};
+
+// Level alert on an exponentially weighted moving average:
+// average = alpha * value + (1 - alpha) * average, seeded by the first
+// sample.
+class EwmaNotifier {
+public:
+  // Throws std::invalid_argument unless 0 < alpha <= 1.
+  EwmaNotifier(int threshold, double alpha);
+
+  // Folds value into the average and compares it with the threshold.
+  auto update(int value) -> bool;
+  auto update(std::span<const int> values, std::span<std::uint64_t> mask)
+      -> std::size_t;
+
+  // 0 before the first sample.
+  [[nodiscard]] auto average() const -> double { return average_; }
+  [[nodiscard]] auto primed() const -> bool { return primed_; }
+  void reset() {
+    average_ = 0;
+    primed_ = false;
+  }
+
+private:
+  double threshold_;
+  double alpha_;
+  double average_ = 0;
+  bool primed_ = false;
+};
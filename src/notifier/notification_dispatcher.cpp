@@ -0,0 +1,346 @@
+#include "notification_dispatcher.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+auto validated(DispatcherOptions options) -> DispatcherOptions {
+  if (options.queueCapacity == 0 || options.batchSize == 0 ||
+      options.maxPendingKeys == 0) {
+    throw std::invalid_argument(
+        "NotificationDispatcher: queueCapacity, batchSize and maxPendingKeys "
+        "must be non-zero");
+  }
+  return options;
+}
+
+} // namespace
+
+TokenBucket::TokenBucket(double ratePerSecond, double burst,
+                         Clock::time_point now)
+    : rate_(ratePerSecond), burst_(burst), tokens_(burst), last_(now) {
+  if (rate_ < 0 || (rate_ > 0 && burst_ < 1)) {
+    throw std::invalid_argument("TokenBucket: invalid rate or burst");
+  }
+}
+
+auto TokenBucket::available(Clock::time_point now) const -> double {
+  if (rate_ == 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  const double elapsed =
+      std::chrono::duration<double>(std::max(now - last_, Clock::duration{}))
+          .count();
+  return std::min(burst_, tokens_ + elapsed * rate_);
+}
+
+auto TokenBucket::tryAcquire(Clock::time_point now) -> bool {
+  if (rate_ == 0) {
+    return true;
+  }
+  tokens_ = available(now);
+  last_ = std::max(last_, now);
+  if (tokens_ < 1) {
+    return false;
+  }
+  tokens_ -= 1;
+  return true;
+}
+
+auto Notification::format() const -> std::string {
+  std::string out;
+  formatTo(out);
+  return out;
+}
+
+void Notification::formatTo(std::string &out) const {
+  std::array<char, NotifyMessage::kMaxLength> text{};
+  std::array<char, std::numeric_limits<std::uint64_t>::digits10 + 2> digits{};
+  out.push_back('[');
+  const auto keyEnd =
+      std::to_chars(digits.data(), digits.data() + digits.size(), key).ptr;
+  out.append(digits.data(), keyEnd);
+  out += "] ";
+  out += message.render(text);
+  if (count > 1) {
+    out += " (x";
+    const auto countEnd =
+        std::to_chars(digits.data(), digits.data() + digits.size(), count)
+            .ptr;
+    out.append(digits.data(), countEnd);
+    out.push_back(')');
+  }
+}
+
+auto fdNotificationSink(int fd) -> NotificationSink {
+  return [fd, buffer = std::string()](
+             std::span<const Notification> notifications) mutable {
+    buffer.clear();
+    for (const Notification &notification : notifications) {
+      notification.formatTo(buffer);
+      buffer.push_back('\n');
+    }
+    const char *data = buffer.data();
+    std::size_t remaining = buffer.size();
+    while (remaining > 0) {
+      const ssize_t written = ::write(fd, data, remaining);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(),
+                                "fdNotificationSink: write failed");
+      }
+      data += written;
+      remaining -= static_cast<std::size_t>(written);
+    }
+  };
+}
+
+NotificationDispatcher::NotificationDispatcher(DispatcherOptions options)
+    : options_(validated(std::move(options))),
+      queue_(options_.queueCapacity),
+      bucket_(options_.ratePerSecond, options_.burst) {
+  dispatcher_ = std::thread([this] { run(); });
+}
+
+NotificationDispatcher::~NotificationDispatcher() { close(); }
+
+void NotificationDispatcher::pushLocked(const Event &event) {
+  std::size_t slot = head_ + count_;
+  if (slot >= queue_.size()) {
+    slot -= queue_.size();
+  }
+  queue_[slot] = event;
+  ++count_;
+}
+
+auto NotificationDispatcher::waitForRoomLocked(
+    std::unique_lock<std::mutex> &lock) -> bool {
+  if (closed_) {
+    return false;
+  }
+  if (count_ < queue_.size()) {
+    return true;
+  }
+  if (options_.policy == BackpressurePolicy::Drop) {
+    return false;
+  }
+  notFull_.wait(lock,
+                [this] { return closed_ || count_ < queue_.size(); });
+  return !closed_;
+}
+
+auto NotificationDispatcher::publish(std::uint64_t key, NotifyMessage message)
+    -> bool {
+  const auto now = std::chrono::steady_clock::now();
+  std::size_t queued = 0;
+  {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    if (!waitForRoomLocked(lock)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    pushLocked({key, message, now});
+    queued = count_;
+  }
+  published_.fetch_add(1, std::memory_order_relaxed);
+  // Only the publisher that crosses the threshold pays for the wake-up.
+  if (queued == options_.batchSize) {
+    wake_.notify_one();
+  }
+  return true;
+}
+
+auto NotificationDispatcher::publish(std::uint64_t key,
+                                     std::span<const int> values,
+                                     std::span<const std::uint64_t> mask)
+    -> std::size_t {
+  if (mask.size() < Notifier::maskWords(values.size())) {
+    throw std::invalid_argument("NotificationDispatcher: mask is too small");
+  }
+  const auto now = std::chrono::steady_clock::now();
+  std::size_t published = 0;
+  std::size_t dropped = 0;
+  bool wake = false;
+  {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    for (std::size_t word = 0; word < Notifier::maskWords(values.size());
+         ++word) {
+      for (std::uint64_t bits = mask[word]; bits != 0; bits &= bits - 1) {
+        const std::size_t index =
+            word * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+        if (index >= values.size()) {
+          break;
+        }
+        if (!waitForRoomLocked(lock)) {
+          ++dropped;
+          continue;
+        }
+        pushLocked({key, NotifyMessage(true, values[index]), now});
+        ++published;
+        wake = wake || count_ == options_.batchSize;
+      }
+    }
+  }
+  published_.fetch_add(published, std::memory_order_relaxed);
+  dropped_.fetch_add(dropped, std::memory_order_relaxed);
+  if (wake) {
+    wake_.notify_one();
+  }
+  return published;
+}
+
+void NotificationDispatcher::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Once close() has begun, the thread may have read its last ticket and
+  // close() may be joining dispatcher_. Its final pass delivers everything.
+  if (stopping_ || !dispatcher_.joinable()) {
+    return;
+  }
+  const std::uint64_t ticket = ++flushRequested_;
+  wake_.notify_one();
+  flushed_.wait(lock, [this, ticket] { return flushCompleted_ >= ticket; });
+}
+
+void NotificationDispatcher::close() {
+  {
+    const std::lock_guard<std::mutex> lock(queueMutex_);
+    closed_ = true;
+  }
+  notFull_.notify_all();
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    if (!dispatcher_.joinable()) {
+      return;
+    }
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  dispatcher_.join();
+}
+
+auto NotificationDispatcher::stats() const -> DispatcherStats {
+  return {published_.load(std::memory_order_relaxed),
+          dropped_.load(std::memory_order_relaxed),
+          coalesced_.load(std::memory_order_relaxed),
+          delivered_.load(std::memory_order_relaxed),
+          throttled_.load(std::memory_order_relaxed),
+          sinkErrors_.load(std::memory_order_relaxed)};
+}
+
+void NotificationDispatcher::run() {
+  MY_CODE_TRACE_THREAD_NAME("notification dispatcher");
+  std::uint64_t completed = 0;
+  while (true) {
+    std::uint64_t ticket = 0;
+    bool stopping = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait_for(lock, options_.pollInterval, [this] {
+        if (stopping_ || flushRequested_ != flushCompleted_) {
+          return true;
+        }
+        const std::lock_guard<std::mutex> queueLock(queueMutex_);
+        return count_ >= options_.batchSize;
+      });
+      ticket = flushRequested_;
+      stopping = stopping_;
+    }
+
+    batch_.clear();
+    {
+      const std::lock_guard<std::mutex> lock(queueMutex_);
+      for (std::size_t i = 0; i < count_; ++i) {
+        batch_.push_back(queue_[(head_ + i) % queue_.size()]);
+      }
+      head_ = 0;
+      count_ = 0;
+    }
+    notFull_.notify_all();
+    for (const Event &event : batch_) {
+      coalesce(event);
+    }
+    deliverReady(std::chrono::steady_clock::now(),
+                 stopping || ticket != completed);
+    completed = ticket;
+
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      flushCompleted_ = ticket;
+    }
+    flushed_.notify_all();
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+void NotificationDispatcher::coalesce(const Event &event) {
+  const auto found = pending_.find(event.key);
+  if (found != pending_.end()) {
+    Notification &notification = found->second.notification;
+    notification.message = event.message;
+    notification.peak = std::max(notification.peak, event.message.value());
+    ++notification.count;
+    notification.last = event.time;
+    coalesced_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (pending_.size() >= options_.maxPendingKeys) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  pending_.emplace(event.key,
+                   Pending{{event.key, event.message, event.message.value(),
+                            1, event.time, event.time},
+                           event.time + options_.coalesceWindow,
+                           false});
+}
+
+void NotificationDispatcher::deliverReady(
+    std::chrono::steady_clock::time_point now, bool force) {
+  due_.clear();
+  for (const auto &[key, pending] : pending_) {
+    if (force || pending.windowEnd <= now) {
+      due_.emplace_back(pending.windowEnd, key);
+    }
+  }
+  // Oldest windows first, so the rate limit serves keys in arrival order.
+  std::sort(due_.begin(), due_.end());
+
+  ready_.clear();
+  for (const auto &[windowEnd, key] : due_) {
+    const auto found = pending_.find(key);
+    if (!force && !bucket_.tryAcquire(now)) {
+      if (!found->second.throttled) {
+        found->second.throttled = true;
+        throttled_.fetch_add(1, std::memory_order_relaxed);
+      }
+      continue;
+    }
+    ready_.push_back(found->second.notification);
+    pending_.erase(found);
+  }
+  if (ready_.empty()) {
+    return;
+  }
+
+  MY_CODE_TRACE_SPAN_ITEMS("NotificationDispatcher::deliver", ready_.size());
+  for (const NotificationSink &sink : options_.sinks) {
+    try {
+      sink(ready_);
+    } catch (...) {
+      sinkErrors_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  delivered_.fetch_add(ready_.size(), std::memory_order_relaxed);
+}
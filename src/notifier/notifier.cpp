@@ -1,13 +1,244 @@
 #include "notifier.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <stdexcept>
 #include <string> // Include for std::string and std::to_string
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NOTIFIER_HAS_X86_KERNELS 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define NOTIFIER_HAS_NEON_KERNELS 1
+#endif
+
+#ifdef MY_CODE_METRICS
+namespace {
+
+struct NotifierMetrics {
+  Counter &checks;
+  Counter &hits;
+};
+
+auto notifierMetrics() -> NotifierMetrics & {
+  static NotifierMetrics metrics{
+      MetricsRegistry::global().counter("my_code_notifier_checks",
+                                        "Values compared to a threshold"),
+      MetricsRegistry::global().counter("my_code_notifier_hits",
+                                        "Values that exceeded a threshold")};
+  return metrics;
+}
+
+} // namespace
+#endif
+
 auto Notifier::shouldNotify(int value) const -> bool {
-  return value > threshold_;
+  const bool exceeded = value > threshold_;
+  MY_CODE_METRICS_ONLY(NotifierMetrics &metrics = notifierMetrics();
+                       metrics.checks.add();
+                       metrics.hits.add(exceeded ? 1 : 0);)
+  return exceeded;
 }
 
 auto Notifier::notifyMessage(int value) const -> std::string {
-  if (shouldNotify(value)) {
-    return "Threshold exceeded! Value: " + std::to_string(value);
+  return message(value).str();
+}
+
+auto NotifyMessage::render(std::span<char> buffer) const -> std::string_view {
+  if (!exceeded_) {
+    return kWithinThreshold;
+  }
+  if (buffer.size() < kMaxLength) {
+    throw std::invalid_argument("NotifyMessage: buffer is too small");
+  }
+  std::copy(kExceededPrefix.begin(), kExceededPrefix.end(), buffer.begin());
+  char *const digits = buffer.data() + kExceededPrefix.size();
+  const auto [end, ec] =
+      std::to_chars(digits, buffer.data() + buffer.size(), value_);
+  static_cast<void>(ec);
+  return {buffer.data(), static_cast<std::size_t>(end - buffer.data())};
+}
+
+auto NotifyMessage::str() const -> std::string {
+  std::array<char, kMaxLength> buffer{};
+  return std::string(render(buffer));
+}
+
+namespace {
+
+constexpr std::size_t kWordBits = 64;
+
+// Builds one mask word from up to 64 values.
+using MaskKernel = auto (*)(const int *, std::size_t, int) -> std::uint64_t;
+
+auto scalarMask(const int *values, std::size_t count, int threshold)
+    -> std::uint64_t {
+  std::uint64_t word = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    word |= static_cast<std::uint64_t>(values[i] > threshold) << i;
+  }
+  return word;
+}
+
+#ifdef NOTIFIER_HAS_X86_KERNELS
+// SSE2 is part of the x86-64 baseline, so this needs no runtime check.
+auto sse2Mask(const int *values, std::size_t count, int threshold)
+    -> std::uint64_t {
+  const __m128i limit = _mm_set1_epi32(threshold);
+  std::uint64_t word = 0;
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+    const auto bits = static_cast<unsigned>(
+        _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, limit))));
+    word |= static_cast<std::uint64_t>(bits) << i;
+  }
+  return word | (scalarMask(values + i, count - i, threshold) << i);
+}
+
+__attribute__((target("avx2"))) auto avx2Mask(const int *values,
+                                              std::size_t count,
+                                              int threshold) -> std::uint64_t {
+  const __m256i limit = _mm256_set1_epi32(threshold);
+  std::uint64_t word = 0;
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+    const auto bits = static_cast<unsigned>(_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(v, limit))));
+    word |= static_cast<std::uint64_t>(bits) << i;
+  }
+  return word | (scalarMask(values + i, count - i, threshold) << i);
+}
+#endif
+
+#ifdef NOTIFIER_HAS_NEON_KERNELS
+auto neonMask(const int *values, std::size_t count, int threshold)
+    -> std::uint64_t {
+  const int32x4_t limit = vdupq_n_s32(threshold);
+  const uint32x4_t lanes = {1, 2, 4, 8};
+  std::uint64_t word = 0;
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const uint32x4_t gt = vcgtq_s32(vld1q_s32(values + i), limit);
+    word |= static_cast<std::uint64_t>(vaddvq_u32(vandq_u32(gt, lanes))) << i;
   }
-  return "Value within threshold.";
+  return word | (scalarMask(values + i, count - i, threshold) << i);
+}
+#endif
+
+auto selectMaskKernel() -> MaskKernel {
+#ifdef NOTIFIER_HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return &avx2Mask;
+  }
+  return &sse2Mask;
+#elif defined(NOTIFIER_HAS_NEON_KERNELS)
+  return &neonMask;
+#else
+  return &scalarMask;
+#endif
+}
+
+auto maskKernel() -> MaskKernel {
+  static const MaskKernel kernel = selectMaskKernel();
+  return kernel;
+}
+
+} // namespace
+
+auto Notifier::shouldNotify(std::span<const int> values,
+                            std::span<std::uint64_t> mask) const
+    -> std::size_t {
+  const std::size_t words = maskWords(values.size());
+  if (mask.size() < words) {
+    throw std::invalid_argument("Notifier: mask span is too small");
+  }
+  MY_CODE_TRACE_SPAN_ITEMS("Notifier::shouldNotify", values.size());
+  const MaskKernel kernel = maskKernel();
+  std::size_t hits = 0;
+  for (std::size_t w = 0; w < words; ++w) {
+    const std::size_t begin = w * kWordBits;
+    const std::size_t count = std::min(kWordBits, values.size() - begin);
+    mask[w] = kernel(values.data() + begin, count, threshold_);
+    hits += static_cast<std::size_t>(std::popcount(mask[w]));
+  }
+  MY_CODE_METRICS_ONLY(NotifierMetrics &metrics = notifierMetrics();
+                       metrics.checks.add(values.size());
+                       metrics.hits.add(hits);)
+  return hits;
+}
+
+auto Notifier::shouldNotify(const ParallelOptions &options,
+                            std::span<const int> values,
+                            std::span<std::uint64_t> mask) const
+    -> std::size_t {
+  if (mask.size() < maskWords(values.size())) {
+    throw std::invalid_argument("Notifier: mask span is too small");
+  }
+  std::atomic<std::size_t> hits{0};
+  Scheduler::forEachChunk(
+      options, values.size(), [&](std::size_t begin, std::size_t end) {
+        hits.fetch_add(shouldNotify(values.subspan(begin, end - begin),
+                                    mask.subspan(begin / kWordBits)),
+                       std::memory_order_relaxed);
+      });
+  return hits.load(std::memory_order_relaxed);
+}
+
+auto Notifier::shouldNotify(std::span<const int> values) const
+    -> std::vector<std::uint64_t> {
+  std::vector<std::uint64_t> mask(maskWords(values.size()));
+  shouldNotify(values, mask);
+  return mask;
+}
+
+auto Notifier::shouldNotify(std::span<const int> values,
+                            std::pmr::memory_resource *resource) const
+    -> std::pmr::vector<std::uint64_t> {
+  std::pmr::vector<std::uint64_t> mask(maskWords(values.size()), resource);
+  shouldNotify(values, mask);
+  return mask;
+}
+
+namespace {
+
+// Appends the index of every set bit of mask to indices, in order.
+template <class Indices>
+void appendSetBits(std::span<const std::uint64_t> mask, std::size_t hits,
+                   Indices &indices) {
+  indices.reserve(hits);
+  for (std::size_t w = 0; w < mask.size(); ++w) {
+    for (std::uint64_t word = mask[w]; word != 0; word &= word - 1) {
+      indices.push_back(w * kWordBits +
+                        static_cast<std::size_t>(std::countr_zero(word)));
+    }
+  }
+}
+
+} // namespace
+
+auto Notifier::exceedingIndices(std::span<const int> values) const
+    -> std::vector<std::size_t> {
+  std::vector<std::uint64_t> mask(maskWords(values.size()));
+  std::vector<std::size_t> indices;
+  appendSetBits(mask, shouldNotify(values, mask), indices);
+  return indices;
+}
+
+auto Notifier::exceedingIndices(std::span<const int> values,
+                                std::pmr::memory_resource *resource) const
+    -> std::pmr::vector<std::size_t> {
+  std::pmr::vector<std::uint64_t> mask(maskWords(values.size()), resource);
+  std::pmr::vector<std::size_t> indices(resource);
+  appendSetBits(mask, shouldNotify(values, mask), indices);
+  return indices;
 }
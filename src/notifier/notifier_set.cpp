@@ -0,0 +1,168 @@
+#include "notifier_set.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+NotifierSet::EytzingerKeys::EytzingerKeys(std::span<const int> sorted)
+    : keys_(sorted.size() + 1), ranks_(sorted.size() + 1) {
+  // An in-order walk of the implicit tree visits the slots in sorted order.
+  std::size_t next = 0;
+  const std::size_t n = sorted.size();
+  std::vector<std::size_t> stack;
+  std::size_t k = 1;
+  while (k <= n || !stack.empty()) {
+    while (k <= n) {
+      stack.push_back(k);
+      k *= 2;
+    }
+    k = stack.back();
+    stack.pop_back();
+    keys_[k] = sorted[next];
+    ranks_[k] = static_cast<std::uint32_t>(next++);
+    k = 2 * k + 1;
+  }
+}
+
+auto NotifierSet::EytzingerKeys::rank(int value) const -> std::size_t {
+  const std::size_t n = keys_.size() - 1;
+  std::size_t k = 1;
+  while (k <= n) {
+    k = 2 * k + static_cast<std::size_t>(keys_[k] <= value);
+  }
+  // Undo the trailing right turns: k becomes the first key > value.
+  k >>= static_cast<unsigned>(std::countr_one(k)) + 1U;
+  return k == 0 ? n : ranks_[k];
+}
+
+NotifierSet::NotifierSet(std::span<const NotifierRule> rules)
+    : ruleCount_(rules.size()) {
+  if (rules.size() > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::invalid_argument("NotifierSet: too many rules");
+  }
+
+  std::vector<std::uint32_t> ranges;
+  std::vector<int> boundaries;
+  for (std::size_t id = 0; id < rules.size(); ++id) {
+    const NotifierRule &rule = rules[id];
+    if (rule.low > rule.high) {
+      continue; // can never fire
+    }
+    if (rule.high == std::numeric_limits<int>::max()) {
+      thresholdIds_.push_back(static_cast<std::uint32_t>(id));
+    } else {
+      ranges.push_back(static_cast<std::uint32_t>(id));
+      boundaries.push_back(rule.low);
+      boundaries.push_back(rule.high + 1);
+    }
+  }
+
+  std::stable_sort(thresholdIds_.begin(), thresholdIds_.end(),
+                   [rules](std::uint32_t lhs, std::uint32_t rhs) {
+                     return rules[lhs].low < rules[rhs].low;
+                   });
+  std::vector<int> lows(thresholdIds_.size());
+  std::transform(thresholdIds_.begin(), thresholdIds_.end(), lows.begin(),
+                 [rules](std::uint32_t id) { return rules[id].low; });
+  thresholdKeys_ = EytzingerKeys(lows);
+
+  std::sort(boundaries.begin(), boundaries.end());
+  boundaries.erase(std::unique(boundaries.begin(), boundaries.end()),
+                   boundaries.end());
+  boundaryKeys_ = EytzingerKeys(boundaries);
+
+  // Segment s is [boundaries[s - 1], boundaries[s]); a range [low, high]
+  // covers segments rank(low) .. rank(high + 1) - 1.
+  const auto rankOf = [&boundaries](int key) {
+    return static_cast<std::size_t>(
+               std::lower_bound(boundaries.begin(), boundaries.end(), key) -
+               boundaries.begin()) +
+           1;
+  };
+  const std::size_t segments = boundaries.size() + 1;
+  std::vector<std::uint32_t> counts(segments, 0);
+  for (const std::uint32_t id : ranges) {
+    const std::size_t last = rankOf(rules[id].high + 1);
+    for (std::size_t s = rankOf(rules[id].low); s < last; ++s) {
+      ++counts[s];
+    }
+  }
+  segmentOffsets_.assign(segments + 1, 0);
+  std::partial_sum(counts.begin(), counts.end(), segmentOffsets_.begin() + 1);
+  rangeIds_.resize(segmentOffsets_.back());
+  std::vector<std::uint32_t> fill(segmentOffsets_.begin(),
+                                  segmentOffsets_.end() - 1);
+  for (const std::uint32_t id : ranges) {
+    const std::size_t last = rankOf(rules[id].high + 1);
+    for (std::size_t s = rankOf(rules[id].low); s < last; ++s) {
+      rangeIds_[fill[s]++] = id;
+    }
+  }
+}
+
+auto NotifierSet::locate(int value) const -> Located {
+  return {thresholdKeys_.rank(value), boundaryKeys_.rank(value)};
+}
+
+auto NotifierSet::match(int value) const -> NotifierSetMatch {
+  const Located where = locate(value);
+  const std::span<const std::uint32_t> ranges(rangeIds_);
+  return {std::span<const std::uint32_t>(thresholdIds_)
+              .first(where.thresholds),
+          ranges.subspan(segmentOffsets_[where.segment],
+                         segmentOffsets_[where.segment + 1] -
+                             segmentOffsets_[where.segment])};
+}
+
+auto NotifierSet::matchCount(int value) const -> std::size_t {
+  const Located where = locate(value);
+  return where.thresholds + segmentOffsets_[where.segment + 1] -
+         segmentOffsets_[where.segment];
+}
+
+void NotifierSet::matchCounts(std::span<const int> values,
+                              std::span<std::uint32_t> counts) const {
+  if (counts.size() < values.size()) {
+    throw std::invalid_argument("NotifierSet: counts span is too small");
+  }
+  MY_CODE_TRACE_SPAN_ITEMS("NotifierSet::matchCounts", values.size());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    counts[i] = static_cast<std::uint32_t>(matchCount(values[i]));
+  }
+}
+
+void NotifierSet::matchCounts(const ParallelOptions &options,
+                              std::span<const int> values,
+                              std::span<std::uint32_t> counts) const {
+  if (counts.size() < values.size()) {
+    throw std::invalid_argument("NotifierSet: counts span is too small");
+  }
+  Scheduler::forEachChunk(
+      options, values.size(), [&](std::size_t begin, std::size_t end) {
+        matchCounts(values.subspan(begin, end - begin),
+                    counts.subspan(begin, end - begin));
+      });
+}
+
+auto NotifierSet::matchAll(std::span<const int> values) const
+    -> std::vector<NotifierSetMatch> {
+  std::vector<NotifierSetMatch> matches;
+  matches.reserve(values.size());
+  for (const int value : values) {
+    matches.push_back(match(value));
+  }
+  return matches;
+}
+
+auto NotifierSet::matchAll(std::span<const int> values,
+                           std::pmr::memory_resource *resource) const
+    -> std::pmr::vector<NotifierSetMatch> {
+  std::pmr::vector<NotifierSetMatch> matches(resource);
+  matches.reserve(values.size());
+  for (const int value : values) {
+    matches.push_back(match(value));
+  }
+  return matches;
+}
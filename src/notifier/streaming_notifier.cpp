@@ -0,0 +1,209 @@
+#include "streaming_notifier.hpp"
+#include "notifier.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr std::size_t kWordBits = 64;
+
+// Runs step over values in order and packs its results into mask words.
+template <typename Step>
+auto fillMask(const char *name, std::span<const int> values,
+              std::span<std::uint64_t> mask, Step step) -> std::size_t {
+  const std::size_t words = Notifier::maskWords(values.size());
+  if (mask.size() < words) {
+    throw std::invalid_argument(std::string(name) +
+                                ": mask span is too small");
+  }
+  std::size_t hits = 0;
+  for (std::size_t w = 0; w < words; ++w) {
+    const std::size_t begin = w * kWordBits;
+    const std::size_t count = std::min(kWordBits, values.size() - begin);
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      bits |= static_cast<std::uint64_t>(step(begin + i)) << i;
+    }
+    mask[w] = bits;
+    hits += static_cast<std::size_t>(std::popcount(bits));
+  }
+  return hits;
+}
+
+} // namespace
+
+HysteresisNotifier::HysteresisNotifier(int rise, int fall)
+    : rise_(rise), fall_(fall) {
+  if (fall > rise) {
+    throw std::invalid_argument(
+        "HysteresisNotifier: fall threshold is above rise threshold");
+  }
+}
+
+auto HysteresisNotifier::update(int value) -> bool {
+  if (active_) {
+    active_ = value > fall_;
+    return false;
+  }
+  active_ = value > rise_;
+  return active_;
+}
+
+auto HysteresisNotifier::update(std::span<const int> values,
+                                std::span<std::uint64_t> mask)
+    -> std::size_t {
+  MY_CODE_TRACE_SPAN_ITEMS("HysteresisNotifier::update", values.size());
+  return fillMask("HysteresisNotifier", values, mask,
+                  [&](std::size_t i) { return update(values[i]); });
+}
+
+SlidingWindow::SlidingWindow(std::size_t samples, Clock::duration maxAge)
+    : maxAge_(maxAge), values_(samples), maxQueue_(samples) {
+  if (samples == 0) {
+    throw std::invalid_argument("SlidingWindow: samples must be non-zero");
+  }
+  if (maxAge_ < Clock::duration::zero()) {
+    throw std::invalid_argument("SlidingWindow: maxAge is negative");
+  }
+  if (maxAge_ > Clock::duration::zero()) {
+    times_.resize(samples);
+  }
+}
+
+void SlidingWindow::evictOldest() {
+  sum_ -= values_[oldest_];
+  if (maxQueue_[maxHead_] == oldest_) {
+    maxHead_ = next(maxHead_);
+    --maxCount_;
+  }
+  oldest_ = next(oldest_);
+  --size_;
+}
+
+void SlidingWindow::expire(Clock::time_point now) {
+  if (times_.empty()) {
+    return;
+  }
+  while (size_ > 0 && times_[oldest_] <= now - maxAge_) {
+    evictOldest();
+  }
+}
+
+void SlidingWindow::push(int value, Clock::time_point now) {
+  expire(now);
+  if (size_ == values_.size()) {
+    evictOldest();
+  }
+  std::size_t slot = oldest_ + size_;
+  if (slot >= values_.size()) {
+    slot -= values_.size();
+  }
+  values_[slot] = value;
+  if (!times_.empty()) {
+    times_[slot] = now;
+  }
+  ++size_;
+  sum_ += value;
+
+  // Samples no larger than value can never be the max again.
+  while (maxCount_ > 0) {
+    std::size_t back = maxHead_ + maxCount_ - 1;
+    if (back >= maxQueue_.size()) {
+      back -= maxQueue_.size();
+    }
+    if (values_[maxQueue_[back]] > value) {
+      break;
+    }
+    --maxCount_;
+  }
+  std::size_t tail = maxHead_ + maxCount_;
+  if (tail >= maxQueue_.size()) {
+    tail -= maxQueue_.size();
+  }
+  maxQueue_[tail] = slot;
+  ++maxCount_;
+}
+
+void SlidingWindow::clear() {
+  oldest_ = 0;
+  size_ = 0;
+  sum_ = 0;
+  maxHead_ = 0;
+  maxCount_ = 0;
+}
+
+auto SlidingWindow::mean() const -> double {
+  if (size_ == 0) {
+    throw std::logic_error("SlidingWindow: window is empty");
+  }
+  return static_cast<double>(sum_) / static_cast<double>(size_);
+}
+
+auto SlidingWindow::max() const -> int {
+  if (size_ == 0) {
+    throw std::logic_error("SlidingWindow: window is empty");
+  }
+  return values_[maxQueue_[maxHead_]];
+}
+
+WindowNotifier::WindowNotifier(int threshold, WindowStatistic statistic,
+                               std::size_t samples, Clock::duration maxAge)
+    : threshold_(threshold), statistic_(statistic), window_(samples, maxAge) {}
+
+auto WindowNotifier::exceeded() const -> bool {
+  if (statistic_ == WindowStatistic::Max) {
+    return window_.max() > threshold_;
+  }
+  // mean > threshold without rounding: sum > threshold * size.
+  return window_.sum() > static_cast<std::int64_t>(threshold_) *
+                             static_cast<std::int64_t>(window_.size());
+}
+
+auto WindowNotifier::update(int value, Clock::time_point now) -> bool {
+  window_.push(value, now);
+  return exceeded();
+}
+
+auto WindowNotifier::update(std::span<const int> values,
+                            std::span<std::uint64_t> mask) -> std::size_t {
+  MY_CODE_TRACE_SPAN_ITEMS("WindowNotifier::update", values.size());
+  return fillMask("WindowNotifier", values, mask,
+                  [&](std::size_t i) { return update(values[i]); });
+}
+
+auto WindowNotifier::update(std::span<const int> values,
+                            std::span<const Clock::time_point> times,
+                            std::span<std::uint64_t> mask) -> std::size_t {
+  if (times.size() != values.size()) {
+    throw std::invalid_argument(
+        "WindowNotifier: values and times differ in size");
+  }
+  MY_CODE_TRACE_SPAN_ITEMS("WindowNotifier::update", values.size());
+  return fillMask("WindowNotifier", values, mask, [&](std::size_t i) {
+    return update(values[i], times[i]);
+  });
+}
+
+EwmaNotifier::EwmaNotifier(int threshold, double alpha)
+    : threshold_(threshold), alpha_(alpha) {
+  if (!(alpha > 0 && alpha <= 1)) {
+    throw std::invalid_argument("EwmaNotifier: alpha must be in (0, 1]");
+  }
+}
+
+auto EwmaNotifier::update(int value) -> bool {
+  const auto sample = static_cast<double>(value);
+  average_ = primed_ ? average_ + alpha_ * (sample - average_) : sample;
+  primed_ = true;
+  return average_ > threshold_;
+}
+
+auto EwmaNotifier::update(std::span<const int> values,
+                          std::span<std::uint64_t> mask) -> std::size_t {
+  MY_CODE_TRACE_SPAN_ITEMS("EwmaNotifier::update", values.size());
+  return fillMask("EwmaNotifier", values, mask,
+                  [&](std::size_t i) { return update(values[i]); });
+}
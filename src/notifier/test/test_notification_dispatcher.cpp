@@ -0,0 +1,240 @@
+#include "notification_dispatcher.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// Collects delivered notifications; the sink runs on the dispatcher thread.
+struct Collector {
+  std::mutex mutex;
+  std::condition_variable delivered;
+  std::vector<Notification> notifications;
+  std::vector<std::size_t> batchSizes;
+
+  auto sink() -> NotificationSink {
+    return [this](std::span<const Notification> batch) {
+      const std::lock_guard guard(mutex);
+      notifications.insert(notifications.end(), batch.begin(), batch.end());
+      batchSizes.push_back(batch.size());
+      delivered.notify_all();
+    };
+  }
+  auto waitFor(std::size_t count) -> bool {
+    std::unique_lock lock(mutex);
+    return delivered.wait_for(lock, 5s, [&] {
+      return notifications.size() >= count;
+    });
+  }
+  auto size() -> std::size_t {
+    const std::lock_guard guard(mutex);
+    return notifications.size();
+  }
+};
+
+} // namespace
+
+TEST(NotificationDispatcherTests, TestTokenBucketRefills) {
+  const auto start = TokenBucket::Clock::time_point{};
+  TokenBucket bucket(2.0, 3.0, start);
+  EXPECT_TRUE(bucket.tryAcquire(start));
+  EXPECT_TRUE(bucket.tryAcquire(start));
+  EXPECT_TRUE(bucket.tryAcquire(start));
+  EXPECT_FALSE(bucket.tryAcquire(start));
+  // Two tokens per second: one is back after half a second.
+  EXPECT_FALSE(bucket.tryAcquire(start + 400ms));
+  EXPECT_TRUE(bucket.tryAcquire(start + 500ms));
+  // Refills stop at the burst size.
+  EXPECT_DOUBLE_EQ(bucket.available(start + 1h), 3.0);
+
+  TokenBucket unlimited(0.0, 0.0, start);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(unlimited.tryAcquire(start));
+  }
+  EXPECT_THROW(TokenBucket(1.0, 0.5), std::invalid_argument);
+  EXPECT_THROW(TokenBucket(-1.0, 1.0), std::invalid_argument);
+}
+
+TEST(NotificationDispatcherTests, TestCoalescesRepeatsPerKey) {
+  Collector collector;
+  NotificationDispatcher dispatcher(
+      {.sinks = {collector.sink()}, .coalesceWindow = 1h});
+  for (int value = 11; value <= 15; ++value) {
+    EXPECT_TRUE(dispatcher.publish(7, NotifyMessage(true, value)));
+  }
+  EXPECT_TRUE(dispatcher.publish(7, NotifyMessage(true, 12)));
+  EXPECT_TRUE(dispatcher.publish(9, NotifyMessage(true, 100)));
+  // Windows are still open, so nothing is delivered before the flush.
+  std::this_thread::sleep_for(30ms);
+  EXPECT_EQ(collector.size(), 0u);
+  dispatcher.flush();
+
+  ASSERT_EQ(collector.size(), 2u);
+  const Notification &first = collector.notifications[0];
+  EXPECT_EQ(first.key, 7u);
+  EXPECT_EQ(first.count, 6u);
+  EXPECT_EQ(first.peak, 15);
+  EXPECT_EQ(first.message.value(), 12);
+  EXPECT_LE(first.first, first.last);
+  EXPECT_EQ(collector.notifications[1].format(),
+            "[9] Threshold exceeded! Value: 100");
+  EXPECT_EQ(first.format(), "[7] Threshold exceeded! Value: 12 (x6)");
+
+  const DispatcherStats stats = dispatcher.stats();
+  EXPECT_EQ(stats.published, 7u);
+  EXPECT_EQ(stats.coalesced, 5u);
+  EXPECT_EQ(stats.delivered, 2u);
+}
+
+TEST(NotificationDispatcherTests, TestDeliversWhenWindowCloses) {
+  Collector collector;
+  NotificationDispatcher dispatcher({.sinks = {collector.sink()},
+                                     .coalesceWindow = 20ms,
+                                     .pollInterval = 1ms});
+  dispatcher.publish(1, NotifyMessage(true, 50));
+  ASSERT_TRUE(collector.waitFor(1));
+  dispatcher.publish(1, NotifyMessage(true, 60));
+  ASSERT_TRUE(collector.waitFor(2));
+  EXPECT_EQ(collector.notifications[1].count, 1u);
+  EXPECT_EQ(collector.notifications[1].peak, 60);
+}
+
+// A flush() that loses the race with close() returns instead of waiting for
+// a pass the exiting thread will never make.
+TEST(NotificationDispatcherTests, TestFlushRacingCloseReturns) {
+  for (int round = 0; round < 200; ++round) {
+    Collector collector;
+    NotificationDispatcher dispatcher(
+        {.sinks = {collector.sink()}, .pollInterval = 1ms});
+    dispatcher.publish(1, NotifyMessage(true, round));
+    std::atomic<bool> closed{false};
+    std::thread flusher([&] {
+      while (!closed.load(std::memory_order_acquire)) {
+        dispatcher.flush();
+      }
+    });
+    dispatcher.close();
+    closed.store(true, std::memory_order_release);
+    flusher.join();
+    EXPECT_EQ(collector.size(), 1u);
+  }
+}
+
+TEST(NotificationDispatcherTests, TestRateLimitHoldsNotifications) {
+  Collector collector;
+  // One token every 100 seconds: only the burst gets through in the test.
+  NotificationDispatcher dispatcher({.sinks = {collector.sink()},
+                                     .coalesceWindow = 0ms,
+                                     .ratePerSecond = 0.01,
+                                     .burst = 2,
+                                     .pollInterval = 1ms});
+  for (std::uint64_t key = 0; key < 5; ++key) {
+    dispatcher.publish(key, NotifyMessage(true, 20));
+  }
+  ASSERT_TRUE(collector.waitFor(2));
+  // Throttled keys keep absorbing repeats.
+  dispatcher.publish(4, NotifyMessage(true, 30));
+  std::this_thread::sleep_for(30ms);
+  EXPECT_EQ(collector.size(), 2u);
+  EXPECT_EQ(dispatcher.stats().throttled, 3u);
+
+  // flush() bypasses the limit.
+  dispatcher.flush();
+  ASSERT_EQ(collector.size(), 5u);
+  EXPECT_EQ(collector.notifications[4].key, 4u);
+  EXPECT_EQ(collector.notifications[4].count, 2u);
+  EXPECT_EQ(collector.notifications[4].peak, 30);
+}
+
+TEST(NotificationDispatcherTests, TestFullQueueAppliesBackpressure) {
+  std::mutex gate;
+  std::unique_lock closed(gate);
+  std::atomic<bool> entered{false};
+  Collector collector;
+  NotificationSink collect = collector.sink();
+  // The sink stalls until the gate opens, so the queue fills up behind it.
+  NotificationDispatcher dropping(
+      {.sinks = {[&](std::span<const Notification> batch) {
+         entered = true;
+         const std::lock_guard wait(gate);
+         collect(batch);
+       }},
+       .queueCapacity = 4,
+       .coalesceWindow = 0ms,
+       .pollInterval = 1ms});
+  ASSERT_TRUE(dropping.publish(0, NotifyMessage(true, 1)));
+  while (!entered) {
+    std::this_thread::sleep_for(1ms);
+  }
+  std::size_t accepted = 0;
+  for (std::uint64_t key = 10; key < 20; ++key) {
+    accepted += dropping.publish(key, NotifyMessage(true, 1)) ? 1 : 0;
+  }
+  EXPECT_EQ(accepted, 4u);
+  EXPECT_EQ(dropping.stats().dropped, 6u);
+  closed.unlock();
+  dropping.flush();
+  EXPECT_EQ(collector.size(), 5u);
+
+  // Block makes the publisher wait for room instead.
+  Collector blocked;
+  NotificationDispatcher blocking({.sinks = {blocked.sink()},
+                                   .queueCapacity = 2,
+                                   .policy = BackpressurePolicy::Block,
+                                   .coalesceWindow = 0ms,
+                                   .pollInterval = 1ms});
+  std::thread producer([&blocking] {
+    for (std::uint64_t key = 0; key < 50; ++key) {
+      blocking.publish(key, NotifyMessage(true, 1));
+    }
+  });
+  producer.join();
+  blocking.flush();
+  EXPECT_EQ(blocked.size(), 50u);
+  EXPECT_EQ(blocking.stats().dropped, 0u);
+}
+
+TEST(NotificationDispatcherTests, TestPublishesMaskAndWritesToFd) {
+  int pipeFds[2];
+  ASSERT_EQ(::pipe(pipeFds), 0);
+  {
+    NotificationDispatcher dispatcher(
+        {.sinks = {fdNotificationSink(pipeFds[1]),
+                   [](std::span<const Notification>) {
+                     throw std::runtime_error("sink failed");
+                   }},
+         .coalesceWindow = 1h});
+    const Notifier notifier(10);
+    const std::vector<int> values{5, 11, 3, 42};
+    const std::vector<std::uint64_t> mask = notifier.shouldNotify(values);
+    // Distinct keys per value so nothing is merged.
+    EXPECT_EQ(dispatcher.publish(1, std::span(values).first(2),
+                                 std::span(mask)),
+              1u);
+    EXPECT_EQ(dispatcher.publish(2, values, mask), 2u);
+    dispatcher.close();
+    EXPECT_EQ(dispatcher.stats().sinkErrors, 1u);
+    EXPECT_FALSE(dispatcher.publish(3, NotifyMessage(true, 1)));
+    EXPECT_THROW(dispatcher.publish(4, values, {}), std::invalid_argument);
+  }
+  ::close(pipeFds[1]);
+  std::string output;
+  char buffer[256];
+  ssize_t got = 0;
+  while ((got = ::read(pipeFds[0], buffer, sizeof(buffer))) > 0) {
+    output.append(buffer, static_cast<std::size_t>(got));
+  }
+  ::close(pipeFds[0]);
+  EXPECT_EQ(output, "[1] Threshold exceeded! Value: 11\n"
+                    "[2] Threshold exceeded! Value: 42 (x2)\n");
+}
@@ -1,5 +1,12 @@
 #include "notifier.hpp"
+#include "memory_resource.hpp"
 #include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
 
 TEST(NotifierTests, TestThresholdNotExceeded) {
   Notifier notifier(10);
@@ -12,3 +19,90 @@ TEST(NotifierTests, TestThresholdExceeded) {
   EXPECT_TRUE(notifier.shouldNotify(15));
   EXPECT_EQ(notifier.notifyMessage(15), "Threshold exceeded! Value: 15");
 }
+
+TEST(NotifierTests, TestBatchMaskMatchesScalar) {
+  Notifier notifier(10);
+  // 70 values span a full mask word plus a partial one.
+  std::vector<int> values(70);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<int>(i % 23) - 2;
+  }
+
+  const auto mask = notifier.shouldNotify(values);
+  ASSERT_EQ(mask.size(), Notifier::maskWords(values.size()));
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    const bool bit = ((mask[i / 64] >> (i % 64)) & 1U) != 0;
+    EXPECT_EQ(bit, notifier.shouldNotify(values[i])) << "index " << i;
+  }
+}
+
+TEST(NotifierTests, TestExceedingIndices) {
+  Notifier notifier(10);
+  const std::vector<int> values{11, 10, -5, 42, 9, 10, 11};
+  EXPECT_EQ(notifier.exceedingIndices(values),
+            (std::vector<std::size_t>{0, 3, 6}));
+
+  std::vector<std::uint64_t> mask(1);
+  EXPECT_EQ(notifier.shouldNotify(values, mask), 3u);
+  EXPECT_EQ(mask[0], 0b1001001U);
+
+  std::vector<std::uint64_t> tooSmall;
+  EXPECT_THROW(static_cast<void>(notifier.shouldNotify(values, tooSmall)),
+               std::invalid_argument);
+}
+
+TEST(NotifierTests, TestBatchResultsFromMemoryResource) {
+  Notifier notifier(10);
+  const std::vector<int> values{11, 10, -5, 42, 9, 10, 11};
+  MonotonicArena arena;
+  const auto mask = notifier.shouldNotify(values, &arena);
+  EXPECT_EQ(mask.get_allocator().resource(), &arena);
+  EXPECT_EQ(mask[0], 0b1001001U);
+  const auto indices = notifier.exceedingIndices(values, &arena);
+  EXPECT_EQ(indices.get_allocator().resource(), &arena);
+  EXPECT_EQ(std::vector<std::size_t>(indices.begin(), indices.end()),
+            notifier.exceedingIndices(values));
+  EXPECT_GE(arena.bytesAllocated(), 3 * sizeof(std::size_t));
+}
+
+TEST(NotifierTests, TestMessageRendersIntoBuffer) {
+  Notifier notifier(10);
+  std::array<char, NotifyMessage::kMaxLength> buffer{};
+
+  const NotifyMessage within = notifier.message(5);
+  EXPECT_FALSE(within.exceeded());
+  const std::string_view text = within.render(buffer);
+  EXPECT_EQ(text, "Value within threshold.");
+  // The static message is returned as-is; the buffer is left untouched.
+  EXPECT_NE(text.data(), buffer.data());
+  EXPECT_EQ(buffer[0], '\0');
+
+  const Notifier lowest(std::numeric_limits<int>::min());
+  const int value = std::numeric_limits<int>::min() + 1;
+  EXPECT_EQ(lowest.message(value).render(buffer),
+            "Threshold exceeded! Value: -2147483647");
+  EXPECT_EQ(notifier.message(15).str(), notifier.notifyMessage(15));
+
+  std::array<char, 4> tiny{};
+  EXPECT_THROW(static_cast<void>(notifier.message(15).render(tiny)),
+               std::invalid_argument);
+}
+
+TEST(NotifierTests, TestParallelScreeningMatchesSequential) {
+  Scheduler scheduler(SchedulerOptions{.threads = 3});
+  const ParallelOptions options{.grain = 1, .scheduler = &scheduler};
+  std::vector<int> values(5'000);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<int>((i * 7919) % 200) - 100;
+  }
+  const Notifier notifier(42);
+  std::vector<std::uint64_t> sequential(Notifier::maskWords(values.size()));
+  std::vector<std::uint64_t> parallel(sequential.size());
+  EXPECT_EQ(notifier.shouldNotify(options, values, parallel),
+            notifier.shouldNotify(values, sequential));
+  EXPECT_EQ(parallel, sequential);
+
+  std::vector<std::uint64_t> tooSmall(1);
+  EXPECT_THROW(notifier.shouldNotify(options, values, tooSmall),
+               std::invalid_argument);
+}
@@ -0,0 +1,102 @@
+#include "notifier.hpp"
+#include "notifier_set.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+auto bruteForce(const std::vector<NotifierRule> &rules, int value)
+    -> std::vector<std::uint32_t> {
+  std::vector<std::uint32_t> ids;
+  for (std::size_t id = 0; id < rules.size(); ++id) {
+    if (rules[id].low <= value && value <= rules[id].high) {
+      ids.push_back(static_cast<std::uint32_t>(id));
+    }
+  }
+  return ids;
+}
+
+auto sortedIds(const NotifierSetMatch &match) -> std::vector<std::uint32_t> {
+  std::vector<std::uint32_t> ids(match.thresholds.begin(),
+                                 match.thresholds.end());
+  ids.insert(ids.end(), match.ranges.begin(), match.ranges.end());
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+} // namespace
+
+TEST(NotifierSetTests, TestThresholdsAgreeWithNotifier) {
+  const std::vector<int> thresholds{10, -5, 100, 10, 42};
+  std::vector<NotifierRule> rules;
+  for (const int threshold : thresholds) {
+    rules.push_back(NotifierRule::above(threshold));
+  }
+  const NotifierSet set(rules);
+
+  for (int value = -10; value <= 110; ++value) {
+    std::size_t expected = 0;
+    for (const int threshold : thresholds) {
+      expected += Notifier(threshold).shouldNotify(value) ? 1 : 0;
+    }
+    EXPECT_EQ(set.matchCount(value), expected) << "value " << value;
+  }
+  // Matching thresholds come back lowest bound first.
+  const auto match = set.match(50);
+  EXPECT_EQ(std::vector<std::uint32_t>(match.thresholds.begin(),
+                                       match.thresholds.end()),
+            (std::vector<std::uint32_t>{1, 0, 3, 4}));
+}
+
+TEST(NotifierSetTests, TestMixedRulesMatchBruteForce) {
+  constexpr int kMax = std::numeric_limits<int>::max();
+  constexpr int kMin = std::numeric_limits<int>::min();
+  const std::vector<NotifierRule> rules{
+      NotifierRule::between(0, 10),   NotifierRule::above(5),
+      NotifierRule::between(5, 5),    NotifierRule::between(-20, 3),
+      NotifierRule::between(8, 30),   NotifierRule::between(kMin, -100),
+      NotifierRule::between(7, 2),    NotifierRule::above(kMax),
+      NotifierRule::between(kMin, kMax)};
+  const NotifierSet set(rules);
+  EXPECT_EQ(set.ruleCount(), rules.size());
+
+  std::vector<int> values{kMin, kMax, -101, -100, -99};
+  for (int value = -25; value <= 35; ++value) {
+    values.push_back(value);
+  }
+  const auto matches = set.matchAll(values);
+  std::vector<std::uint32_t> counts(values.size());
+  set.matchCounts(values, counts);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    const auto expected = bruteForce(rules, values[i]);
+    EXPECT_EQ(sortedIds(matches[i]), expected) << "value " << values[i];
+    EXPECT_EQ(counts[i], expected.size());
+  }
+}
+
+TEST(NotifierSetTests, TestEmptySet) {
+  const NotifierSet set(std::vector<NotifierRule>{});
+  EXPECT_TRUE(set.match(0).empty());
+  EXPECT_EQ(set.matchCount(std::numeric_limits<int>::max()), 0u);
+}
+
+TEST(NotifierSetTests, TestParallelMatchCounts) {
+  const std::vector<NotifierRule> rules{NotifierRule::above(10),
+                                        NotifierRule::between(-5, 5),
+                                        NotifierRule::between(0, 100)};
+  const NotifierSet set(rules);
+  std::vector<int> values(3'000);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<int>(i % 150) - 20;
+  }
+  Scheduler scheduler(SchedulerOptions{.threads = 2});
+  std::vector<std::uint32_t> sequential(values.size());
+  std::vector<std::uint32_t> parallel(values.size());
+  set.matchCounts(values, sequential);
+  set.matchCounts(ParallelOptions{.grain = 1, .scheduler = &scheduler}, values,
+                  parallel);
+  EXPECT_EQ(parallel, sequential);
+}
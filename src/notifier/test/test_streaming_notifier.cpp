@@ -0,0 +1,182 @@
+#include "streaming_notifier.hpp"
+#include "notifier.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+auto makeValues(std::size_t count) -> std::vector<int> {
+  std::vector<int> values(count);
+  std::uint32_t state = 99;
+  for (int &value : values) {
+    state = state * 1'664'525U + 1'013'904'223U;
+    value = static_cast<int>(state % 201) - 100;
+  }
+  return values;
+}
+
+auto maskBit(const std::vector<std::uint64_t> &mask, std::size_t i) -> bool {
+  return ((mask[i / 64] >> (i % 64)) & 1U) != 0;
+}
+
+} // namespace
+
+TEST(StreamingNotifierTests, TestHysteresisSuppressesFlapping) {
+  HysteresisNotifier notifier(10, 5);
+  // Hovering around the rise threshold alerts once.
+  const std::vector<int> values{9, 11, 9, 12, 10, 6, 5, 11, 4, 20};
+  std::vector<bool> alerts;
+  for (const int value : values) {
+    alerts.push_back(notifier.update(value));
+  }
+  EXPECT_EQ(alerts, (std::vector<bool>{false, true, false, false, false,
+                                       false, false, true, false, true}));
+  EXPECT_TRUE(notifier.active());
+  notifier.reset();
+  EXPECT_FALSE(notifier.active());
+
+  // With rise == fall it behaves like Notifier, reporting rising edges.
+  HysteresisNotifier edges(10, 10);
+  EXPECT_TRUE(edges.update(11));
+  EXPECT_FALSE(edges.update(12));
+  EXPECT_FALSE(edges.update(10));
+  EXPECT_TRUE(edges.update(11));
+  EXPECT_THROW(HysteresisNotifier(5, 10), std::invalid_argument);
+}
+
+TEST(StreamingNotifierTests, TestSlidingWindowTracksMeanAndMax) {
+  SlidingWindow window(3);
+  EXPECT_THROW(static_cast<void>(window.max()), std::logic_error);
+  window.push(5);
+  window.push(9);
+  window.push(1);
+  EXPECT_EQ(window.max(), 9);
+  EXPECT_EQ(window.sum(), 15);
+  window.push(2); // evicts 5
+  EXPECT_EQ(window.max(), 9);
+  window.push(3); // evicts 9
+  EXPECT_EQ(window.max(), 3);
+  EXPECT_DOUBLE_EQ(window.mean(), 2.0);
+  EXPECT_EQ(window.size(), 3u);
+
+  // Matches a brute-force window over a long run.
+  const auto values = makeValues(5000);
+  SlidingWindow longWindow(37);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    longWindow.push(values[i]);
+    const std::size_t begin = i + 1 >= 37 ? i + 1 - 37 : 0;
+    const auto first = values.begin() + static_cast<std::ptrdiff_t>(begin);
+    const auto last = values.begin() + static_cast<std::ptrdiff_t>(i + 1);
+    ASSERT_EQ(longWindow.max(), *std::max_element(first, last)) << i;
+    ASSERT_EQ(longWindow.sum(), std::accumulate(first, last, 0LL)) << i;
+  }
+  EXPECT_THROW(SlidingWindow(0), std::invalid_argument);
+}
+
+TEST(StreamingNotifierTests, TestSlidingWindowExpiresByAge) {
+  const auto start = SlidingWindow::Clock::time_point{} + 1h;
+  SlidingWindow window(100, 10s);
+  window.push(50, start);
+  window.push(20, start + 4s);
+  window.push(30, start + 8s);
+  EXPECT_EQ(window.max(), 50);
+  // The first sample is exactly maxAge old and drops out.
+  window.push(10, start + 10s);
+  EXPECT_EQ(window.size(), 3u);
+  EXPECT_EQ(window.max(), 30);
+  window.expire(start + 30s);
+  EXPECT_TRUE(window.empty());
+
+  // The sample bound still applies.
+  SlidingWindow both(2, 1h);
+  both.push(1, start);
+  both.push(2, start);
+  both.push(3, start);
+  EXPECT_EQ(both.sum(), 5);
+}
+
+TEST(StreamingNotifierTests, TestWindowNotifierSmoothsSpikes) {
+  // A single spike moves the mean of four samples by a quarter of its size.
+  WindowNotifier mean(10, WindowStatistic::Mean, 4);
+  EXPECT_FALSE(mean.update(8));
+  EXPECT_FALSE(mean.update(8));
+  EXPECT_FALSE(mean.update(14)); // mean 30 / 3 is not above 10
+  EXPECT_TRUE(mean.update(12));  // mean 42 / 4
+  EXPECT_FALSE(mean.update(4));  // 8 drops out: mean 38 / 4
+
+  WindowNotifier max(10, WindowStatistic::Max, 3);
+  EXPECT_TRUE(max.update(11));
+  EXPECT_TRUE(max.update(1));
+  EXPECT_TRUE(max.update(1));
+  EXPECT_FALSE(max.update(1));
+}
+
+TEST(StreamingNotifierTests, TestBatchUpdatesMatchSamples) {
+  const auto values = makeValues(1000 + 17);
+  std::vector<std::uint64_t> mask(Notifier::maskWords(values.size()));
+
+  HysteresisNotifier hysteresis(60, 0);
+  HysteresisNotifier hysteresisRef(60, 0);
+  std::size_t hits = hysteresis.update(values, mask);
+  std::size_t expected = 0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    const bool alert = hysteresisRef.update(values[i]);
+    expected += alert ? 1 : 0;
+    ASSERT_EQ(maskBit(mask, i), alert) << i;
+  }
+  EXPECT_EQ(hits, expected);
+  EXPECT_GT(hits, 0u);
+
+  WindowNotifier window(5, WindowStatistic::Mean, 16);
+  WindowNotifier windowRef(5, WindowStatistic::Mean, 16);
+  window.update(values, mask);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(maskBit(mask, i), windowRef.update(values[i])) << i;
+  }
+
+  const auto start = WindowNotifier::Clock::time_point{};
+  std::vector<WindowNotifier::Clock::time_point> times(values.size());
+  for (std::size_t i = 0; i < times.size(); ++i) {
+    times[i] = start + std::chrono::milliseconds(i * 7);
+  }
+  WindowNotifier timed(0, WindowStatistic::Max, 1000, 50ms);
+  WindowNotifier timedRef(0, WindowStatistic::Max, 1000, 50ms);
+  timed.update(values, times, mask);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(maskBit(mask, i), timedRef.update(values[i], times[i])) << i;
+  }
+  EXPECT_LE(timed.window().size(), 8u);
+
+  EwmaNotifier ewma(20, 0.125);
+  EwmaNotifier ewmaRef(20, 0.125);
+  ewma.update(values, mask);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(maskBit(mask, i), ewmaRef.update(values[i])) << i;
+  }
+  EXPECT_DOUBLE_EQ(ewma.average(), ewmaRef.average());
+
+  std::vector<std::uint64_t> small(1);
+  EXPECT_THROW(ewma.update(values, small), std::invalid_argument);
+  EXPECT_THROW(timed.update(values, std::span(times).first(3), mask),
+               std::invalid_argument);
+}
+
+TEST(StreamingNotifierTests, TestEwmaFollowsTrend) {
+  EwmaNotifier ewma(10, 0.5);
+  EXPECT_FALSE(ewma.primed());
+  EXPECT_TRUE(ewma.update(12)); // seeded with the first sample
+  EXPECT_FALSE(ewma.update(6)); // 9
+  EXPECT_DOUBLE_EQ(ewma.average(), 9.0);
+  EXPECT_TRUE(ewma.update(13)); // 11
+  ewma.reset();
+  EXPECT_FALSE(ewma.update(0));
+  EXPECT_THROW(EwmaNotifier(10, 0.0), std::invalid_argument);
+  EXPECT_THROW(EwmaNotifier(10, 1.5), std::invalid_argument);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "log_record.hpp"
+#include "logger.hpp"
+#include "notifier_set.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace state_snapshot {
+
+inline constexpr char kMagic[8] = {'M', 'C', 'S', 'T', 'A', 'T', 'E', '1'};
+inline constexpr std::uint32_t kVersion = 1;
+// Header, then the section table, then the sections, each starting on a
+// kSectionAlignment boundary.
+inline constexpr std::size_t kHeaderSize = 64;
+inline constexpr std::size_t kSectionEntrySize = 24;
+inline constexpr std::size_t kSectionAlignment = 64;
+
+} // namespace state_snapshot
+
+struct StateRestoreOptions {
+  // Asks the kernel to read the whole file ahead (MADV_WILLNEED) instead of
+  // paging it in as records are touched.
+  bool prefetch = false;
+};
+
+// Writes records (typically a Logger snapshot's), every label interned in
+// OperationTable::global() and rules into one file that StateSnapshot can
+// map. Records are stored as LogRecords with their text repacked into one
+// arena; interned records keep their OpIds. The file is written next to
+// path and renamed over it, so readers never see a partial snapshot.
+// Throws std::system_error on I/O failure and std::length_error if the
+// text does not fit 32-bit offsets.
+void writeStateSnapshot(
+    const std::filesystem::path &path, const LogRecordRange &records,
+    std::span<const NotifierRule> rules = {});
+
+// Read-only mapping of a state snapshot. Opening reads only the header and
+// the operation labels; records and rules are served straight from the
+// mapping, so pages are read from disk as they are first touched and the
+// open costs the same whatever the history size. Only the layout is
+// validated on open (std::runtime_error if it is damaged); verify() checks
+// every record.
+//
+// The saved labels are re-interned into OperationTable::global() in id
+// order. In a fresh process they get their saved ids back and records are
+// used as mapped; otherwise the records are rewritten into memory once,
+// which touches every page (remapped()).
+class StateSnapshot {
+public:
+  explicit StateSnapshot(const std::filesystem::path &path,
+                         StateRestoreOptions options = {});
+  ~StateSnapshot();
+  StateSnapshot(const StateSnapshot &) = delete;
+  auto operator=(const StateSnapshot &) -> StateSnapshot & = delete;
+  StateSnapshot(StateSnapshot &&) = delete;
+  auto operator=(StateSnapshot &&) -> StateSnapshot & = delete;
+
+  // The saved records, keeping their sequence numbers. Valid as long as
+  // the StateSnapshot.
+  [[nodiscard]] auto records() const -> LogRecordRange;
+  [[nodiscard]] auto firstSequence() const -> std::uint64_t {
+    return firstSequence_;
+  }
+  [[nodiscard]] auto endSequence() const -> std::uint64_t {
+    return firstSequence_ + records_.size();
+  }
+  [[nodiscard]] auto rules() const -> std::span<const NotifierRule> {
+    return rules_;
+  }
+  // Builds the NotifierSet of rules(): O(n log n) in the rule count.
+  [[nodiscard]] auto notifierSet() const -> NotifierSet {
+    return NotifierSet(rules_);
+  }
+  [[nodiscard]] auto operationCount() const -> std::size_t {
+    return operationCount_;
+  }
+  [[nodiscard]] auto remapped() const -> bool { return !remapped_.empty(); }
+  [[nodiscard]] auto fileSize() const -> std::size_t { return size_; }
+
+  // Touches every record: throws std::runtime_error if one points outside
+  // the text or at an OpId OperationTable::global() never issued.
+  void verify() const;
+  // Logs every record into logger, in order. O(n); for callers that need
+  // the history inside a live Logger rather than beside it.
+  void appendTo(const Logger &logger) const;
+
+private:
+  void parse();
+
+  void *data_ = nullptr;
+  std::size_t size_ = 0;
+  std::uint64_t firstSequence_ = 0;
+  std::span<const LogRecord> records_;
+  std::string_view text_;
+  std::span<const NotifierRule> rules_;
+  std::size_t operationCount_ = 0;
+  // Rewritten records, when the saved OpIds differ from the restore ones.
+  std::vector<LogRecord> remapped_;
+};
@@ -0,0 +1,377 @@
+#include "state_snapshot.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+// Records and rules are mapped in place, so they are stored in host layout.
+static_assert(std::endian::native == std::endian::little,
+              "state snapshots store records in host byte order");
+static_assert(std::is_trivially_copyable_v<LogRecord> &&
+              sizeof(LogRecord) == 12 && alignof(LogRecord) == 4);
+static_assert(std::is_trivially_copyable_v<NotifierRule> &&
+              sizeof(NotifierRule) == 8 && alignof(NotifierRule) == 4);
+
+namespace {
+
+using state_snapshot::kHeaderSize;
+using state_snapshot::kSectionAlignment;
+using state_snapshot::kSectionEntrySize;
+
+constexpr std::size_t kVersionOffset = 8;
+constexpr std::size_t kSectionCountOffset = 12;
+constexpr std::size_t kFirstSequenceOffset = 16;
+constexpr std::size_t kRecordCountOffset = 24;
+constexpr std::size_t kFileSizeOffset = 32;
+// Operations section: label count, padding, count + 1 offsets into the
+// label bytes that follow.
+constexpr std::size_t kLabelsHeader = 8;
+
+enum class Section : std::uint32_t { Records, Text, Operations, Rules };
+constexpr std::size_t kSectionCount = 4;
+
+struct SectionEntry {
+  std::uint64_t offset = 0;
+  std::uint64_t size = 0;
+};
+
+[[noreturn]] void throwErrno(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+[[noreturn]] void throwCorrupt() {
+  throw std::runtime_error("StateSnapshot: corrupt snapshot");
+}
+
+void storeLe(char *out, std::uint64_t value, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    out[i] = static_cast<char>((value >> (8 * i)) & 0xFFU);
+  }
+}
+
+auto loadLe(const char *in, std::size_t bytes) -> std::uint64_t {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(in[i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+auto aligned(std::uint64_t offset) -> std::uint64_t {
+  return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+// Owns the temporary file until it is renamed over the snapshot.
+class TempFile {
+public:
+  explicit TempFile(std::filesystem::path path) : path_(std::move(path)) {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0644);
+    if (fd_ < 0) {
+      throwErrno("writeStateSnapshot: cannot open " + path_.string());
+    }
+  }
+  TempFile(const TempFile &) = delete;
+  auto operator=(const TempFile &) -> TempFile & = delete;
+  ~TempFile() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      std::error_code ignored;
+      std::filesystem::remove(path_, ignored);
+    }
+  }
+
+  void write(const void *data, std::size_t size) {
+    const auto *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+      const ::ssize_t written = ::write(fd_, bytes, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throwErrno("writeStateSnapshot: write failed");
+      }
+      bytes += written;
+      size -= static_cast<std::size_t>(written);
+      offset_ += static_cast<std::uint64_t>(written);
+    }
+  }
+  // Zero-fills up to the next section boundary.
+  void align() {
+    static constexpr std::array<char, kSectionAlignment> kZeros{};
+    write(kZeros.data(), aligned(offset_) - offset_);
+  }
+
+  void commit(const std::filesystem::path &target) {
+    if (::fsync(fd_) != 0) {
+      throwErrno("writeStateSnapshot: fsync failed");
+    }
+    if (::close(std::exchange(fd_, -1)) != 0) {
+      const int error = errno;
+      std::error_code ignored;
+      std::filesystem::remove(path_, ignored);
+      errno = error;
+      throwErrno("writeStateSnapshot: close failed");
+    }
+    std::filesystem::rename(path_, target);
+  }
+
+private:
+  std::filesystem::path path_;
+  int fd_ = -1;
+  std::uint64_t offset_ = 0;
+};
+
+} // namespace
+
+void writeStateSnapshot(const std::filesystem::path &path,
+                        const LogRecordRange &records,
+                        std::span<const NotifierRule> rules) {
+  // Unwrap the ring and repack the text the records still reference, so
+  // the file holds no overwritten or drained bytes.
+  std::vector<LogRecord> packed;
+  packed.reserve(records.size());
+  std::string text;
+  std::string_view previous;
+  std::uint32_t previousOffset = 0;
+  for (const LogEntry entry : records) {
+    if (entry.op) {
+      packed.push_back({static_cast<std::uint32_t>(*entry.op),
+                        LogRecord::kInterned, entry.result});
+      continue;
+    }
+    // Consecutive records usually repeat their label; store it once.
+    if (entry.operation.data() != previous.data() ||
+        entry.operation.size() != previous.size()) {
+      if (text.size() + entry.operation.size() >= LogRecord::kInterned) {
+        throw std::length_error(
+            "writeStateSnapshot: text exceeds 32-bit offsets");
+      }
+      previous = entry.operation;
+      previousOffset = static_cast<std::uint32_t>(text.size());
+      text.append(entry.operation);
+    }
+    packed.push_back({previousOffset,
+                      static_cast<std::uint32_t>(entry.operation.size()),
+                      entry.result});
+  }
+
+  const OperationTable &table = OperationTable::global();
+  const std::size_t labelCount = table.size();
+  std::vector<char> labels(kLabelsHeader +
+                           (labelCount + 1) * sizeof(std::uint64_t));
+  const std::size_t labelBytes = labels.size();
+  storeLe(labels.data(), labelCount, 4);
+  for (std::size_t id = 0; id < labelCount; ++id) {
+    const std::string_view name = table.name(static_cast<OpId>(id));
+    labels.insert(labels.end(), name.begin(), name.end());
+    storeLe(labels.data() + kLabelsHeader + (id + 1) * sizeof(std::uint64_t),
+            labels.size() - labelBytes, 8);
+  }
+
+  const std::array<std::pair<const void *, std::size_t>, kSectionCount>
+      bodies{{{packed.data(), packed.size() * sizeof(LogRecord)},
+              {text.data(), text.size()},
+              {labels.data(), labels.size()},
+              {rules.data(), rules.size() * sizeof(NotifierRule)}}};
+  std::array<SectionEntry, kSectionCount> sections{};
+  std::uint64_t offset = aligned(kHeaderSize + kSectionCount *
+                                                   kSectionEntrySize);
+  for (std::size_t i = 0; i < kSectionCount; ++i) {
+    sections[i] = {offset, bodies[i].second};
+    offset = aligned(offset + bodies[i].second);
+  }
+
+  std::array<char, kHeaderSize + kSectionCount * kSectionEntrySize> head{};
+  std::memcpy(head.data(), state_snapshot::kMagic,
+              sizeof(state_snapshot::kMagic));
+  storeLe(head.data() + kVersionOffset, state_snapshot::kVersion, 4);
+  storeLe(head.data() + kSectionCountOffset, kSectionCount, 4);
+  storeLe(head.data() + kFirstSequenceOffset, records.firstSequence(), 8);
+  storeLe(head.data() + kRecordCountOffset, packed.size(), 8);
+  storeLe(head.data() + kFileSizeOffset, offset, 8);
+  for (std::size_t i = 0; i < kSectionCount; ++i) {
+    char *entry = head.data() + kHeaderSize + i * kSectionEntrySize;
+    storeLe(entry, i, 4);
+    storeLe(entry + 8, sections[i].offset, 8);
+    storeLe(entry + 16, sections[i].size, 8);
+  }
+
+  std::filesystem::path temporary = path;
+  temporary += ".tmp";
+  TempFile file(temporary);
+  file.write(head.data(), head.size());
+  for (const auto &[data, size] : bodies) {
+    file.align();
+    if (size != 0) {
+      file.write(data, size);
+    }
+  }
+  file.align();
+  file.commit(path);
+}
+
+StateSnapshot::StateSnapshot(const std::filesystem::path &path,
+                             StateRestoreOptions options) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throwErrno("StateSnapshot: cannot open " + path.string());
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throwErrno("StateSnapshot: cannot stat " + path.string());
+  }
+  size_ = static_cast<std::size_t>(info.st_size);
+  if (size_ < kHeaderSize + kSectionCount * kSectionEntrySize) {
+    ::close(fd);
+    throwCorrupt();
+  }
+  // Private and unpopulated: nothing is read until a page is touched.
+  data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data_ == MAP_FAILED) {
+    data_ = nullptr;
+    throwErrno("StateSnapshot: cannot map " + path.string());
+  }
+  if (options.prefetch) {
+    ::madvise(data_, size_, MADV_WILLNEED);
+  }
+  try {
+    parse();
+  } catch (...) {
+    ::munmap(data_, size_);
+    throw;
+  }
+}
+
+StateSnapshot::~StateSnapshot() { ::munmap(data_, size_); }
+
+void StateSnapshot::parse() {
+  const auto *base = static_cast<const char *>(data_);
+  if (std::memcmp(base, state_snapshot::kMagic,
+                  sizeof(state_snapshot::kMagic)) != 0 ||
+      loadLe(base + kVersionOffset, 4) != state_snapshot::kVersion ||
+      loadLe(base + kSectionCountOffset, 4) != kSectionCount ||
+      loadLe(base + kFileSizeOffset, 8) != size_) {
+    throwCorrupt();
+  }
+  firstSequence_ = loadLe(base + kFirstSequenceOffset, 8);
+  const std::uint64_t recordCount = loadLe(base + kRecordCountOffset, 8);
+
+  std::array<SectionEntry, kSectionCount> sections{};
+  for (std::size_t i = 0; i < kSectionCount; ++i) {
+    const char *entry = base + kHeaderSize + i * kSectionEntrySize;
+    const SectionEntry section{loadLe(entry + 8, 8), loadLe(entry + 16, 8)};
+    if (loadLe(entry, 4) != i || section.offset % kSectionAlignment != 0 ||
+        section.offset > size_ || section.size > size_ - section.offset) {
+      throwCorrupt();
+    }
+    sections[i] = section;
+  }
+  const auto at = [&](Section kind) {
+    return sections[static_cast<std::size_t>(kind)];
+  };
+
+  const SectionEntry records = at(Section::Records);
+  if (records.size / sizeof(LogRecord) != recordCount ||
+      records.size % sizeof(LogRecord) != 0) {
+    throwCorrupt();
+  }
+  // Sections start 64-byte aligned in a page-aligned mapping.
+  records_ = {reinterpret_cast<const LogRecord *>(base + records.offset),
+              static_cast<std::size_t>(recordCount)};
+  text_ = {base + at(Section::Text).offset,
+           static_cast<std::size_t>(at(Section::Text).size)};
+  const SectionEntry rules = at(Section::Rules);
+  if (rules.size % sizeof(NotifierRule) != 0) {
+    throwCorrupt();
+  }
+  rules_ = {reinterpret_cast<const NotifierRule *>(base + rules.offset),
+            static_cast<std::size_t>(rules.size / sizeof(NotifierRule))};
+
+  // Re-intern the labels in their saved order; only records of labels that
+  // come back under another id need rewriting.
+  const SectionEntry labels = at(Section::Operations);
+  const char *in = base + labels.offset;
+  if (labels.size < kLabelsHeader) {
+    throwCorrupt();
+  }
+  operationCount_ = static_cast<std::size_t>(loadLe(in, 4));
+  if (operationCount_ >=
+      (labels.size - kLabelsHeader) / sizeof(std::uint64_t)) {
+    throwCorrupt();
+  }
+  const std::uint64_t bytesOffset =
+      kLabelsHeader + (operationCount_ + 1) * sizeof(std::uint64_t);
+  const std::string_view bytes(in + bytesOffset,
+                               labels.size - bytesOffset);
+  std::vector<OpId> ids(operationCount_);
+  bool identical = true;
+  OperationTable &table = OperationTable::global();
+  for (std::size_t id = 0; id < operationCount_; ++id) {
+    const char *offsets = in + kLabelsHeader + id * sizeof(std::uint64_t);
+    const std::uint64_t begin = loadLe(offsets, 8);
+    const std::uint64_t end = loadLe(offsets + sizeof(std::uint64_t), 8);
+    if (begin > end || end > bytes.size()) {
+      throwCorrupt();
+    }
+    ids[id] = table.intern(bytes.substr(begin, end - begin));
+    identical = identical && static_cast<std::size_t>(ids[id]) == id;
+  }
+  if (identical) {
+    return;
+  }
+  remapped_.assign(records_.begin(), records_.end());
+  for (LogRecord &record : remapped_) {
+    if (record.operationLength != LogRecord::kInterned) {
+      continue;
+    }
+    if (record.operationOffset >= operationCount_) {
+      throwCorrupt();
+    }
+    record.operationOffset =
+        static_cast<std::uint32_t>(ids[record.operationOffset]);
+  }
+  records_ = remapped_;
+}
+
+auto StateSnapshot::records() const -> LogRecordRange {
+  return {records_, 0, records_.size(), text_, firstSequence_};
+}
+
+void StateSnapshot::verify() const {
+  const OperationTable &table = OperationTable::global();
+  for (const LogRecord &record : records_) {
+    const bool valid =
+        record.operationLength == LogRecord::kInterned
+            ? table.contains(static_cast<OpId>(record.operationOffset))
+            : record.operationOffset <= text_.size() &&
+                  record.operationLength <=
+                      text_.size() - record.operationOffset;
+    if (!valid) {
+      throwCorrupt();
+    }
+  }
+}
+
+void StateSnapshot::appendTo(const Logger &logger) const {
+  for (const LogEntry entry : records()) {
+    if (entry.op) {
+      logger.logOperation(*entry.op, entry.result);
+    } else {
+      logger.logOperation(entry.operation, entry.result);
+    }
+  }
+}
@@ -0,0 +1,163 @@
+#include "state_snapshot.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+auto tempPath(const std::string &name) -> std::filesystem::path {
+  return std::filesystem::path(::testing::TempDir()) / name;
+}
+
+auto readFile(const std::filesystem::path &path) -> std::string {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+void writeFile(const std::filesystem::path &path, const std::string &bytes) {
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+}
+
+auto formatted(const LogRecordRange &records) -> std::vector<std::string> {
+  std::vector<std::string> out;
+  for (const LogEntry entry : records) {
+    out.push_back(entry.format());
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(StateSnapshotTests, TestRoundTripKeepsRecordsAndRules) {
+  // A bounded ring that has wrapped, mixing text and interned records.
+  const Logger logger(LoggerOptions{.capacity = 64});
+  const OpId add = OperationTable::global().intern("snapshot add");
+  for (int i = 0; i < 150; ++i) {
+    if (i % 3 == 0) {
+      logger.logOperation(add, i);
+    } else {
+      logger.logOperation(i % 2 == 0 ? "even" : "odd", -i);
+    }
+  }
+  const LogSnapshot snapshot = logger.snapshot();
+  const std::vector<NotifierRule> rules{NotifierRule::above(10),
+                                        NotifierRule::between(-5, 5),
+                                        NotifierRule::above(-100)};
+  const auto path = tempPath("round_trip.state");
+  writeStateSnapshot(path, snapshot.records(), rules);
+  EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+
+  const StateSnapshot restored(path);
+  EXPECT_FALSE(restored.remapped());
+  EXPECT_EQ(restored.firstSequence(), snapshot.records().firstSequence());
+  EXPECT_EQ(restored.endSequence(), 150u);
+  EXPECT_EQ(restored.records().firstSequence(), 150u - 64u);
+  EXPECT_EQ(formatted(restored.records()), formatted(snapshot.records()));
+  EXPECT_GE(restored.operationCount(), 1u);
+  EXPECT_NO_THROW(restored.verify());
+  const LogEntry first = restored.records()[0];
+  EXPECT_EQ(first.op.has_value(), snapshot.records()[0].op.has_value());
+
+  ASSERT_EQ(restored.rules().size(), rules.size());
+  const NotifierSet set = restored.notifierSet();
+  const NotifierSet expected(rules);
+  for (int value = -120; value <= 20; ++value) {
+    EXPECT_EQ(set.matchCount(value), expected.matchCount(value)) << value;
+  }
+
+  // Replaying into a Logger that continues the history.
+  const Logger replayed;
+  restored.appendTo(replayed);
+  EXPECT_EQ(formatted(replayed.snapshot().records()),
+            formatted(snapshot.records()));
+}
+
+TEST(StateSnapshotTests, TestEmptySnapshot) {
+  const Logger logger;
+  const auto path = tempPath("empty.state");
+  writeStateSnapshot(path, logger.snapshot().records());
+  const StateSnapshot restored(path, StateRestoreOptions{.prefetch = true});
+  EXPECT_TRUE(restored.records().empty());
+  EXPECT_TRUE(restored.rules().empty());
+  EXPECT_EQ(restored.notifierSet().ruleCount(), 0u);
+  EXPECT_EQ(restored.fileSize() % state_snapshot::kSectionAlignment, 0u);
+}
+
+TEST(StateSnapshotTests, TestRelabelledIdsAreRemapped) {
+  OperationTable &table = OperationTable::global();
+  const OpId left = table.intern("snapshot left");
+  const OpId right = table.intern("snapshot right");
+  ASSERT_EQ(static_cast<std::uint32_t>(right),
+            static_cast<std::uint32_t>(left) + 1);
+  const Logger logger;
+  logger.logOperation(left, 1);
+  logger.logOperation(right, 2);
+  logger.logOperation("plain", 3);
+  const auto path = tempPath("remap.state");
+  writeStateSnapshot(path, logger.snapshot().records());
+
+  // As if another process had interned the two labels the other way round:
+  // swap them in the operations section (the third section entry) and move
+  // the offset between them.
+  std::string bytes = readFile(path);
+  std::uint64_t section = 0;
+  std::memcpy(&section,
+              bytes.data() + state_snapshot::kHeaderSize +
+                  2 * state_snapshot::kSectionEntrySize + 8,
+              sizeof(section));
+  const std::size_t id = static_cast<std::size_t>(left);
+  char *offsets = bytes.data() + section + 8;
+  std::uint32_t count = 0;
+  std::memcpy(&count, bytes.data() + section, sizeof(count));
+  std::uint64_t begin = 0;
+  std::memcpy(&begin, offsets + id * 8, sizeof(begin));
+  const std::string_view swapped = "snapshot rightsnapshot left";
+  const std::size_t labels = section + 8 + (count + std::size_t{1}) * 8;
+  ASSERT_EQ(bytes.substr(labels + begin, swapped.size()),
+            "snapshot leftsnapshot right");
+  bytes.replace(labels + begin, swapped.size(), swapped);
+  const std::uint64_t middle =
+      begin + std::string_view("snapshot right").size();
+  std::memcpy(offsets + (id + 1) * 8, &middle, sizeof(middle));
+  writeFile(path, bytes);
+
+  const StateSnapshot restored(path);
+  EXPECT_TRUE(restored.remapped());
+  EXPECT_NO_THROW(restored.verify());
+  EXPECT_EQ(formatted(restored.records()),
+            (std::vector<std::string>{"snapshot right = 1",
+                                      "snapshot left = 2", "plain = 3"}));
+}
+
+TEST(StateSnapshotTests, TestCorruptFilesAreRejected) {
+  const Logger logger;
+  logger.logOperation("add", 1);
+  const auto path = tempPath("corrupt.state");
+  writeStateSnapshot(path, logger.snapshot().records(),
+                     std::vector<NotifierRule>{NotifierRule::above(0)});
+  const std::string bytes = readFile(path);
+
+  writeFile(path, bytes.substr(0, bytes.size() - 1));
+  EXPECT_THROW(StateSnapshot{path}, std::runtime_error);
+  std::string badMagic = bytes;
+  badMagic[0] = 'X';
+  writeFile(path, badMagic);
+  EXPECT_THROW(StateSnapshot{path}, std::runtime_error);
+  std::string badSection = bytes;
+  // Push the records section past the end of the file.
+  badSection[state_snapshot::kHeaderSize + 15] = '\x7F';
+  writeFile(path, badSection);
+  EXPECT_THROW(StateSnapshot{path}, std::runtime_error);
+  writeFile(path, bytes.substr(0, 10));
+  EXPECT_THROW(StateSnapshot{path}, std::runtime_error);
+  EXPECT_THROW(StateSnapshot{tempPath("missing.state")}, std::system_error);
+
+  writeFile(path, bytes);
+  EXPECT_NO_THROW(StateSnapshot{path}.verify());
+}
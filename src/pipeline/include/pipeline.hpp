@@ -0,0 +1,55 @@
+#pragma once
+#include "calculator.hpp"
+#include "logger.hpp"
+#include "notifier.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+
+struct PipelineOptions {
+  // Elements handled per pass; rounded up to a multiple of 64 so each chunk
+  // fills whole notification mask words.
+  std::size_t batchSize = 1024;
+  // Called for every result that exceeds the notifier's threshold, with the
+  // element index within the process() call.
+  std::function<void(std::size_t, const NotifyMessage &)> onNotify{};
+  // Source of the scratch space; nullptr selects
+  // std::pmr::get_default_resource(). Must outlive the Pipeline.
+  std::pmr::memory_resource *resource = nullptr;
+};
+
+struct PipelineResult {
+  std::size_t processed = 0;
+  std::size_t logged = 0;
+  std::size_t notified = 0;
+};
+
+// Fused calculate -> log -> notify flow. Inputs are processed in chunks of
+// batchSize so each chunk's results are still in cache when they are logged
+// and screened. Scratch space is allocated once, in the constructor.
+class Pipeline {
+public:
+  Pipeline(const Logger &logger, const Notifier &notifier,
+           PipelineOptions options = {});
+
+  // Computes lhs[i] op rhs[i] and logs every result under label. results
+  // and mask are optional outputs; when given they need lhs.size() and
+  // Notifier::maskWords(lhs.size()) elements (std::invalid_argument
+  // otherwise).
+  auto process(Operation op, std::string_view label, std::span<const int> lhs,
+               std::span<const int> rhs, std::span<int> results = {},
+               std::span<std::uint64_t> mask = {}) -> PipelineResult;
+
+  [[nodiscard]] auto batchSize() const -> std::size_t { return batchSize_; }
+
+private:
+  const Logger &logger_;
+  const Notifier &notifier_;
+  PipelineOptions options_;
+  std::size_t batchSize_;
+  std::pmr::vector<int> resultScratch_;
+  std::pmr::vector<std::uint64_t> maskScratch_;
+};
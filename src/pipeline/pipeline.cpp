@@ -0,0 +1,83 @@
+#include "pipeline.hpp"
+#include "memory_resource.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr std::size_t kMaskBits = 64;
+
+auto roundedBatchSize(std::size_t requested) -> std::size_t {
+  const std::size_t size = std::max<std::size_t>(requested, 1);
+  return (size + kMaskBits - 1) / kMaskBits * kMaskBits;
+}
+
+} // namespace
+
+Pipeline::Pipeline(const Logger &logger, const Notifier &notifier,
+                   PipelineOptions options)
+    : logger_(logger), notifier_(notifier), options_(std::move(options)),
+      batchSize_(roundedBatchSize(options_.batchSize)),
+      resultScratch_(batchSize_, resourceOrDefault(options_.resource)),
+      maskScratch_(Notifier::maskWords(batchSize_),
+                   resourceOrDefault(options_.resource)) {}
+
+auto Pipeline::process(Operation op, std::string_view label,
+                       std::span<const int> lhs, std::span<const int> rhs,
+                       std::span<int> results, std::span<std::uint64_t> mask)
+    -> PipelineResult {
+  const std::size_t count = lhs.size();
+  if (rhs.size() != count) {
+    throw std::invalid_argument("Pipeline: operand spans do not match");
+  }
+  if (!results.empty() && results.size() != count) {
+    throw std::invalid_argument("Pipeline: results span has the wrong size");
+  }
+  if (!mask.empty() && mask.size() < Notifier::maskWords(count)) {
+    throw std::invalid_argument("Pipeline: mask span is too small");
+  }
+
+  MY_CODE_TRACE_SPAN_ITEMS("Pipeline::process", count);
+  PipelineResult total;
+  for (std::size_t begin = 0; begin < count; begin += batchSize_) {
+    const std::size_t size = std::min(batchSize_, count - begin);
+    const std::span<int> chunk =
+        results.empty() ? std::span<int>(resultScratch_).first(size)
+                        : results.subspan(begin, size);
+    const std::span<std::uint64_t> chunkMask =
+        mask.empty() ? std::span<std::uint64_t>(maskScratch_)
+                     : mask.subspan(begin / kMaskBits);
+
+    {
+      MY_CODE_TRACE_SPAN("Pipeline::calculate");
+      Calculator::apply(op, lhs.subspan(begin, size),
+                        rhs.subspan(begin, size), chunk);
+    }
+    {
+      MY_CODE_TRACE_SPAN("Pipeline::log");
+      total.logged += logger_.logOperations(label, chunk);
+    }
+    {
+      MY_CODE_TRACE_SPAN("Pipeline::notify");
+      total.notified += notifier_.shouldNotify(chunk, chunkMask);
+    }
+
+    if (options_.onNotify) {
+      MY_CODE_TRACE_SPAN("Pipeline::onNotify");
+      for (std::size_t w = 0; w < Notifier::maskWords(size); ++w) {
+        for (std::uint64_t bits = chunkMask[w]; bits != 0; bits &= bits - 1) {
+          const std::size_t i =
+              w * kMaskBits + static_cast<std::size_t>(std::countr_zero(bits));
+          // The mask already screened chunk[i]; notifier_.message() would
+          // screen (and count) it again.
+          options_.onNotify(begin + i, NotifyMessage(true, chunk[i]));
+        }
+      }
+    }
+    total.processed += size;
+  }
+  return total;
+}
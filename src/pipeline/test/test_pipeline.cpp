@@ -0,0 +1,93 @@
+#include "pipeline.hpp"
+#include "memory_resource.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+TEST(PipelineTests, TestProcessMatchesSeparateStages) {
+  const Logger logger;
+  const Notifier notifier(100);
+  Pipeline pipeline(logger, notifier, PipelineOptions{.batchSize = 64});
+
+  // 150 elements: two full chunks and a partial one.
+  std::vector<int> lhs(150);
+  std::vector<int> rhs(150, 3);
+  std::iota(lhs.begin(), lhs.end(), -10);
+  std::vector<int> results(lhs.size());
+  std::vector<std::uint64_t> mask(Notifier::maskWords(lhs.size()));
+
+  const PipelineResult outcome = pipeline.process(Operation::Multiply, "mul",
+                                                  lhs, rhs, results, mask);
+  EXPECT_EQ(outcome.processed, lhs.size());
+  EXPECT_EQ(outcome.logged, lhs.size());
+
+  std::vector<int> expected(lhs.size());
+  Calculator::multiply(lhs, rhs, expected);
+  EXPECT_EQ(results, expected);
+  EXPECT_EQ(mask, notifier.shouldNotify(expected));
+  EXPECT_EQ(outcome.notified, notifier.exceedingIndices(expected).size());
+
+  const auto records = logger.records();
+  ASSERT_EQ(records.size(), lhs.size());
+  EXPECT_EQ(records[0].format(), "mul = -30");
+  EXPECT_EQ(records[149].result, expected[149]);
+}
+
+TEST(PipelineTests, TestOnNotifyReceivesGlobalIndices) {
+  const Logger logger(LoggerOptions{.capacity = 16});
+  const Notifier notifier(5);
+  std::vector<std::size_t> hits;
+  Pipeline pipeline(
+      logger, notifier,
+      PipelineOptions{.batchSize = 1,
+                      .onNotify = [&hits](std::size_t index,
+                                          const NotifyMessage &message) {
+                        EXPECT_TRUE(message.exceeded());
+                        hits.push_back(index);
+                      }});
+  EXPECT_EQ(pipeline.batchSize(), 64u);
+
+  std::vector<int> lhs(100, 1);
+  std::vector<int> rhs(100, 0);
+  rhs[3] = 10;
+  rhs[70] = 5;
+  rhs[99] = 4;
+  const PipelineResult outcome =
+      pipeline.process(Operation::Add, "add", lhs, rhs);
+  EXPECT_EQ(outcome.notified, 2u);
+  EXPECT_EQ(hits, (std::vector<std::size_t>{3, 70}));
+  // The bounded logger keeps only the newest records.
+  EXPECT_EQ(logger.size(), 16u);
+}
+
+TEST(PipelineTests, TestRejectsMismatchedSpans) {
+  const Logger logger;
+  const Notifier notifier(0);
+  Pipeline pipeline(logger, notifier);
+  std::vector<int> lhs(4);
+  std::vector<int> rhs(3);
+  EXPECT_THROW(pipeline.process(Operation::Add, "add", lhs, rhs),
+               std::invalid_argument);
+}
+
+TEST(PipelineTests, TestScratchAndLoggerShareAnArena) {
+  // A request-scoped pipeline: everything it and its logger allocate is
+  // freed at once when the arena goes.
+  MonotonicArena arena;
+  const Logger logger(LoggerOptions{.resource = &arena});
+  const Notifier notifier(5);
+  Pipeline pipeline(logger, notifier,
+                    PipelineOptions{.batchSize = 128, .resource = &arena});
+  const std::size_t scratch = arena.bytesAllocated();
+  EXPECT_GE(scratch, 128 * sizeof(int) + 2 * sizeof(std::uint64_t));
+
+  const std::vector<int> lhs(300, 2);
+  const std::vector<int> rhs(300, 3);
+  const PipelineResult outcome =
+      pipeline.process(Operation::Multiply, "2 * 3", lhs, rhs);
+  EXPECT_EQ(outcome.logged, 300u);
+  EXPECT_EQ(outcome.notified, 300u);
+  EXPECT_GT(arena.bytesAllocated(), scratch + 300 * sizeof(LogRecord));
+}
@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class Scheduler;
+class TaskGroup;
+
+struct SchedulerOptions {
+  // Worker threads. 0 means hardware_concurrency() - 1, leaving a core for
+  // the thread that waits on the work; there is always at least one worker.
+  std::size_t threads = 0;
+  // Pins worker i to cores[i % cores.size()], or to CPU i when cores is
+  // empty. Pinning is best effort: CPUs outside the process's affinity mask
+  // are skipped by the kernel and the worker stays unpinned.
+  bool pinThreads = false;
+  std::vector<int> cores{};
+};
+
+// Controls the data-parallel overloads of Calculator and Notifier. Inputs
+// are cut into chunks of at least `grain` elements (rounded up to a multiple
+// of kAlignment) that depend only on the input size, so chunked reductions
+// give the same result for every thread count. At most `threads` contiguous
+// runs of chunks are in flight at once (0: the scheduler's concurrency()).
+// The runs are stolen like any other task, so there is no NUMA placement.
+struct ParallelOptions {
+  // Chunk sizes are multiples of this many elements: a 4 KiB page of int,
+  // and whole 64-bit words of a bit mask.
+  static constexpr std::size_t kAlignment = 1024;
+
+  std::size_t threads = 0;
+  std::size_t grain = std::size_t{1} << 16U;
+  // nullptr selects Scheduler::global().
+  Scheduler *scheduler = nullptr;
+
+  [[nodiscard]] constexpr auto chunkSize() const -> std::size_t {
+    const std::size_t minimum = grain == 0 ? 1 : grain;
+    return (minimum + kAlignment - 1) / kAlignment * kAlignment;
+  }
+};
+
+// Work-stealing task scheduler shared by the library's components. Each
+// worker owns a Chase-Lev deque: it pushes and pops tasks at the bottom
+// (LIFO, so nested work stays cache-hot) while idle workers steal from the
+// top (FIFO, so thieves take the oldest and usually largest pieces). Tasks
+// submitted from outside the pool go through a shared inbox. Threads that
+// wait on a TaskGroup run queued tasks instead of blocking.
+class Scheduler {
+public:
+  explicit Scheduler(SchedulerOptions options = {});
+  // Runs every task still queued, then joins the workers.
+  ~Scheduler();
+  Scheduler(const Scheduler &) = delete;
+  auto operator=(const Scheduler &) -> Scheduler & = delete;
+  Scheduler(Scheduler &&) = delete;
+  auto operator=(Scheduler &&) -> Scheduler & = delete;
+
+  // Queues a detached task. Exceptions escaping it call std::terminate; use
+  // a TaskGroup to collect them.
+  void submit(std::function<void()> task);
+
+  // Runs body(begin, end) over [0, count) in pieces of at most grain
+  // elements, splitting the range in halves so thieves steal large
+  // contiguous blocks. The calling thread takes part in the work and the
+  // call returns once every piece has finished; the first exception thrown
+  // by body is rethrown.
+  template <class Body>
+  void parallelFor(std::size_t count, std::size_t grain, const Body &body);
+
+  // Runs body(begin, end) for every ParallelOptions chunk of [0, count).
+  // Each contiguous run of chunks goes to whichever thread takes it, so
+  // the same run is not guaranteed the same worker from call to call and
+  // memory is not kept on the node that first touched it.
+  template <class Body>
+  static void forEachChunk(const ParallelOptions &options, std::size_t count,
+                           const Body &body);
+
+  // Executes one queued task on the calling thread. Returns false if no
+  // task could be found.
+  auto tryRunOne() -> bool;
+
+  [[nodiscard]] auto workerCount() const -> std::size_t {
+    return workers_.size();
+  }
+  // Threads that execute work in parallelFor: the workers and the caller.
+  [[nodiscard]] auto concurrency() const -> std::size_t {
+    return workers_.size() + 1;
+  }
+
+  // The process-wide instance, created on first use.
+  static auto global() -> Scheduler &;
+  // Sets the options global() is created with. Throws std::logic_error once
+  // the global scheduler exists.
+  static void configureGlobal(SchedulerOptions options);
+
+private:
+  struct Task;
+  class WorkDeque;
+  struct Worker;
+
+  void push(Task *task);
+  auto findTask() -> Task *;
+  void execute(Task *task) noexcept;
+  void workerLoop(std::size_t index);
+
+  template <class Body>
+  static void splitRange(TaskGroup &group, std::size_t begin,
+                         std::size_t end, std::size_t grain,
+                         const Body &body);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  std::mutex inboxMutex_;
+  std::deque<Task *> inbox_;
+  std::atomic<std::size_t> inboxSize_{0};
+
+  // Tasks sitting in a deque or the inbox. Workers sleep only while it is
+  // zero; producers wake one only if someone sleeps.
+  std::atomic<std::int64_t> queued_{0};
+  std::atomic<std::size_t> sleepers_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+};
+
+// Set of tasks that can be waited on together. run() queues a task on the
+// scheduler; wait() helps execute queued tasks until all of the group's
+// tasks have finished and rethrows the first exception one of them threw.
+class TaskGroup {
+public:
+  explicit TaskGroup(Scheduler &scheduler = Scheduler::global())
+      : scheduler_(scheduler) {}
+  // Waits for outstanding tasks; exceptions not collected by wait() are
+  // discarded.
+  ~TaskGroup();
+  TaskGroup(const TaskGroup &) = delete;
+  auto operator=(const TaskGroup &) -> TaskGroup & = delete;
+  TaskGroup(TaskGroup &&) = delete;
+  auto operator=(TaskGroup &&) -> TaskGroup & = delete;
+
+  void run(std::function<void()> task);
+  void wait();
+
+private:
+  void finish(std::exception_ptr error);
+  void waitPending();
+
+  Scheduler &scheduler_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  std::size_t pending_ = 0;
+  std::exception_ptr error_;
+};
+
+template <class Body>
+void Scheduler::parallelFor(std::size_t count, std::size_t grain,
+                            const Body &body) {
+  grain = std::max<std::size_t>(grain, 1);
+  if (count <= grain) {
+    if (count > 0) {
+      body(std::size_t{0}, count);
+    }
+    return;
+  }
+  TaskGroup group(*this);
+  splitRange(group, 0, count, grain, body);
+  group.wait();
+}
+
+template <class Body>
+void Scheduler::splitRange(TaskGroup &group, std::size_t begin,
+                           std::size_t end, std::size_t grain,
+                           const Body &body) {
+  // Split points stay on multiples of grain, so every piece but the last is
+  // exactly grain elements long.
+  while (end - begin > grain) {
+    const std::size_t pieces = (end - begin + grain - 1) / grain;
+    const std::size_t mid = begin + pieces / 2 * grain;
+    group.run([&group, mid, end, grain, &body] {
+      splitRange(group, mid, end, grain, body);
+    });
+    end = mid;
+  }
+  body(begin, end);
+}
+
+template <class Body>
+void Scheduler::forEachChunk(const ParallelOptions &options, std::size_t count,
+                             const Body &body) {
+  Scheduler &scheduler =
+      options.scheduler != nullptr ? *options.scheduler : global();
+  const std::size_t size = options.chunkSize();
+  const std::size_t chunks = (count + size - 1) / size;
+  const std::size_t threads =
+      options.threads == 0 ? scheduler.concurrency() : options.threads;
+  const std::size_t parts = std::min(threads, chunks);
+  // Part p owns chunks [p * chunks / parts, (p + 1) * chunks / parts).
+  scheduler.parallelFor(parts, 1, [&](std::size_t first, std::size_t last) {
+    for (std::size_t part = first; part < last; ++part) {
+      const std::size_t begin = part * chunks / parts;
+      const std::size_t end = (part + 1) * chunks / parts;
+      for (std::size_t chunk = begin; chunk < end; ++chunk) {
+        body(chunk * size, std::min(count, (chunk + 1) * size));
+      }
+    }
+  });
+}
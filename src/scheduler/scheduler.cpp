@@ -0,0 +1,355 @@
+#include "scheduler.hpp"
+#include "tracing.hpp"
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct Scheduler::Task {
+  std::function<void()> run;
+};
+
+// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models"). The owner pushes and pops at
+// bottom_, thieves CAS top_ forward. The fences of the paper are folded into
+// seq_cst accesses so thread sanitizers can follow the synchronisation.
+class Scheduler::WorkDeque {
+public:
+  WorkDeque() : ring_(new Ring(kInitialCapacity)) {}
+  ~WorkDeque() { delete ring_.load(std::memory_order_relaxed); }
+  WorkDeque(const WorkDeque &) = delete;
+  auto operator=(const WorkDeque &) -> WorkDeque & = delete;
+  WorkDeque(WorkDeque &&) = delete;
+  auto operator=(WorkDeque &&) -> WorkDeque & = delete;
+
+  // Owner only.
+  void push(Task *task) {
+    const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const std::int64_t top = top_.load(std::memory_order_acquire);
+    Ring *ring = ring_.load(std::memory_order_relaxed);
+    if (bottom - top >= static_cast<std::int64_t>(ring->capacity())) {
+      ring = grow(ring, top, bottom);
+    }
+    ring->put(bottom, task);
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  // Owner only; takes the most recently pushed task.
+  auto pop() -> Task * {
+    const std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Ring *ring = ring_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_seq_cst);
+    std::int64_t top = top_.load(std::memory_order_seq_cst);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_release);
+      return nullptr;
+    }
+    Task *task = ring->get(bottom);
+    if (top == bottom) {
+      // Last task: race the thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_release);
+    }
+    return task;
+  }
+
+  // Any thread; takes the oldest task. nullptr if empty or lost a race.
+  auto steal() -> Task * {
+    std::int64_t top = top_.load(std::memory_order_seq_cst);
+    const std::int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    Task *task = ring_.load(std::memory_order_acquire)->get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+private:
+  static constexpr std::size_t kInitialCapacity = 256;
+
+  class Ring {
+  public:
+    explicit Ring(std::size_t capacity)
+        : mask_(capacity - 1),
+          slots_(std::make_unique<std::atomic<Task *>[]>(capacity)) {}
+    [[nodiscard]] auto capacity() const -> std::size_t { return mask_ + 1; }
+    [[nodiscard]] auto get(std::int64_t index) const -> Task * {
+      return slots_[static_cast<std::size_t>(index) & mask_].load(
+          std::memory_order_relaxed);
+    }
+    void put(std::int64_t index, Task *task) {
+      slots_[static_cast<std::size_t>(index) & mask_].store(
+          task, std::memory_order_relaxed);
+    }
+
+  private:
+    std::size_t mask_;
+    std::unique_ptr<std::atomic<Task *>[]> slots_;
+  };
+
+  auto grow(Ring *ring, std::int64_t top, std::int64_t bottom) -> Ring * {
+    auto *larger = new Ring(2 * ring->capacity());
+    for (std::int64_t i = top; i < bottom; ++i) {
+      larger->put(i, ring->get(i));
+    }
+    // A thief may still be reading the old ring, so it lives as long as the
+    // deque does.
+    retired_.emplace_back(ring);
+    ring_.store(larger, std::memory_order_release);
+    return larger;
+  }
+
+  alignas(64) std::atomic<std::int64_t> top_{0};
+  alignas(64) std::atomic<std::int64_t> bottom_{0};
+  std::atomic<Ring *> ring_;
+  std::vector<std::unique_ptr<Ring>> retired_;
+};
+
+struct Scheduler::Worker {
+  WorkDeque deque;
+  std::thread thread;
+};
+
+namespace {
+
+// Identifies the worker running on the current thread, if any.
+struct WorkerSlot {
+  const Scheduler *scheduler = nullptr;
+  std::size_t index = 0;
+};
+thread_local WorkerSlot currentWorker;
+
+auto defaultWorkerCount() -> std::size_t {
+  const std::size_t hardware = std::thread::hardware_concurrency();
+  return hardware > 1 ? hardware - 1 : 1;
+}
+
+void pinToCore([[maybe_unused]] std::thread &thread,
+               [[maybe_unused]] int core) {
+#ifdef __linux__
+  if (core < 0 || core >= CPU_SETSIZE) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  static_cast<void>(
+      ::pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set));
+#endif
+}
+
+std::mutex globalMutex;
+std::optional<SchedulerOptions> globalOptions;
+bool globalCreated = false;
+
+} // namespace
+
+Scheduler::Scheduler(SchedulerOptions options) {
+  for (const int core : options.cores) {
+    if (core < 0) {
+      throw std::invalid_argument("Scheduler: core ids must be non-negative");
+    }
+  }
+  const std::size_t count =
+      options.threads == 0 ? defaultWorkerCount() : options.threads;
+  workers_.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  // Every deque exists before any worker starts stealing from them.
+  for (std::size_t i = 0; i < count; ++i) {
+    workers_[i]->thread = std::thread([this, i] { workerLoop(i); });
+    if (options.pinThreads) {
+      const int core = options.cores.empty()
+                           ? static_cast<int>(i)
+                           : options.cores[i % options.cores.size()];
+      pinToCore(workers_[i]->thread, core);
+    }
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    const std::lock_guard guard(sleepMutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (const auto &worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+void Scheduler::submit(std::function<void()> task) {
+  push(new Task{std::move(task)});
+}
+
+void Scheduler::push(Task *task) {
+  if (currentWorker.scheduler == this) {
+    workers_[currentWorker.index]->deque.push(task);
+  } else {
+    const std::lock_guard guard(inboxMutex_);
+    inbox_.push_back(task);
+    inboxSize_.store(inbox_.size(), std::memory_order_relaxed);
+  }
+  queued_.fetch_add(1, std::memory_order_seq_cst);
+  // Pairs with the sleeper registering itself before it re-checks queued_:
+  // either it sees the new task or we see it and wake it.
+  if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+    { const std::lock_guard guard(sleepMutex_); }
+    wake_.notify_one();
+  }
+}
+
+auto Scheduler::findTask() -> Task * {
+  const bool isWorker = currentWorker.scheduler == this;
+  const std::size_t self = isWorker ? currentWorker.index : 0;
+  if (isWorker) {
+    if (Task *task = workers_[self]->deque.pop()) {
+      return task;
+    }
+  }
+  // The relaxed size only saves the lock when the inbox is empty; a stale
+  // zero is retried on the next round.
+  if (inboxSize_.load(std::memory_order_relaxed) > 0) {
+    const std::lock_guard guard(inboxMutex_);
+    if (!inbox_.empty()) {
+      Task *task = inbox_.front();
+      inbox_.pop_front();
+      inboxSize_.store(inbox_.size(), std::memory_order_relaxed);
+      return task;
+    }
+  }
+  const std::size_t count = workers_.size();
+  for (std::size_t offset = isWorker ? 1 : 0; offset < count; ++offset) {
+    if (Task *task = workers_[(self + offset) % count]->deque.steal()) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void Scheduler::execute(Task *task) noexcept {
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+  const std::unique_ptr<Task> owned(task);
+  owned->run();
+}
+
+auto Scheduler::tryRunOne() -> bool {
+  Task *task = findTask();
+  if (task == nullptr) {
+    return false;
+  }
+  execute(task);
+  return true;
+}
+
+void Scheduler::workerLoop(std::size_t index) {
+  currentWorker = {this, index};
+  MY_CODE_TRACE_THREAD_NAME("scheduler worker " + std::to_string(index));
+  while (true) {
+    if (tryRunOne()) {
+      continue;
+    }
+    std::unique_lock guard(sleepMutex_);
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    wake_.wait(guard, [this] {
+      return stopping_ || queued_.load(std::memory_order_seq_cst) > 0;
+    });
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    if (stopping_ && queued_.load(std::memory_order_seq_cst) <= 0) {
+      return;
+    }
+  }
+}
+
+auto Scheduler::global() -> Scheduler & {
+  static Scheduler instance([] {
+    const std::lock_guard guard(globalMutex);
+    globalCreated = true;
+    return globalOptions.value_or(SchedulerOptions{});
+  }());
+  return instance;
+}
+
+void Scheduler::configureGlobal(SchedulerOptions options) {
+  const std::lock_guard guard(globalMutex);
+  if (globalCreated) {
+    throw std::logic_error("Scheduler: global scheduler already created");
+  }
+  globalOptions = std::move(options);
+}
+
+TaskGroup::~TaskGroup() { waitPending(); }
+
+void TaskGroup::run(std::function<void()> task) {
+  {
+    const std::lock_guard guard(mutex_);
+    ++pending_;
+  }
+  scheduler_.submit([this, task = std::move(task)] {
+    std::exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    finish(error);
+  });
+}
+
+void TaskGroup::finish(std::exception_ptr error) {
+  // Notify under the lock: once pending_ reaches zero the waiter may destroy
+  // the group as soon as it can re-acquire the mutex.
+  const std::lock_guard guard(mutex_);
+  if (error && !error_) {
+    error_ = std::move(error);
+  }
+  if (--pending_ == 0) {
+    done_.notify_all();
+  }
+}
+
+void TaskGroup::waitPending() {
+  while (true) {
+    {
+      const std::lock_guard guard(mutex_);
+      if (pending_ == 0) {
+        return;
+      }
+    }
+    if (scheduler_.tryRunOne()) {
+      continue;
+    }
+    // Everything left is running elsewhere; new child tasks are picked up
+    // by the workers, the timeout only lets this thread help again.
+    std::unique_lock guard(mutex_);
+    done_.wait_for(guard, std::chrono::milliseconds(1),
+                   [this] { return pending_ == 0; });
+  }
+}
+
+void TaskGroup::wait() {
+  MY_CODE_TRACE_SPAN("TaskGroup::wait");
+  waitPending();
+  std::exception_ptr error;
+  {
+    const std::lock_guard guard(mutex_);
+    error = std::exchange(error_, nullptr);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,119 @@
+#include "scheduler.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(SchedulerTests, TestParallelForCoversRangeOnce) {
+  Scheduler scheduler(SchedulerOptions{.threads = 3});
+  EXPECT_EQ(scheduler.workerCount(), 3U);
+  EXPECT_EQ(scheduler.concurrency(), 4U);
+
+  std::vector<std::atomic<int>> hits(10'007);
+  std::atomic<std::size_t> pieces{0};
+  scheduler.parallelFor(hits.size(), 100,
+                        [&](std::size_t begin, std::size_t end) {
+                          EXPECT_LE(end - begin, 100U);
+                          EXPECT_EQ(begin % 100, 0U);
+                          for (std::size_t i = begin; i < end; ++i) {
+                            hits[i].fetch_add(1);
+                          }
+                          pieces.fetch_add(1);
+                        });
+  for (const auto &hit : hits) {
+    ASSERT_EQ(hit.load(), 1);
+  }
+  EXPECT_EQ(pieces.load(), 101U);
+}
+
+TEST(SchedulerTests, TestNestedGroupsAndStealing) {
+  Scheduler scheduler(SchedulerOptions{.threads = 3});
+  // Four tasks that only finish once all four are running at the same time:
+  // three workers plus the waiting caller must each take one.
+  std::atomic<int> started{0};
+  std::mutex idsMutex;
+  std::set<std::thread::id> ids;
+  TaskGroup group(scheduler);
+  for (int i = 0; i < 4; ++i) {
+    group.run([&] {
+      {
+        const std::lock_guard guard(idsMutex);
+        ids.insert(std::this_thread::get_id());
+      }
+      started.fetch_add(1);
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while (started.load() < 4 &&
+             std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  group.wait();
+  EXPECT_EQ(started.load(), 4);
+  EXPECT_EQ(ids.size(), 4U);
+
+  // Recursive fork-join: tasks spawned on a worker land in its own deque
+  // and are stolen by the others.
+  std::atomic<long> total{0};
+  TaskGroup outer(scheduler);
+  for (int i = 0; i < 8; ++i) {
+    outer.run([&scheduler, &total] {
+      TaskGroup inner(scheduler);
+      for (int j = 0; j < 64; ++j) {
+        inner.run([&total, j] { total.fetch_add(j); });
+      }
+      inner.wait();
+    });
+  }
+  outer.wait();
+  EXPECT_EQ(total.load(), 8L * (63 * 64 / 2));
+}
+
+TEST(SchedulerTests, TestExceptionsReachTheWaiter) {
+  Scheduler scheduler(SchedulerOptions{.threads = 2});
+  TaskGroup group(scheduler);
+  std::atomic<int> ran{0};
+  for (int i = 0; i < 16; ++i) {
+    group.run([&ran, i] {
+      ran.fetch_add(1);
+      if (i == 5) {
+        throw std::runtime_error("task failed");
+      }
+    });
+  }
+  EXPECT_THROW(group.wait(), std::runtime_error);
+  EXPECT_EQ(ran.load(), 16);
+
+  EXPECT_THROW(scheduler.parallelFor(1000, 10,
+                                     [](std::size_t begin, std::size_t) {
+                                       if (begin == 500) {
+                                         throw std::logic_error("chunk");
+                                       }
+                                     }),
+               std::logic_error);
+}
+
+TEST(SchedulerTests, TestSubmitAndGlobalConfiguration) {
+  std::atomic<int> done{0};
+  {
+    Scheduler scheduler(
+        SchedulerOptions{.threads = 2, .pinThreads = true, .cores = {0}});
+    for (int i = 0; i < 100; ++i) {
+      scheduler.submit([&done] { done.fetch_add(1); });
+    }
+  } // The destructor runs what is still queued.
+  EXPECT_EQ(done.load(), 100);
+
+  EXPECT_THROW(Scheduler(SchedulerOptions{.cores = {-1}}),
+               std::invalid_argument);
+
+  Scheduler &global = Scheduler::global();
+  EXPECT_GE(global.workerCount(), 1U);
+  EXPECT_THROW(Scheduler::configureGlobal(SchedulerOptions{.threads = 1}),
+               std::logic_error);
+}
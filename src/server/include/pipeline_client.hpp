@@ -0,0 +1,47 @@
+#pragma once
+#include "wire_protocol.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Blocking client for PipelineServer. send() only encodes into a buffer;
+// requests go out on flush(), on receive(), or once the buffer holds
+// kFlushBytes, so any number of requests can be pipelined before their
+// responses are read back in order. While flushing, the client also reads
+// whatever responses arrive, so a long pipeline cannot deadlock against the
+// server's output limit. Connection and I/O failures throw
+// std::system_error; a connection the server closed throws
+// std::runtime_error from receive().
+class PipelineClient {
+public:
+  static constexpr std::size_t kFlushBytes = std::size_t{1} << 20U;
+
+  PipelineClient(const std::string &address, std::uint16_t port);
+  ~PipelineClient();
+  PipelineClient(const PipelineClient &) = delete;
+  auto operator=(const PipelineClient &) -> PipelineClient & = delete;
+  PipelineClient(PipelineClient &&) = delete;
+  auto operator=(PipelineClient &&) -> PipelineClient & = delete;
+
+  void send(const wire::Request &request);
+  void flush();
+  // The next response, in request order.
+  auto receive() -> wire::Response;
+  auto call(const wire::Request &request) -> wire::Response;
+
+  // Requests sent and not yet received.
+  [[nodiscard]] auto pending() const -> std::size_t { return pending_; }
+
+private:
+  // Reads what is available into input_; blocks first when wait is set.
+  void fill(bool wait);
+
+  int fd_ = -1;
+  std::vector<char> output_;
+  // input_[consumed_, received_) is unparsed.
+  std::vector<char> input_;
+  std::size_t consumed_ = 0;
+  std::size_t received_ = 0;
+  std::size_t pending_ = 0;
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include "logger.hpp"
+#include "notifier.hpp"
+#include "pipeline.hpp"
+#include "scheduler.hpp"
+#include "wire_protocol.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ServerOptions {
+  // IPv4 address to listen on.
+  std::string address = "127.0.0.1";
+  // 0 picks a free port; see PipelineServer::port().
+  std::uint16_t port = 0;
+  int backlog = 128;
+  // Larger request frames are rejected with Status::BadFrame.
+  std::size_t maxFrameBytes = std::size_t{16} << 20U;
+  // Connections whose frames are processed at the same time. Above 1 the
+  // Logger must be bounded, i.e. internally synchronised
+  // (std::invalid_argument otherwise).
+  std::size_t concurrency = 1;
+  // PipelineOptions::batchSize of the pipelines frames are run through.
+  std::size_t batchSize = 1024;
+  // nullptr selects Scheduler::global().
+  Scheduler *scheduler = nullptr;
+};
+
+struct ServerStats {
+  std::uint64_t connections = 0;
+  std::uint64_t frames = 0;
+  std::uint64_t operations = 0;
+  // Error responses sent, of any Status.
+  std::uint64_t errors = 0;
+};
+
+// Network frontend for the calculate -> log -> notify pipeline, speaking
+// the wire protocol (wire_protocol.hpp). One epoll thread owns the
+// sockets: it reads whatever each connection has sent, cuts it into whole
+// frames and hands them to a scheduler task, which runs each request
+// through a Pipeline and encodes the responses. The loop keeps reading the
+// connection's next frames meanwhile, but a connection has at most one task
+// at a time, so its requests are processed and answered in order. The bind
+// happens in the constructor (std::system_error on failure), so port() is
+// valid as soon as it returns.
+class PipelineServer {
+public:
+  PipelineServer(const Logger &logger, const Notifier &notifier,
+                 ServerOptions options = {});
+  // stop()s the server.
+  ~PipelineServer();
+  PipelineServer(const PipelineServer &) = delete;
+  auto operator=(const PipelineServer &) -> PipelineServer & = delete;
+  PipelineServer(PipelineServer &&) = delete;
+  auto operator=(PipelineServer &&) -> PipelineServer & = delete;
+
+  [[nodiscard]] auto port() const -> std::uint16_t { return port_; }
+  // Waits for running tasks, closes every connection and joins the event
+  // loop thread. Responses not yet written are discarded.
+  void stop();
+
+  [[nodiscard]] auto stats() const -> ServerStats;
+
+private:
+  struct Connection {
+    int fd = -1;
+    // input[0, received) has been read and not yet handed to a task.
+    std::vector<char> input;
+    std::size_t received = 0;
+    // Encoded responses and how much of them has been written.
+    std::vector<char> output;
+    std::size_t written = 0;
+    // A task owns this connection's frames; spare is the buffer it hands
+    // back, reused as the next input.
+    bool busy = false;
+    // Waiting in queued_ for a free task slot.
+    bool queued = false;
+    // The peer shut down, or the stream can no longer be framed: close once
+    // output is flushed and no task is running.
+    bool closing = false;
+    std::vector<char> spare;
+    std::uint32_t events = 0;
+  };
+  struct Completion {
+    int fd = -1;
+    std::vector<char> frames;
+    std::vector<char> responses;
+  };
+
+  void run();
+  void accept();
+  void read(Connection &connection);
+  void write(Connection &connection);
+  // Bytes at the front of input that form whole frames; marks the
+  // connection closing and queues an error for an invalid frame.
+  auto completeFrames(Connection &connection) -> std::size_t;
+  // Hands the connection's whole frames to a task, or queues it when
+  // concurrency tasks are already running.
+  void schedule(Connection &connection);
+  void dispatchQueued();
+  void start(Connection &connection, std::size_t bytes);
+  void finish(Completion completion);
+  void drainCompletions();
+  void process(std::span<const char> frames, std::vector<char> &out);
+  // Closes a connection that is done, or updates its epoll interest; the
+  // connection must not be used afterwards.
+  void updateEvents(Connection &connection);
+  void close(Connection &connection);
+
+  auto acquirePipeline() -> std::unique_ptr<Pipeline>;
+  void releasePipeline(std::unique_ptr<Pipeline> pipeline);
+
+  const Logger &logger_;
+  const Notifier &notifier_;
+  const ServerOptions options_;
+  Scheduler &scheduler_;
+  int listenFd_ = -1;
+  int epollFd_ = -1;
+  // Written by tasks and stop() to wake the event loop.
+  int wakeFd_ = -1;
+  std::uint16_t port_ = 0;
+
+  // Event loop thread only.
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+  std::deque<int> queued_;
+  std::size_t running_ = 0;
+
+  std::mutex completionMutex_;
+  std::vector<Completion> completions_;
+  std::atomic<bool> stopping_{false};
+
+  std::mutex pipelineMutex_;
+  std::vector<std::unique_ptr<Pipeline>> pipelines_;
+
+  std::atomic<std::uint64_t> connectionsAccepted_{0};
+  std::atomic<std::uint64_t> frames_{0};
+  std::atomic<std::uint64_t> operations_{0};
+  std::atomic<std::uint64_t> errors_{0};
+
+  std::mutex stopMutex_;
+  std::thread loop_;
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "calculator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Length-prefixed binary protocol of PipelineServer. A frame is a 16-byte
+// header followed by its body. Every frame is padded to a multiple of 8
+// bytes so the int and mask arrays inside it stay aligned in a stream of
+// frames. All fields are little-endian, and operands are sent as raw int32
+// arrays that the server hands to Pipeline::process without copying.
+//
+// Request: header{type Request, code Operation, flags, labelLength, id,
+//   count}, label (padded to 8), lhs[count], rhs[count].
+// Response: header{type Response, code Status::Ok, flags, 0, id, count},
+//   logged, notified (uint32), then results[count] (padded to 8) if
+//   kWantResults, then Notifier::maskWords(count) mask words if kWantMask.
+// Error: header{type Response, code Status, 0, 0, id, 0}, message (padded).
+//
+// Clients may pipeline any number of requests; responses come back in
+// request order on each connection. id is echoed and not interpreted.
+namespace wire {
+
+inline constexpr std::size_t kHeaderSize = 16;
+inline constexpr std::size_t kAlignment = 8;
+inline constexpr std::size_t kMaxLabelLength = 255;
+
+// Request flags.
+inline constexpr std::uint8_t kWantResults = 1U << 0U;
+inline constexpr std::uint8_t kWantMask = 1U << 1U;
+
+enum class FrameType : std::uint8_t { Request = 1, Response = 2 };
+
+enum class Status : std::uint8_t {
+  Ok = 0,
+  // The frame is malformed. If its header is unusable the server can no
+  // longer find frame boundaries and closes the connection after the error.
+  BadFrame = 1,
+  BadOperation = 2,
+  // The pipeline threw; the message is its what().
+  Failed = 3,
+};
+
+struct FrameHeader {
+  // Whole frame in bytes, header included.
+  std::uint32_t size = 0;
+  FrameType type = FrameType::Request;
+  // Operation for requests, Status for responses.
+  std::uint8_t code = 0;
+  std::uint8_t flags = 0;
+  std::uint8_t labelLength = 0;
+  std::uint32_t id = 0;
+  std::uint32_t count = 0;
+};
+
+struct Request {
+  std::uint32_t id = 0;
+  Operation operation = Operation::Add;
+  std::uint8_t flags = 0;
+  std::string_view label{};
+  std::span<const int> lhs{};
+  std::span<const int> rhs{};
+};
+
+// A parsed request frame; the views point into the frame.
+struct RequestView {
+  FrameHeader header;
+  std::string_view label;
+  std::span<const int> lhs;
+  std::span<const int> rhs;
+};
+
+struct Response {
+  std::uint32_t id = 0;
+  Status status = Status::Ok;
+  std::uint32_t count = 0;
+  std::uint32_t logged = 0;
+  std::uint32_t notified = 0;
+  // Filled for requests with kWantResults and kWantMask.
+  std::vector<int> results;
+  std::vector<std::uint64_t> mask;
+  // Status other than Ok only.
+  std::string error;
+};
+
+[[nodiscard]] constexpr auto padded(std::size_t bytes) -> std::size_t {
+  return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+[[nodiscard]] auto requestSize(std::size_t labelLength, std::size_t count)
+    -> std::size_t;
+[[nodiscard]] auto responseSize(std::uint8_t flags, std::size_t count)
+    -> std::size_t;
+
+// bytes must hold at least kHeaderSize bytes.
+[[nodiscard]] auto readHeader(std::span<const char> bytes) -> FrameHeader;
+void writeHeader(char *out, const FrameHeader &header);
+
+// Appends one request frame. Throws std::invalid_argument if lhs and rhs
+// differ in size or the label is longer than kMaxLabelLength.
+void appendRequest(std::vector<char> &out, const Request &request);
+// Parses one whole request frame; throws std::invalid_argument if it is
+// malformed.
+[[nodiscard]] auto parseRequest(std::span<const char> frame) -> RequestView;
+
+void appendError(std::vector<char> &out, std::uint32_t id, Status status,
+                 std::string_view message);
+// Parses one whole response frame; throws std::invalid_argument if it is
+// malformed.
+[[nodiscard]] auto parseResponse(std::span<const char> frame) -> Response;
+
+} // namespace wire
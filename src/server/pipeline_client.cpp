@@ -0,0 +1,153 @@
+#include "pipeline_client.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <span>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t kReadChunk = std::size_t{256} << 10U;
+
+[[noreturn]] void throwErrno(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+PipelineClient::PipelineClient(const std::string &address,
+                               std::uint16_t port) {
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  if (::inet_pton(AF_INET, address.c_str(), &server.sin_addr) != 1) {
+    throw std::invalid_argument("PipelineClient: invalid IPv4 address");
+  }
+  fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    throwErrno("PipelineClient: socket");
+  }
+  if (::connect(fd_, reinterpret_cast<const sockaddr *>(&server),
+                sizeof(server)) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw std::system_error(error, std::generic_category(),
+                            "PipelineClient: connect");
+  }
+  const int on = 1;
+  ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+PipelineClient::~PipelineClient() { ::close(fd_); }
+
+void PipelineClient::send(const wire::Request &request) {
+  wire::appendRequest(output_, request);
+  ++pending_;
+  if (output_.size() >= kFlushBytes) {
+    flush();
+  }
+}
+
+void PipelineClient::flush() {
+  std::size_t written = 0;
+  while (written < output_.size()) {
+    pollfd events{fd_, POLLIN | POLLOUT, 0};
+    if (::poll(&events, 1, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throwErrno("PipelineClient: poll");
+    }
+    if ((events.revents & POLLIN) != 0) {
+      fill(false);
+    }
+    if ((events.revents & (POLLOUT | POLLERR | POLLHUP)) == 0) {
+      continue;
+    }
+    const ssize_t sent =
+        ::send(fd_, output_.data() + written, output_.size() - written,
+               MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+        continue;
+      }
+      throwErrno("PipelineClient: send");
+    }
+    written += static_cast<std::size_t>(sent);
+  }
+  output_.clear();
+}
+
+auto PipelineClient::receive() -> wire::Response {
+  if (pending_ == 0) {
+    throw std::logic_error("PipelineClient: no request is pending");
+  }
+  flush();
+  while (true) {
+    const std::size_t available = received_ - consumed_;
+    if (available >= wire::kHeaderSize) {
+      const std::span<const char> bytes(input_.data() + consumed_, available);
+      const wire::FrameHeader header = wire::readHeader(bytes);
+      if (header.size < wire::kHeaderSize) {
+        throw std::runtime_error("PipelineClient: malformed response");
+      }
+      if (available >= header.size) {
+        wire::Response response =
+            wire::parseResponse(bytes.first(header.size));
+        consumed_ += header.size;
+        --pending_;
+        return response;
+      }
+    }
+    fill(true);
+  }
+}
+
+auto PipelineClient::call(const wire::Request &request) -> wire::Response {
+  send(request);
+  return receive();
+}
+
+void PipelineClient::fill(bool wait) {
+  if (consumed_ == received_) {
+    consumed_ = 0;
+    received_ = 0;
+  }
+  if (input_.size() - received_ < kReadChunk) {
+    if (consumed_ != 0) {
+      std::memmove(input_.data(), input_.data() + consumed_,
+                   received_ - consumed_);
+      received_ -= consumed_;
+      consumed_ = 0;
+    }
+    if (input_.size() - received_ < kReadChunk) {
+      input_.resize(std::max(input_.size() * 2, received_ + kReadChunk));
+    }
+  }
+  while (true) {
+    const ssize_t got = ::recv(fd_, input_.data() + received_,
+                               input_.size() - received_,
+                               wait ? 0 : MSG_DONTWAIT);
+    if (got > 0) {
+      received_ += static_cast<std::size_t>(got);
+      return;
+    }
+    if (got == 0) {
+      throw std::runtime_error("PipelineClient: connection closed");
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (!wait && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    throwErrno("PipelineClient: recv");
+  }
+}
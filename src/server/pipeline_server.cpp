@@ -0,0 +1,529 @@
+#include "pipeline_server.hpp"
+#include "tracing.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t kReadChunk = std::size_t{256} << 10U;
+constexpr int kMaxEvents = 64;
+// Offset of the results array in an Ok response.
+constexpr std::size_t kResultsOffset = wire::kHeaderSize + 8;
+
+[[noreturn]] void throwErrno(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+void closeFd(int &fd) {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+auto validOperation(std::uint8_t code) -> bool {
+  return code <= static_cast<std::uint8_t>(Operation::Multiply);
+}
+
+// Appends size bytes to out and returns their offset.
+auto grow(std::vector<char> &out, std::size_t size) -> std::size_t {
+  const std::size_t offset = out.size();
+  out.resize(offset + size);
+  return offset;
+}
+
+} // namespace
+
+PipelineServer::PipelineServer(const Logger &logger, const Notifier &notifier,
+                               ServerOptions options)
+    : logger_(logger), notifier_(notifier), options_(std::move(options)),
+      scheduler_(options_.scheduler != nullptr ? *options_.scheduler
+                                               : Scheduler::global()) {
+  if (options_.concurrency == 0) {
+    throw std::invalid_argument("PipelineServer: concurrency must be > 0");
+  }
+  if (options_.concurrency > 1 && logger_.options().capacity == 0) {
+    throw std::invalid_argument(
+        "PipelineServer: concurrency above 1 needs a bounded Logger");
+  }
+  if (options_.maxFrameBytes < wire::kHeaderSize) {
+    throw std::invalid_argument("PipelineServer: maxFrameBytes is too small");
+  }
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(options_.port);
+  if (::inet_pton(AF_INET, options_.address.c_str(), &address.sin_addr) !=
+      1) {
+    throw std::invalid_argument("PipelineServer: invalid IPv4 address");
+  }
+  try {
+    listenFd_ =
+        ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) {
+      throwErrno("PipelineServer: socket");
+    }
+    const int on = 1;
+    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (::bind(listenFd_, reinterpret_cast<const sockaddr *>(&address),
+               sizeof(address)) != 0) {
+      throwErrno("PipelineServer: bind");
+    }
+    if (::listen(listenFd_, options_.backlog) != 0) {
+      throwErrno("PipelineServer: listen");
+    }
+    socklen_t length = sizeof(address);
+    if (::getsockname(listenFd_, reinterpret_cast<sockaddr *>(&address),
+                      &length) != 0) {
+      throwErrno("PipelineServer: getsockname");
+    }
+    port_ = ntohs(address.sin_port);
+
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd_ < 0 || wakeFd_ < 0) {
+      throwErrno("PipelineServer: epoll");
+    }
+    for (const int fd : {listenFd_, wakeFd_}) {
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.fd = fd;
+      if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+        throwErrno("PipelineServer: epoll_ctl");
+      }
+    }
+    loop_ = std::thread([this] { run(); });
+  } catch (...) {
+    closeFd(wakeFd_);
+    closeFd(epollFd_);
+    closeFd(listenFd_);
+    throw;
+  }
+}
+
+PipelineServer::~PipelineServer() { stop(); }
+
+void PipelineServer::stop() {
+  const std::lock_guard<std::mutex> lock(stopMutex_);
+  if (!loop_.joinable()) {
+    return;
+  }
+  stopping_.store(true);
+  const std::uint64_t one = 1;
+  [[maybe_unused]] const auto written = ::write(wakeFd_, &one, sizeof(one));
+  loop_.join();
+  closeFd(wakeFd_);
+  closeFd(epollFd_);
+  closeFd(listenFd_);
+}
+
+auto PipelineServer::stats() const -> ServerStats {
+  return {connectionsAccepted_.load(std::memory_order_relaxed),
+          frames_.load(std::memory_order_relaxed),
+          operations_.load(std::memory_order_relaxed),
+          errors_.load(std::memory_order_relaxed)};
+}
+
+void PipelineServer::run() {
+  std::vector<epoll_event> events(kMaxEvents);
+  while (!stopping_.load()) {
+    const int ready = ::epoll_wait(epollFd_, events.data(), kMaxEvents, -1);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    for (int i = 0; i < ready; ++i) {
+      const int fd = events[i].data.fd;
+      const std::uint32_t flags = events[i].events;
+      if (fd == listenFd_) {
+        accept();
+        continue;
+      }
+      if (fd == wakeFd_) {
+        drainCompletions();
+        continue;
+      }
+      const auto found = connections_.find(fd);
+      if (found == connections_.end()) {
+        continue;
+      }
+      Connection &connection = *found->second;
+      if ((flags & EPOLLOUT) != 0) {
+        write(connection);
+      }
+      if ((flags & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0) {
+        read(connection);
+      }
+      schedule(connection);
+      updateEvents(connection);
+    }
+  }
+
+  // Tasks refer to the server: wait for them before tearing down.
+  while (running_ > 0) {
+    pollfd wake{wakeFd_, POLLIN, 0};
+    ::poll(&wake, 1, -1);
+    std::uint64_t count = 0;
+    [[maybe_unused]] const auto got = ::read(wakeFd_, &count, sizeof(count));
+    const std::lock_guard<std::mutex> lock(completionMutex_);
+    running_ -= completions_.size();
+    completions_.clear();
+  }
+  for (auto &[fd, connection] : connections_) {
+    ::close(fd);
+  }
+  connections_.clear();
+  queued_.clear();
+}
+
+void PipelineServer::accept() {
+  while (true) {
+    const int fd =
+        ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // EAGAIN, or a connection that went away before it was accepted.
+      return;
+    }
+    const int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    auto connection = std::make_unique<Connection>();
+    connection->fd = fd;
+    connection->input.resize(kReadChunk);
+    connection->events = EPOLLIN;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+      ::close(fd);
+      continue;
+    }
+    connections_.emplace(fd, std::move(connection));
+    connectionsAccepted_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void PipelineServer::read(Connection &connection) {
+  while (!connection.closing && connection.received < options_.maxFrameBytes) {
+    if (connection.input.size() - connection.received < kReadChunk) {
+      connection.input.resize(
+          std::max(connection.input.size() * 2,
+                   connection.received + kReadChunk));
+    }
+    const ssize_t got =
+        ::recv(connection.fd, connection.input.data() + connection.received,
+               connection.input.size() - connection.received, 0);
+    if (got > 0) {
+      connection.received += static_cast<std::size_t>(got);
+      continue;
+    }
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    // Orderly shutdown or a reset: answer what has arrived, then close.
+    connection.closing = true;
+  }
+}
+
+void PipelineServer::write(Connection &connection) {
+  while (connection.written < connection.output.size()) {
+    const ssize_t sent =
+        ::send(connection.fd, connection.output.data() + connection.written,
+               connection.output.size() - connection.written, MSG_NOSIGNAL);
+    if (sent > 0) {
+      connection.written += static_cast<std::size_t>(sent);
+      continue;
+    }
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    // The peer is gone; nothing more can be delivered.
+    connection.output.clear();
+    connection.written = 0;
+    connection.closing = true;
+    return;
+  }
+  connection.output.clear();
+  connection.written = 0;
+}
+
+auto PipelineServer::completeFrames(Connection &connection) -> std::size_t {
+  std::size_t offset = 0;
+  while (connection.received - offset >= wire::kHeaderSize) {
+    const wire::FrameHeader header = wire::readHeader(
+        {connection.input.data() + offset, wire::kHeaderSize});
+    if (header.size < wire::kHeaderSize ||
+        header.size % wire::kAlignment != 0 ||
+        header.size > options_.maxFrameBytes ||
+        header.type != wire::FrameType::Request) {
+      if (offset == 0) {
+        // Everything before it has been answered: report it and give up on
+        // the stream.
+        wire::appendError(connection.output, header.id,
+                          wire::Status::BadFrame, "invalid frame header");
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        connection.closing = true;
+        connection.received = 0;
+      }
+      break;
+    }
+    if (connection.received - offset < header.size) {
+      break;
+    }
+    offset += header.size;
+  }
+  return offset;
+}
+
+void PipelineServer::schedule(Connection &connection) {
+  if (connection.busy || connection.queued) {
+    return;
+  }
+  if (running_ >= options_.concurrency) {
+    if (connection.received >= wire::kHeaderSize) {
+      connection.queued = true;
+      queued_.push_back(connection.fd);
+    }
+    return;
+  }
+  const std::size_t bytes = completeFrames(connection);
+  if (bytes != 0) {
+    start(connection, bytes);
+  } else {
+    write(connection);
+  }
+}
+
+void PipelineServer::dispatchQueued() {
+  while (running_ < options_.concurrency && !queued_.empty()) {
+    const int fd = queued_.front();
+    queued_.pop_front();
+    const auto found = connections_.find(fd);
+    if (found == connections_.end()) {
+      continue;
+    }
+    Connection &connection = *found->second;
+    connection.queued = false;
+    schedule(connection);
+    updateEvents(connection);
+  }
+}
+
+void PipelineServer::start(Connection &connection, std::size_t bytes) {
+  connection.busy = true;
+  ++running_;
+  // The task takes the whole buffer; the partial frame after its frames
+  // moves to the spare buffer, which becomes the new input.
+  std::vector<char> frames = std::move(connection.input);
+  std::vector<char> &input = connection.spare;
+  const std::size_t rest = connection.received - bytes;
+  if (input.size() < std::max(frames.size(), rest + kReadChunk)) {
+    input.resize(std::max(frames.size(), rest + kReadChunk));
+  }
+  std::memcpy(input.data(), frames.data() + bytes, rest);
+  connection.input = std::move(input);
+  connection.spare = {};
+  connection.received = rest;
+
+  scheduler_.submit([this, fd = connection.fd, frames = std::move(frames),
+                     bytes]() mutable {
+    Completion completion{fd, std::move(frames), {}};
+    try {
+      process({completion.frames.data(), bytes}, completion.responses);
+    } catch (const std::exception &) {
+      // Out of memory while encoding; the client sees the connection close.
+      completion.responses.clear();
+    }
+    // Wake the loop under the lock: once run() has counted this completion
+    // the server may be destroyed, so the task must not touch it after the
+    // unlock.
+    const std::lock_guard<std::mutex> lock(completionMutex_);
+    completions_.push_back(std::move(completion));
+    const std::uint64_t one = 1;
+    [[maybe_unused]] const auto written = ::write(wakeFd_, &one, sizeof(one));
+  });
+}
+
+void PipelineServer::drainCompletions() {
+  std::uint64_t count = 0;
+  [[maybe_unused]] const auto got = ::read(wakeFd_, &count, sizeof(count));
+  std::vector<Completion> done;
+  {
+    const std::lock_guard<std::mutex> lock(completionMutex_);
+    done.swap(completions_);
+  }
+  for (Completion &completion : done) {
+    finish(std::move(completion));
+  }
+  dispatchQueued();
+}
+
+void PipelineServer::finish(Completion completion) {
+  --running_;
+  Connection &connection = *connections_.at(completion.fd);
+  connection.busy = false;
+  connection.spare = std::move(completion.frames);
+  if (completion.responses.empty()) {
+    connection.closing = true;
+  } else if (connection.output.empty()) {
+    connection.output = std::move(completion.responses);
+  } else {
+    connection.output.insert(connection.output.end(),
+                             completion.responses.begin(),
+                             completion.responses.end());
+  }
+  write(connection);
+  schedule(connection);
+  updateEvents(connection);
+}
+
+void PipelineServer::process(std::span<const char> frames,
+                             std::vector<char> &out) {
+  MY_CODE_TRACE_SPAN_ITEMS("PipelineServer::process", frames.size());
+  std::unique_ptr<Pipeline> pipeline = acquirePipeline();
+  std::size_t size = 0;
+  for (std::size_t offset = 0; offset < frames.size();) {
+    const wire::FrameHeader header =
+        wire::readHeader(frames.subspan(offset, wire::kHeaderSize));
+    // Only frames whose size matches their count get a full response; a
+    // count the frame does not carry must not size the buffer.
+    if (header.size == wire::requestSize(header.labelLength, header.count)) {
+      size += wire::responseSize(header.flags, header.count);
+    }
+    offset += header.size;
+  }
+  out.reserve(size);
+
+  std::uint64_t count = 0;
+  std::uint64_t operations = 0;
+  for (std::size_t offset = 0; offset < frames.size(); ++count) {
+    const std::span<const char> frame = frames.subspan(
+        offset, wire::readHeader(frames.subspan(offset)).size);
+    offset += frame.size();
+    wire::RequestView request;
+    try {
+      request = wire::parseRequest(frame);
+    } catch (const std::invalid_argument &error) {
+      wire::appendError(out, wire::readHeader(frame).id,
+                        wire::Status::BadFrame, error.what());
+      errors_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    const wire::FrameHeader &header = request.header;
+    if (!validOperation(header.code)) {
+      wire::appendError(out, header.id, wire::Status::BadOperation,
+                        "unknown operation");
+      errors_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    const std::size_t responseSize =
+        wire::responseSize(header.flags, header.count);
+    const std::size_t slot = grow(out, responseSize);
+    // Responses are 8-byte multiples, so the arrays are aligned.
+    std::span<int> results;
+    std::span<std::uint64_t> mask;
+    std::size_t arrays = slot + kResultsOffset;
+    if ((header.flags & wire::kWantResults) != 0) {
+      results = {reinterpret_cast<int *>(out.data() + arrays), header.count};
+      arrays += wire::padded(header.count * sizeof(int));
+    }
+    if ((header.flags & wire::kWantMask) != 0) {
+      mask = {reinterpret_cast<std::uint64_t *>(out.data() + arrays),
+              Notifier::maskWords(header.count)};
+    }
+    try {
+      const PipelineResult result =
+          pipeline->process(static_cast<Operation>(header.code),
+                            request.label, request.lhs, request.rhs,
+                            results, mask);
+      wire::writeHeader(out.data() + slot,
+                        {.size = static_cast<std::uint32_t>(responseSize),
+                         .type = wire::FrameType::Response,
+                         .code = static_cast<std::uint8_t>(wire::Status::Ok),
+                         .flags = header.flags,
+                         .id = header.id,
+                         .count = header.count});
+      const auto logged = static_cast<std::uint32_t>(result.logged);
+      const auto notified = static_cast<std::uint32_t>(result.notified);
+      std::memcpy(out.data() + slot + wire::kHeaderSize, &logged, 4);
+      std::memcpy(out.data() + slot + wire::kHeaderSize + 4, &notified, 4);
+      operations += header.count;
+    } catch (const std::exception &error) {
+      out.resize(slot);
+      wire::appendError(out, header.id, wire::Status::Failed, error.what());
+      errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  releasePipeline(std::move(pipeline));
+  frames_.fetch_add(count, std::memory_order_relaxed);
+  operations_.fetch_add(operations, std::memory_order_relaxed);
+}
+
+void PipelineServer::updateEvents(Connection &connection) {
+  if (connection.closing && !connection.busy && !connection.queued &&
+      connection.output.empty()) {
+    close(connection);
+    return;
+  }
+  std::uint32_t events = 0;
+  if (!connection.closing && connection.received < options_.maxFrameBytes &&
+      connection.output.size() - connection.written <
+          options_.maxFrameBytes) {
+    events |= EPOLLIN;
+  }
+  if (connection.written < connection.output.size()) {
+    events |= EPOLLOUT;
+  }
+  if (events != connection.events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = connection.fd;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.events = events;
+  }
+}
+
+void PipelineServer::close(Connection &connection) {
+  const int fd = connection.fd;
+  ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  connections_.erase(fd);
+}
+
+auto PipelineServer::acquirePipeline() -> std::unique_ptr<Pipeline> {
+  {
+    const std::lock_guard<std::mutex> lock(pipelineMutex_);
+    if (!pipelines_.empty()) {
+      std::unique_ptr<Pipeline> pipeline = std::move(pipelines_.back());
+      pipelines_.pop_back();
+      return pipeline;
+    }
+  }
+  return std::make_unique<Pipeline>(
+      logger_, notifier_, PipelineOptions{.batchSize = options_.batchSize});
+}
+
+void PipelineServer::releasePipeline(std::unique_ptr<Pipeline> pipeline) {
+  const std::lock_guard<std::mutex> lock(pipelineMutex_);
+  pipelines_.push_back(std::move(pipeline));
+}
@@ -0,0 +1,237 @@
+#include "pipeline_client.hpp"
+#include "pipeline_server.hpp"
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <cstdint>
+#include <netinet/in.h>
+#include <numeric>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Connects a plain socket, for frames PipelineClient would refuse to send.
+auto rawConnect(std::uint16_t port) -> int {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  ::inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+  EXPECT_EQ(::connect(fd, reinterpret_cast<const sockaddr *>(&server),
+                      sizeof(server)),
+            0);
+  return fd;
+}
+
+// Reads until the server closes the connection.
+auto readAll(int fd) -> std::vector<char> {
+  std::vector<char> bytes;
+  char buffer[4096];
+  ssize_t got = 0;
+  while ((got = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    bytes.insert(bytes.end(), buffer, buffer + got);
+  }
+  return bytes;
+}
+
+} // namespace
+
+TEST(PipelineServerTests, TestWireRoundTrip) {
+  const std::vector<int> lhs{1, -2, 3};
+  const std::vector<int> rhs{4, 5, -6};
+  std::vector<char> bytes;
+  wire::appendRequest(bytes, {.id = 9,
+                              .operation = Operation::Subtract,
+                              .flags = wire::kWantResults,
+                              .label = "sub",
+                              .lhs = lhs,
+                              .rhs = rhs});
+  ASSERT_EQ(bytes.size(), wire::requestSize(3, 3));
+  EXPECT_EQ(bytes.size() % wire::kAlignment, 0u);
+
+  const wire::RequestView request = wire::parseRequest(bytes);
+  EXPECT_EQ(request.header.id, 9u);
+  EXPECT_EQ(request.header.code,
+            static_cast<std::uint8_t>(Operation::Subtract));
+  EXPECT_EQ(request.label, "sub");
+  EXPECT_EQ(std::vector<int>(request.lhs.begin(), request.lhs.end()), lhs);
+  EXPECT_EQ(std::vector<int>(request.rhs.begin(), request.rhs.end()), rhs);
+
+  bytes.pop_back();
+  EXPECT_THROW((void)wire::parseRequest(bytes), std::invalid_argument);
+  EXPECT_THROW(wire::appendRequest(bytes, {.lhs = lhs}),
+               std::invalid_argument);
+
+  std::vector<char> error;
+  wire::appendError(error, 4, wire::Status::Failed, "boom");
+  const wire::Response response = wire::parseResponse(error);
+  EXPECT_EQ(response.id, 4u);
+  EXPECT_EQ(response.status, wire::Status::Failed);
+  EXPECT_EQ(response.error, "boom");
+}
+
+TEST(PipelineServerTests, TestPipelinedBatchesAnswerInOrder) {
+  const Logger logger;
+  const Notifier notifier(100);
+  PipelineServer server(logger, notifier, ServerOptions{.batchSize = 64});
+  ASSERT_NE(server.port(), 0);
+
+  PipelineClient client("127.0.0.1", server.port());
+  constexpr std::uint32_t kBatches = 50;
+  std::vector<int> lhs(1000);
+  std::iota(lhs.begin(), lhs.end(), -500);
+  const std::vector<int> rhs(lhs.size(), 3);
+  for (std::uint32_t id = 0; id < kBatches; ++id) {
+    // Batches of different lengths, so frames straddle reads.
+    const std::size_t count = 1 + (id * 37) % lhs.size();
+    client.send({.id = id,
+                 .operation = Operation::Multiply,
+                 .flags = wire::kWantResults | wire::kWantMask,
+                 .label = "mul",
+                 .lhs = std::span<const int>(lhs).first(count),
+                 .rhs = std::span<const int>(rhs).first(count)});
+  }
+  EXPECT_EQ(client.pending(), kBatches);
+
+  std::size_t total = 0;
+  for (std::uint32_t id = 0; id < kBatches; ++id) {
+    const wire::Response response = client.receive();
+    const std::size_t count = 1 + (id * 37) % lhs.size();
+    ASSERT_EQ(response.status, wire::Status::Ok) << response.error;
+    EXPECT_EQ(response.id, id);
+    EXPECT_EQ(response.count, count);
+    EXPECT_EQ(response.logged, count);
+
+    std::vector<int> expected(count);
+    Calculator::multiply(std::span<const int>(lhs).first(count),
+                         std::span<const int>(rhs).first(count), expected);
+    EXPECT_EQ(response.results, expected);
+    EXPECT_EQ(response.mask, notifier.shouldNotify(expected));
+    EXPECT_EQ(response.notified, notifier.exceedingIndices(expected).size());
+    total += count;
+  }
+  EXPECT_EQ(logger.size(), total);
+  const ServerStats stats = server.stats();
+  EXPECT_EQ(stats.connections, 1u);
+  EXPECT_EQ(stats.frames, kBatches);
+  EXPECT_EQ(stats.operations, total);
+  EXPECT_EQ(stats.errors, 0u);
+}
+
+TEST(PipelineServerTests, TestErrorResponses) {
+  const Logger logger;
+  const Notifier notifier(10);
+  PipelineServer server(logger, notifier);
+  const std::vector<int> values{1, 2};
+
+  // An unknown operation fails only its own request.
+  PipelineClient client("127.0.0.1", server.port());
+  client.send({.id = 1, .operation = static_cast<Operation>(7),
+               .lhs = values, .rhs = values});
+  client.send({.id = 2, .lhs = values, .rhs = values});
+  const wire::Response bad = client.receive();
+  EXPECT_EQ(bad.id, 1u);
+  EXPECT_EQ(bad.status, wire::Status::BadOperation);
+  const wire::Response good = client.receive();
+  EXPECT_EQ(good.status, wire::Status::Ok);
+  EXPECT_EQ(good.logged, 2u);
+
+  // A header without a usable size ends the connection after an error.
+  const int fd = rawConnect(server.port());
+  std::vector<char> frame(wire::kHeaderSize);
+  wire::writeHeader(frame.data(), {.size = 13, .id = 5});
+  ASSERT_EQ(::send(fd, frame.data(), frame.size(), 0),
+            static_cast<ssize_t>(frame.size()));
+  const std::vector<char> reply = readAll(fd);
+  ::close(fd);
+  const wire::Response closed = wire::parseResponse(reply);
+  EXPECT_EQ(closed.id, 5u);
+  EXPECT_EQ(closed.status, wire::Status::BadFrame);
+  EXPECT_EQ(server.stats().errors, 2u);
+
+  // A count the frame does not carry fails that frame alone; the requests
+  // before it are still answered.
+  const int oversized = rawConnect(server.port());
+  std::vector<char> stream;
+  wire::appendRequest(stream, {.id = 1, .lhs = values, .rhs = values});
+  const std::size_t valid = stream.size();
+  stream.resize(valid + wire::kHeaderSize);
+  wire::writeHeader(stream.data() + valid,
+                    {.size = static_cast<std::uint32_t>(wire::kHeaderSize),
+                     .type = wire::FrameType::Request,
+                     .flags = wire::kWantResults | wire::kWantMask,
+                     .id = 2,
+                     .count = 0xFFFF'FFFFU});
+  ASSERT_EQ(::send(oversized, stream.data(), stream.size(), 0),
+            static_cast<ssize_t>(stream.size()));
+  ::shutdown(oversized, SHUT_WR);
+  const std::vector<char> answers = readAll(oversized);
+  ::close(oversized);
+  ASSERT_GE(answers.size(), wire::kHeaderSize);
+  const std::size_t first = wire::readHeader(answers).size;
+  ASSERT_LT(first, answers.size());
+  const wire::Response ok =
+      wire::parseResponse(std::span<const char>(answers).first(first));
+  EXPECT_EQ(ok.id, 1u);
+  EXPECT_EQ(ok.status, wire::Status::Ok);
+  const wire::Response rejected =
+      wire::parseResponse(std::span<const char>(answers).subspan(first));
+  EXPECT_EQ(rejected.id, 2u);
+  EXPECT_EQ(rejected.status, wire::Status::BadFrame);
+  EXPECT_EQ(server.stats().errors, 3u);
+
+  EXPECT_THROW(PipelineServer(logger, notifier,
+                              ServerOptions{.concurrency = 2}),
+               std::invalid_argument);
+  EXPECT_THROW(PipelineServer(logger, notifier,
+                              ServerOptions{.address = "not an address"}),
+               std::invalid_argument);
+}
+
+TEST(PipelineServerTests, TestConcurrentConnections) {
+  const Logger logger(LoggerOptions{.capacity = 1 << 16});
+  const Notifier notifier(50);
+  Scheduler scheduler(SchedulerOptions{.threads = 3});
+  PipelineServer server(logger, notifier,
+                        ServerOptions{.concurrency = 4,
+                                      .scheduler = &scheduler});
+  constexpr int kClients = 4;
+  constexpr std::uint32_t kBatches = 200;
+  const std::vector<int> lhs(256, 20);
+  const std::vector<int> rhs(256, 2);
+
+  std::vector<std::thread> clients;
+  std::vector<std::uint32_t> answered(kClients);
+  for (int c = 0; c < kClients; ++c) {
+    clients.emplace_back([&, c] {
+      PipelineClient client("127.0.0.1", server.port());
+      for (std::uint32_t id = 0; id < kBatches; ++id) {
+        client.send({.id = id, .lhs = lhs, .rhs = rhs});
+      }
+      for (std::uint32_t id = 0; id < kBatches; ++id) {
+        const wire::Response response = client.receive();
+        // 20 + 2 never exceeds the threshold.
+        if (response.id == id && response.status == wire::Status::Ok &&
+            response.notified == 0) {
+          ++answered[c];
+        }
+      }
+    });
+  }
+  for (std::thread &client : clients) {
+    client.join();
+  }
+  for (const std::uint32_t count : answered) {
+    EXPECT_EQ(count, kBatches);
+  }
+  const ServerStats stats = server.stats();
+  EXPECT_EQ(stats.connections, static_cast<std::uint64_t>(kClients));
+  EXPECT_EQ(stats.frames, kClients * kBatches);
+  EXPECT_EQ(stats.operations, kClients * kBatches * lhs.size());
+  EXPECT_EQ(logger.stats().appended, stats.operations);
+  server.stop();
+  server.stop();
+}
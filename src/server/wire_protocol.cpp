@@ -0,0 +1,180 @@
+#include "wire_protocol.hpp"
+#include "notifier.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace wire {
+
+static_assert(std::endian::native == std::endian::little,
+              "the wire protocol sends operands in host byte order");
+
+namespace {
+
+constexpr std::size_t kResponseCounters = 8;
+
+[[noreturn]] void throwMalformed(const char *what) {
+  throw std::invalid_argument(std::string("wire: ") + what);
+}
+
+template <class T> auto load(const char *in) -> T {
+  T value;
+  std::memcpy(&value, in, sizeof(value));
+  return value;
+}
+
+template <class T> void store(char *out, T value) {
+  std::memcpy(out, &value, sizeof(value));
+}
+
+// Appends size zeroed bytes and returns where they start.
+auto grow(std::vector<char> &out, std::size_t size) -> char * {
+  const std::size_t offset = out.size();
+  out.resize(offset + size);
+  return out.data() + offset;
+}
+
+auto checkFrame(std::span<const char> frame, FrameType type) -> FrameHeader {
+  if (frame.size() < kHeaderSize) {
+    throwMalformed("frame is shorter than its header");
+  }
+  const FrameHeader header = readHeader(frame);
+  if (header.size != frame.size()) {
+    throwMalformed("frame size does not match its header");
+  }
+  if (header.type != type) {
+    throwMalformed("unexpected frame type");
+  }
+  return header;
+}
+
+} // namespace
+
+auto requestSize(std::size_t labelLength, std::size_t count) -> std::size_t {
+  return kHeaderSize + padded(labelLength) + 2 * count * sizeof(int);
+}
+
+auto responseSize(std::uint8_t flags, std::size_t count) -> std::size_t {
+  std::size_t size = kHeaderSize + kResponseCounters;
+  if ((flags & kWantResults) != 0) {
+    size += padded(count * sizeof(int));
+  }
+  if ((flags & kWantMask) != 0) {
+    size += Notifier::maskWords(count) * sizeof(std::uint64_t);
+  }
+  return size;
+}
+
+auto readHeader(std::span<const char> bytes) -> FrameHeader {
+  const char *in = bytes.data();
+  return {
+      .size = load<std::uint32_t>(in),
+      .type = static_cast<FrameType>(in[4]),
+      .code = static_cast<std::uint8_t>(in[5]),
+      .flags = static_cast<std::uint8_t>(in[6]),
+      .labelLength = static_cast<std::uint8_t>(in[7]),
+      .id = load<std::uint32_t>(in + 8),
+      .count = load<std::uint32_t>(in + 12),
+  };
+}
+
+void writeHeader(char *out, const FrameHeader &header) {
+  store(out, header.size);
+  out[4] = static_cast<char>(header.type);
+  out[5] = static_cast<char>(header.code);
+  out[6] = static_cast<char>(header.flags);
+  out[7] = static_cast<char>(header.labelLength);
+  store(out + 8, header.id);
+  store(out + 12, header.count);
+}
+
+void appendRequest(std::vector<char> &out, const Request &request) {
+  if (request.lhs.size() != request.rhs.size()) {
+    throw std::invalid_argument("wire: operand spans do not match");
+  }
+  if (request.label.size() > kMaxLabelLength) {
+    throw std::invalid_argument("wire: label is too long");
+  }
+  const std::size_t count = request.lhs.size();
+  const std::size_t size = requestSize(request.label.size(), count);
+  if (size > UINT32_MAX) {
+    throw std::invalid_argument("wire: request is too large");
+  }
+  char *frame = grow(out, size);
+  writeHeader(frame,
+              {.size = static_cast<std::uint32_t>(size),
+               .type = FrameType::Request,
+               .code = static_cast<std::uint8_t>(request.operation),
+               .flags = request.flags,
+               .labelLength = static_cast<std::uint8_t>(request.label.size()),
+               .id = request.id,
+               .count = static_cast<std::uint32_t>(count)});
+  char *body = frame + kHeaderSize;
+  std::copy(request.label.begin(), request.label.end(), body);
+  body += padded(request.label.size());
+  if (count != 0) {
+    std::memcpy(body, request.lhs.data(), count * sizeof(int));
+    std::memcpy(body + count * sizeof(int), request.rhs.data(),
+                count * sizeof(int));
+  }
+}
+
+auto parseRequest(std::span<const char> frame) -> RequestView {
+  const FrameHeader header = checkFrame(frame, FrameType::Request);
+  if (header.size != requestSize(header.labelLength, header.count)) {
+    throwMalformed("request size does not match its operands");
+  }
+  const char *body = frame.data() + kHeaderSize;
+  const char *lhs = body + padded(header.labelLength);
+  // The frame starts 8-byte aligned, so lhs and rhs are int-aligned.
+  return {header,
+          {body, header.labelLength},
+          {reinterpret_cast<const int *>(lhs), header.count},
+          {reinterpret_cast<const int *>(lhs) + header.count, header.count}};
+}
+
+void appendError(std::vector<char> &out, std::uint32_t id, Status status,
+                 std::string_view message) {
+  const std::size_t size = kHeaderSize + padded(message.size());
+  char *frame = grow(out, size);
+  writeHeader(frame, {.size = static_cast<std::uint32_t>(size),
+                      .type = FrameType::Response,
+                      .code = static_cast<std::uint8_t>(status),
+                      .id = id});
+  std::copy(message.begin(), message.end(), frame + kHeaderSize);
+}
+
+auto parseResponse(std::span<const char> frame) -> Response {
+  const FrameHeader header = checkFrame(frame, FrameType::Response);
+  Response response;
+  response.id = header.id;
+  response.status = static_cast<Status>(header.code);
+  response.count = header.count;
+  const char *body = frame.data() + kHeaderSize;
+  if (response.status != Status::Ok) {
+    const std::string_view message(body, frame.size() - kHeaderSize);
+    // Drop the zero padding.
+    response.error = message.substr(0, message.find('\0'));
+    return response;
+  }
+  if (header.size != responseSize(header.flags, header.count)) {
+    throwMalformed("response size does not match its flags");
+  }
+  response.logged = load<std::uint32_t>(body);
+  response.notified = load<std::uint32_t>(body + 4);
+  body += kResponseCounters;
+  if ((header.flags & kWantResults) != 0) {
+    response.results.resize(header.count);
+    std::memcpy(response.results.data(), body, header.count * sizeof(int));
+    body += padded(header.count * sizeof(int));
+  }
+  if ((header.flags & kWantMask) != 0) {
+    response.mask.resize(Notifier::maskWords(header.count));
+    std::memcpy(response.mask.data(), body,
+                response.mask.size() * sizeof(std::uint64_t));
+  }
+  return response;
+}
+
+} // namespace wire
@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Component trace spans are compiled in only with -DENABLE_TRACING=ON,
+// which defines MY_CODE_TRACING; without it the span macros expand to
+// nothing. Compiled in, a span costs one relaxed load until a capture is
+// started with Tracer::global().start().
+#ifdef MY_CODE_TRACING
+#define MY_CODE_TRACE_CONCAT_(a, b) a##b
+#define MY_CODE_TRACE_CONCAT(a, b) MY_CODE_TRACE_CONCAT_(a, b)
+// Records the enclosing scope as a span. name must be a string literal.
+#define MY_CODE_TRACE_SPAN(name)                                             \
+  const TraceSpan MY_CODE_TRACE_CONCAT(myCodeTraceSpan, __LINE__)(name)
+// Same, tagged with the number of items the scope handles.
+#define MY_CODE_TRACE_SPAN_ITEMS(name, items)                                \
+  const TraceSpan MY_CODE_TRACE_CONCAT(myCodeTraceSpan, __LINE__)(          \
+      name, static_cast<std::uint64_t>(items))
+#define MY_CODE_TRACE_THREAD_NAME(name) Tracer::setThreadName(name)
+#else
+#define MY_CODE_TRACE_SPAN(name) static_cast<void>(0)
+#define MY_CODE_TRACE_SPAN_ITEMS(name, items) static_cast<void>(0)
+#define MY_CODE_TRACE_THREAD_NAME(name) static_cast<void>(0)
+#endif
+
+// One finished span. Times are steady_clock nanoseconds.
+struct TraceEvent {
+  const char *name = nullptr;
+  std::int64_t start = 0;
+  std::int64_t end = 0;
+  std::uint64_t items = 0;
+};
+
+struct TraceOptions {
+  // Events kept per thread and capture; later ones are counted as dropped.
+  std::size_t eventsPerThread = std::size_t{1} << 16U;
+};
+
+// Events of one capture, grouped by the thread that recorded them.
+struct TraceCapture {
+  struct Thread {
+    // Small sequential id, stable for the thread's lifetime.
+    std::uint32_t id = 0;
+    std::string name;
+    // In the order the spans finished (inner spans before outer ones).
+    std::vector<TraceEvent> events;
+    std::uint64_t dropped = 0;
+  };
+
+  // steady_clock nanoseconds at start(); exported timestamps are relative
+  // to it.
+  std::int64_t origin = 0;
+  std::vector<Thread> threads;
+};
+
+// Process-wide span recorder. Every thread appends to its own fixed-size
+// buffer with no locks or read-modify-write operations; capture() may run
+// while threads keep recording and sees every event finished before it.
+class Tracer {
+public:
+  ~Tracer();
+  Tracer(const Tracer &) = delete;
+  auto operator=(const Tracer &) -> Tracer & = delete;
+  Tracer(Tracer &&) = delete;
+  auto operator=(Tracer &&) -> Tracer & = delete;
+
+  // Never destroyed, so threads exiting during static destruction can still
+  // finish their spans.
+  static auto global() -> Tracer & {
+    static Tracer *const instance = new Tracer();
+    return *instance;
+  }
+
+  // Begins a new capture, discarding the previous one.
+  void start(TraceOptions options = {});
+  // Stops recording new spans; spans already open still finish.
+  void stop();
+  [[nodiscard]] auto active() const -> bool {
+    return active_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] auto capture() const -> TraceCapture;
+
+  // Appends event to the calling thread's buffer for the current capture.
+  void record(const TraceEvent &event);
+  // Names the calling thread in exported traces.
+  static void setThreadName(std::string name);
+
+private:
+  struct ThreadBuffer;
+  Tracer();
+  auto localBuffer() -> ThreadBuffer &;
+
+  std::atomic<bool> active_{false};
+  std::atomic<std::uint64_t> epoch_{0};
+  std::atomic<std::size_t> capacity_{TraceOptions{}.eventsPerThread};
+  std::int64_t origin_ = 0;
+
+  // Guards the buffer list, thread names and captures.
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+  std::uint32_t nextThreadId_ = 0;
+};
+
+// Records the time between construction and destruction as a span on the
+// global tracer, if a capture was active at construction.
+class TraceSpan {
+public:
+  explicit TraceSpan(const char *name, std::uint64_t items = 0)
+      : name_(name), items_(items),
+        start_(Tracer::global().active() ? now() : 0) {}
+  ~TraceSpan() {
+    if (start_ != 0) {
+      Tracer::global().record({name_, start_, now(), items_});
+    }
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  auto operator=(const TraceSpan &) -> TraceSpan & = delete;
+  TraceSpan(TraceSpan &&) = delete;
+  auto operator=(TraceSpan &&) -> TraceSpan & = delete;
+
+private:
+  static auto now() -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  const char *name_;
+  std::uint64_t items_;
+  std::int64_t start_;
+};
+
+// Chrome trace event JSON ("X" complete events plus thread names), for
+// chrome://tracing and ui.perfetto.dev.
+auto formatChromeTrace(const TraceCapture &capture) -> std::string;
+// Binary Perfetto trace (perfetto.protos.Trace): one track per thread with
+// slice begin/end events, for ui.perfetto.dev and trace_processor.
+auto formatPerfettoTrace(const TraceCapture &capture) -> std::string;
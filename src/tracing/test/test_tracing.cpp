@@ -0,0 +1,247 @@
+#include "tracing.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef MY_CODE_TRACING
+#include "calculator.hpp"
+#include "logger.hpp"
+#include "notifier.hpp"
+#include "pipeline.hpp"
+#endif
+
+namespace {
+
+auto findThread(const TraceCapture &capture, std::string_view name)
+    -> const TraceCapture::Thread * {
+  for (const TraceCapture::Thread &thread : capture.threads) {
+    for (const TraceEvent &event : thread.events) {
+      if (event.name == name) {
+        return &thread;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// Reads one protobuf varint from data at offset, advancing it.
+auto readVarint(std::string_view data, std::size_t &offset) -> std::uint64_t {
+  std::uint64_t value = 0;
+  for (unsigned shift = 0; offset < data.size(); shift += 7) {
+    const auto byte = static_cast<unsigned char>(data[offset++]);
+    value |= std::uint64_t{byte & 0x7FU} << shift;
+    if ((byte & 0x80U) == 0) {
+      break;
+    }
+  }
+  return value;
+}
+
+// Splits a message into (field, payload) pairs; varint payloads are
+// returned re-encoded as their decimal value.
+auto fields(std::string_view message)
+    -> std::vector<std::pair<std::uint32_t, std::string>> {
+  std::vector<std::pair<std::uint32_t, std::string>> result;
+  std::size_t offset = 0;
+  while (offset < message.size()) {
+    const std::uint64_t key = readVarint(message, offset);
+    const auto field = static_cast<std::uint32_t>(key >> 3U);
+    if ((key & 7U) == 0) {
+      result.emplace_back(field, std::to_string(readVarint(message, offset)));
+    } else {
+      const auto size =
+          static_cast<std::size_t>(readVarint(message, offset));
+      result.emplace_back(field, std::string(message.substr(offset, size)));
+      offset += size;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+TEST(TracingTests, TestNestedSpansAreCaptured) {
+  Tracer &tracer = Tracer::global();
+  { const TraceSpan ignored("before start"); }
+  tracer.start();
+  {
+    const TraceSpan outer("outer", 8);
+    { const TraceSpan inner("inner", 3); }
+  }
+  tracer.stop();
+  { const TraceSpan ignored("after stop"); }
+
+  const TraceCapture capture = tracer.capture();
+  const TraceCapture::Thread *thread = findThread(capture, "outer");
+  ASSERT_NE(thread, nullptr);
+  ASSERT_EQ(thread->events.size(), 2U);
+  const TraceEvent &inner = thread->events[0];
+  const TraceEvent &outer = thread->events[1];
+  EXPECT_STREQ(inner.name, "inner");
+  EXPECT_EQ(inner.items, 3U);
+  EXPECT_EQ(outer.items, 8U);
+  EXPECT_GE(outer.start, capture.origin);
+  EXPECT_LE(outer.start, inner.start);
+  EXPECT_LE(inner.end, outer.end);
+  EXPECT_EQ(thread->dropped, 0U);
+
+  // A new capture starts empty.
+  tracer.start();
+  tracer.stop();
+  EXPECT_EQ(findThread(tracer.capture(), "outer"), nullptr);
+}
+
+TEST(TracingTests, TestThreadsRecordIntoTheirOwnBuffers) {
+  Tracer &tracer = Tracer::global();
+  tracer.start();
+  constexpr int kThreads = 4;
+  constexpr int kSpans = 1000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([t] {
+      std::string name(1, 'w');
+      name += std::to_string(t);
+      Tracer::setThreadName(name);
+      for (int i = 0; i < kSpans; ++i) {
+        const TraceSpan span("worker span");
+      }
+    });
+  }
+  // Capturing while the workers record is safe.
+  static_cast<void>(tracer.capture());
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  tracer.stop();
+
+  const TraceCapture capture = tracer.capture();
+  std::set<std::string> names;
+  std::set<std::uint32_t> ids;
+  for (const TraceCapture::Thread &thread : capture.threads) {
+    if (thread.events.empty() ||
+        std::string_view(thread.events.front().name) != "worker span") {
+      continue;
+    }
+    EXPECT_EQ(thread.events.size(), std::size_t{kSpans});
+    names.insert(thread.name);
+    ids.insert(thread.id);
+  }
+  EXPECT_EQ(names, (std::set<std::string>{"w0", "w1", "w2", "w3"}));
+  EXPECT_EQ(ids.size(), std::size_t{kThreads});
+}
+
+TEST(TracingTests, TestFullBufferCountsDroppedEvents) {
+  Tracer &tracer = Tracer::global();
+  tracer.start({.eventsPerThread = 4});
+  for (int i = 0; i < 10; ++i) {
+    const TraceSpan span("bounded");
+  }
+  tracer.stop();
+  const TraceCapture capture = tracer.capture();
+  const TraceCapture::Thread *thread = findThread(capture, "bounded");
+  ASSERT_NE(thread, nullptr);
+  EXPECT_EQ(thread->events.size(), 4U);
+  EXPECT_EQ(thread->dropped, 6U);
+
+  // The next capture uses the default capacity again.
+  tracer.start();
+  for (int i = 0; i < 10; ++i) {
+    const TraceSpan span("bounded");
+  }
+  tracer.stop();
+  EXPECT_EQ(findThread(tracer.capture(), "bounded")->events.size(), 10U);
+}
+
+TEST(TracingTests, TestChromeTraceFormat) {
+  TraceCapture capture;
+  capture.origin = 1'000'000;
+  capture.threads.push_back(
+      {3, "main \"thread\"", {{"span", 1'001'500, 1'004'000, 42}}, 0});
+  const std::string json = formatChromeTrace(capture);
+  EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0),
+            0U);
+  EXPECT_NE(json.find("\"name\":\"thread_name\",\"ph\":\"M\""),
+            std::string::npos);
+  EXPECT_NE(json.find("\"args\":{\"name\":\"main \\\"thread\\\"\"}"),
+            std::string::npos);
+  EXPECT_NE(json.find("{\"name\":\"span\",\"cat\":\"my_code\",\"ph\":\"X\","
+                      "\"ts\":1.500,\"dur\":2.500,"),
+            std::string::npos);
+  EXPECT_NE(json.find("\"tid\":3,\"args\":{\"items\":42}}"),
+            std::string::npos);
+  EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+}
+
+TEST(TracingTests, TestPerfettoTraceNestsSlices) {
+  TraceCapture capture;
+  capture.origin = 100;
+  capture.threads.push_back({0,
+                             "worker",
+                             {{"inner", 120, 130, 0},
+                              {"second", 140, 150, 0},
+                              {"outer", 110, 160, 5}},
+                             0});
+  const std::string trace = formatPerfettoTrace(capture);
+
+  std::size_t descriptors = 0;
+  std::vector<std::string> order;
+  std::vector<std::uint64_t> timestamps;
+  for (const auto &[field, packet] : fields(trace)) {
+    ASSERT_EQ(field, 1U);
+    for (const auto &[packetField, payload] : fields(packet)) {
+      if (packetField == 60) {
+        ++descriptors;
+      } else if (packetField == 8) {
+        timestamps.push_back(std::stoull(payload));
+      } else if (packetField == 11) {
+        std::string entry;
+        for (const auto &[eventField, value] : fields(payload)) {
+          if (eventField == 9) {
+            entry.insert(0, value == "1" ? "B:" : "E");
+          } else if (eventField == 23) {
+            entry += value;
+          }
+        }
+        order.push_back(entry);
+      }
+    }
+  }
+  EXPECT_EQ(descriptors, 2U);
+  EXPECT_EQ(order, (std::vector<std::string>{"B:outer", "B:inner", "E",
+                                             "B:second", "E", "E"}));
+  EXPECT_EQ(timestamps,
+            (std::vector<std::uint64_t>{10, 20, 30, 40, 50, 60}));
+}
+
+#ifdef MY_CODE_TRACING
+TEST(TracingTests, TestComponentHooksRecordSpans) {
+  Logger logger;
+  Notifier notifier(10);
+  Pipeline pipeline(logger, notifier, {.batchSize = 64});
+  const std::vector<int> lhs(100, 4);
+  const std::vector<int> rhs(100, 3);
+
+  Tracer &tracer = Tracer::global();
+  tracer.start();
+  pipeline.process(Operation::Add, "add", lhs, rhs);
+  tracer.stop();
+
+  const TraceCapture capture = tracer.capture();
+  const TraceCapture::Thread *thread =
+      findThread(capture, "Pipeline::process");
+  ASSERT_NE(thread, nullptr);
+  std::multiset<std::string_view> names;
+  for (const TraceEvent &event : thread->events) {
+    names.insert(event.name);
+  }
+  EXPECT_EQ(names.count("Pipeline::calculate"), 2U);
+  EXPECT_EQ(names.count("Calculator::add"), 2U);
+  EXPECT_EQ(names.count("Logger::logOperations"), 2U);
+  EXPECT_EQ(names.count("Notifier::shouldNotify"), 2U);
+  EXPECT_EQ(thread->events.back().items, lhs.size());
+}
+#endif
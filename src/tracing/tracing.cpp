@@ -0,0 +1,371 @@
+#include "tracing.hpp"
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+
+// Buffers are written by their owning thread only. Within a capture the
+// owner stores an event and then publishes it with a release store of
+// count; capture() reads count with acquire and copies the events below
+// it, which the owner never rewrites during that capture. A new capture
+// bumps epoch_; each owner resets its own buffer when it first records in
+// the new epoch and publishes the reset through its buffer's epoch.
+struct Tracer::ThreadBuffer {
+  std::uint32_t id = 0;
+  std::string name;
+  std::atomic<std::uint64_t> epoch{0};
+  std::atomic<std::size_t> count{0};
+  std::atomic<std::uint64_t> dropped{0};
+  // Set once the owning thread has exited; the buffer is reclaimed by the
+  // next start().
+  std::atomic<bool> retired{false};
+  std::size_t capacity = 0;
+  std::unique_ptr<TraceEvent[]> events;
+};
+
+namespace {
+
+struct LocalBuffer {
+  LocalBuffer() = default;
+  ~LocalBuffer() {
+    if (retired != nullptr) {
+      retired->store(true, std::memory_order_release);
+    }
+  }
+  LocalBuffer(const LocalBuffer &) = delete;
+  auto operator=(const LocalBuffer &) -> LocalBuffer & = delete;
+  LocalBuffer(LocalBuffer &&) = delete;
+  auto operator=(LocalBuffer &&) -> LocalBuffer & = delete;
+
+  void *buffer = nullptr;
+  std::atomic<bool> *retired = nullptr;
+};
+
+thread_local LocalBuffer localBufferSlot;
+
+auto steadyNow() -> std::int64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void appendJsonString(std::string &out, std::string_view text) {
+  out.push_back('"');
+  for (const char c : text) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        constexpr std::string_view kHex = "0123456789abcdef";
+        out += "\\u00";
+        out.push_back(kHex[static_cast<unsigned char>(c) >> 4U]);
+        out.push_back(kHex[static_cast<unsigned char>(c) & 0xFU]);
+      } else {
+        out.push_back(c);
+      }
+    }
+  }
+  out.push_back('"');
+}
+
+template <class T> void appendInteger(std::string &out, T value) {
+  char buffer[24];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  static_cast<void>(ec);
+  out.append(buffer, end);
+}
+
+// Chrome trace timestamps are microseconds; keep nanosecond precision.
+void appendMicroseconds(std::string &out, std::int64_t nanoseconds) {
+  char buffer[32];
+  const auto [end, ec] =
+      std::to_chars(buffer, buffer + sizeof(buffer),
+                    static_cast<double>(nanoseconds) / 1000.0,
+                    std::chars_format::fixed, 3);
+  static_cast<void>(ec);
+  out.append(buffer, end);
+}
+
+// Minimal protobuf wire-format writer for the Perfetto trace messages.
+void putVarint(std::string &out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+    value >>= 7U;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void putVarintField(std::string &out, std::uint32_t field,
+                    std::uint64_t value) {
+  putVarint(out, std::uint64_t{field} << 3U);
+  putVarint(out, value);
+}
+
+void putBytesField(std::string &out, std::uint32_t field,
+                   std::string_view bytes) {
+  putVarint(out, (std::uint64_t{field} << 3U) | 2U);
+  putVarint(out, bytes.size());
+  out.append(bytes);
+}
+
+// Field numbers from perfetto/protos/perfetto/trace.
+namespace proto {
+constexpr std::uint32_t kTracePacket = 1;
+constexpr std::uint32_t kPacketTimestamp = 8;
+constexpr std::uint32_t kPacketSequenceId = 10;
+constexpr std::uint32_t kPacketTrackEvent = 11;
+constexpr std::uint32_t kPacketTrackDescriptor = 60;
+constexpr std::uint32_t kTrackUuid = 1;
+constexpr std::uint32_t kTrackName = 2;
+constexpr std::uint32_t kTrackProcess = 3;
+constexpr std::uint32_t kTrackThread = 4;
+constexpr std::uint32_t kTrackParentUuid = 5;
+constexpr std::uint32_t kProcessPid = 1;
+constexpr std::uint32_t kThreadPid = 1;
+constexpr std::uint32_t kThreadTid = 2;
+constexpr std::uint32_t kThreadName = 5;
+constexpr std::uint32_t kEventDebugAnnotation = 4;
+constexpr std::uint32_t kEventType = 9;
+constexpr std::uint32_t kEventTrackUuid = 11;
+constexpr std::uint32_t kEventName = 23;
+constexpr std::uint32_t kAnnotationUint = 3;
+constexpr std::uint32_t kAnnotationName = 10;
+constexpr std::uint64_t kSliceBegin = 1;
+constexpr std::uint64_t kSliceEnd = 2;
+constexpr std::uint64_t kSequenceId = 1;
+} // namespace proto
+
+void putPacket(std::string &out, const std::string &packet) {
+  putBytesField(out, proto::kTracePacket, packet);
+}
+
+auto threadUuid(std::uint32_t id) -> std::uint64_t {
+  // 1 is the process track.
+  return std::uint64_t{id} + 2;
+}
+
+} // namespace
+
+Tracer::Tracer() = default;
+Tracer::~Tracer() = default;
+
+auto Tracer::localBuffer() -> ThreadBuffer & {
+  if (localBufferSlot.buffer == nullptr) {
+    auto buffer = std::make_unique<ThreadBuffer>();
+    const std::lock_guard guard(mutex_);
+    buffer->id = nextThreadId_++;
+    localBufferSlot.buffer = buffer.get();
+    localBufferSlot.retired = &buffer->retired;
+    buffers_.push_back(std::move(buffer));
+  }
+  return *static_cast<ThreadBuffer *>(localBufferSlot.buffer);
+}
+
+void Tracer::start(TraceOptions options) {
+  const std::lock_guard guard(mutex_);
+  std::erase_if(buffers_, [](const std::unique_ptr<ThreadBuffer> &buffer) {
+    return buffer->retired.load(std::memory_order_acquire);
+  });
+  capacity_.store(std::max<std::size_t>(options.eventsPerThread, 1),
+                  std::memory_order_relaxed);
+  origin_ = steadyNow();
+  epoch_.fetch_add(1, std::memory_order_release);
+  active_.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop() { active_.store(false, std::memory_order_relaxed); }
+
+void Tracer::record(const TraceEvent &event) {
+  ThreadBuffer &buffer = localBuffer();
+  const std::uint64_t epoch = epoch_.load(std::memory_order_acquire);
+  if (buffer.epoch.load(std::memory_order_relaxed) != epoch) {
+    const std::size_t capacity = capacity_.load(std::memory_order_relaxed);
+    if (buffer.capacity != capacity) {
+      buffer.events = std::make_unique<TraceEvent[]>(capacity);
+      buffer.capacity = capacity;
+    }
+    buffer.count.store(0, std::memory_order_relaxed);
+    buffer.dropped.store(0, std::memory_order_relaxed);
+    buffer.epoch.store(epoch, std::memory_order_release);
+  }
+  const std::size_t count = buffer.count.load(std::memory_order_relaxed);
+  if (count == buffer.capacity) {
+    buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    return;
+  }
+  buffer.events[count] = event;
+  buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(std::string name) {
+  Tracer &tracer = global();
+  ThreadBuffer &buffer = tracer.localBuffer();
+  const std::lock_guard guard(tracer.mutex_);
+  buffer.name = std::move(name);
+}
+
+auto Tracer::capture() const -> TraceCapture {
+  const std::lock_guard guard(mutex_);
+  const std::uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+  TraceCapture result;
+  result.origin = origin_;
+  for (const auto &buffer : buffers_) {
+    TraceCapture::Thread thread;
+    thread.id = buffer->id;
+    thread.name = buffer->name;
+    if (buffer->epoch.load(std::memory_order_acquire) == epoch) {
+      const std::size_t count = buffer->count.load(std::memory_order_acquire);
+      // Spans opened during an earlier capture may finish in this one.
+      std::copy_if(buffer->events.get(), buffer->events.get() + count,
+                   std::back_inserter(thread.events),
+                   [this](const TraceEvent &event) {
+                     return event.start >= origin_;
+                   });
+      thread.dropped = buffer->dropped.load(std::memory_order_relaxed);
+    }
+    if (!thread.events.empty() || thread.dropped != 0) {
+      result.threads.push_back(std::move(thread));
+    }
+  }
+  return result;
+}
+
+auto formatChromeTrace(const TraceCapture &capture) -> std::string {
+  const auto pid = static_cast<std::int64_t>(::getpid());
+  std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  const auto separator = [&] {
+    if (!first) {
+      out.push_back(',');
+    }
+    first = false;
+  };
+  for (const TraceCapture::Thread &thread : capture.threads) {
+    if (!thread.name.empty()) {
+      separator();
+      out += "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":";
+      appendInteger(out, pid);
+      out += ",\"tid\":";
+      appendInteger(out, thread.id);
+      out += ",\"args\":{\"name\":";
+      appendJsonString(out, thread.name);
+      out += "}}";
+    }
+    for (const TraceEvent &event : thread.events) {
+      separator();
+      out += "\n{\"name\":";
+      appendJsonString(out, event.name);
+      out += ",\"cat\":\"my_code\",\"ph\":\"X\",\"ts\":";
+      appendMicroseconds(out, event.start - capture.origin);
+      out += ",\"dur\":";
+      appendMicroseconds(out, event.end - event.start);
+      out += ",\"pid\":";
+      appendInteger(out, pid);
+      out += ",\"tid\":";
+      appendInteger(out, thread.id);
+      if (event.items != 0) {
+        out += ",\"args\":{\"items\":";
+        appendInteger(out, event.items);
+        out.push_back('}');
+      }
+      out.push_back('}');
+    }
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+auto formatPerfettoTrace(const TraceCapture &capture) -> std::string {
+  const auto pid = static_cast<std::uint64_t>(::getpid());
+  std::string out;
+  std::string packet;
+  std::string message;
+  std::string nested;
+
+  // Process track, then one thread track per buffer.
+  message.clear();
+  putVarintField(message, proto::kTrackUuid, 1);
+  nested.clear();
+  putVarintField(nested, proto::kProcessPid, pid);
+  putBytesField(message, proto::kTrackProcess, nested);
+  packet.clear();
+  putBytesField(packet, proto::kPacketTrackDescriptor, message);
+  putVarintField(packet, proto::kPacketSequenceId, proto::kSequenceId);
+  putPacket(out, packet);
+
+  for (const TraceCapture::Thread &thread : capture.threads) {
+    message.clear();
+    putVarintField(message, proto::kTrackUuid, threadUuid(thread.id));
+    putVarintField(message, proto::kTrackParentUuid, 1);
+    if (!thread.name.empty()) {
+      putBytesField(message, proto::kTrackName, thread.name);
+    }
+    nested.clear();
+    putVarintField(nested, proto::kThreadPid, pid);
+    putVarintField(nested, proto::kThreadTid, std::uint64_t{thread.id} + 1);
+    if (!thread.name.empty()) {
+      putBytesField(nested, proto::kThreadName, thread.name);
+    }
+    putBytesField(message, proto::kTrackThread, nested);
+    packet.clear();
+    putBytesField(packet, proto::kPacketTrackDescriptor, message);
+    putVarintField(packet, proto::kPacketSequenceId, proto::kSequenceId);
+    putPacket(out, packet);
+
+    // Slices must be emitted as properly nested begin/end pairs in time
+    // order: walk the spans by start (longest first on ties) with a stack
+    // of open ends.
+    std::vector<TraceEvent> spans = thread.events;
+    std::sort(spans.begin(), spans.end(),
+              [](const TraceEvent &lhs, const TraceEvent &rhs) {
+                return lhs.start != rhs.start ? lhs.start < rhs.start
+                                              : lhs.end > rhs.end;
+              });
+    const auto slice = [&](std::int64_t timestamp, std::uint64_t type,
+                           const TraceEvent *event) {
+      message.clear();
+      putVarintField(message, proto::kEventType, type);
+      putVarintField(message, proto::kEventTrackUuid, threadUuid(thread.id));
+      if (event != nullptr) {
+        putBytesField(message, proto::kEventName, event->name);
+        if (event->items != 0) {
+          nested.clear();
+          putBytesField(nested, proto::kAnnotationName, "items");
+          putVarintField(nested, proto::kAnnotationUint, event->items);
+          putBytesField(message, proto::kEventDebugAnnotation, nested);
+        }
+      }
+      packet.clear();
+      putVarintField(packet, proto::kPacketTimestamp,
+                     static_cast<std::uint64_t>(timestamp - capture.origin));
+      putBytesField(packet, proto::kPacketTrackEvent, message);
+      putVarintField(packet, proto::kPacketSequenceId, proto::kSequenceId);
+      putPacket(out, packet);
+    };
+    std::vector<std::int64_t> open;
+    for (const TraceEvent &span : spans) {
+      while (!open.empty() && open.back() <= span.start) {
+        slice(open.back(), proto::kSliceEnd, nullptr);
+        open.pop_back();
+      }
+      slice(span.start, proto::kSliceBegin, &span);
+      open.push_back(span.end);
+    }
+    while (!open.empty()) {
+      slice(open.back(), proto::kSliceEnd, nullptr);
+      open.pop_back();
+    }
+  }
+  return out;
+}
@@ -1,7 +1,9 @@
 #include "calculator.hpp"
 #include "logger.hpp"
 #include "notifier.hpp"
+#include "pipeline.hpp"
 #include "gtest/gtest.h"
+#include <vector>
 
 // Full scenario: Calculate, log, notify if threshold exceeded
 constexpr int kMultiplier1 = 5;
@@ -9,7 +11,6 @@ constexpr int kMultiplier2 = 3;
 constexpr int kThreshold = 10;
 
 TEST(EndToEndTests, FullFlow) {
-  const Calculator calc;
   const Logger logger;
   const Notifier notifier(kThreshold);
 
@@ -27,3 +28,20 @@ TEST(EndToEndTests, FullFlow) {
   EXPECT_EQ(notifier.notifyMessage(result), "Threshold exceeded! Value: 15");
   return;
 }
+
+TEST(EndToEndTests, PipelineFlow) {
+  const Logger logger;
+  const Notifier notifier(kThreshold);
+  Pipeline pipeline(logger, notifier);
+
+  const std::vector<int> lhs{kMultiplier1, 2};
+  const std::vector<int> rhs{kMultiplier2, 2};
+  const PipelineResult outcome =
+      pipeline.process(Operation::Multiply, "5 * 3", lhs, rhs);
+  EXPECT_EQ(outcome.processed, 2U);
+  EXPECT_EQ(outcome.notified, 1U);
+
+  auto logs = logger.getLogs();
+  ASSERT_EQ(logs.size(), 2U);
+  EXPECT_EQ(logs[0], "5 * 3 = 15");
+}
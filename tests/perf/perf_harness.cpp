@@ -0,0 +1,321 @@
+#include "perf_harness.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+namespace perf {
+
+namespace {
+
+struct Entry {
+  double value = 0;
+  std::string unit;
+  double tolerance = 0;
+  bool lowerIsBetter = false;
+};
+
+using Entries = std::map<std::string, Entry>;
+
+// Timings are noisy on shared machines; allocation sizes are not.
+constexpr double kDefaultTolerance = 0.5;
+constexpr double kMemoryTolerance = 0.1;
+
+// Reads the flat subset of JSON the baseline uses: nested objects whose
+// leaves are numbers, strings or booleans. Throws std::runtime_error.
+class Reader {
+public:
+  explicit Reader(std::string_view text) : text_(text) {}
+
+  auto parse() -> Entries {
+    Entries entries;
+    expect('{');
+    if (!consume('}')) {
+      do {
+        const std::string key = string();
+        expect(':');
+        if (key == "metrics") {
+          metrics(entries);
+        } else {
+          skipValue();
+        }
+      } while (consume(','));
+      expect('}');
+    }
+    return entries;
+  }
+
+private:
+  void metrics(Entries &entries) {
+    expect('{');
+    if (consume('}')) {
+      return;
+    }
+    do {
+      const std::string name = string();
+      expect(':');
+      entries[name] = entry();
+    } while (consume(','));
+    expect('}');
+  }
+
+  auto entry() -> Entry {
+    Entry entry;
+    entry.tolerance = kDefaultTolerance;
+    expect('{');
+    if (consume('}')) {
+      return entry;
+    }
+    do {
+      const std::string key = string();
+      expect(':');
+      if (key == "value") {
+        entry.value = number();
+      } else if (key == "tolerance") {
+        entry.tolerance = number();
+      } else if (key == "unit") {
+        entry.unit = string();
+      } else if (key == "lower_is_better") {
+        entry.lowerIsBetter = boolean();
+      } else {
+        skipValue();
+      }
+    } while (consume(','));
+    expect('}');
+    return entry;
+  }
+
+  void skipValue() {
+    skipSpace();
+    if (consume('{')) {
+      if (!consume('}')) {
+        do {
+          (void)string();
+          expect(':');
+          skipValue();
+        } while (consume(','));
+        expect('}');
+      }
+    } else if (peek() == '"') {
+      (void)string();
+    } else if (peek() == 't' || peek() == 'f') {
+      (void)boolean();
+    } else {
+      (void)number();
+    }
+  }
+
+  auto string() -> std::string {
+    expect('"');
+    std::string out;
+    while (position_ < text_.size() && text_[position_] != '"') {
+      if (text_[position_] == '\\') {
+        ++position_;
+      }
+      if (position_ < text_.size()) {
+        out.push_back(text_[position_++]);
+      }
+    }
+    expect('"');
+    return out;
+  }
+
+  auto number() -> double {
+    skipSpace();
+    const std::size_t begin = position_;
+    while (position_ < text_.size() &&
+           (std::isdigit(static_cast<unsigned char>(text_[position_])) != 0 ||
+            std::string_view("+-.eE").find(text_[position_]) !=
+                std::string_view::npos)) {
+      ++position_;
+    }
+    const std::string digits(text_.substr(begin, position_ - begin));
+    char *end = nullptr;
+    const double value = std::strtod(digits.c_str(), &end);
+    if (digits.empty() || end != digits.c_str() + digits.size()) {
+      fail("number");
+    }
+    return value;
+  }
+
+  auto boolean() -> bool {
+    skipSpace();
+    for (const std::string_view word : {"true", "false"}) {
+      if (text_.substr(position_, word.size()) == word) {
+        position_ += word.size();
+        return word == "true";
+      }
+    }
+    fail("boolean");
+  }
+
+  void skipSpace() {
+    while (position_ < text_.size() &&
+           std::isspace(static_cast<unsigned char>(text_[position_])) != 0) {
+      ++position_;
+    }
+  }
+  auto peek() -> char {
+    skipSpace();
+    return position_ < text_.size() ? text_[position_] : '\0';
+  }
+  auto consume(char c) -> bool {
+    if (peek() != c) {
+      return false;
+    }
+    ++position_;
+    return true;
+  }
+  void expect(char c) {
+    if (!consume(c)) {
+      fail(std::string(1, c).c_str());
+    }
+  }
+  [[noreturn]] void fail(const char *expected) const {
+    throw std::runtime_error("perf: malformed JSON, expected " +
+                             std::string(expected) + " at offset " +
+                             std::to_string(position_));
+  }
+
+  std::string_view text_;
+  std::size_t position_ = 0;
+};
+
+auto readEntries(const std::string &path) -> std::optional<Entries> {
+  std::ifstream in(path);
+  if (!in) {
+    return std::nullopt;
+  }
+  const std::string text{std::istreambuf_iterator<char>(in), {}};
+  return Reader(text).parse();
+}
+
+auto baselinePath() -> std::string {
+  const char *path = std::getenv("MY_CODE_PERF_BASELINE");
+  return path != nullptr ? path : MY_CODE_PERF_BASELINE_FILE;
+}
+
+auto baseline() -> const Entries & {
+  static const Entries entries = [] {
+    const std::string path = baselinePath();
+    std::optional<Entries> loaded = readEntries(path);
+    if (!loaded) {
+      throw std::runtime_error("perf: cannot read baseline " + path);
+    }
+    return *std::move(loaded);
+  }();
+  return entries;
+}
+
+void writeEntries(const std::string &path, const Entries &entries) {
+  std::ostringstream out;
+  out.precision(6);
+  out << "{\n  \"metrics\": {";
+  const char *separator = "\n";
+  for (const auto &[name, entry] : entries) {
+    out << separator << "    \"" << name << "\": {\"value\": " << entry.value
+        << ", \"unit\": \"" << entry.unit
+        << "\", \"tolerance\": " << entry.tolerance;
+    if (entry.lowerIsBetter) {
+      out << ", \"lower_is_better\": true";
+    }
+    out << "}";
+    separator = ",\n";
+  }
+  out << "\n  }\n}\n";
+  std::ofstream(path, std::ios::trunc) << out.str();
+}
+
+// ctest runs every test in its own process, so results are merged into the
+// file rather than written once.
+void recordResult(const Metric &metric, const Entry *reference) {
+  const char *path = std::getenv("MY_CODE_PERF_RESULTS");
+  if (path == nullptr) {
+    return;
+  }
+  Entries results = readEntries(path).value_or(Entries{});
+  results[metric.name] = {
+      .value = metric.value,
+      .unit = metric.unit,
+      .tolerance = reference != nullptr ? reference->tolerance
+                   : metric.kind == Kind::Memory ? kMemoryTolerance
+                                                 : kDefaultTolerance,
+      .lowerIsBetter = metric.kind == Kind::Memory,
+  };
+  writeEntries(path, results);
+}
+
+} // namespace
+
+auto timingEnforced() -> bool {
+#ifdef MY_CODE_PERF_TIMING
+  return true;
+#else
+  return false;
+#endif
+}
+
+auto threadCounts() -> std::vector<std::size_t> {
+  const std::size_t cores =
+      std::max<std::size_t>(1, std::thread::hardware_concurrency());
+  std::vector<std::size_t> counts{1, 2, 4};
+  for (std::size_t count = 8; count <= cores; count *= 2) {
+    counts.push_back(count);
+  }
+  if (std::find(counts.begin(), counts.end(), cores) == counts.end()) {
+    counts.push_back(cores);
+  }
+  return counts;
+}
+
+auto check(const Metric &metric) -> ::testing::AssertionResult {
+  const Entries &entries = baseline();
+  const auto found = entries.find(metric.name);
+  const Entry *reference = found != entries.end() ? &found->second : nullptr;
+  recordResult(metric, reference);
+
+  std::ostringstream line;
+  line << metric.name << ": " << metric.value << ' ' << metric.unit;
+  if (reference == nullptr) {
+    std::printf("%s (no baseline)\n", line.str().c_str());
+    return ::testing::AssertionSuccess();
+  }
+  line << " (baseline " << reference->value << ", tolerance "
+       << reference->tolerance * 100 << "%)";
+  std::printf("%s\n", line.str().c_str());
+  if (metric.kind == Kind::Throughput && !timingEnforced()) {
+    return ::testing::AssertionSuccess();
+  }
+  const bool regressed =
+      reference->lowerIsBetter
+          ? metric.value > reference->value * (1 + reference->tolerance)
+          : metric.value < reference->value * (1 - reference->tolerance);
+  if (regressed) {
+    return ::testing::AssertionFailure() << "regression: " << line.str();
+  }
+  return ::testing::AssertionSuccess();
+}
+
+auto CountingResource::do_allocate(std::size_t bytes, std::size_t alignment)
+    -> void * {
+  void *pointer = upstream_->allocate(bytes, alignment);
+  outstanding_ += bytes;
+  peak_ = std::max(peak_, outstanding_);
+  return pointer;
+}
+
+void CountingResource::do_deallocate(void *pointer, std::size_t bytes,
+                                     std::size_t alignment) {
+  upstream_->deallocate(pointer, bytes, alignment);
+  outstanding_ -= bytes;
+}
+
+} // namespace perf
@@ -0,0 +1,97 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Support for the perf_tests scaling tests: best-of-N timing, allocation
+// high-water marks and comparison against tests/perf/baseline.json.
+//
+// The baseline maps metric names to {"value", "unit", "tolerance",
+// "lower_is_better"}. A metric fails when it is worse than its baseline by
+// more than the tolerance (a fraction of the value). Metrics without a
+// baseline entry are only reported, so new thread counts or workloads can be
+// added before their baseline is recorded.
+//
+// Environment:
+//   MY_CODE_PERF_BASELINE  baseline to compare against instead of the one
+//                          in the source tree.
+//   MY_CODE_PERF_RESULTS   file to write this run's metrics to, in the
+//                          baseline format (keeping baseline tolerances).
+//
+// Timing metrics are only compared when configured with ENABLE_PERF_TIMING
+// in an optimised, uninstrumented build (MY_CODE_PERF_TIMING); elsewhere
+// they are measured once and reported.
+namespace perf {
+
+enum class Kind {
+  Throughput, // higher is better; compared only with MY_CODE_PERF_TIMING
+  Memory,     // lower is better; always compared
+};
+
+struct Metric {
+  std::string name;
+  double value = 0;
+  std::string unit;
+  Kind kind = Kind::Throughput;
+};
+
+// Records metric for the results file and compares it with the baseline.
+auto check(const Metric &metric) -> ::testing::AssertionResult;
+
+// Whether timing metrics are compared in this build.
+auto timingEnforced() -> bool;
+
+// Fastest of repeated runs of body, in seconds: one run when timings are
+// not compared, otherwise enough runs to fill a short time budget.
+template <class Body> auto bestSeconds(const Body &body) -> double {
+  using Clock = std::chrono::steady_clock;
+  const int runs = timingEnforced() ? 7 : 1;
+  double best = 0;
+  for (int run = 0; run < runs; ++run) {
+    const auto start = Clock::now();
+    body();
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    if (run == 0 || seconds < best) {
+      best = seconds;
+    }
+  }
+  return best;
+}
+
+// 1, 2, 4 and every power of two up to hardware_concurrency(), followed by
+// hardware_concurrency() itself.
+auto threadCounts() -> std::vector<std::size_t>;
+
+// Forwards to an upstream resource and tracks the bytes outstanding and
+// their peak. Not synchronised.
+class CountingResource final : public std::pmr::memory_resource {
+public:
+  explicit CountingResource(
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+      : upstream_(upstream) {}
+
+  [[nodiscard]] auto outstanding() const -> std::size_t {
+    return outstanding_;
+  }
+  [[nodiscard]] auto peak() const -> std::size_t { return peak_; }
+
+private:
+  auto do_allocate(std::size_t bytes, std::size_t alignment)
+      -> void * override;
+  void do_deallocate(void *pointer, std::size_t bytes,
+                     std::size_t alignment) override;
+  [[nodiscard]] auto do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept -> bool override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource *upstream_;
+  std::size_t outstanding_ = 0;
+  std::size_t peak_ = 0;
+};
+
+} // namespace perf
@@ -0,0 +1,173 @@
+#include "logger.hpp"
+#include "notifier.hpp"
+#include "perf_harness.hpp"
+#include "pipeline.hpp"
+#include "scheduler.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <latch>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scaling tests: throughput against thread count and batch size, and the
+// allocation high-water mark against record count. Each fixed amount of work
+// is timed best-of-N; see perf_harness.hpp for the baseline comparison.
+
+namespace {
+
+constexpr std::size_t kLoggedRecords = 1 << 19;
+constexpr std::size_t kSchedulerTasks = 1 << 14;
+constexpr std::size_t kPipelineElements = 1 << 20;
+
+// Runs body(thread) on threads threads, released together, and returns once
+// all have finished.
+template <class Body> void runThreads(std::size_t threads, const Body &body) {
+  std::latch start(static_cast<std::ptrdiff_t>(threads));
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  for (std::size_t thread = 0; thread < threads; ++thread) {
+    workers.emplace_back([&, thread] {
+      start.arrive_and_wait();
+      body(thread);
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+auto operands(std::size_t count, int modulus) -> std::vector<int> {
+  std::vector<int> values(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    values[i] = static_cast<int>(i % static_cast<std::size_t>(modulus));
+  }
+  return values;
+}
+
+} // namespace
+
+// Writers share one bounded Logger, whose mutex is the contention point.
+TEST(PerfTests, LoggerThroughputByThreads) {
+  const OpId add = OperationTable::global().intern("add");
+  for (const std::size_t threads : perf::threadCounts()) {
+    const Logger logger(
+        LoggerOptions{.capacity = 1 << 16, .maxOperationLength = 0});
+    const double seconds = perf::bestSeconds([&] {
+      runThreads(threads, [&](std::size_t) {
+        for (std::size_t i = 0; i < kLoggedRecords / threads; ++i) {
+          logger.logOperation(add, static_cast<int>(i));
+        }
+      });
+    });
+    EXPECT_TRUE(perf::check(
+        {.name = "logger.threads." + std::to_string(threads),
+         .value = static_cast<double>(kLoggedRecords) / seconds,
+         .unit = "records/s"}));
+  }
+}
+
+// Many small tasks through one TaskGroup: the inbox, the deques and the
+// wakeups are the contention points.
+TEST(PerfTests, SchedulerThroughputByThreads) {
+  for (const std::size_t threads : perf::threadCounts()) {
+    Scheduler scheduler(SchedulerOptions{.threads = threads});
+    std::vector<std::uint64_t> sums(kSchedulerTasks);
+    const double seconds = perf::bestSeconds([&] {
+      TaskGroup group(scheduler);
+      for (std::size_t task = 0; task < kSchedulerTasks; ++task) {
+        group.run([&sums, task] {
+          std::uint64_t sum = 0;
+          for (std::uint64_t i = 0; i < 256; ++i) {
+            sum += i * task;
+          }
+          sums[task] = sum;
+        });
+      }
+      group.wait();
+    });
+    EXPECT_TRUE(perf::check(
+        {.name = "scheduler.threads." + std::to_string(threads),
+         .value = static_cast<double>(kSchedulerTasks) / seconds,
+         .unit = "tasks/s"}));
+  }
+}
+
+// One Pipeline per thread over a shared bounded Logger.
+TEST(PerfTests, PipelineThroughputByThreads) {
+  const std::vector<int> lhs = operands(kPipelineElements, 1000);
+  const std::vector<int> rhs = operands(kPipelineElements, 7);
+  const Notifier notifier(1500);
+  for (const std::size_t threads : perf::threadCounts()) {
+    const Logger logger(LoggerOptions{.capacity = 1 << 16});
+    const std::size_t share = kPipelineElements / threads;
+    const double seconds = perf::bestSeconds([&] {
+      runThreads(threads, [&](std::size_t thread) {
+        Pipeline pipeline(logger, notifier);
+        const std::span<const int> left(lhs);
+        const std::span<const int> right(rhs);
+        pipeline.process(Operation::Multiply, "mul",
+                         left.subspan(thread * share, share),
+                         right.subspan(thread * share, share));
+      });
+    });
+    EXPECT_TRUE(perf::check(
+        {.name = "pipeline.threads." + std::to_string(threads),
+         .value = static_cast<double>(share * threads) / seconds,
+         .unit = "elements/s"}));
+  }
+}
+
+// Small batches pay the per-chunk log and screen calls; large ones fall out
+// of cache before they are logged.
+TEST(PerfTests, PipelineThroughputByBatchSize) {
+  const std::vector<int> lhs = operands(kPipelineElements, 1000);
+  const std::vector<int> rhs = operands(kPipelineElements, 7);
+  const Notifier notifier(1500);
+  const Logger logger(LoggerOptions{.capacity = 1 << 16});
+  for (const std::size_t batch : {64, 256, 1024, 4096, 16384, 65536}) {
+    Pipeline pipeline(logger, notifier, PipelineOptions{.batchSize = batch});
+    const double seconds = perf::bestSeconds(
+        [&] { pipeline.process(Operation::Add, "add", lhs, rhs); });
+    EXPECT_TRUE(perf::check(
+        {.name = "pipeline.batch." + std::to_string(batch),
+         .value = static_cast<double>(kPipelineElements) / seconds,
+         .unit = "elements/s"}));
+  }
+}
+
+// Peak bytes held by an unbounded Logger per record, text records and
+// interned ones. Growth is geometric, so this stays flat as the history
+// grows; a rise means a copy or a leak on the append path.
+TEST(PerfTests, LoggerMemoryHighWaterByRecords) {
+  const OpId add = OperationTable::global().intern("add");
+  for (const std::size_t records : {1'000, 10'000, 100'000, 1'000'000}) {
+    perf::CountingResource text;
+    perf::CountingResource interned;
+    {
+      const Logger textLogger(LoggerOptions{.resource = &text});
+      const Logger internedLogger(LoggerOptions{.resource = &interned});
+      for (std::size_t i = 0; i < records; ++i) {
+        textLogger.logOperation("add", static_cast<int>(i));
+        internedLogger.logOperation(add, static_cast<int>(i));
+      }
+    }
+    EXPECT_EQ(text.outstanding(), 0u);
+    EXPECT_EQ(interned.outstanding(), 0u);
+    const auto perRecord = [records](const perf::CountingResource &counted) {
+      return static_cast<double>(counted.peak()) /
+             static_cast<double>(records);
+    };
+    EXPECT_TRUE(perf::check(
+        {.name = "logger.memory.text." + std::to_string(records),
+         .value = perRecord(text),
+         .unit = "bytes/record",
+         .kind = perf::Kind::Memory}));
+    EXPECT_TRUE(perf::check(
+        {.name = "logger.memory.interned." + std::to_string(records),
+         .value = perRecord(interned),
+         .unit = "bytes/record",
+         .kind = perf::Kind::Memory}));
+  }
+}